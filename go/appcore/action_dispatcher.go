@@ -5,6 +5,8 @@ import datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_mode
 // Action dispatcher wraps logic for dispatching actions. Some go straight to native libBindings, but some require some pre-work
 type actionDispatcher struct {
 	appcore *Appcore
+	// Dispatching on the ingest stage, see performNamedActionWithConfig
+	inline bool
 }
 
 func (ap *actionDispatcher) ShowBanner(banner *datamodel.BannerAction, actionName string) error {
@@ -33,13 +35,16 @@ func (ap *actionDispatcher) PerformConditionalAction(ca *datamodel.ConditionalAc
 		return err
 	}
 	if passed {
-		return ap.appcore.PerformNamedAction(ca.PassedActionName)
+		return ap.PerformNamedAction(ca.PassedActionName)
 	} else if ca.FailedActionName != "" {
-		return ap.appcore.PerformNamedAction(ca.FailedActionName)
+		return ap.PerformNamedAction(ca.FailedActionName)
 	}
 	return nil
 }
 
 func (ap *actionDispatcher) PerformNamedAction(actionName string) error {
-	return ap.appcore.PerformNamedAction(actionName)
+	if !ap.inline {
+		return ap.appcore.PerformNamedAction(actionName)
+	}
+	return ap.appcore.performNamedActionWithConfig(ap.appcore.config(), actionName, true)
 }
@@ -1,11 +1,14 @@
 package appcore
 
 import (
+	"crypto/sha256"
 	"encoding/json"
 	"errors"
 	"fmt"
 	"os"
 	"strings"
+	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
@@ -20,9 +23,9 @@ func GoPing() string {
 }
 
 type Appcore struct {
-	started bool
+	started atomic.Bool
 
-	// Library binding/delegate
+	// Library binding/delegate. Set before Start, then read without locking.
 	libBindings LibBindings
 
 	// API Key
@@ -30,38 +33,144 @@ type Appcore struct {
 
 	// Primary configuration
 	configUrlString string
-	config          *datamodel.PrimaryConfig
+	// Current config snapshot. Swapped atomically, never mutated.
+	loadedConfig atomic.Pointer[configSnapshot]
+	// Start with the cached config, and fetch updates after startup
+	staleWhileRevalidate    bool
+	needsConfigRevalidation bool
+	configRevalidation      sync.WaitGroup
 
 	// Cache
 	cache *cache
 
 	// database and events
-	db           *db.DB
+	db           db.Storage
 	eventManager *EventManager
+	// Ordered ingestion pipeline, created at Start. Capacity and backpressure are set before Start. See event_queue.go
+	eventQueue               *eventQueue
+	eventQueueCapacity       int
+	eventQueueRejectWhenFull bool
+	// Workers evaluating trigger conditions concurrently, 0 or 1 for serial. Set before Start. See trigger_evaluation.go
+	triggerEvaluationWorkers int
 
 	// Properties
 	propertyRegistry *propertyRegistry
 
-	// Notifications
+	// Notifications. Lock guards the plan, planner and cancelation cache, as the plan can be rebuilt in the background.
+	notificationLock      sync.Mutex
 	notificationPlan      *NotificationPlan
+	notificationPlanner   *notificationPlanner
 	seenCancelationEvents map[string]*bool
+	// Plan updates requested within this window are coalesced. See notification_plan_delivery.go
+	notificationPlanDebounce      time.Duration
+	notificationPlanUpdatePending bool
+	notificationPlanVersion       int64
 
 	// Allow forcing a specific parse mode for testing
 	forceParseModeForStrict *bool
+
+	// Current time for event processing and notification planning. Injectable for simulations; nil uses time.Now.
+	clock func() time.Time
+	// Runs f after d, for delayed work such as the notification plan debounce. Injected along with clock by tests;
+	// nil uses time.AfterFunc.
+	afterFunc func(d time.Duration, f func())
+
+	// Latency histograms for each processing stage. See instrumentation.go
+	instrumentation *instrumentation
+
+	// Startup stages, see startup.go. The DB is opened from SetDataDirPath, the rest from Start. dataDirLock guards
+	// the cache and openDBStage while they're set, as SetDataDirPath can be called from any thread.
+	dataDirLock   sync.Mutex
+	openDBStage   *startupStage
+	startupStages []*startupStage
+
+	// Nil unless recording a trace of the inputs. See event_trace.go
+	traceRecorder atomic.Pointer[traceRecorder]
+}
+
+// An immutable loaded config, along with metadata about the version loaded
+type configSnapshot struct {
+	config *datamodel.PrimaryConfig
+	// SHA-256 of the config file, identifies the exact config version loaded
+	sha256 string
+	// When this config was last confirmed to be current with the server (or loaded, for local files)
+	validatedAt time.Time
 }
 
 func NewAppcore() *Appcore {
+	return newAppcoreWithStorage(db.NewDB())
+}
+
+// Allows an alternate storage backend (such as db.MemoryDB) for simulations, benchmarks and tests
+func newAppcoreWithStorage(storage db.Storage) *Appcore {
+	in := newInstrumentation()
 	ac := &Appcore{
 		propertyRegistry:      newPropertyRegistry(),
-		db:                    db.NewDB(),
+		db:                    storage,
 		eventManager:          &EventManager{},
 		seenCancelationEvents: make(map[string]*bool),
+		notificationPlanner:   newNotificationPlanner(),
+
+		notificationPlanDebounce: defaultNotificationPlanDebounce,
+		eventQueueCapacity:       defaultEventQueueCapacity,
+		instrumentation:          in,
 	}
 	// Connect the property registry to the db/proptery history manager
 	ac.propertyRegistry.phm = ac.db.PropertyHistoryManager()
+	ac.propertyRegistry.instrumentation = in
+	ac.propertyRegistry.trace = &ac.traceRecorder
 	return ac
 }
 
+func (ac *Appcore) now() time.Time {
+	if ac.clock != nil {
+		return ac.clock()
+	}
+	return time.Now()
+}
+
+func (ac *Appcore) after(d time.Duration, f func()) {
+	if ac.afterFunc != nil {
+		ac.afterFunc(d, f)
+		return
+	}
+	time.AfterFunc(d, f)
+}
+
+// The current config, or nil if not loaded. Callers needing consistency across several lookups
+// should call this once and use the result, as the config can be swapped in the background.
+func (ac *Appcore) config() *datamodel.PrimaryConfig {
+	snapshot := ac.loadedConfig.Load()
+	if snapshot == nil {
+		return nil
+	}
+	return snapshot.config
+}
+
+// When enabled, Start uses the cached remote config if available, instead of waiting on the network.
+// The config is revalidated in the background, and swapped in if it has changed. Must be set before Start.
+func (ac *Appcore) SetStaleWhileRevalidate(enabled bool) {
+	ac.staleWhileRevalidate = enabled
+}
+
+// SHA-256 (hex) of the loaded config file, or empty string if no config is loaded
+func (ac *Appcore) ConfigVersionHash() string {
+	snapshot := ac.loadedConfig.Load()
+	if snapshot == nil {
+		return ""
+	}
+	return snapshot.sha256
+}
+
+// Seconds since the loaded config was confirmed current with the server, or -1 if no config is loaded
+func (ac *Appcore) ConfigAgeSeconds() int64 {
+	snapshot := ac.loadedConfig.Load()
+	if snapshot == nil {
+		return -1
+	}
+	return int64(time.Since(snapshot.validatedAt).Seconds())
+}
+
 // Hopefully no one wants http (no TLS) in 2023... but given the importance of the config file we can't open this up to injection attacks
 const filePrefix = "file://"
 const httpsPrefix = "https://"
@@ -123,23 +232,47 @@ func (ac *Appcore) SetDataDirPath(dataDirPath string) (returnErr error) {
 		}
 	}()
 
+	ac.dataDirLock.Lock()
+	defer ac.dataDirLock.Unlock()
+	if ac.openDBStage != nil {
+		return errors.New("CriticalMoments: data directory already set. SetDataDirPath should only be called once")
+	}
+
 	cache, err := newCacheWithBaseDir(dataDirPath)
 	if err != nil {
 		return err
 	}
 	ac.cache = cache
 
-	err = ac.db.StartWithPath(dataDirPath)
-	if err != nil {
-		return err
-	}
+	// Opened in the background, overlapping the rest of startup. Errors are returned from Start. See startup.go
+	ac.openDBStage = newStartupStage("open_db", func() error {
+		return ac.db.StartWithPath(dataDirPath)
+	})
+	ac.openDBStage.start()
 
-	dbOperations := ac.db.DbConditionFunctions()
+	dbOperations := ac.instrumentation.instrumentDynamicFunctions(stageDBFunction, ac.db.DbConditionFunctions())
 	ac.propertyRegistry.RegisterDynamicFunctions(dbOperations)
 
 	return nil
 }
 
+// Max events waiting to be processed. Set before Start.
+func (ac *Appcore) SetEventQueueCapacity(capacity int) {
+	ac.eventQueueCapacity = capacity
+}
+
+// When the event queue is full, enqueueing returns an error (dropping the event) instead of waiting for space. Set
+// before Start.
+func (ac *Appcore) SetEventQueueRejectWhenFull(reject bool) {
+	ac.eventQueueRejectWhenFull = reject
+}
+
+// Evaluate the trigger conditions for an event concurrently with this many workers, then perform passing actions in
+// trigger order. 0 or 1 evaluates serially, as do events with only a few triggers. Set before Start.
+func (ac *Appcore) SetTriggerEvaluationWorkers(workers int) {
+	ac.triggerEvaluationWorkers = workers
+}
+
 func (ac *Appcore) SetTimezoneGMTOffset(gmtOffset int) {
 	defer func() {
 		// We never intentionally panic in CM, but we want to recover if we do
@@ -152,7 +285,7 @@ func (ac *Appcore) SetTimezoneGMTOffset(gmtOffset int) {
 	tz := time.FixedZone(tzName, gmtOffset)
 	time.Local = tz
 
-	ac.propertyRegistry.registerStaticProperty("timezone_gmt_offset", gmtOffset)
+	ac.propertyRegistry.registerStaticProperty("timezone_gmt_offset", datamodel.NewIntPropertyValue(int64(gmtOffset)))
 }
 
 // Internal use only
@@ -166,12 +299,12 @@ func (ac *Appcore) CheckTestCondition(conditionString string) (returnResult bool
 	}()
 
 	appId, err := ac.propertyRegistry.propertyValue("app_id")
-	if err != nil || appId == nil {
+	if err != nil || appId.IsNil() {
 		return false, errors.New("CheckTestCondition only available in the test app. No app ID")
 	}
-	appIdString, ok := appId.(string)
-	if !ok || (appIdString != "io.criticalmoments.demo-app" &&
-		appIdString != "com.apple.dt.xctest.tool") {
+	// Empty for non-string values
+	appIdString := appId.StringValue()
+	if appIdString != "io.criticalmoments.demo-app" && appIdString != "com.apple.dt.xctest.tool" {
 		return false, errors.New("CheckTestCondition only available in the test app")
 	}
 
@@ -196,7 +329,7 @@ func (ac *Appcore) CheckNamedCondition(name string) (returnResult bool, returnEr
 		}
 	}()
 
-	if !ac.started {
+	if !ac.started.Load() {
 		return false, errors.New("Appcore not started")
 	}
 	if name == "" {
@@ -204,29 +337,34 @@ func (ac *Appcore) CheckNamedCondition(name string) (returnResult bool, returnEr
 	}
 
 	// lookup name for override, preferring the condition from the config when available
-	condition := ac.config.ConditionWithName(name)
+	config := ac.config()
+	condition := config.ConditionWithName(name)
 
 	if condition == nil {
 		return false, fmt.Errorf("CheckNamedCondition: no condition found named '%v'", name)
 	}
 
-	condResult, condErr := ac.propertyRegistry.evaluateCondition(condition)
-	ac.logEventForNamedCondition(condition, condResult, condErr)
+	var condResult bool
+	var condErr error
+	ac.instrumentation.withProfilingLabels(stageConditionEvaluate, func() {
+		condResult, condErr = ac.propertyRegistry.evaluateCondition(condition)
+	})
+	ac.logEventForNamedCondition(config, condition, condResult, condErr)
 	return condResult, condErr
 }
 
-func (ac *Appcore) logEventForNamedCondition(condition *datamodel.Condition, result bool, err error) {
-	name := ac.config.NameForCondition(condition)
-	if name == "" {
+func (ac *Appcore) logEventForNamedCondition(config *datamodel.PrimaryConfig, condition *datamodel.Condition, result bool, err error) {
+	events := config.EventsForCondition(condition)
+	if events == nil {
 		return
 	}
 
 	if err != nil {
-		ac.SendClientEvent(fmt.Sprintf("ff_error:%v", name))
+		ac.sendDerivedEvent(&events.Error, false)
 	} else if result {
-		ac.SendClientEvent(fmt.Sprintf("ff_true:%v", name))
+		ac.sendDerivedEvent(&events.True, false)
 	} else {
-		ac.SendClientEvent(fmt.Sprintf("ff_false:%v", name))
+		ac.sendDerivedEvent(&events.False, false)
 	}
 }
 
@@ -260,7 +398,7 @@ func (ac *Appcore) Start(allowDebugLoad bool) (returnErr error) {
 		}
 	}()
 
-	if ac.started {
+	if ac.started.Load() {
 		return errors.New("appcore already started. Start should only be called once")
 	}
 
@@ -273,40 +411,65 @@ func (ac *Appcore) Start(allowDebugLoad bool) (returnErr error) {
 	if ac.libBindings == nil {
 		return errors.New("the SDK must register LibBindings before calling start")
 	}
-	if ac.cache == nil {
+	ac.dataDirLock.Lock()
+	dataDirSet := ac.cache != nil && ac.openDBStage != nil
+	ac.dataDirLock.Unlock()
+	if !dataDirSet {
 		return errors.New("the SDK must register a cache directory before calling start")
 	}
+	ac.traceRecorder.Load().recordStart(allowDebugLoad, ac.apiKey.String(), ac.apiKey.BundleId(), ac.libBindings)
 
-	err := ac.RegisterStaticTimeProperty("app_start_time", time.Now().UnixMilli())
-	if err != nil {
+	registerProperties := newStartupStage("register_properties", func() error {
+		return ac.registerStartupProperties(allowDebugLoad)
+	})
+	loadConfig := newStartupStage("load_config", func() (err error) {
+		ac.instrumentation.withProfilingLabels(stageConfigLoad, func() {
+			err = ac.loadConfig(allowDebugLoad)
+		})
 		return err
-	}
-	err = ac.propertyRegistry.addProviderForKey("session_start_time", SessionStartTimePropertyProvider{eventManager: ac.eventManager})
+	}, registerProperties)
+	sampleProperties := newStartupStage("sample_properties", func() error {
+		err := ac.propertyRegistry.samplePropertiesForStartup()
+		if err != nil {
+			fmt.Printf("CriticalMoments: there was an issue sampling properties for startup. Continuing as this error is non-fatal: %v\n", err)
+		}
+		return nil
+	}, registerProperties, ac.openDBStage)
+	startEvents := newStartupStage("start_events", ac.startEvents, loadConfig, sampleProperties)
+
+	ac.startupStages = []*startupStage{ac.openDBStage, registerProperties, loadConfig, sampleProperties, startEvents}
+	return runStartupStages(ac.startupStages...)
+}
+
+// Built in properties provided by appcore, then validates all registered properties
+func (ac *Appcore) registerStartupProperties(allowDebugLoad bool) error {
+	// Registered directly, not with the public functions, so they aren't recorded in traces (replay registers them again)
+	err := ac.propertyRegistry.registerStaticProperty("app_start_time", datamodel.NewTimePropertyValue(time.UnixMilli(ac.now().UnixMilli())))
 	if err != nil {
 		return err
 	}
-	err = ac.RegisterStaticBoolProperty("is_debug_build", allowDebugLoad)
+	err = ac.propertyRegistry.addProviderForKey("session_start_time", SessionStartTimePropertyProvider{eventManager: ac.eventManager, ac: ac})
 	if err != nil {
 		return err
 	}
-
-	if err := ac.propertyRegistry.validateProperties(); err != nil {
-		return err
-	}
-
-	err = ac.loadConfig(allowDebugLoad)
+	err = ac.propertyRegistry.registerStaticProperty("is_debug_build", datamodel.NewBoolPropertyValue(allowDebugLoad))
 	if err != nil {
 		return err
 	}
 
-	err = ac.propertyRegistry.samplePropertiesForStartup()
-	if err != nil {
-		fmt.Printf("CriticalMoments: there was an issue sampling properties for startup. Continuing as this error is non-fatal: %v\n", err)
-	}
+	return ac.propertyRegistry.validateProperties()
+}
 
-	ac.started = true
+// After the config is loaded and startup properties sampled. Errors are non-fatal.
+func (ac *Appcore) startEvents() error {
+	ac.eventQueue = newEventQueue(ac, ac.eventQueueCapacity, ac.eventQueueRejectWhenFull)
+	ac.started.Store(true)
 
-	err = ac.SendBuiltInEvent(datamodel.AppStartBuiltInEvent)
+	// Not recorded in traces, as replay sends it again on Start
+	future, err := ac.enqueueBuiltInEvent(datamodel.AppStartBuiltInEvent)
+	if err == nil {
+		err = future.Wait()
+	}
 	if err != nil {
 		fmt.Printf("CriticalMoments: there was an issue sending the built in event \"%v\". Continuing as this error is non-fatal: %v\n", datamodel.AppStartBuiltInEvent, err)
 	}
@@ -317,33 +480,94 @@ func (ac *Appcore) Start(allowDebugLoad bool) (returnErr error) {
 		fmt.Printf("CriticalMoments: there was an issue setting up notifications. Continuing as this error is non-fatal: %v\n", err)
 	}
 
+	if ac.needsConfigRevalidation {
+		ac.needsConfigRevalidation = false
+		ac.configRevalidation.Add(1)
+		go ac.revalidateConfig()
+	}
+
 	return nil
 }
 
 func (ac *Appcore) loadConfig(allowDebugLoad bool) error {
+	defer ac.instrumentation.since(stageConfigLoad, time.Now())
 	var configFilePath string
 	var err error
 	isFilePath := strings.HasPrefix(ac.configUrlString, filePrefix)
+	validatedAt := time.Now()
 
 	if isFilePath {
 		// Strip file:// prefix
 		configFilePath = ac.configUrlString[len(filePrefix):]
 	} else if strings.HasPrefix(ac.configUrlString, httpsPrefix) {
-		configFilePath, err = ac.cache.verifyOrFetchRemoteConfigFile(ac.configUrlString, "primary")
+		if ac.staleWhileRevalidate {
+			// Start with the cached config if it's valid, and revalidate after startup
+			if cachedPath, _ := ac.cache.existingCacheFileOfName("primary"); cachedPath != "" {
+				err = ac.loadCachedConfig(cachedPath)
+				if err == nil {
+					ac.needsConfigRevalidation = true
+					return nil
+				}
+				fmt.Printf("CriticalMoments: cached config not used, loading from network. %v\n", err)
+			}
+		}
+
+		var validated bool
+		configFilePath, validated, err = ac.cache.verifyOrFetchRemoteConfigFileWithStatus(ac.configUrlString, "primary")
 		if err != nil {
 			return err
 		}
+		if !validated && configFilePath != "" {
+			// Network issue, fell back to cache. Age is from when the cache was downloaded.
+			validatedAt = fileModTime(configFilePath)
+		}
 	}
 	if configFilePath == "" {
 		return errors.New("CriticalMoments: Invalid config url")
 	}
 
-	configFileData, err := os.ReadFile(configFilePath)
+	// If we're in debug mode and the file is local, allow parsing unsigned config files
+	allowParsingUnsigned := allowDebugLoad && isFilePath
+	pc, configHash, err := ac.decodeConfigFile(configFilePath, allowParsingUnsigned)
+	if err != nil {
+		return err
+	}
+	return ac.setConfig(pc, configHash, validatedAt)
+}
+
+func (ac *Appcore) loadCachedConfig(cachedPath string) error {
+	pc, configHash, err := ac.decodeConfigFile(cachedPath, false)
 	if err != nil {
 		return err
 	}
+	return ac.setConfig(pc, configHash, fileModTime(cachedPath))
+}
+
+func fileModTime(path string) time.Time {
+	fileInfo, err := os.Stat(path)
+	if err != nil {
+		return time.Now()
+	}
+	return fileInfo.ModTime()
+}
 
-	pc, err := datamodel.DecodePrimaryConfig(configFileData, signing.SharedSignUtil())
+// Reads, decodes and validates a config file, without applying it
+func (ac *Appcore) decodeConfigFile(configFilePath string, allowParsingUnsigned bool) (*datamodel.PrimaryConfig, string, error) {
+	configFileData, err := os.ReadFile(configFilePath)
+	if err != nil {
+		return nil, "", err
+	}
+	configHash := fmt.Sprintf("%x", sha256.Sum256(configFileData))
+
+	// A pre-parsed snapshot only exists if this exact file was already decoded and validated by this library version
+	pc := ac.loadPreparsedConfig(configFileData, configHash)
+	if pc == nil {
+		var signature string
+		pc, signature, err = datamodel.DecodePrimaryConfigWithSignature(configFileData, signing.SharedSignUtil())
+		if err == nil {
+			ac.savePreparsedConfig(pc, configHash, signature)
+		}
+	}
 	if err != nil {
 		if len(configFileData) == 2 && string(configFileData) == "{}" {
 			// Special case: empty config does not require signing.
@@ -351,10 +575,8 @@ func (ac *Appcore) loadConfig(allowDebugLoad bool) error {
 				AppId: ac.apiKey.BundleId(),
 			}
 		} else {
-			// If we're in debug mode and the file is local, allow parsing unsigned config files
-			allowParsingUnsigned := allowDebugLoad && isFilePath
 			if !allowParsingUnsigned {
-				return err
+				return nil, "", err
 			}
 			if ac.forceParseModeForStrict != nil {
 				// Allow forcing a specific parse mode for testing
@@ -366,28 +588,127 @@ func (ac *Appcore) loadConfig(allowDebugLoad bool) error {
 			pc = &datamodel.PrimaryConfig{}
 			err = json.Unmarshal(configFileData, &pc)
 			if err != nil {
-				return datamodel.UserFriendlyJsonError(err, configFileData)
+				return nil, "", datamodel.UserFriendlyJsonError(err, configFileData)
 			}
 		}
 	}
 	if pc.AppId != ac.apiKey.BundleId() {
-		return fmt.Errorf("this config file isn't valid for this app. Config file is key is for app id '%s', but this app has bundle ID is '%s'", pc.AppId, ac.apiKey.BundleId())
+		return nil, "", fmt.Errorf("this config file isn't valid for this app. Config file is key is for app id '%s', but this app has bundle ID is '%s'", pc.AppId, ac.apiKey.BundleId())
 	}
 	if err = ac.isClientTooOldForConfig(pc); err != nil {
-		return err
+		return nil, "", err
 	}
-	ac.config = pc
 	if pc.ConfigVersion != "v1" {
 		fmt.Printf("CriticalMoments: the CM configVersion should be \"v1\". Was: \"%v\"\n", pc.ConfigVersion)
 	}
-	err = ac.postConfigSetup()
+	return pc, configHash, nil
+}
+
+// Pre-parsed snapshots of signed config files. Loading one skips JSON and condition parsing, which dominate startup
+// time for large configs. The config file's signature is still verified on every load, and must match the signature
+// the snapshot was written for. Any issue falls back to decoding the config file.
+const preparsedConfigCacheName = "primary"
+
+func (ac *Appcore) loadPreparsedConfig(configFileData []byte, configHash string) *datamodel.PrimaryConfig {
+	if ac.cache == nil || ac.libBindings == nil {
+		return nil
+	}
+	data := ac.cache.readConfigSnapshot(preparsedConfigCacheName, configHash)
+	if data == nil {
+		return nil
+	}
+	signature, err := datamodel.VerifyPrimaryConfigSignature(configFileData, signing.SharedSignUtil())
 	if err != nil {
-		return err
+		return nil
+	}
+	pc, err := datamodel.DecodePrimaryConfigSnapshot(data, configHash, signature, ac.libBindings.CMVersion())
+	if err != nil {
+		fmt.Printf("CriticalMoments: config snapshot not used, decoding config file. %v\n", err)
+		return nil
+	}
+	return pc
+}
+
+// signature must be the config file's signature, as verified when decoding it
+func (ac *Appcore) savePreparsedConfig(pc *datamodel.PrimaryConfig, configHash string, signature string) {
+	if ac.cache == nil || ac.libBindings == nil {
+		return
+	}
+	data, err := datamodel.EncodePrimaryConfigSnapshot(pc, configHash, signature, ac.libBindings.CMVersion())
+	if err == nil {
+		err = ac.cache.writeConfigSnapshot(preparsedConfigCacheName, configHash, data)
+	}
+	if err != nil {
+		// Not fatal, next start will decode the config file again
+		fmt.Printf("CriticalMoments: unable to save config snapshot. %v\n", err)
 	}
+}
 
+// Publishes a new config snapshot. Readers which already loaded the prior snapshot continue using it.
+// The config's setup (theme) runs first: if it fails, the prior config stays live.
+func (ac *Appcore) setConfig(pc *datamodel.PrimaryConfig, configHash string, validatedAt time.Time) error {
+	if err := ac.postConfigSetup(pc); err != nil {
+		return err
+	}
+	ac.traceRecorder.Load().recordConfig(configHash, pc.ConfigVersion)
+	ac.loadedConfig.Store(&configSnapshot{
+		config:      pc,
+		sha256:      configHash,
+		validatedAt: validatedAt,
+	})
 	return nil
 }
 
+// Runs in the background after a stale-while-revalidate start. Swaps in the remote config if it changed.
+func (ac *Appcore) revalidateConfig() {
+	defer ac.configRevalidation.Done()
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			fmt.Printf("CriticalMoments: panic in revalidateConfig: %v\n", r)
+		}
+	}()
+
+	configFilePath, validated, err := ac.cache.verifyOrFetchRemoteConfigFileWithStatus(ac.configUrlString, "primary")
+	if err != nil || !validated || configFilePath == "" {
+		// Offline or failed fetch: keep using the cached config
+		return
+	}
+	validatedAt := time.Now()
+
+	prior := ac.loadedConfig.Load()
+	configHash := ""
+	if data, err := os.ReadFile(configFilePath); err == nil {
+		configHash = fmt.Sprintf("%x", sha256.Sum256(data))
+	}
+	if prior != nil && configHash == prior.sha256 {
+		// Unchanged, only update the age
+		ac.loadedConfig.Store(&configSnapshot{
+			config:      prior.config,
+			sha256:      prior.sha256,
+			validatedAt: validatedAt,
+		})
+		return
+	}
+
+	pc, configHash, err := ac.decodeConfigFile(configFilePath, false)
+	if err != nil {
+		fmt.Printf("CriticalMoments: updated config file is invalid, continuing with cached config: %v\n", err)
+		return
+	}
+	err = ac.setConfig(pc, configHash, validatedAt)
+	if err != nil {
+		fmt.Printf("CriticalMoments: issue applying updated config, continuing with cached config: %v\n", err)
+		return
+	}
+
+	// Notifications depend on the config, so the plan needs to be rebuilt
+	err = ac.ForceUpdateNotificationPlan()
+	if err != nil {
+		fmt.Printf("CriticalMoments: issue updating notification plan for updated config: %v\n", err)
+	}
+}
+
 func (ac *Appcore) isClientTooOldForConfig(pc *datamodel.PrimaryConfig) error {
 	if pc.MinAppVersion != "" {
 		if conditions.VersionLessThan(ac.libBindings.AppVersion(), pc.MinAppVersion) {
@@ -408,16 +729,16 @@ func (ac *Appcore) isClientTooOldForConfig(pc *datamodel.PrimaryConfig) error {
 	return nil
 }
 
-func (ac *Appcore) postConfigSetup() error {
-	dt := ac.config.DefaultTheme()
+func (ac *Appcore) postConfigSetup(config *datamodel.PrimaryConfig) error {
+	dt := config.DefaultTheme()
 	if dt != nil {
 		err := ac.libBindings.SetDefaultTheme(dt)
 		if err != nil {
 			fmt.Println("CriticalMoments: there was an issue setting up the default theme from config")
 			return err
 		}
-	} else if ac.config.LibraryThemeName != "" {
-		err := ac.libBindings.SetDefaultThemeByLibaryThemeName(ac.config.LibraryThemeName)
+	} else if config.LibraryThemeName != "" {
+		err := ac.libBindings.SetDefaultThemeByLibaryThemeName(config.LibraryThemeName)
 		if err != nil {
 			// Non critical error. We can continue with default theme
 			fmt.Println("CriticalMoments: there was an issue setting up the default library theme from config")
@@ -428,53 +749,86 @@ func (ac *Appcore) postConfigSetup() error {
 }
 
 func (ac *Appcore) SendClientEvent(name string) error {
-	event, err := datamodel.NewClientEventWithName(name)
+	future, err := ac.EnqueueClientEvent(name)
 	if err != nil {
-		return fmt.Errorf("SendEvent error for \"%v\"", name)
+		return err
 	}
-	return ac.processEvent(event)
+	return future.Wait()
 }
 
 func (ac *Appcore) SendBuiltInEvent(name string) error {
-	event, err := datamodel.NewBuiltInEventWithName(name)
+	future, err := ac.EnqueueBuiltInEvent(name)
 	if err != nil {
-		return fmt.Errorf("SendEvent error for \"%v\"", name)
+		return err
 	}
-	return ac.processEvent(event)
+	return future.Wait()
 }
 
-func (ac *Appcore) processEvent(event *datamodel.Event) (returnErr error) {
-	defer func() {
-		// We never intentionally panic in CM, but we want to recover if we do
-		if r := recover(); r != nil {
-			returnErr = fmt.Errorf("panic in SendEvent: %v", r)
-		}
-	}()
+// Queues the event and returns without waiting for it to be processed. Wait on the future if you need the result.
+func (ac *Appcore) EnqueueClientEvent(name string) (*EventFuture, error) {
+	ac.traceRecorder.Load().recordEvent(name, false)
+	event, err := datamodel.NewClientEventWithName(name)
+	if err != nil {
+		return nil, fmt.Errorf("SendEvent error for \"%v\"", name)
+	}
+	return ac.enqueueEvent(event)
+}
 
-	if !ac.started {
-		return errors.New("Appcore not started")
+func (ac *Appcore) EnqueueBuiltInEvent(name string) (*EventFuture, error) {
+	ac.traceRecorder.Load().recordEvent(name, true)
+	return ac.enqueueBuiltInEvent(name)
+}
+
+func (ac *Appcore) enqueueBuiltInEvent(name string) (*EventFuture, error) {
+	event, err := datamodel.NewBuiltInEventWithName(name)
+	if err != nil {
+		return nil, fmt.Errorf("SendEvent error for \"%v\"", name)
+	}
+	return ac.enqueueEvent(event)
+}
+
+func (ac *Appcore) enqueueEvent(event *datamodel.Event) (*EventFuture, error) {
+	if !ac.started.Load() {
+		return nil, errors.New("Appcore not started")
 	}
 	if ac.eventManager == nil {
-		return errors.New("Appcore EM not started")
+		return nil, errors.New("Appcore EM not started")
 	}
+	return ac.eventQueue.enqueue(event)
+}
 
-	err := ac.eventManager.SendEvent(event, ac)
-	if err != nil {
+// Blocks until all events enqueued before the call are processed and saved, and any notification plan update they
+// requested is sent. Call when entering background or terminating.
+func (ac *Appcore) FlushEvents() error {
+	if !ac.started.Load() {
+		return errors.New("Appcore not started")
+	}
+	if err := ac.eventQueue.flush(); err != nil {
 		return err
 	}
+	if err := ac.db.FlushQueuedEvents(); err != nil {
+		return err
+	}
+	return ac.flushPendingNotificationPlanUpdate()
+}
 
-	performErr := ac.performActionsForEvent(event.Name)
-
-	err = ac.notificationRunnerProcessEvent(event)
+// Send an event raised while ingesting another event. See event_queue.go
+func (ac *Appcore) sendInlineBuiltInEvent(name string) error {
+	event, err := datamodel.NewBuiltInEventWithName(name)
 	if err != nil {
-		fmt.Printf("CriticalMoments: there was an issue processing notifications for event '%v'. Error: %v\n", event.Name, err)
+		return fmt.Errorf("SendEvent error for \"%v\"", name)
 	}
-
-	return performErr
+	return ac.eventQueue.ingestInline(event)
 }
 
 func (ac *Appcore) performActionsForEvent(eventName string) error {
-	triggers := ac.config.TriggersForEvent(eventName)
+	// Use one config snapshot for the whole event, even if a new config is swapped in while processing
+	config := ac.config()
+	triggers := config.TriggersForEvent(eventName)
+	if ac.triggerEvaluationWorkers > 1 && len(triggers) >= minParallelTriggerCount {
+		return ac.performActionsForTriggersParallel(config, eventName, triggers)
+	}
+
 	var lastErr error
 	for _, trigger := range triggers {
 		if trigger.Condition != nil {
@@ -488,7 +842,7 @@ func (ac *Appcore) performActionsForEvent(eventName string) error {
 				continue
 			}
 		}
-		err := ac.PerformNamedAction(trigger.ActionName)
+		err := ac.performNamedActionWithConfig(config, trigger.ActionName, true)
 		if err != nil {
 			// return an error, but don't stop processing
 			lastErr = fmt.Errorf("CriticalMoments: there was an issue performing action for event \"%v\". Error: %v", eventName, err)
@@ -505,14 +859,20 @@ func (ac *Appcore) PerformNamedAction(actionName string) (returnErr error) {
 		}
 	}()
 
-	if !ac.started {
+	if !ac.started.Load() {
 		return errors.New("Appcore not started")
 	}
-	action := ac.config.ActionWithName(actionName)
+	return ac.performNamedActionWithConfig(ac.config(), actionName, false)
+}
+
+// Inline is true when performing on the ingest stage (trigger actions), so events raised are ingested inline
+// instead of waiting on the queue
+func (ac *Appcore) performNamedActionWithConfig(config *datamodel.PrimaryConfig, actionName string, inline bool) error {
+	action := config.ActionWithName(actionName)
 	if action == nil {
 		return fmt.Errorf("no action found named %v", actionName)
 	}
-	return ac.PerformAction(action)
+	return ac.performActionWithConfig(config, action, inline)
 }
 
 func (ac *Appcore) PerformAction(action *datamodel.ActionContainer) (returnErr error) {
@@ -523,9 +883,13 @@ func (ac *Appcore) PerformAction(action *datamodel.ActionContainer) (returnErr e
 		}
 	}()
 
-	if !ac.started {
+	if !ac.started.Load() {
 		return errors.New("Appcore not started")
 	}
+	return ac.performActionWithConfig(ac.config(), action, false)
+}
+
+func (ac *Appcore) performActionWithConfig(config *datamodel.PrimaryConfig, action *datamodel.ActionContainer, inline bool) error {
 	if action.Condition != nil {
 		conditionResult, err := ac.propertyRegistry.evaluateCondition(action.Condition)
 		if err != nil {
@@ -538,23 +902,40 @@ func (ac *Appcore) PerformAction(action *datamodel.ActionContainer) (returnErr e
 	}
 	ad := actionDispatcher{
 		appcore: ac,
+		inline:  inline,
 	}
-	actionName := ac.config.NameForActionContainer(action)
+	actionName := config.NameForActionContainer(action)
 	actionErr := action.PerformAction(&ad, actionName)
-	ac.sendEventForPerformedAction(actionName, actionErr)
+	ac.sendEventForPerformedAction(config, action, actionErr, inline)
 	return actionErr
 }
 
-func (ac *Appcore) sendEventForPerformedAction(actionName string, err error) {
-	if actionName == "" {
+func (ac *Appcore) sendEventForPerformedAction(config *datamodel.PrimaryConfig, action *datamodel.ActionContainer, err error, inline bool) {
+	events := config.EventsForActionContainer(action)
+	if events == nil {
 		return
 	}
 
 	if err == nil {
-		ac.SendClientEvent(fmt.Sprintf("action:%v", actionName))
+		ac.sendDerivedEvent(&events.Performed, inline)
 	} else {
-		ac.SendClientEvent(fmt.Sprintf("action_error:%v", actionName))
+		ac.sendDerivedEvent(&events.Failed, inline)
+	}
+}
+
+// Bookkeeping events without listeners skip the queue: nothing to dispatch, and the write can be batched
+func (ac *Appcore) sendDerivedEvent(derived *datamodel.DerivedEvent, inline bool) error {
+	if !derived.HasListeners {
+		return ac.eventManager.queueEvent(derived.Event, ac)
+	}
+	if inline {
+		return ac.eventQueue.ingestInline(derived.Event)
 	}
+	future, err := ac.enqueueEvent(derived.Event)
+	if err != nil {
+		return err
+	}
+	return future.Wait()
 }
 
 func (ac *Appcore) ThemeForName(themeName string) (resultTheme *datamodel.Theme) {
@@ -566,56 +947,66 @@ func (ac *Appcore) ThemeForName(themeName string) (resultTheme *datamodel.Theme)
 		}
 	}()
 
-	if !ac.started {
+	if !ac.started.Load() {
 		return nil
 	}
-	return ac.config.ThemeWithName(themeName)
+	return ac.config().ThemeWithName(themeName)
 }
 
 // set developer mode: log events for now, later we'll add condition evals, triggers, etc
 func (ac *Appcore) SetDeveloperMode(developerMode bool) {
-	ac.eventManager.logEvents = developerMode
+	ac.eventManager.logEvents.Store(developerMode)
 }
 
 // Repeitive, but gomobile doesn't allow for `interface{}`
 // Panic catching is one level down stack here, but still there.
 func (ac *Appcore) RegisterStaticStringProperty(key string, value string) error {
-	return ac.propertyRegistry.registerStaticProperty(key, value)
+	return ac.registerStaticProperty(key, datamodel.NewStringPropertyValue(value))
 }
 func (ac *Appcore) RegisterStaticIntProperty(key string, value int) error {
-	return ac.propertyRegistry.registerStaticProperty(key, value)
+	return ac.registerStaticProperty(key, datamodel.NewIntPropertyValue(int64(value)))
 }
 func (ac *Appcore) RegisterStaticFloatProperty(key string, value float64) error {
-	return ac.propertyRegistry.registerStaticProperty(key, value)
+	return ac.registerStaticProperty(key, datamodel.NewFloatPropertyValue(value))
 }
 func (ac *Appcore) RegisterStaticBoolProperty(key string, value bool) error {
-	return ac.propertyRegistry.registerStaticProperty(key, value)
+	return ac.registerStaticProperty(key, datamodel.NewBoolPropertyValue(value))
 }
 func (ac *Appcore) RegisterStaticTimeProperty(key string, value int64) error {
 	if value == LibPropertyProviderNilIntValue {
-		return ac.propertyRegistry.registerStaticProperty(key, nil)
+		return ac.registerStaticProperty(key, datamodel.PropertyValue{})
 	}
 	timeVal := time.UnixMilli(value)
-	return ac.propertyRegistry.registerStaticProperty(key, timeVal)
+	return ac.registerStaticProperty(key, datamodel.NewTimePropertyValue(timeVal))
 }
 func (ac *Appcore) RegisterClientStringProperty(key string, value string) error {
-	return ac.propertyRegistry.registerClientProperty(key, value)
+	return ac.registerClientProperty(key, datamodel.NewStringPropertyValue(value))
 }
 func (ac *Appcore) RegisterClientIntProperty(key string, value int) error {
-	return ac.propertyRegistry.registerClientProperty(key, value)
+	return ac.registerClientProperty(key, datamodel.NewIntPropertyValue(int64(value)))
 }
 func (ac *Appcore) RegisterClientFloatProperty(key string, value float64) error {
-	return ac.propertyRegistry.registerClientProperty(key, value)
+	return ac.registerClientProperty(key, datamodel.NewFloatPropertyValue(value))
 }
 func (ac *Appcore) RegisterClientBoolProperty(key string, value bool) error {
-	return ac.propertyRegistry.registerClientProperty(key, value)
+	return ac.registerClientProperty(key, datamodel.NewBoolPropertyValue(value))
 }
 func (ac *Appcore) RegisterClientTimeProperty(key string, value int64) error {
 	if value == LibPropertyProviderNilIntValue {
-		return ac.propertyRegistry.registerClientProperty(key, nil)
+		return ac.registerClientProperty(key, datamodel.PropertyValue{})
 	}
 	timeVal := time.UnixMilli(value)
-	return ac.propertyRegistry.registerClientProperty(key, timeVal)
+	return ac.registerClientProperty(key, datamodel.NewTimePropertyValue(timeVal))
+}
+
+// Registers, and records the registration if recording a trace
+func (ac *Appcore) registerStaticProperty(key string, value datamodel.PropertyValue) error {
+	ac.traceRecorder.Load().recordProperty(traceRecordStaticProperty, key, value)
+	return ac.propertyRegistry.registerStaticProperty(key, value)
+}
+func (ac *Appcore) registerClientProperty(key string, value datamodel.PropertyValue) error {
+	ac.traceRecorder.Load().recordProperty(traceRecordClientProperty, key, value)
+	return ac.propertyRegistry.registerClientProperty(key, value)
 }
 
 func (ac *Appcore) RegisterLibPropertyProvider(key string, dpp LibPropertyProvider) (returnErr error) {
@@ -626,6 +1017,9 @@ func (ac *Appcore) RegisterLibPropertyProvider(key string, dpp LibPropertyProvid
 		}
 	}()
 
+	if r := ac.traceRecorder.Load(); r != nil {
+		r.recordLibPropertyProvider(key, dpp.Type())
+	}
 	return ac.propertyRegistry.registerLibPropertyProvider(key, dpp)
 }
 
@@ -637,11 +1031,12 @@ func (ac *Appcore) RegisterClientPropertiesFromJson(jsonData []byte) (returnErr
 		}
 	}()
 
+	ac.traceRecorder.Load().recordClientPropertiesJson(jsonData)
 	return ac.propertyRegistry.registerClientPropertiesFromJson(jsonData)
 }
 
 func (ac *Appcore) ActionForNotification(notificationId string) error {
-	for _, notification := range ac.config.Notifications {
+	for _, notification := range ac.config().Notifications {
 		if notification.UniqueID() == notificationId && notification.ActionName != "" {
 			return ac.PerformNamedAction(notification.ActionName)
 		}
@@ -649,12 +1044,19 @@ func (ac *Appcore) ActionForNotification(notificationId string) error {
 	return nil
 }
 
-func (ac *Appcore) PerformBackgroundWork() (returnErr error) {
+// Processes time driven work which is due, and returns the next time background work should run (epoch seconds, 0 if
+// none needed)
+func (ac *Appcore) PerformBackgroundWork() (nextWakeEpochSeconds int64, returnErr error) {
 	defer func() {
 		// We never intentionally panic in CM, but we want to recover if we do
 		if r := recover(); r != nil {
+			nextWakeEpochSeconds = 0
 			returnErr = fmt.Errorf("panic in PerformBackgroundWork: %v", r)
 		}
 	}()
-	return ac.performBackgroundWorkForNotifications()
+	ac.traceRecorder.Load().recordBackgroundWork()
+	ac.instrumentation.withProfilingLabels(stageNotificationPlan, func() {
+		nextWakeEpochSeconds, returnErr = ac.performBackgroundWorkForNotifications(ac.now())
+	})
+	return nextWakeEpochSeconds, returnErr
 }
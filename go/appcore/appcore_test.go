@@ -1,16 +1,23 @@
 package appcore
 
 import (
+	"crypto/sha256"
 	"database/sql"
+	"errors"
 	"fmt"
 	"math/rand"
+	"net/http"
+	"net/http/httptest"
 	"os"
 	"path/filepath"
 	"reflect"
 	"strings"
 	"testing"
+	"time"
 
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+	"github.com/CriticalMoments/CriticalMoments/go/cmcore/signing"
 	"github.com/google/go-cmp/cmp"
 	"github.com/google/go-cmp/cmp/cmpopts"
 	"golang.org/x/exp/maps"
@@ -64,6 +71,7 @@ type testLibBindings struct {
 	lastLinkAction       *datamodel.LinkAction
 	reviewCount          int
 	defaultTheme         *datamodel.Theme
+	defaultThemeErr      error
 	libThemeName         string
 	lastModal            *datamodel.ModalAction
 	lastNotificationPlan *NotificationPlan
@@ -82,6 +90,9 @@ func (lb *testLibBindings) ShowLink(l *datamodel.LinkAction) error {
 	return nil
 }
 func (lb *testLibBindings) SetDefaultTheme(theme *datamodel.Theme) error {
+	if lb.defaultThemeErr != nil {
+		return lb.defaultThemeErr
+	}
 	lb.defaultTheme = theme
 	return nil
 }
@@ -127,12 +138,41 @@ func testBuildValidTestAppCore(t *testing.T) (*Appcore, error) {
 }
 
 func buildTestAppCoreWithPath(path string, t *testing.T) (*Appcore, error) {
+	return buildTestAppCoreWithPathAndStorage(path, db.NewDB(), t)
+}
+
+func buildTestAppCoreWithPathAndStorage(path string, storage db.Storage, t testing.TB) (*Appcore, error) {
+	ac := buildTestAppCoreWithoutDataDir(path, storage, t)
+	baseDataPath := fmt.Sprintf("/tmp/criticalmoments/test-temp-%v", rand.Int())
+	os.MkdirAll(baseDataPath, os.ModePerm)
+	err := ac.SetDataDirPath(baseDataPath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	// Tests may use the DB before Start, so wait for it to open
+	if err := ac.openDBStage.wait(); err != nil {
+		t.Fatal(err)
+	}
+	if ac.db == nil || ac.eventManager == nil || ac.db.PropertyHistoryManager() == nil || ac.cache == nil {
+		t.Fatal("db, event manager, prop history manager, or cache not setup")
+	}
+	if ac.propertyRegistry.phm != ac.db.PropertyHistoryManager() {
+		t.Fatal("property history manager not set to the correct DB instance via NewAppcore")
+	}
+	return ac, nil
+}
+
+// Valid for bundle ID io.criticalmoments.demo
+const testApiKey = "CM1-aGVsbG86d29ybGQ=-Yjppby5jcml0aWNhbG1vbWVudHMuZGVtbw==-MEUCIQCUfx6xlmQ0kdYkuw3SMFFI6WXrCWKWwetXBrXXG2hjAwIgWBPIMrdM1ET0HbpnXlnpj/f+VXtjRTqNNz9L/AOt4GY="
+
+// Everything but SetDataDirPath, for tests of startup
+func buildTestAppCoreWithoutDataDir(path string, storage db.Storage, t testing.TB) *Appcore {
 	t.Cleanup(func() {
 		// Appcore may mutate global state, so let's reset it
 		datamodel.StrictDatamodelParsing = false
 	})
 
-	ac := NewAppcore()
+	ac := newAppcoreWithStorage(storage)
 	configPath, err := filepath.Abs(path)
 	if err != nil {
 		t.Fatal(err)
@@ -142,26 +182,16 @@ func buildTestAppCoreWithPath(path string, t *testing.T) (*Appcore, error) {
 	if err != nil {
 		t.Fatal(err)
 	}
-	baseDataPath := fmt.Sprintf("/tmp/criticalmoments/test-temp-%v", rand.Int())
-	os.MkdirAll(baseDataPath, os.ModePerm)
-	err = ac.SetDataDirPath(baseDataPath)
-	if err != nil {
-		t.Fatal(err)
-	}
-	if ac.db == nil || ac.eventManager == nil || ac.db.PropertyHistoryManager() == nil || ac.cache == nil {
-		t.Fatal("db, event manager, prop history manager, or cache not setup")
-	}
-	if ac.propertyRegistry.phm != ac.db.PropertyHistoryManager() {
-		t.Fatal("property history manager not set to the correct DB instance via NewAppcore")
-	}
 	lb := testLibBindings{}
 	ac.RegisterLibraryBindings(&lb)
 
-	ac.SetApiKey("CM1-aGVsbG86d29ybGQ=-Yjppby5jcml0aWNhbG1vbWVudHMuZGVtbw==-MEUCIQCUfx6xlmQ0kdYkuw3SMFFI6WXrCWKWwetXBrXXG2hjAwIgWBPIMrdM1ET0HbpnXlnpj/f+VXtjRTqNNz9L/AOt4GY=", "io.criticalmoments.demo")
+	ac.SetApiKey(testApiKey, "io.criticalmoments.demo")
 
 	// Clear required properties, for easier setup
 	ac.propertyRegistry.builtInPropertyTypes = buildTestBuiltInProps(map[string]*datamodel.CMPropertyConfig{})
-	return ac, nil
+	// Deliver plans synchronously, so tests can check them right after sending events
+	ac.notificationPlanDebounce = 0
+	return ac
 }
 
 func TestAppcoreStart(t *testing.T) {
@@ -174,7 +204,7 @@ func TestAppcoreStart(t *testing.T) {
 		t.Fatal(err)
 	}
 	// Check it loaded the config (more detailed test of parsing in cmcore)
-	if ac.config.DefaultTheme() == nil {
+	if ac.config().DefaultTheme() == nil {
 		t.Fatal("Failed to load config in Appcore setup")
 	}
 }
@@ -189,7 +219,7 @@ func TestAppcoreStartMissingConfig(t *testing.T) {
 	if err == nil {
 		t.Fatal("Should not start without config")
 	}
-	if ac.config != nil {
+	if ac.config() != nil {
 		t.Fatal("Loaded config from empty url")
 	}
 }
@@ -204,7 +234,7 @@ func TestAppcoreStartMissingBindings(t *testing.T) {
 	if err == nil {
 		t.Fatal("Should not start without bindings")
 	}
-	if ac.config != nil {
+	if ac.config() != nil {
 		t.Fatal("Loaded config without bindings")
 	}
 }
@@ -219,7 +249,7 @@ func TestAppcoreStartBadConfig(t *testing.T) {
 	if err == nil {
 		t.Fatal("Should not start with bad config")
 	}
-	if ac.config != nil {
+	if ac.config() != nil {
 		t.Fatal("Loaded config from bad url")
 	}
 }
@@ -498,6 +528,28 @@ func TestSetDefaultTheme(t *testing.T) {
 	}
 }
 
+func TestSetConfigKeepsPriorConfigOnSetupFailure(t *testing.T) {
+	ac, err := testBuildValidTestAppCore(t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	err = ac.Start(true)
+	if err != nil {
+		t.Fatal(err)
+	}
+	prior := ac.loadedConfig.Load()
+
+	// A config whose theme can't be applied must not go live
+	ac.libBindings.(*testLibBindings).defaultThemeErr = errors.New("theme failed")
+	err = ac.setConfig(prior.config, "updatedhash", time.Now())
+	if err == nil {
+		t.Fatal("Expected theme error")
+	}
+	if ac.loadedConfig.Load() != prior || ac.ConfigVersionHash() != prior.sha256 {
+		t.Fatal("Config swapped in despite setup failure")
+	}
+}
+
 func TestSetDefaultLibraryTheme(t *testing.T) {
 	ac, err := buildTestAppCoreWithPath("../cmcore/data_model/test/testdata/primary_config/valid/builtInLibraryTheme.json", t)
 	if err != nil {
@@ -652,6 +704,30 @@ func TestEndToEndEvents(t *testing.T) {
 		t.Fatal("eventCountWithLimit should limit")
 	}
 
+	c, err = datamodel.NewCondition("eventCountSince('test', duration('1h')) == 2 && eventCountSince('test2', duration('1h')) == 1 && eventCountSince('test', duration('0s')) == 0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	r, err = ac.propertyRegistry.evaluateCondition(c)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !r {
+		t.Fatal("eventCountSince should count recent events")
+	}
+
+	c, err = datamodel.NewCondition("eventCountInWindow('test', now() - duration('1h'), now()) == 2 && eventCountInWindow('test', now() - duration('48h'), now() - duration('24h')) == 0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	r, err = ac.propertyRegistry.evaluateCondition(c)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !r {
+		t.Fatal("eventCountInWindow should count events in window")
+	}
+
 	// Confirm we are checking signature
 	invalidParams := []string{
 		"eventCount() > 1",
@@ -661,6 +737,11 @@ func TestEndToEndEvents(t *testing.T) {
 		"eventCountWithLimit('test') > 1",
 		"eventCountWithLimit('test', 'test2') > 1",
 		"eventCountWithLimit() > 1",
+		"eventCountSince('test') > 1",
+		"eventCountSince('test', 'test2') > 1",
+		"eventCountSince('test', 1) > 1",
+		"eventCountInWindow('test', now()) > 1",
+		"eventCountInWindow('test', duration('1h'), now()) > 1",
 	}
 	for _, cs := range invalidParams {
 		c, err = datamodel.NewCondition(cs)
@@ -674,6 +755,35 @@ func TestEndToEndEvents(t *testing.T) {
 	}
 }
 
+func TestEndToEndEventsWithMemoryStorage(t *testing.T) {
+	ac, err := buildTestAppCoreWithPathAndStorage("../cmcore/data_model/test/testdata/primary_config/valid/maximalValid.json", db.NewMemoryDB(), t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	mode := false
+	ac.forceParseModeForStrict = &mode
+	ac.RegisterClientStringProperty("memory_prop", "hello")
+	err = ac.Start(true)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	ac.SendClientEvent("test")
+	ac.SendClientEvent("test")
+
+	c, err := datamodel.NewCondition("eventCount('test') == 2 && eventCountSince('test', duration('1h')) == 2 && eventCount('app_start') == 1 && propertyHistoryLatestValue('custom_memory_prop') == 'hello'")
+	if err != nil {
+		t.Fatal(err)
+	}
+	r, err := ac.propertyRegistry.evaluateCondition(c)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !r {
+		t.Fatal("Memory storage should track events and property history like SQLite")
+	}
+}
+
 func arraysEqualOrderInsensitive(a []string, b []string) bool {
 	less := func(aa, bb string) bool { return aa < bb }
 	return cmp.Diff(a, b, cmpopts.SortSlices(less)) == ""
@@ -693,7 +803,7 @@ func TestValidateAllBuiltInFunctionsAreRegistered(t *testing.T) {
 		t.Fatal(err)
 	}
 
-	registered := ac.propertyRegistry.dynamicFunctionNames
+	registered := ac.propertyRegistry.registrations().dynamicFunctionNames
 	expected := maps.Keys(datamodel.AllBuiltInDynamicFunctions)
 	if !arraysEqualOrderInsensitive(registered, expected) {
 		t.Fatal("Not all built in functions registered or too many registered")
@@ -710,7 +820,7 @@ func TestLoadingSignedConfig(t *testing.T) {
 	if err != nil {
 		t.Fatal(err)
 	}
-	if ac.config == nil || ac.config.ConfigVersion != "v1" {
+	if ac.config() == nil || ac.config().ConfigVersion != "v1" {
 		t.Fatal("Failed to load signed config")
 	}
 	// is_debug_build should be false
@@ -723,6 +833,92 @@ func TestLoadingSignedConfig(t *testing.T) {
 	}
 }
 
+func TestPreparsedConfigSnapshot(t *testing.T) {
+	configPath := "../cmcore/data_model/test/testdata/primary_config/valid/signedValid.cmconfig"
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// First decode parses the file, and saves a snapshot
+	pc, configHash, err := ac.decodeConfigFile(configPath, false)
+	if err != nil || pc == nil {
+		t.Fatal(err)
+	}
+	snapshotPath := ac.cache.configSnapshotPath(preparsedConfigCacheName, configHash)
+	if _, err := os.Stat(snapshotPath); err != nil {
+		t.Fatal("Snapshot not written")
+	}
+
+	// Subsequent decodes use the snapshot. Tag it to confirm.
+	pc.ConfigVersion = "v1.from-snapshot"
+	configData, err := os.ReadFile(configPath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	signature, err := datamodel.VerifyPrimaryConfigSignature(configData, signing.SharedSignUtil())
+	if err != nil {
+		t.Fatal(err)
+	}
+	data, err := datamodel.EncodePrimaryConfigSnapshot(pc, configHash, signature, ac.libBindings.CMVersion())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err = os.WriteFile(snapshotPath, data, 0644); err != nil {
+		t.Fatal(err)
+	}
+	spc, _, err := ac.decodeConfigFile(configPath, false)
+	if err != nil || spc.ConfigVersion != "v1.from-snapshot" {
+		t.Fatal("Snapshot not used")
+	}
+
+	// A snapshot doesn't stand in for a config file which is no longer correctly signed, even if the hash matches
+	tamperedPath := filepath.Join(t.TempDir(), "tampered.cmconfig")
+	tamperedData := []byte(strings.Replace(string(configData), "ewogICAg", "ewogICAh", 1))
+	if err = os.WriteFile(tamperedPath, tamperedData, 0644); err != nil {
+		t.Fatal(err)
+	}
+	tamperedHash := fmt.Sprintf("%x", sha256.Sum256(tamperedData))
+	forged, err := datamodel.EncodePrimaryConfigSnapshot(pc, tamperedHash, signature, ac.libBindings.CMVersion())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err = ac.cache.writeConfigSnapshot(preparsedConfigCacheName, tamperedHash, forged); err != nil {
+		t.Fatal(err)
+	}
+	if _, _, err = ac.decodeConfigFile(tamperedPath, false); err == nil {
+		t.Fatal("Snapshot used for config file with invalid signature")
+	}
+	if err = os.WriteFile(snapshotPath, data, 0644); err != nil {
+		t.Fatal(err)
+	}
+
+	// Invalid snapshot falls back to the config file, and is replaced
+	if err = os.WriteFile(snapshotPath, []byte("corrupt"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	spc, _, err = ac.decodeConfigFile(configPath, false)
+	if err != nil || spc.ConfigVersion != "v1" {
+		t.Fatal("Didn't fall back from corrupt snapshot")
+	}
+	if data, err := os.ReadFile(snapshotPath); err != nil || string(data) == "corrupt" {
+		t.Fatal("Corrupt snapshot not replaced")
+	}
+
+	// Snapshots for other config files are removed when a new one is written
+	err = ac.cache.writeConfigSnapshot(preparsedConfigCacheName, "otherhash", data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := os.Stat(snapshotPath); !os.IsNotExist(err) {
+		t.Fatal("Prior snapshot not removed")
+	}
+	// Snapshots must not be mistaken for cached config files
+	if cachedPath, _ := ac.cache.existingCacheFileOfName(preparsedConfigCacheName); cachedPath != "" {
+		t.Fatal("Snapshot treated as a cached config file")
+	}
+}
+
 func TestLoadingEmptyUnsignedConfig(t *testing.T) {
 	// Signed special case: empty without signature should work
 	ac, err := buildTestAppCoreWithPath("../cmcore/data_model/test/testdata/primary_config/valid/emptyValid.json", t)
@@ -735,6 +931,123 @@ func TestLoadingEmptyUnsignedConfig(t *testing.T) {
 	}
 }
 
+func testStaleWhileRevalidateAppcore(t *testing.T, serverHandler http.HandlerFunc) (*Appcore, *httptest.Server) {
+	ac, err := buildTestAppCoreWithPath("../cmcore/data_model/test/testdata/primary_config/valid/emptyValid.json", t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	server := httptest.NewTLSServer(serverHandler)
+	t.Cleanup(server.Close)
+	priorClient := configHttpClient
+	configHttpClient = server.Client()
+	t.Cleanup(func() {
+		configHttpClient = priorClient
+	})
+	ac.configUrlString = server.URL
+	ac.SetStaleWhileRevalidate(true)
+	return ac, server
+}
+
+func TestStaleWhileRevalidateStartup(t *testing.T) {
+	signedConfig, err := os.ReadFile("../cmcore/data_model/test/testdata/primary_config/valid/signedValid.cmconfig")
+	if err != nil {
+		t.Fatal(err)
+	}
+	releaseServer := make(chan struct{})
+	ac, _ := testStaleWhileRevalidateAppcore(t, func(w http.ResponseWriter, r *http.Request) {
+		// Block until startup is complete, proving start doesn't wait on the network
+		<-releaseServer
+		w.Header().Set("ETag", "\"signed\"")
+		w.Write(signedConfig)
+	})
+
+	// Cached config from a prior session, downloaded an hour ago
+	cachedPath := filepath.Join(ac.cache.baseDirectory, "primary--etag--empty.config")
+	err = os.WriteFile(cachedPath, []byte("{}"), 0644)
+	if err != nil {
+		t.Fatal(err)
+	}
+	os.Chtimes(cachedPath, time.Now().Add(-time.Hour), time.Now().Add(-time.Hour))
+
+	if ac.ConfigVersionHash() != "" || ac.ConfigAgeSeconds() != -1 {
+		t.Fatal("Config version/age should be empty before start")
+	}
+	err = ac.Start(false)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if ac.ConfigVersionHash() != fmt.Sprintf("%x", sha256.Sum256([]byte("{}"))) || ac.config().ConfigVersion != "" {
+		t.Fatal("Didn't start with cached config")
+	}
+	if age := ac.ConfigAgeSeconds(); age < 3599 || age > 3700 {
+		t.Fatalf("Cached config age incorrect: %v", age)
+	}
+
+	// Process events on the cached config while the revalidation is in flight
+	err = ac.SendClientEvent("test")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	close(releaseServer)
+	ac.configRevalidation.Wait()
+	if ac.ConfigVersionHash() != fmt.Sprintf("%x", sha256.Sum256(signedConfig)) || ac.config().ConfigVersion != "v1" {
+		t.Fatal("Didn't swap in the updated config")
+	}
+	if age := ac.ConfigAgeSeconds(); age < 0 || age > 5 {
+		t.Fatalf("Updated config age incorrect: %v", age)
+	}
+	if ac.notificationPlan == nil {
+		t.Fatal("Notification plan not rebuilt for updated config")
+	}
+	if _, err := os.Stat(cachedPath); !os.IsNotExist(err) {
+		t.Fatal("Prior cached config not replaced")
+	}
+}
+
+func TestStaleWhileRevalidateKeepsCacheOnFailure(t *testing.T) {
+	ac, _ := testStaleWhileRevalidateAppcore(t, func(w http.ResponseWriter, r *http.Request) {
+		w.WriteHeader(http.StatusInternalServerError)
+	})
+	cachedPath := filepath.Join(ac.cache.baseDirectory, "primary--etag--empty.config")
+	err := os.WriteFile(cachedPath, []byte("{}"), 0644)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	err = ac.Start(false)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ac.configRevalidation.Wait()
+	if ac.ConfigVersionHash() != fmt.Sprintf("%x", sha256.Sum256([]byte("{}"))) {
+		t.Fatal("Cached config should be kept when revalidation fails")
+	}
+}
+
+func TestStaleWhileRevalidateWithoutCacheBlocks(t *testing.T) {
+	signedConfig, err := os.ReadFile("../cmcore/data_model/test/testdata/primary_config/valid/signedValid.cmconfig")
+	if err != nil {
+		t.Fatal(err)
+	}
+	ac, _ := testStaleWhileRevalidateAppcore(t, func(w http.ResponseWriter, r *http.Request) {
+		w.Header().Set("ETag", "\"signed\"")
+		w.Write(signedConfig)
+	})
+
+	// No cache: must load from network before start returns
+	err = ac.Start(false)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if ac.ConfigVersionHash() != fmt.Sprintf("%x", sha256.Sum256(signedConfig)) || ac.config().ConfigVersion != "v1" {
+		t.Fatal("Didn't load config from network on cold start")
+	}
+	if ac.needsConfigRevalidation {
+		t.Fatal("Revalidation not needed after a network load")
+	}
+}
+
 func TestLoadingJsonOnlyAllowedInDebug(t *testing.T) {
 	ac, err := testBuildValidTestAppCore(t)
 	if err != nil {
@@ -742,12 +1055,12 @@ func TestLoadingJsonOnlyAllowedInDebug(t *testing.T) {
 	}
 	// Debug=false should not allow unsigned
 	err = ac.Start(false)
-	if err == nil || ac.config != nil {
+	if err == nil || ac.config() != nil {
 		t.Fatal("Should not load json config unless in debug mode", err)
 	}
 	// Debug=true should load unsigned/json
 	err = ac.Start(true)
-	if err != nil || ac.config == nil || ac.config.AppId != "io.criticalmoments.demo" {
+	if err != nil || ac.config() == nil || ac.config().AppId != "io.criticalmoments.demo" {
 		t.Fatal("Should not load json config unless in debug mode")
 	}
 }
@@ -892,11 +1205,11 @@ func TestSetLogEvents(t *testing.T) {
 		t.Fatal(err)
 	}
 
-	if ac.eventManager.logEvents {
+	if ac.eventManager.logEvents.Load() {
 		t.Fatal("logEvents should be false by default")
 	}
 	ac.SetDeveloperMode(true)
-	if !ac.eventManager.logEvents {
+	if !ac.eventManager.logEvents.Load() {
 		t.Fatal("logEvents should be true after setting")
 	}
 }
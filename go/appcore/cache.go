@@ -1,6 +1,8 @@
 package appcore
 
 import (
+	"bytes"
+	"crypto/sha256"
 	"errors"
 	"fmt"
 	"io"
@@ -18,8 +20,10 @@ type cache struct {
 }
 
 const (
-	configFileSuffix = ".config"
-	etagDelim        = "--etag--"
+	configFileSuffix   = ".config"
+	etagDelim          = "--etag--"
+	snapshotFileSuffix = ".snapshot"
+	snapshotDelim      = "--snapshot--"
 )
 
 func newCacheWithBaseDir(cacheDirPath string) (*cache, error) {
@@ -36,6 +40,13 @@ func newCacheWithBaseDir(cacheDirPath string) (*cache, error) {
 }
 
 func (c *cache) verifyOrFetchRemoteConfigFile(rawUrl string, configFileName string) (filepath string, err error) {
+	filepath, _, err = c.verifyOrFetchRemoteConfigFileWithStatus(rawUrl, configFileName)
+	return filepath, err
+}
+
+// validated is true if the returned file was confirmed current with the server, and false if we fell back
+// to a cached file because the server couldn't be reached
+func (c *cache) verifyOrFetchRemoteConfigFileWithStatus(rawUrl string, configFileName string) (filepath string, validated bool, err error) {
 	// filename: primary--etag--[ETAG].config if etag, if not primary.config
 	// only one "primary*.config" at a time.
 
@@ -44,30 +55,27 @@ func (c *cache) verifyOrFetchRemoteConfigFile(rawUrl string, configFileName stri
 	// We force loading from origin by adding a unique query param
 	url, err := cacheBustUrl(rawUrl)
 	if err != nil {
-		return "", err
+		return "", false, err
 	}
 
 	// find existing config in cache
 	priorCached, priorEtag := c.existingCacheFileOfName(configFileName)
-	if priorEtag != "" {
-		// validate etag hasn't changed, so we don't have to request full file
-		currentEtag := fetchEtag(url)
-		if currentEtag == priorEtag {
-			return priorCached, nil
-		}
-	}
 
-	newCached, err := c.fetchAndCache(url, configFileName)
+	// Single conditional request: if the etag still matches, the server responds 304 without a body
+	newCached, notModified, err := c.fetchAndCacheIfNoneMatch(url, configFileName, priorEtag)
 	if err != nil {
 		if priorCached != "" {
 			fmt.Printf("CriticalMoments: Unable to update CM config file. This may be a temporarily a network issue (ie, you're offline). For now, CM will use a cached config file. Please verify url is valid if you're online and expect this to work: %v\n", url)
-			return priorCached, nil
+			return priorCached, false, nil
 		}
-		return "", nil
+		return "", false, nil
+	}
+	if notModified {
+		return priorCached, true, nil
 	}
 
-	// Prior cache has been replaced, delete it
-	if priorCached != "" {
+	// Prior cache has been replaced, delete it (unless the new file took the same name)
+	if priorCached != "" && priorCached != newCached {
 		err = os.Remove(priorCached)
 		if err != nil {
 			// Shouldn't happen, shouldn't be fatal if it does
@@ -75,7 +83,7 @@ func (c *cache) verifyOrFetchRemoteConfigFile(rawUrl string, configFileName stri
 		}
 	}
 
-	return newCached, nil
+	return newCached, true, nil
 
 }
 
@@ -108,35 +116,43 @@ func (c *cache) existingCacheFileOfName(fileName string) (path string, etag stri
 	return "", ""
 }
 
-func fetchEtag(url string) string {
-	var client = &http.Client{
-		Timeout: time.Second * 5,
-	}
-
-	response, err := client.Head(url)
-	if err != nil {
-		return ""
-	}
-
-	if response.StatusCode != http.StatusOK {
-		return ""
-	}
-
-	return cleanEtag(response.Header.Get("ETag"))
+// Shared by all config fetches, so connections are kept alive and reused. The transport requests gzip
+// and transparently decompresses, as long as we don't set Accept-Encoding ourselves.
+var configHttpClient = &http.Client{
+	Timeout:   time.Second * 20,
+	Transport: http.DefaultTransport.(*http.Transport).Clone(),
 }
 
 func (c *cache) fetchAndCache(url string, fileName string) (cachedFile string, err error) {
-	var client = &http.Client{
-		Timeout: time.Second * 20,
+	cachedFile, _, err = c.fetchAndCacheIfNoneMatch(url, fileName, "")
+	return cachedFile, err
+}
+
+// Fetches the url and caches it, unless the server's etag matches priorEtag (notModified, nothing written)
+func (c *cache) fetchAndCacheIfNoneMatch(url string, fileName string, priorEtag string) (cachedFile string, notModified bool, err error) {
+	request, err := http.NewRequest(http.MethodGet, url, nil)
+	if err != nil {
+		return "", false, err
+	}
+	if priorEtag != "" {
+		request.Header.Set("If-None-Match", fmt.Sprintf("\"%v\"", priorEtag))
 	}
 
-	response, err := client.Get(url)
+	response, err := configHttpClient.Do(request)
 	if err != nil {
-		return "", err
+		return "", false, err
 	}
+	defer func() {
+		// Drain so the connection can be reused
+		io.Copy(io.Discard, response.Body)
+		response.Body.Close()
+	}()
 
+	if response.StatusCode == http.StatusNotModified && priorEtag != "" {
+		return "", true, nil
+	}
 	if response.StatusCode != http.StatusOK {
-		return "", errors.New("failed to fetch config file")
+		return "", false, errors.New("failed to fetch config file")
 	}
 
 	cacheFileName := fileName + configFileSuffix
@@ -150,36 +166,61 @@ func (c *cache) fetchAndCache(url string, fileName string) (cachedFile string, e
 
 	cacheFileFullPath := filepath.Join(c.baseDirectory, cacheFileName)
 
-	// Read into memory and write to file atomically. We don't want a file
+	// Stream to a tmp file then move to make this atomic (via Rename). We don't want a file
 	// with an etag to be written, that isn't complete.
-	defer response.Body.Close()
-	bodyBytes, err := io.ReadAll(response.Body)
-	if err != nil {
-		return "", err
-	}
-
-	// Jump though hoops of write then move to make this atomic (via Rename)
 	tmpCache := filepath.Join(c.baseDirectory, "tmp")
 	err = os.MkdirAll(tmpCache, 0744)
 	if err != nil {
-		return "", err
+		return "", false, err
 	}
 	tmpFilePath := filepath.Join(tmpCache, fmt.Sprintf("%v", rand.Int()))
 	defer os.Remove(tmpFilePath)
-	err = os.WriteFile(tmpFilePath, bodyBytes, 0644)
+	tmpFile, err := os.OpenFile(tmpFilePath, os.O_WRONLY|os.O_CREATE|os.O_EXCL, 0644)
 	if err != nil {
-		return "", err
+		return "", false, err
+	}
+	hash := sha256.New()
+	_, err = io.Copy(io.MultiWriter(tmpFile, hash), response.Body)
+	closeErr := tmpFile.Close()
+	if err != nil {
+		return "", false, err
+	}
+	if closeErr != nil {
+		return "", false, closeErr
 	}
+
+	// Without an etag we can't skip the download, but can skip replacing an identical file
+	if etag == "" && priorEtag == "" {
+		if priorHash, err := fileSha256(cacheFileFullPath); err == nil && bytes.Equal(priorHash, hash.Sum(nil)) {
+			return "", true, nil
+		}
+	}
+
 	err = os.Rename(tmpFilePath, cacheFileFullPath)
 	if err != nil {
 		defer os.Remove(cacheFileFullPath)
-		return "", err
+		return "", false, err
 	}
 	if cacheFileFullPath == "" {
-		return "", errors.New("unknown issue caching config file")
+		return "", false, errors.New("unknown issue caching config file")
 	}
 
-	return cacheFileFullPath, nil
+	return cacheFileFullPath, false, nil
+}
+
+func fileSha256(path string) ([]byte, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	hash := sha256.New()
+	_, err = io.Copy(hash, f)
+	if err != nil {
+		return nil, err
+	}
+	return hash.Sum(nil), nil
 }
 
 func cleanEtag(etag string) string {
@@ -215,3 +256,53 @@ func cacheBustUrl(urlString string) (cacheBustUrl string, err error) {
 	url.RawQuery = values.Encode()
 	return url.String(), nil
 }
+
+// Pre-parsed config snapshots are stored as NAME--snapshot--SHA256.snapshot, keyed by the hash of the
+// config file they were decoded from. Returns nil if there is no snapshot for this exact config file.
+func (c *cache) readConfigSnapshot(fileName string, configHash string) []byte {
+	data, err := os.ReadFile(c.configSnapshotPath(fileName, configHash))
+	if err != nil {
+		return nil
+	}
+	return data
+}
+
+// Only one snapshot is kept per name; snapshots for prior config files are deleted.
+func (c *cache) writeConfigSnapshot(fileName string, configHash string, data []byte) error {
+	snapshotPath := c.configSnapshotPath(fileName, configHash)
+
+	// Write to a temp file and rename, so a partial snapshot is never read
+	tmpFile, err := os.CreateTemp(c.baseDirectory, fileName+snapshotDelim+"*.tmp")
+	if err != nil {
+		return err
+	}
+	_, err = tmpFile.Write(data)
+	closeErr := tmpFile.Close()
+	if err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(tmpFile.Name(), snapshotPath)
+	}
+	if err != nil {
+		os.Remove(tmpFile.Name())
+		return err
+	}
+
+	cacheFiles, err := os.ReadDir(c.baseDirectory)
+	if err != nil {
+		return nil
+	}
+	for _, file := range cacheFiles {
+		name := file.Name()
+		fullFilePath := filepath.Join(c.baseDirectory, name)
+		if !file.IsDir() && strings.HasPrefix(name, fileName+snapshotDelim) && strings.HasSuffix(name, snapshotFileSuffix) && fullFilePath != snapshotPath {
+			os.Remove(fullFilePath)
+		}
+	}
+	return nil
+}
+
+func (c *cache) configSnapshotPath(fileName string, configHash string) string {
+	return filepath.Join(c.baseDirectory, fileName+snapshotDelim+configHash+snapshotFileSuffix)
+}
@@ -0,0 +1,161 @@
+package appcore
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Lib bindings which can be called from several threads, like the iOS action queue
+type testConcurrentLibBindings struct {
+	testLibBindings
+	links atomic.Int64
+	plans atomic.Int64
+}
+
+func (lb *testConcurrentLibBindings) ShowLink(l *datamodel.LinkAction) error {
+	lb.links.Add(1)
+	return nil
+}
+func (lb *testConcurrentLibBindings) UpdateNotificationPlan(plan *NotificationPlan) error {
+	lb.plans.Add(1)
+	return nil
+}
+
+// Config with named conditions, link actions, triggers and notifications
+func testConcurrencyConfigJson(count int) string {
+	var conditions, actions, triggers, notifications []string
+	for i := 0; i < count; i++ {
+		conditions = append(conditions, fmt.Sprintf(`"condition%v": "eventCount('e%v') > 0 || platform == 'iOS'"`, i, i))
+		actions = append(actions, fmt.Sprintf(`"link%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, i, i))
+		triggers = append(triggers, fmt.Sprintf(`"trigger%v": {"eventName": "e%v", "actionName": "link%v"}`, i, i, i))
+		notifications = append(notifications, fmt.Sprintf(`"n%v": {"title": "t", "cancelationEvents": ["c%v"], "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": 3600}}`, i, i, i))
+	}
+	return fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"conditions": {"namedConditions": {%v}},
+		"actions": {"namedActions": {%v}},
+		"triggers": {"namedTriggers": {%v}},
+		"notifications": {%v}}`,
+		strings.Join(conditions, ","), strings.Join(actions, ","), strings.Join(triggers, ","), strings.Join(notifications, ","))
+}
+
+func testBuildConcurrentAppcore(tb testing.TB, count int) (*Appcore, *testConcurrentLibBindings) {
+	configPath := filepath.Join(tb.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(testConcurrencyConfigJson(count)), 0644); err != nil {
+		tb.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, db.NewMemoryDB(), tb)
+	if err != nil {
+		tb.Fatal(err)
+	}
+	lb := &testConcurrentLibBindings{}
+	ac.RegisterLibraryBindings(lb)
+	if err := ac.Start(true); err != nil {
+		tb.Fatal(err)
+	}
+	return ac, lb
+}
+
+// Run with -race: every public entry point the lib calls from its action queue, in parallel
+func TestConcurrentAppcoreUse(t *testing.T) {
+	ac, lb := testBuildConcurrentAppcore(t, 10)
+	// Exercise debounced plan updates too
+	ac.notificationPlanDebounce = 1
+
+	const goroutines = 8
+	const iterations = 200
+	var wg sync.WaitGroup
+	var performed atomic.Int64
+	errs := make(chan error, goroutines*iterations)
+	for g := 0; g < goroutines; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < iterations; i++ {
+				n := (g + i) % 10
+				switch i % 6 {
+				case 0:
+					if _, err := ac.CheckNamedCondition(fmt.Sprintf("condition%v", n)); err != nil && strings.Contains(err.Error(), "panic") {
+						errs <- err
+					}
+				case 1:
+					performed.Add(1)
+					if err := ac.PerformNamedAction(fmt.Sprintf("link%v", n)); err != nil {
+						errs <- err
+					}
+				case 2:
+					if err := ac.SendClientEvent(fmt.Sprintf("c%v", n)); err != nil {
+						errs <- err
+					}
+				case 3:
+					if err := ac.RegisterClientIntProperty(fmt.Sprintf("prop%v", n), i); err != nil {
+						errs <- err
+					}
+				case 4:
+					if _, err := ac.FetchNotificationPlan(); err != nil {
+						errs <- err
+					}
+					ac.SetDeveloperMode(false)
+				default:
+					if _, err := ac.PerformBackgroundWork(); err != nil {
+						errs <- err
+					}
+				}
+			}
+		}(g)
+	}
+	wg.Wait()
+	close(errs)
+	for err := range errs {
+		t.Fatal(err)
+	}
+	if lb.links.Load() != performed.Load() {
+		t.Fatalf("Expected %v links shown, got %v", performed.Load(), lb.links.Load())
+	}
+}
+
+func TestPropertyRegistrationsAreSnapshots(t *testing.T) {
+	pr := newPropertyRegistry()
+	before := pr.registrations()
+	if err := pr.registerStaticProperty("app_version", datamodel.NewStringPropertyValue("1.0")); err != nil {
+		t.Fatal(err)
+	}
+	if before.providers["app_version"] != nil || pr.provider("app_version") == nil {
+		t.Fatal("Registration mutated the published snapshot")
+	}
+}
+
+// Compare ns/op with -cpu 1,2,4,8. Lookups and evaluation read snapshots without locking; the shared locks left are
+// around the events each call records (DB insert, notification state).
+func BenchmarkParallelCheckNamedCondition(b *testing.B) {
+	ac, _ := testBuildConcurrentAppcore(b, 100)
+	var next atomic.Int64
+	b.ReportAllocs()
+	b.ResetTimer()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			ac.CheckNamedCondition(fmt.Sprintf("condition%v", next.Add(1)%100))
+		}
+	})
+}
+
+func BenchmarkParallelPerformNamedAction(b *testing.B) {
+	ac, _ := testBuildConcurrentAppcore(b, 100)
+	var next atomic.Int64
+	b.ReportAllocs()
+	b.ResetTimer()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			if err := ac.PerformNamedAction(fmt.Sprintf("link%v", next.Add(1)%100)); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
@@ -0,0 +1,265 @@
+package appcore
+
+import (
+	"encoding/json"
+	"errors"
+	"sync"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+	"github.com/antonmedv/expr"
+	"golang.org/x/exp/slices"
+)
+
+/*
+Condition profiler
+
+Opt-in (SetConditionProfilingEnabled), per condition stats from propertyRegistry.evaluateCondition: evaluation count,
+total and p99 time, results (true/false/error), and the property fetches and dynamic function calls (eventCount,
+canOpenUrl, ...) made while evaluating, by name, with their time. Instrumentation (instrumentation.go) shows which
+stage is slow; this shows which condition in the config is responsible.
+
+When disabled the cost is one atomic load per evaluation. When enabled, each evaluation allocates a trace, and the
+dynamic functions are wrapped to count calls, so it's for debug builds and profiling sessions, not always on.
+
+Stats are keyed by condition, and attributed to the config entity (named condition, trigger, action or
+notification) when the report is generated (ConditionProfileReport), using the names from PrimaryConfig. Conditions
+not in the current config (test conditions, or a config since replaced) are reported as "unknown". Static helper
+functions (versionGreaterThan, formatTime, ...) are pure and fast, and aren't counted.
+*/
+
+// Bounds memory if callers evaluate many distinct conditions (each test condition is new). Past the limit, new
+// conditions are counted in droppedEvaluations only.
+const maxProfiledConditions = 4096
+
+type profileCallCount struct {
+	count   int64
+	totalNs int64
+}
+
+func (c *profileCallCount) add(d time.Duration) {
+	c.count++
+	c.totalNs += max(int64(d), 0)
+}
+
+type conditionProfile struct {
+	latency         latencyHistogram
+	passed          int64
+	failed          int64
+	errored         int64
+	propertyFetches map[string]*profileCallCount
+	functionCalls   map[string]*profileCallCount
+}
+
+type conditionProfiler struct {
+	lock               sync.Mutex
+	profiles           map[*datamodel.Condition]*conditionProfile
+	droppedEvaluations int64
+}
+
+func newConditionProfiler() *conditionProfiler {
+	return &conditionProfiler{
+		profiles: make(map[*datamodel.Condition]*conditionProfile),
+	}
+}
+
+// Calls made during one evaluation. Expr calls functions on the evaluating goroutine, so no locking needed.
+// Methods are no-ops on a nil trace (profiling disabled).
+type conditionTrace struct {
+	propertyFetches map[string]*profileCallCount
+	functionCalls   map[string]*profileCallCount
+}
+
+func newConditionTrace() *conditionTrace {
+	return &conditionTrace{
+		propertyFetches: make(map[string]*profileCallCount),
+		functionCalls:   make(map[string]*profileCallCount),
+	}
+}
+
+func (t *conditionTrace) propertyFetched(name string, start time.Time) {
+	if t == nil {
+		return
+	}
+	addProfileCall(t.propertyFetches, name, time.Since(start))
+}
+
+func (t *conditionTrace) functionCalled(name string, start time.Time) {
+	if t == nil {
+		return
+	}
+	addProfileCall(t.functionCalls, name, time.Since(start))
+}
+
+func addProfileCall(calls map[string]*profileCallCount, name string, d time.Duration) {
+	c := calls[name]
+	if c == nil {
+		c = &profileCallCount{}
+		calls[name] = c
+	}
+	c.add(d)
+}
+
+// The registered dynamic functions, wrapped to record calls on this trace
+func (t *conditionTrace) dynamicFunctionOps(r *propertyRegistrations) []expr.Option {
+	ops := make([]expr.Option, 0, len(r.dynamicFunctions))
+	for i, function := range r.dynamicFunctions {
+		name := r.dynamicFunctionNames[i]
+		f := function.Function
+		traced := func(params ...any) (any, error) {
+			defer t.functionCalled(name, time.Now())
+			return f(params...)
+		}
+		ops = append(ops, expr.Function(name, traced, function.Types...))
+	}
+	return ops
+}
+
+func (p *conditionProfiler) record(condition *datamodel.Condition, trace *conditionTrace, start time.Time, result *bool, err *error) {
+	duration := time.Since(start)
+
+	p.lock.Lock()
+	defer p.lock.Unlock()
+	profile := p.profiles[condition]
+	if profile == nil {
+		if len(p.profiles) >= maxProfiledConditions {
+			p.droppedEvaluations++
+			return
+		}
+		profile = &conditionProfile{
+			propertyFetches: make(map[string]*profileCallCount),
+			functionCalls:   make(map[string]*profileCallCount),
+		}
+		p.profiles[condition] = profile
+	}
+
+	profile.latency.record(duration)
+	if *err != nil {
+		profile.errored++
+	} else if *result {
+		profile.passed++
+	} else {
+		profile.failed++
+	}
+	mergeProfileCalls(profile.propertyFetches, trace.propertyFetches)
+	mergeProfileCalls(profile.functionCalls, trace.functionCalls)
+}
+
+func mergeProfileCalls(into map[string]*profileCallCount, from map[string]*profileCallCount) {
+	for name, c := range from {
+		total := into[name]
+		if total == nil {
+			total = &profileCallCount{}
+			into[name] = total
+		}
+		total.count += c.count
+		total.totalNs += c.totalNs
+	}
+}
+
+// JSON report format
+type conditionProfileReport struct {
+	Conditions         []*conditionProfileReportEntry `json:"conditions"`
+	DroppedEvaluations int64                          `json:"droppedEvaluations,omitempty"`
+}
+
+type conditionProfileReportEntry struct {
+	Entity           string                                 `json:"entity"`
+	Condition        string                                 `json:"condition"`
+	Evaluations      int64                                  `json:"evaluations"`
+	TotalNanoseconds int64                                  `json:"totalNanoseconds"`
+	P99Nanoseconds   int64                                  `json:"p99Nanoseconds"`
+	Passed           int64                                  `json:"passed"`
+	Failed           int64                                  `json:"failed"`
+	Errors           int64                                  `json:"errors"`
+	PropertyFetches  map[string]*conditionProfileReportCall `json:"propertyFetches,omitempty"`
+	FunctionCalls    map[string]*conditionProfileReportCall `json:"functionCalls,omitempty"`
+}
+
+type conditionProfileReportCall struct {
+	Count            int64 `json:"count"`
+	TotalNanoseconds int64 `json:"totalNanoseconds"`
+}
+
+// Entries ordered by total time, most first
+func (p *conditionProfiler) report(entities map[*datamodel.Condition]string) *conditionProfileReport {
+	p.lock.Lock()
+	defer p.lock.Unlock()
+
+	report := &conditionProfileReport{
+		Conditions:         make([]*conditionProfileReportEntry, 0, len(p.profiles)),
+		DroppedEvaluations: p.droppedEvaluations,
+	}
+	for condition, profile := range p.profiles {
+		entity, ok := entities[condition]
+		if !ok {
+			entity = "unknown"
+		}
+		var buckets [latencyBucketCount]int64
+		var bucketTotal int64
+		for i := range profile.latency.buckets {
+			buckets[i] = profile.latency.buckets[i].Load()
+			bucketTotal += buckets[i]
+		}
+		report.Conditions = append(report.Conditions, &conditionProfileReportEntry{
+			Entity:           entity,
+			Condition:        condition.String(),
+			Evaluations:      profile.latency.count.Load(),
+			TotalNanoseconds: profile.latency.totalNs.Load(),
+			P99Nanoseconds:   latencyPercentile(&buckets, bucketTotal, 0.99),
+			Passed:           profile.passed,
+			Failed:           profile.failed,
+			Errors:           profile.errored,
+			PropertyFetches:  conditionProfileReportCalls(profile.propertyFetches),
+			FunctionCalls:    conditionProfileReportCalls(profile.functionCalls),
+		})
+	}
+	slices.SortFunc(report.Conditions, func(a, b *conditionProfileReportEntry) bool {
+		if a.TotalNanoseconds != b.TotalNanoseconds {
+			return a.TotalNanoseconds > b.TotalNanoseconds
+		}
+		if a.Entity != b.Entity {
+			return a.Entity < b.Entity
+		}
+		return a.Condition < b.Condition
+	})
+	return report
+}
+
+func conditionProfileReportCalls(calls map[string]*profileCallCount) map[string]*conditionProfileReportCall {
+	if len(calls) == 0 {
+		return nil
+	}
+	reportCalls := make(map[string]*conditionProfileReportCall, len(calls))
+	for name, c := range calls {
+		reportCalls[name] = &conditionProfileReportCall{Count: c.count, TotalNanoseconds: c.totalNs}
+	}
+	return reportCalls
+}
+
+// Enabling starts a new profile, discarding any previous one. Disabling discards the profile.
+func (ac *Appcore) SetConditionProfilingEnabled(enabled bool) {
+	if enabled {
+		ac.propertyRegistry.profiler.Store(newConditionProfiler())
+	} else {
+		ac.propertyRegistry.profiler.Store(nil)
+	}
+}
+
+// JSON report of the condition profile, see condition_profiler.go. Errors if profiling isn't enabled.
+func (ac *Appcore) ConditionProfileReport() (string, error) {
+	profiler := ac.propertyRegistry.profiler.Load()
+	if profiler == nil {
+		return "", errors.New("CriticalMoments: condition profiling not enabled")
+	}
+
+	entities := map[*datamodel.Condition]string{}
+	if config := ac.config(); config != nil {
+		entities = config.ConditionEntities()
+	}
+	reportJson, err := json.Marshal(profiler.report(entities))
+	if err != nil {
+		return "", err
+	}
+	return string(reportJson), nil
+}
@@ -0,0 +1,121 @@
+package appcore
+
+import (
+	"encoding/json"
+	"errors"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+func TestConditionProfileReport(t *testing.T) {
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"conditions": {"namedConditions": {"pass": "true", "fail": "false"}},
+		"actions": {"namedActions": {"link0": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/0"}}}},
+		"triggers": {"namedTriggers": {"t": {"eventName": "e", "actionName": "link0", "condition": "true"}}}}`
+	ac, lb := testBuildManyTriggersAppcore(t, config, 0, nil)
+
+	if _, err := ac.ConditionProfileReport(); err == nil {
+		t.Fatal("Expected error when profiling disabled")
+	}
+	ac.SetConditionProfilingEnabled(true)
+	for i := 0; i < 3; i++ {
+		if r, err := ac.CheckNamedCondition("pass"); err != nil || !r {
+			t.Fatal("Expected pass")
+		}
+	}
+	if r, err := ac.CheckNamedCondition("fail"); err != nil || r {
+		t.Fatal("Expected fail")
+	}
+	if err := ac.SendClientEvent("e"); err != nil || len(lb.links) != 1 {
+		t.Fatal("Expected trigger to fire")
+	}
+
+	reportJson, err := ac.ConditionProfileReport()
+	if err != nil {
+		t.Fatal(err)
+	}
+	var report conditionProfileReport
+	if err := json.Unmarshal([]byte(reportJson), &report); err != nil {
+		t.Fatal(err)
+	}
+	entries := map[string]*conditionProfileReportEntry{}
+	for i, entry := range report.Conditions {
+		entries[entry.Entity] = entry
+		if i > 0 && report.Conditions[i-1].TotalNanoseconds < entry.TotalNanoseconds {
+			t.Fatal("Expected entries ordered by total time")
+		}
+	}
+	if len(entries) != 3 {
+		t.Fatalf("Expected 3 profiled conditions, got %v", reportJson)
+	}
+	pass := entries["condition:pass"]
+	if pass == nil || pass.Condition != "true" || pass.Evaluations != 3 || pass.Passed != 3 || pass.Failed != 0 || pass.TotalNanoseconds <= 0 || pass.P99Nanoseconds <= 0 {
+		t.Fatalf("Unexpected profile for named condition: %+v", pass)
+	}
+	if fail := entries["condition:fail"]; fail == nil || fail.Evaluations != 1 || fail.Failed != 1 || fail.Passed != 0 {
+		t.Fatalf("Unexpected profile for failing condition: %+v", fail)
+	}
+	if trigger := entries["trigger:t"]; trigger == nil || trigger.Evaluations != 1 || trigger.Passed != 1 {
+		t.Fatalf("Unexpected profile for trigger condition: %+v", trigger)
+	}
+
+	// Re-enabling starts a new profile, disabling stops recording
+	ac.SetConditionProfilingEnabled(true)
+	if reportJson, _ := ac.ConditionProfileReport(); reportJson != `{"conditions":[]}` {
+		t.Fatalf("Expected empty profile, got %v", reportJson)
+	}
+	ac.SetConditionProfilingEnabled(false)
+	ac.CheckNamedCondition("pass")
+	if ac.propertyRegistry.profiler.Load() != nil {
+		t.Fatal("Expected no profiler")
+	}
+}
+
+func TestConditionProfilerRecord(t *testing.T) {
+	p := newConditionProfiler()
+	named, _ := datamodel.NewCondition("true")
+	other, _ := datamodel.NewCondition("false")
+
+	for i := 0; i < 2; i++ {
+		trace := newConditionTrace()
+		trace.propertyFetched("platform", time.Now())
+		trace.functionCalled("eventCount", time.Now())
+		trace.functionCalled("eventCount", time.Now())
+		result, err := true, error(nil)
+		if i == 1 {
+			result, err = false, errors.New("failed")
+		}
+		p.record(named, trace, time.Now(), &result, &err)
+	}
+	result, err := false, error(nil)
+	p.record(other, newConditionTrace(), time.Now(), &result, &err)
+
+	report := p.report(map[*datamodel.Condition]string{named: "condition:named"})
+	if len(report.Conditions) != 2 {
+		t.Fatal("Expected two conditions")
+	}
+	var namedEntry, otherEntry *conditionProfileReportEntry
+	for _, entry := range report.Conditions {
+		if entry.Entity == "condition:named" {
+			namedEntry = entry
+		} else {
+			otherEntry = entry
+		}
+	}
+	if namedEntry == nil || namedEntry.Evaluations != 2 || namedEntry.Passed != 1 || namedEntry.Errors != 1 || namedEntry.Failed != 0 {
+		t.Fatalf("Unexpected results: %+v", namedEntry)
+	}
+	if namedEntry.PropertyFetches["platform"].Count != 2 || namedEntry.FunctionCalls["eventCount"].Count != 4 {
+		t.Fatal("Unexpected call counts")
+	}
+	if otherEntry == nil || otherEntry.Entity != "unknown" || otherEntry.Failed != 1 || otherEntry.PropertyFetches != nil {
+		t.Fatalf("Expected unattributed condition reported as unknown: %+v", otherEntry)
+	}
+
+	// Nil trace is a no-op when profiling is disabled
+	var nilTrace *conditionTrace
+	nilTrace.propertyFetched("platform", time.Now())
+	nilTrace.functionCalled("eventCount", time.Now())
+}
@@ -0,0 +1,114 @@
+package db
+
+import (
+	"context"
+	"math"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Default number of rows fetched per page by cursors. Bounds memory used while iterating long histories.
+const DefaultCursorPageSize = 500
+
+// Cursor iterates rows in created_at order, fetching one page at a time (keyset pagination, not OFFSET).
+// Memory use is bounded by the page size, regardless of how many rows exist. Iteration stops early if
+// the context is cancelled, which is reported by Err().
+//
+//	c := db.EventTimesByNameCursor(ctx, "name", DefaultCursorPageSize)
+//	defer c.Close()
+//	for c.Next() {
+//		t := c.Value()
+//	}
+//	if err := c.Err(); err != nil { ... }
+type Cursor[T any] struct {
+	ctx      context.Context
+	pageSize int
+	// Appends the next page (up to limit rows, after the last row fetched) to buf and returns it
+	fetchPage func(buf []T, limit int) ([]T, error)
+
+	page      []T
+	index     int
+	current   T
+	exhausted bool
+	err       error
+}
+
+func newCursor[T any](ctx context.Context, pageSize int, fetchPage func(buf []T, limit int) ([]T, error)) *Cursor[T] {
+	if pageSize <= 0 {
+		pageSize = DefaultCursorPageSize
+	}
+	return &Cursor[T]{
+		ctx:       ctx,
+		pageSize:  pageSize,
+		fetchPage: fetchPage,
+	}
+}
+
+func newErrorCursor[T any](err error) *Cursor[T] {
+	return &Cursor[T]{
+		err: err,
+	}
+}
+
+// Advances to the next row. Returns false when there are no more rows, or on error (check Err).
+func (c *Cursor[T]) Next() bool {
+	if c.err != nil {
+		return false
+	}
+	if c.index >= len(c.page) {
+		if c.exhausted {
+			return false
+		}
+		if err := c.ctx.Err(); err != nil {
+			c.err = err
+			return false
+		}
+		// Reuse the page buffer, so iterating allocates once per cursor, not per page
+		page, err := c.fetchPage(c.page[:0], c.pageSize)
+		if err != nil {
+			c.err = err
+			return false
+		}
+		c.page = page
+		c.index = 0
+		if len(page) < c.pageSize {
+			c.exhausted = true
+		}
+		if len(page) == 0 {
+			return false
+		}
+	}
+
+	c.current = c.page[c.index]
+	c.index++
+	return true
+}
+
+// The current row. Only valid after Next() returns true.
+func (c *Cursor[T]) Value() T {
+	return c.current
+}
+
+func (c *Cursor[T]) Err() error {
+	return c.err
+}
+
+// Releases the page buffer. Further calls to Next() return false.
+func (c *Cursor[T]) Close() {
+	c.page = nil
+	c.index = 0
+	c.exhausted = true
+}
+
+type PropertyHistoryRow struct {
+	Value      interface{}
+	SampleType datamodel.CMPropertySampleType
+	CreatedAt  time.Time
+}
+
+func timeFromEpochSeconds(epochTime float64) time.Time {
+	_, fractionalSeconds := math.Modf(epochTime)
+	nanoseconds := int64(fractionalSeconds * 1_000_000_000)
+	return time.Unix(int64(epochTime), nanoseconds)
+}
@@ -0,0 +1,248 @@
+package db
+
+import (
+	"context"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Inserts an event with a specific created_at time, for the given backend
+type testInsertEventAt func(name string, createdAt time.Time)
+
+func testSqlInsertEventAt(db *DB, t *testing.T) testInsertEventAt {
+	return func(name string, createdAt time.Time) {
+		e, err := datamodel.NewCustomEventWithName(name)
+		if err != nil {
+			t.Fatal(err)
+		}
+		err = db.InsertEvent(e)
+		if err != nil {
+			t.Fatal(err)
+		}
+		_, err = db.sqldb.Exec(`UPDATE events SET created_at = ? WHERE id = (SELECT MAX(id) FROM events)`, float64(createdAt.UnixMilli())/1000.0)
+		if err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func TestEventTimesCursor(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+	testEventTimesCursor(db, testSqlInsertEventAt(db, t), t)
+}
+
+func TestMemoryDBEventTimesCursor(t *testing.T) {
+	db := testBuildMemoryDb(t)
+	testEventTimesCursor(db, db.insertEventTime, t)
+}
+
+func testEventTimesCursor(s Storage, insert testInsertEventAt, t *testing.T) {
+	c := s.EventTimesByNameCursor(context.Background(), "test", 3)
+	if c.Next() || c.Err() != nil {
+		t.Fatal("Expected empty cursor")
+	}
+
+	// Include runs of identical times which straddle page boundaries, and out of order inserts
+	base := time.UnixMilli(time.Now().Add(-time.Hour).UnixMilli())
+	offsets := []int{5, 1, 2, 2, 2, 2, 3, 9, 4, 4, 7, 0, 8, 8, 8}
+	for _, o := range offsets {
+		insert("test", base.Add(time.Duration(o)*time.Second))
+	}
+	insert("other", base)
+
+	expected, err := s.AllEventTimesByName("test")
+	if err != nil || len(expected) != len(offsets) {
+		t.Fatal("Failed to load expected event times")
+	}
+
+	for _, pageSize := range []int{1, 3, 4, len(offsets), 100} {
+		c := s.EventTimesByNameCursor(context.Background(), "test", pageSize)
+		count := 0
+		for c.Next() {
+			if count >= len(expected) || c.Value().Sub(expected[count]).Abs() >= time.Millisecond {
+				t.Fatalf("Cursor out of order or repeated rows with page size %v", pageSize)
+			}
+			count++
+		}
+		if c.Err() != nil || count != len(expected) {
+			t.Fatalf("Cursor returned %v rows with page size %v, expected %v", count, pageSize, len(expected))
+		}
+		c.Close()
+		if c.Next() {
+			t.Fatal("Closed cursor returned rows")
+		}
+	}
+
+	// Rows inserted later in the order while iterating should be seen, and never duplicated
+	c = s.EventTimesByNameCursor(context.Background(), "test", 4)
+	count := 0
+	for c.Next() {
+		if count == 2 {
+			insert("test", base.Add(time.Minute))
+		}
+		count++
+	}
+	if c.Err() != nil || count != len(offsets)+1 {
+		t.Fatal("Cursor didn't see row inserted while iterating")
+	}
+
+	// Cancel stops iteration at the next page
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+	c = s.EventTimesByNameCursor(ctx, "test", 2)
+	count = 0
+	for c.Next() {
+		count++
+		cancel()
+	}
+	if count != 2 || c.Err() != context.Canceled {
+		t.Fatal("Cursor didn't stop on cancel")
+	}
+}
+
+func TestPropertyHistoryCursor(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+	testPropertyHistoryCursor(db, func() {
+		// Move history into the past, to avoid the sampling rate limit
+		_, err := db.sqldb.Exec(`UPDATE property_history SET created_at = created_at - 600`)
+		if err != nil {
+			t.Fatal(err)
+		}
+	}, t)
+}
+
+func TestMemoryDBPropertyHistoryCursor(t *testing.T) {
+	db := testBuildMemoryDb(t)
+	testPropertyHistoryCursor(db, func() {
+		for _, history := range db.propertyHistory {
+			for i := range history {
+				history[i].createdAt = history[i].createdAt.Add(-600 * time.Second)
+			}
+		}
+	}, t)
+}
+
+func testPropertyHistoryCursor(s Storage, ageHistory func(), t *testing.T) {
+	values := []interface{}{"a", 1, 2.5, true, time.UnixMicro(1700000000123456), "b"}
+	for _, v := range values {
+		err := s.InsertPropertyHistory("prop", datamodel.PropertyValueFromInterface(v), datamodel.CMPropertySampleTypeOnUse)
+		if err != nil {
+			t.Fatal(err)
+		}
+		ageHistory()
+	}
+
+	c := s.PropertyHistoryCursor(context.Background(), "prop", 4)
+	rows := []PropertyHistoryRow{}
+	for c.Next() {
+		rows = append(rows, c.Value())
+	}
+	if c.Err() != nil || len(rows) != len(values) {
+		t.Fatal("Property history cursor returned wrong number of rows")
+	}
+	expected := []interface{}{"a", int64(1), 2.5, true, time.UnixMicro(1700000000123456), "b"}
+	for i, row := range rows {
+		if tm, ok := expected[i].(time.Time); ok {
+			if rt, ok := row.Value.(time.Time); !ok || !rt.Equal(tm) {
+				t.Fatal("Property history cursor returned wrong time value")
+			}
+		} else if row.Value != expected[i] {
+			t.Fatalf("Property history cursor returned %v, expected %v", row.Value, expected[i])
+		}
+		if row.SampleType != datamodel.CMPropertySampleTypeOnUse {
+			t.Fatal("Property history cursor returned wrong sample type")
+		}
+		if i > 0 && row.CreatedAt.Before(rows[i-1].CreatedAt) {
+			t.Fatal("Property history cursor out of order")
+		}
+	}
+
+	c = s.PropertyHistoryCursor(context.Background(), "missing", 4)
+	if c.Next() || c.Err() != nil {
+		t.Fatal("Expected empty property history cursor")
+	}
+}
+
+func TestCursorNotStarted(t *testing.T) {
+	for _, s := range []Storage{NewDB(), NewMemoryDB()} {
+		c := s.EventTimesByNameCursor(context.Background(), "test", 10)
+		if c.Next() || c.Err() == nil {
+			t.Fatal("Cursor allowed before DB started")
+		}
+		pc := s.PropertyHistoryCursor(context.Background(), "test", 10)
+		if pc.Next() || pc.Err() == nil {
+			t.Fatal("Property cursor allowed before DB started")
+		}
+	}
+}
+
+func TestCursorQueriesUseIndex(t *testing.T) {
+	testSqlExplainIncludes(eventTimesByNameFirstPageQuery, "USING COVERING INDEX events_name_created_at", t, "test", 10)        // add_test_count
+	testSqlExplainIncludes(eventTimesByNameNextPageQuery, "USING COVERING INDEX events_name_created_at", t, "test", 1.0, 1, 10) // add_test_count
+	testSqlExplainIncludes(propertyHistoryFirstPageQuery, "USING INDEX property_history_name_created_at", t, "test", 10)        // add_test_count
+	testSqlExplainIncludes(propertyHistoryNextPageQuery, "USING INDEX property_history_name_created_at", t, "test", 1.0, 1, 10) // add_test_count
+}
+
+// Streaming 1M event times should allocate one page, where AllEventTimesByName allocates all rows
+func BenchmarkEventTimesCursor(b *testing.B) {
+	t := &testing.T{}
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	_, err := db.sqldb.Exec(`
+		WITH RECURSIVE seq(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM seq WHERE i < 1000000)
+		INSERT INTO events (name, type) SELECT 'bench', 2 FROM seq;
+	`)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("cursor", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			c := db.EventTimesByNameCursor(context.Background(), "bench", DefaultCursorPageSize)
+			count := 0
+			for c.Next() {
+				count++
+			}
+			if c.Err() != nil || count != 1000000 {
+				b.Fatal("cursor failed")
+			}
+		}
+	})
+	b.Run("all", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			times, err := db.AllEventTimesByName("bench")
+			if err != nil || len(times) != 1000000 {
+				b.Fatal("all failed")
+			}
+		}
+	})
+}
+
+func BenchmarkMemoryDBEventTimesCursor(b *testing.B) {
+	db := NewMemoryDB()
+	db.StartWithPath("")
+	base := time.Now().Add(-365 * 24 * time.Hour)
+	for i := 0; i < 1000000; i++ {
+		db.insertEventTime("bench", base.Add(time.Duration(i)*time.Second))
+	}
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		c := db.EventTimesByNameCursor(context.Background(), "bench", DefaultCursorPageSize)
+		count := 0
+		for c.Next() {
+			count++
+		}
+		if c.Err() != nil || count != 1000000 {
+			b.Fatal("cursor failed")
+		}
+	}
+}
@@ -1,6 +1,7 @@
 package db
 
 import (
+	"context"
 	"database/sql"
 	"errors"
 	"fmt"
@@ -9,6 +10,8 @@ import (
 	"os"
 	"reflect"
 	"strings"
+	"sync"
+	"sync/atomic"
 	"time"
 
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
@@ -18,15 +21,33 @@ import (
 type DB struct {
 	databasePath string
 	sqldb        *sql.DB
-	started      bool
+	// Atomic: the DB may be opened on a background goroutine (see Appcore startup), while property history
+	// checks it from any thread
+	started atomic.Bool
 
 	propertyHistoryManager *PropertyHistoryManager
+
+	// Events waiting to be written in one transaction. See QueueEvent
+	queuedEventsLock sync.Mutex
+	queuedEvents     []queuedEvent
+	// Consecutive failed writes of the queue
+	queuedEventsFailedFlushes int
+}
+
+type queuedEvent struct {
+	event     *datamodel.Event
+	createdAt time.Time
 }
 
+// Queued events are written once this many are waiting, even if nothing reads them
+const maxQueuedEvents = 64
+
+// A failed write keeps the queue, and the next flush retries it. After this many consecutive failures the queue is
+// dropped, so a batch which can't be written doesn't fail every read.
+const maxQueuedEventsFlushAttempts = 3
+
 func NewDB() *DB {
-	db := DB{
-		started: false,
-	}
+	db := DB{}
 
 	db.propertyHistoryManager = newPropertyHistoryManager(&db)
 
@@ -55,15 +76,22 @@ func (db *DB) StartWithPath(dataDir string) error {
 	}
 
 	db.sqldb = sqldb
-	db.started = true
+	db.started.Store(true)
 	return nil
 }
 
 func (db *DB) Close() error {
-	db.started = false
+	if err := db.FlushQueuedEvents(); err != nil {
+		fmt.Printf("CriticalMoments: issue writing queued events on close: %v\n", err)
+	}
+	db.started.Store(false)
 	return db.sqldb.Close()
 }
 
+func (db *DB) Started() bool {
+	return db.started.Load()
+}
+
 func (db *DB) PropertyHistoryManager() *PropertyHistoryManager {
 	return db.propertyHistoryManager
 }
@@ -76,7 +104,14 @@ func migrate(sqldb *sql.DB) error {
 		return errors.New("CriticalMoments: DB not started")
 	}
 
-	_, err := sqldb.Exec(`
+	// Check before creating, so we know if we need to backfill the event count buckets from existing events
+	var eventCountBucketsExists int
+	err := sqldb.QueryRow(`SELECT COUNT(*) FROM sqlite_schema WHERE type='table' AND name='event_count_buckets'`).Scan(&eventCountBucketsExists)
+	if err != nil {
+		return err
+	}
+
+	_, err = sqldb.Exec(`
 		CREATE TABLE IF NOT EXISTS events (
 			id INTEGER PRIMARY KEY,
 			name TEXT NOT NULL,
@@ -125,18 +160,68 @@ func migrate(sqldb *sql.DB) error {
 		BEGIN
 			UPDATE property_history SET updated_at =unixepoch('subsec') WHERE id = NEW.id;
 		END;
+
+		CREATE TABLE IF NOT EXISTS event_count_buckets (
+			name TEXT NOT NULL,
+			bucket_size INTEGER NOT NULL,
+			bucket_start INTEGER NOT NULL,
+			count INTEGER NOT NULL,
+			PRIMARY KEY (name, bucket_size, bucket_start)
+		) WITHOUT ROWID;
+
+		-- created_at is set by the insert trigger above, so bucket on created_at being set (or changed)
+		CREATE TRIGGER IF NOT EXISTS add_event_count_buckets
+		AFTER UPDATE OF name, created_at ON events
+		WHEN NEW.created_at IS NOT NULL
+		BEGIN
+			INSERT OR IGNORE INTO event_count_buckets (name, bucket_size, bucket_start, count) VALUES
+				(NEW.name, 3600, CAST(NEW.created_at / 3600 AS INTEGER) * 3600, 0),
+				(NEW.name, 86400, CAST(NEW.created_at / 86400 AS INTEGER) * 86400, 0);
+			UPDATE event_count_buckets SET count = count + 1
+			WHERE name = NEW.name AND (
+				(bucket_size = 3600 AND bucket_start = CAST(NEW.created_at / 3600 AS INTEGER) * 3600) OR
+				(bucket_size = 86400 AND bucket_start = CAST(NEW.created_at / 86400 AS INTEGER) * 86400));
+		END;
+
+		CREATE TRIGGER IF NOT EXISTS remove_event_count_buckets
+		AFTER UPDATE OF name, created_at ON events
+		WHEN OLD.created_at IS NOT NULL
+		BEGIN
+			UPDATE event_count_buckets SET count = count - 1
+			WHERE name = OLD.name AND (
+				(bucket_size = 3600 AND bucket_start = CAST(OLD.created_at / 3600 AS INTEGER) * 3600) OR
+				(bucket_size = 86400 AND bucket_start = CAST(OLD.created_at / 86400 AS INTEGER) * 86400));
+		END;
 	`)
 	if err != nil {
 		return err
 	}
 
+	if eventCountBucketsExists == 0 {
+		_, err = sqldb.Exec(`
+			INSERT INTO event_count_buckets (name, bucket_size, bucket_start, count)
+				SELECT name, 3600, CAST(created_at / 3600 AS INTEGER) * 3600, COUNT(*) FROM events
+				WHERE created_at IS NOT NULL GROUP BY 1, 2, 3;
+			INSERT INTO event_count_buckets (name, bucket_size, bucket_start, count)
+				SELECT name, 86400, CAST(created_at / 86400 AS INTEGER) * 86400, COUNT(*) FROM events
+				WHERE created_at IS NOT NULL GROUP BY 1, 2, 3;
+		`)
+		if err != nil {
+			return err
+		}
+	}
+
 	return nil
 }
 
 func (db *DB) InsertEvent(e *datamodel.Event) error {
-	if !db.started {
+	if !db.started.Load() {
 		return errors.New("CriticalMoments: DB not started")
 	}
+	// Keep insert order
+	if err := db.FlushQueuedEvents(); err != nil {
+		return err
+	}
 
 	_, err := db.sqldb.Exec(`
 		INSERT INTO events (name, type)
@@ -149,12 +234,102 @@ func (db *DB) InsertEvent(e *datamodel.Event) error {
 	return nil
 }
 
+// Records an event nobody waits on, like the derived action/condition bookkeeping events. Writes are batched into
+// one transaction, with createdAt (the caller's time queued) as created_at. Every event read and insert writes the queue first, so queued
+// events are always visible. They're durable once maxQueuedEvents are waiting, or after FlushQueuedEvents.
+func (db *DB) QueueEvent(e *datamodel.Event, createdAt time.Time) error {
+	if !db.started.Load() {
+		return errors.New("CriticalMoments: DB not started")
+	}
+
+	db.queuedEventsLock.Lock()
+	db.queuedEvents = append(db.queuedEvents, queuedEvent{event: e, createdAt: createdAt})
+	full := len(db.queuedEvents) >= maxQueuedEvents
+	db.queuedEventsLock.Unlock()
+
+	if full {
+		return db.FlushQueuedEvents()
+	}
+	return nil
+}
+
+// Writes queued events. Holds the queue lock until written, so reads waiting on it see them. If the write fails the
+// events stay queued (see maxQueuedEventsFlushAttempts), and the error is returned.
+func (db *DB) FlushQueuedEvents() error {
+	db.queuedEventsLock.Lock()
+	defer db.queuedEventsLock.Unlock()
+	if len(db.queuedEvents) == 0 {
+		return nil
+	}
+
+	err := db.writeQueuedEvents(db.queuedEvents)
+	if err == nil {
+		db.queuedEvents = nil
+		db.queuedEventsFailedFlushes = 0
+		return nil
+	}
+	db.queuedEventsFailedFlushes++
+	if db.queuedEventsFailedFlushes >= maxQueuedEventsFlushAttempts {
+		fmt.Printf("CriticalMoments: dropping %v queued events after %v failed writes\n", len(db.queuedEvents), db.queuedEventsFailedFlushes)
+		db.queuedEvents = nil
+		db.queuedEventsFailedFlushes = 0
+	}
+	return err
+}
+
+// Writes the events in one transaction: all or none are written. Requires queuedEventsLock.
+func (db *DB) writeQueuedEvents(queued []queuedEvent) (returnErr error) {
+	tx, err := db.sqldb.Begin()
+	if err != nil {
+		return err
+	}
+	defer func() {
+		if returnErr != nil {
+			tx.Rollback()
+		}
+	}()
+
+	// The insert trigger sets created_at to now, so set it to the queued time after. The update triggers move the
+	// event count bucket.
+	insert, err := tx.Prepare(`INSERT INTO events (name, type) VALUES (?, ?)`)
+	if err != nil {
+		return err
+	}
+	defer insert.Close()
+	setCreatedAt, err := tx.Prepare(`UPDATE events SET created_at = ? WHERE id = ?`)
+	if err != nil {
+		return err
+	}
+	defer setCreatedAt.Close()
+
+	for _, q := range queued {
+		result, err := insert.Exec(q.event.Name, q.event.EventType)
+		if err != nil {
+			return err
+		}
+		id, err := result.LastInsertId()
+		if err != nil {
+			return err
+		}
+		// unixepoch('subsec') precision
+		createdAt := float64(q.createdAt.UnixMilli()) / 1000
+		if _, err := setCreatedAt.Exec(createdAt, id); err != nil {
+			return err
+		}
+	}
+
+	return tx.Commit()
+}
+
 const eventCountByNameQuery = `SELECT COUNT(*) FROM events WHERE name = ?`
 
 func (db *DB) EventCountByName(name string) (int, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return 0, errors.New("CriticalMoments: DB not started")
 	}
+	if err := db.FlushQueuedEvents(); err != nil {
+		return 0, err
+	}
 
 	var count int
 	err := db.sqldb.QueryRow(eventCountByNameQuery, name).Scan(&count)
@@ -168,9 +343,12 @@ func (db *DB) EventCountByName(name string) (int, error) {
 const eventCountByNameWithLimitQuery = `SELECT COUNT(*) FROM (SELECT id FROM events WHERE name = ? LIMIT ?)`
 
 func (db *DB) EventCountByNameWithLimit(name string, limit int) (int, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return 0, errors.New("CriticalMoments: DB not started")
 	}
+	if err := db.FlushQueuedEvents(); err != nil {
+		return 0, err
+	}
 
 	var count int
 	err := db.sqldb.QueryRow(eventCountByNameWithLimitQuery, name, limit).Scan(&count)
@@ -181,6 +359,88 @@ func (db *DB) EventCountByNameWithLimit(name string, limit int) (int, error) {
 	return count, nil
 }
 
+const eventCountBucketSumQuery = `SELECT COALESCE(SUM(count), 0) FROM event_count_buckets WHERE name = ? AND bucket_size = ? AND bucket_start >= ? AND bucket_start < ?`
+const eventCountByNameInRangeQuery = `SELECT COUNT(*) FROM events WHERE name = ? AND created_at >= ? AND created_at < ?`
+
+// Bucket sizes for the event_count_buckets index, in seconds. Aligned to UTC epoch.
+const (
+	eventCountHourBucket = 60 * 60
+	eventCountDayBucket  = 24 * 60 * 60
+)
+
+// Count of events with the given name in the last duration
+func (db *DB) EventCountByNameSince(name string, duration time.Duration) (int, error) {
+	now := time.Now()
+	return db.EventCountByNameInWindow(name, now.Add(-duration), now)
+}
+
+// Count of events with the given name, created in window [start, end).
+// Uses the hourly/daily count buckets for the bulk of the window, and only scans events at the
+// edges of the window which don't fill a full bucket. Cost scales with number of buckets, not events.
+func (db *DB) EventCountByNameInWindow(name string, start time.Time, end time.Time) (int, error) {
+	if !db.started.Load() {
+		return 0, errors.New("CriticalMoments: DB not started")
+	}
+	if !end.After(start) {
+		return 0, nil
+	}
+	if err := db.FlushQueuedEvents(); err != nil {
+		return 0, err
+	}
+
+	startEpoch := float64(start.UnixNano()) / float64(time.Second)
+	endEpoch := float64(end.UnixNano()) / float64(time.Second)
+	return db.eventCountInRange(name, startEpoch, endEpoch, eventCountDayBucket)
+}
+
+func (db *DB) eventCountInRange(name string, start float64, end float64, bucketSize int64) (int, error) {
+	if end <= start {
+		return 0, nil
+	}
+
+	// The range of full buckets inside the window
+	bucketStart := int64(math.Ceil(start/float64(bucketSize))) * bucketSize
+	bucketEnd := int64(math.Floor(end/float64(bucketSize))) * bucketSize
+	if bucketStart >= bucketEnd {
+		// No full buckets in window, try smaller buckets or count events directly
+		return db.eventCountInPartialBucket(name, start, end, bucketSize)
+	}
+
+	var count int
+	err := db.sqldb.QueryRow(eventCountBucketSumQuery, name, bucketSize, bucketStart, bucketEnd).Scan(&count)
+	if err != nil {
+		return 0, err
+	}
+
+	// Add edges, before and after the full buckets
+	startEdgeCount, err := db.eventCountInPartialBucket(name, start, float64(bucketStart), bucketSize)
+	if err != nil {
+		return 0, err
+	}
+	endEdgeCount, err := db.eventCountInPartialBucket(name, float64(bucketEnd), end, bucketSize)
+	if err != nil {
+		return 0, err
+	}
+
+	return count + startEdgeCount + endEdgeCount, nil
+}
+
+func (db *DB) eventCountInPartialBucket(name string, start float64, end float64, bucketSize int64) (int, error) {
+	if end <= start {
+		return 0, nil
+	}
+	if bucketSize == eventCountDayBucket {
+		return db.eventCountInRange(name, start, end, eventCountHourBucket)
+	}
+
+	var count int
+	err := db.sqldb.QueryRow(eventCountByNameInRangeQuery, name, start, end).Scan(&count)
+	if err != nil {
+		return 0, err
+	}
+	return count, nil
+}
+
 const latestEventTimeByNameQuery = `SELECT created_at FROM events WHERE name = ? ORDER BY created_at DESC LIMIT 1`
 const firstEventTimeByNameQuery = `SELECT created_at FROM events WHERE name = ? ORDER BY created_at LIMIT 1`
 
@@ -193,10 +453,14 @@ func (db *DB) FirstEventTimeByName(name string) (*time.Time, error) {
 }
 
 func (db *DB) eventTimeByName(name string, first bool) (*time.Time, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return nil, errors.New("CriticalMoments: DB not started")
 	}
 
+	if err := db.FlushQueuedEvents(); err != nil {
+		return nil, err
+	}
+
 	query := latestEventTimeByNameQuery
 	if first {
 		query = firstEventTimeByNameQuery
@@ -217,10 +481,14 @@ func (db *DB) eventTimeByName(name string, first bool) (*time.Time, error) {
 }
 
 func (db *DB) AllEventTimesByName(name string) ([]time.Time, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return nil, errors.New("CriticalMoments: DB not started")
 	}
 
+	if err := db.FlushQueuedEvents(); err != nil {
+		return nil, err
+	}
+
 	rows, err := db.sqldb.Query(`SELECT created_at FROM events WHERE name = ? ORDER BY created_at`, name)
 	if err == sql.ErrNoRows {
 		return []time.Time{}, nil
@@ -245,6 +513,49 @@ func (db *DB) AllEventTimesByName(name string) ([]time.Time, error) {
 	return times, nil
 }
 
+// Keyset pagination: each page is a separate short query, resuming after the last (created_at, id) seen.
+// Never holds a query open between pages, which matters since the DB only allows one connection.
+const eventTimesByNameFirstPageQuery = `SELECT id, created_at FROM events WHERE name = ? AND created_at IS NOT NULL ORDER BY created_at, id LIMIT ?`
+const eventTimesByNameNextPageQuery = `SELECT id, created_at FROM events WHERE name = ? AND (created_at, id) > (?, ?) ORDER BY created_at, id LIMIT ?`
+
+// Streams the times of all events with the given name, oldest first, without loading them all into memory
+func (db *DB) EventTimesByNameCursor(ctx context.Context, name string, pageSize int) *Cursor[time.Time] {
+	if !db.started.Load() {
+		return newErrorCursor[time.Time](errors.New("CriticalMoments: DB not started"))
+	}
+	// Events queued after this aren't included
+	if err := db.FlushQueuedEvents(); err != nil {
+		return newErrorCursor[time.Time](err)
+	}
+
+	firstPage := true
+	var lastId int64
+	var lastCreatedAt float64
+	return newCursor(ctx, pageSize, func(buf []time.Time, limit int) ([]time.Time, error) {
+		var rows *sql.Rows
+		var err error
+		if firstPage {
+			rows, err = db.sqldb.QueryContext(ctx, eventTimesByNameFirstPageQuery, name, limit)
+		} else {
+			rows, err = db.sqldb.QueryContext(ctx, eventTimesByNameNextPageQuery, name, lastCreatedAt, lastId, limit)
+		}
+		if err != nil {
+			return nil, err
+		}
+		defer rows.Close()
+		firstPage = false
+
+		for rows.Next() {
+			err := rows.Scan(&lastId, &lastCreatedAt)
+			if err != nil {
+				return nil, err
+			}
+			buf = append(buf, timeFromEpochSeconds(lastCreatedAt))
+		}
+		return buf, rows.Err()
+	})
+}
+
 type DBPropertyType int
 
 const (
@@ -275,7 +586,7 @@ func DBPropertyTypeIntFromKind(k reflect.Kind) (DBPropertyType, error) {
 const latestPropHistoryTimeByNameQuery = `SELECT created_at FROM property_history WHERE name = ? ORDER BY created_at DESC LIMIT 1`
 
 func (db *DB) latestPropertyHistoryTime(name string) (*time.Time, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return nil, errors.New("CriticalMoments: DB not started")
 	}
 
@@ -300,8 +611,8 @@ var maxTimeBetweenPropertyHistorySamples = time.Minute * 5
 
 const insertPropertyHistorySqlTemplate = `INSERT INTO property_history (name, type, TYPE_VAL, sample_type) VALUES (?, ?, ?, ?)`
 
-func (db *DB) InsertPropertyHistory(name string, value interface{}, sampleType datamodel.CMPropertySampleType) error {
-	if !db.started {
+func (db *DB) InsertPropertyHistory(name string, value datamodel.PropertyValue, sampleType datamodel.CMPropertySampleType) error {
+	if !db.started.Load() {
 		return errors.New("CriticalMoments: DB not started")
 	}
 
@@ -316,18 +627,17 @@ func (db *DB) InsertPropertyHistory(name string, value interface{}, sampleType d
 		}
 	}
 
-	propKind := datamodel.CMTypeFromValue(value)
-	dbType, err := DBPropertyTypeIntFromKind(propKind)
+	dbType, err := DBPropertyTypeIntFromKind(value.Kind())
 	if err != nil {
 		return err
 	}
 
-	sqlTemplate, value, err := formatSqlForPropHistoryType(value, insertPropertyHistorySqlTemplate)
+	sqlTemplate, columnValue, err := formatSqlForPropHistoryType(value, insertPropertyHistorySqlTemplate)
 	if err != nil {
 		return err
 	}
 
-	_, err = db.sqldb.Exec(sqlTemplate, name, dbType, value, sampleType)
+	_, err = db.sqldb.Exec(sqlTemplate, name, dbType, columnValue, sampleType)
 	if err != nil {
 		return err
 	}
@@ -338,7 +648,7 @@ func (db *DB) InsertPropertyHistory(name string, value interface{}, sampleType d
 const latestPropertyHistoryValueByNameQuery = `SELECT text_value, int_value, real_value, numeric_value, type FROM property_history WHERE name = ? ORDER BY created_at DESC LIMIT 1`
 
 func (db *DB) LatestPropertyHistory(name string) (interface{}, error) {
-	if !db.started {
+	if !db.started.Load() {
 		return nil, errors.New("CriticalMoments: DB not started")
 	}
 
@@ -354,6 +664,10 @@ func (db *DB) LatestPropertyHistory(name string) (interface{}, error) {
 	if err != nil {
 		return nil, err
 	}
+	return propertyValueFromColumns(text_value, int_value, real_value, numeric_value, dbType)
+}
+
+func propertyValueFromColumns(text_value sql.NullString, int_value sql.NullInt64, real_value sql.NullFloat64, numeric_value sql.NullBool, dbType sql.NullInt64) (interface{}, error) {
 	if !dbType.Valid {
 		return nil, errors.New("CriticalMoments: Property type invalid")
 	}
@@ -386,20 +700,71 @@ func (db *DB) LatestPropertyHistory(name string) (interface{}, error) {
 	return nil, errors.New("CriticalMoments: Invalid property value")
 }
 
+const propertyHistoryFirstPageQuery = `SELECT id, created_at, text_value, int_value, real_value, numeric_value, type, sample_type FROM property_history WHERE name = ? AND created_at IS NOT NULL ORDER BY created_at, id LIMIT ?`
+const propertyHistoryNextPageQuery = `SELECT id, created_at, text_value, int_value, real_value, numeric_value, type, sample_type FROM property_history WHERE name = ? AND (created_at, id) > (?, ?) ORDER BY created_at, id LIMIT ?`
+
+// Streams the history of a property, oldest first, without loading it all into memory
+func (db *DB) PropertyHistoryCursor(ctx context.Context, name string, pageSize int) *Cursor[PropertyHistoryRow] {
+	if !db.started.Load() {
+		return newErrorCursor[PropertyHistoryRow](errors.New("CriticalMoments: DB not started"))
+	}
+
+	firstPage := true
+	var lastId int64
+	var lastCreatedAt float64
+	return newCursor(ctx, pageSize, func(buf []PropertyHistoryRow, limit int) ([]PropertyHistoryRow, error) {
+		var rows *sql.Rows
+		var err error
+		if firstPage {
+			rows, err = db.sqldb.QueryContext(ctx, propertyHistoryFirstPageQuery, name, limit)
+		} else {
+			rows, err = db.sqldb.QueryContext(ctx, propertyHistoryNextPageQuery, name, lastCreatedAt, lastId, limit)
+		}
+		if err != nil {
+			return nil, err
+		}
+		defer rows.Close()
+		firstPage = false
+
+		for rows.Next() {
+			var text_value sql.NullString
+			var int_value sql.NullInt64
+			var real_value sql.NullFloat64
+			var numeric_value sql.NullBool
+			var dbType sql.NullInt64
+			var sampleType datamodel.CMPropertySampleType
+			err := rows.Scan(&lastId, &lastCreatedAt, &text_value, &int_value, &real_value, &numeric_value, &dbType, &sampleType)
+			if err != nil {
+				return nil, err
+			}
+			value, err := propertyValueFromColumns(text_value, int_value, real_value, numeric_value, dbType)
+			if err != nil {
+				return nil, err
+			}
+			buf = append(buf, PropertyHistoryRow{
+				Value:      value,
+				SampleType: sampleType,
+				CreatedAt:  timeFromEpochSeconds(lastCreatedAt),
+			})
+		}
+		return buf, rows.Err()
+	})
+}
+
 const propertyHistoryEverHadValueQuery = `SELECT COUNT(*) FROM property_history WHERE name = ? AND TYPE_VAL = ? LIMIT 1`
 
-func (db *DB) PropertyHistoryEverHadValue(name string, value interface{}) (bool, error) {
-	if !db.started {
+func (db *DB) PropertyHistoryEverHadValue(name string, value datamodel.PropertyValue) (bool, error) {
+	if !db.started.Load() {
 		return false, errors.New("CriticalMoments: DB not started")
 	}
 
-	sqlTemplate, value, err := formatSqlForPropHistoryType(value, propertyHistoryEverHadValueQuery)
+	sqlTemplate, columnValue, err := formatSqlForPropHistoryType(value, propertyHistoryEverHadValueQuery)
 	if err != nil {
 		return false, err
 	}
 
 	var count sql.NullInt64
-	err = db.sqldb.QueryRow(sqlTemplate, name, value).Scan(&count)
+	err = db.sqldb.QueryRow(sqlTemplate, name, columnValue).Scan(&count)
 	if err != nil {
 		return false, err
 	}
@@ -410,111 +775,36 @@ func (db *DB) PropertyHistoryEverHadValue(name string, value interface{}) (bool,
 }
 
 func (db *DB) DbConditionFunctions() map[string]*datamodel.ConditionDynamicFunction {
-	return map[string]*datamodel.ConditionDynamicFunction{
-		"eventCount": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done with the Types signature
-				count, err := db.EventCountByName(params[0].(string))
-				if err != nil {
-					return nil, err
-				}
-				return count, nil
-			},
-			Types: []any{new(func(string) int)},
-		},
-		"eventCountWithLimit": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done the Types signature
-				count, err := db.EventCountByNameWithLimit(params[0].(string), params[1].(int))
-				if err != nil {
-					return nil, err
-				}
-				return count, nil
-			},
-			Types: []any{new(func(string, int) int)},
-		},
-		"latestEventTime": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done the Types signature
-				time, err := db.LatestEventTimeByName(params[0].(string))
-				if err != nil {
-					return nil, err
-				}
-				if time == nil {
-					return nil, nil
-				}
-				// Time values not passed by reference
-				return *time, nil
-			},
-			Types: []any{new(func(string) interface{})},
-		},
-		"propertyHistoryLatestValue": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done the Types signature
-				value, err := db.LatestPropertyHistory(params[0].(string))
-				// no rows should return nil
-				if err == sql.ErrNoRows {
-					return nil, nil
-				}
-				if err != nil {
-					return nil, err
-				}
-				return value, nil
-			},
-			Types: []any{new(func(string) interface{})},
-		},
-		"propertyEver": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done the Types signature
-				value, err := db.PropertyHistoryEverHadValue(params[0].(string), params[1])
-				if err != nil {
-					return nil, err
-				}
-				return value, nil
-			},
-			Types: []any{new(func(string, interface{}) bool)},
-		},
-		"stableRand": {
-			Function: func(params ...any) (any, error) {
-				// Parameter type+count checking is done the Types signature
-				return db.StableRandom()
-			},
-			Types: []any{new(func() int64)},
-		},
-	}
-}
-
-func formatSqlForPropHistoryType(val any, sqlTemplate string) (string, any, error) {
-	dbType, err := DBPropertyTypeIntFromKind(datamodel.CMTypeFromValue(val))
+	return storageConditionFunctions(db)
+}
+
+func formatSqlForPropHistoryType(val datamodel.PropertyValue, sqlTemplate string) (string, any, error) {
+	column, columnValue, err := propertyHistoryColumnValue(val)
 	if err != nil {
 		return "", nil, err
 	}
 
-	column := ""
-	switch dbType {
-	case DBPropertyTypeString:
-		column = "text_value"
-	case DBPropertyTypeInt:
-		column = "int_value"
-	case DBPropertyTypeFloat:
-		column = "real_value"
-	case DBPropertyTypeBool:
-		column = "numeric_value"
-	case DBPropertyTypeTime:
+	sql := strings.Replace(sqlTemplate, "TYPE_VAL", column, -1)
+	return sql, columnValue, nil
+}
+
+// The column a property value is stored in, and the value stored. Ints are int64, and times microseconds in the
+// int column, matching what's read back from SQLite.
+func propertyHistoryColumnValue(val datamodel.PropertyValue) (string, any, error) {
+	switch val.Kind() {
+	case reflect.String:
+		return "text_value", val.StringValue(), nil
+	case reflect.Int:
+		return "int_value", val.IntValue(), nil
+	case reflect.Float64:
+		return "real_value", val.FloatValue(), nil
+	case reflect.Bool:
+		return "numeric_value", val.BoolValue(), nil
+	case datamodel.CMTimeKind:
 		// Time stored as microseconds, in int column
-		time, ok := val.(time.Time)
-		if !ok {
-			return "", nil, errors.New("CriticalMoments: Invalid time")
-		}
-		val = time.UnixMicro()
-		column = "int_value"
-	}
-	if column == "" {
-		return "", nil, errors.New("CriticalMoments: Unsupported property type")
+		return "int_value", val.TimeValue().UnixMicro(), nil
 	}
-
-	sql := strings.Replace(sqlTemplate, "TYPE_VAL", column, -1)
-	return sql, val, nil
+	return "", nil, errors.New("CriticalMoments: Unsupported property type")
 }
 
 func (db *DB) StableRandom() (int64, error) {
@@ -331,6 +331,106 @@ func TestEventCount(t *testing.T) {
 	}
 }
 
+func TestQueuedEvents(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	e, err := datamodel.NewCustomEventWithName("queued")
+	if err != nil {
+		t.Fatal(err)
+	}
+	queuedAt := time.Now()
+	for i := 0; i < 3; i++ {
+		if err := db.QueueEvent(e, queuedAt); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if len(db.queuedEvents) != 3 {
+		t.Fatal("Expected events queued, not written")
+	}
+
+	// Reads write the queue first, and keep the time queued, not written
+	time.Sleep(20 * time.Millisecond)
+	count, err := db.EventCountByName("queued")
+	if err != nil || count != 3 || len(db.queuedEvents) != 0 {
+		t.Fatal("Expected queued events visible to reads")
+	}
+	latest, err := db.LatestEventTimeByName("queued")
+	if err != nil || latest == nil || latest.Sub(queuedAt).Abs() > 10*time.Millisecond {
+		t.Fatal("Expected created_at to be the time queued")
+	}
+	windowCount, err := db.EventCountByNameSince("queued", time.Hour)
+	if err != nil || windowCount != 3 {
+		t.Fatal("Expected event count buckets updated for queued events")
+	}
+
+	// Written once full
+	for i := 0; i < maxQueuedEvents; i++ {
+		if err := db.QueueEvent(e, queuedAt); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if len(db.queuedEvents) != 0 {
+		t.Fatal("Expected full queue written")
+	}
+}
+
+func TestQueuedEventsKeptWhenFlushFails(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	e, err := datamodel.NewCustomEventWithName("queued")
+	if err != nil {
+		t.Fatal(err)
+	}
+	queuedAt := time.Now()
+	for i := 0; i < 3; i++ {
+		if err := db.QueueEvent(e, queuedAt); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	// Fail the batch part way through: the single connection keeps the temp trigger
+	_, err = db.sqldb.Exec(`CREATE TEMP TRIGGER fail_queued_insert BEFORE INSERT ON events WHEN NEW.name = 'queued'
+		BEGIN SELECT RAISE(ABORT, 'forced failure'); END;`)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := db.FlushQueuedEvents(); err == nil {
+		t.Fatal("Expected failed flush to return an error")
+	}
+	if len(db.queuedEvents) != 3 {
+		t.Fatal("Expected events kept after failed flush")
+	}
+
+	// Retried on the next flush
+	if _, err = db.sqldb.Exec(`DROP TRIGGER fail_queued_insert`); err != nil {
+		t.Fatal(err)
+	}
+	count, err := db.EventCountByName("queued")
+	if err != nil || count != 3 || len(db.queuedEvents) != 0 {
+		t.Fatal("Expected kept events written on retry")
+	}
+
+	// Dropped after repeated failures, so reads don't fail forever
+	if err := db.QueueEvent(e, queuedAt); err != nil {
+		t.Fatal(err)
+	}
+	_, err = db.sqldb.Exec(`CREATE TEMP TRIGGER fail_queued_insert BEFORE INSERT ON events WHEN NEW.name = 'queued'
+		BEGIN SELECT RAISE(ABORT, 'forced failure'); END;`)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < maxQueuedEventsFlushAttempts; i++ {
+		if err := db.FlushQueuedEvents(); err == nil {
+			t.Fatal("Expected failed flush to return an error")
+		}
+	}
+	if len(db.queuedEvents) != 0 {
+		t.Fatal("Expected events dropped after max flush attempts")
+	}
+}
+
 func TestLatestEventUsesIndex(t *testing.T) {
 	testSqlExplainIncludes(latestEventTimeByNameQuery, "USING COVERING INDEX events_name_created_at", t, "test")
 }
@@ -453,7 +553,7 @@ func TestInsertAndRetrievePropHistory(t *testing.T) {
 
 	// insert a row into property history
 	// Other types tested in property_hisotry_manager_test.go
-	err := db.InsertPropertyHistory("testx", "valx", 1)
+	err := db.InsertPropertyHistory("testx", datamodel.NewStringPropertyValue("valx"), 1)
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -484,14 +584,14 @@ func TestInsertAndRetrievePropHistory(t *testing.T) {
 	}
 
 	// check if it has ever had value
-	has, err := db.PropertyHistoryEverHadValue("testx", "valx")
+	has, err := db.PropertyHistoryEverHadValue("testx", datamodel.NewStringPropertyValue("valx"))
 	if err != nil {
 		t.Fatal(err)
 	}
 	if !has {
 		t.Fatal("PropertyHistoryEverHadValue failed")
 	}
-	has, err = db.PropertyHistoryEverHadValue("testx", "wrong value")
+	has, err = db.PropertyHistoryEverHadValue("testx", datamodel.NewStringPropertyValue("wrong value"))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -511,11 +611,11 @@ func TestPropHistoryRateLimit(t *testing.T) {
 		maxTimeBetweenPropertyHistorySamples = original
 	}()
 
-	err := db.InsertPropertyHistory("test", "val1", datamodel.CMPropertySampleTypeOnUse)
+	err := db.InsertPropertyHistory("test", datamodel.NewStringPropertyValue("val1"), datamodel.CMPropertySampleTypeOnUse)
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = db.InsertPropertyHistory("test", "val2", datamodel.CMPropertySampleTypeOnUse)
+	err = db.InsertPropertyHistory("test", datamodel.NewStringPropertyValue("val2"), datamodel.CMPropertySampleTypeOnUse)
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -531,7 +631,7 @@ func TestPropHistoryRateLimit(t *testing.T) {
 
 	// Delayed, writes should work again
 	time.Sleep(delay + time.Millisecond)
-	err = db.InsertPropertyHistory("test", "val3", datamodel.CMPropertySampleTypeOnUse)
+	err = db.InsertPropertyHistory("test", datamodel.NewStringPropertyValue("val3"), datamodel.CMPropertySampleTypeOnUse)
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -701,3 +801,178 @@ func TestAllEventTimesByName(t *testing.T) {
 		priorTime = tm
 	}
 }
+
+func TestEventCountBucketsUseIndex(t *testing.T) {
+	testSqlExplainIncludes(eventCountBucketSumQuery, "USING PRIMARY KEY", t, "test", 3600, 0, 7200)                          // add_test_count
+	testSqlExplainIncludes(eventCountByNameInRangeQuery, "USING COVERING INDEX events_name_created_at", t, "test", 0.0, 1.0) // add_test_count
+}
+
+// Spread events over the last 5 days, with some exactly on bucket boundaries, returning the event times
+func testInsertEventsOverDays(db *DB, name string, count int, t *testing.T) []float64 {
+	e, err := datamodel.NewCustomEventWithName(name)
+	if err != nil {
+		t.Fatal(err)
+	}
+	base := float64(time.Now().Add(-5*24*time.Hour).Unix()/eventCountDayBucket) * eventCountDayBucket
+	times := make([]float64, 0, count)
+	for i := 0; i < count; i++ {
+		err = db.InsertEvent(e)
+		if err != nil {
+			t.Fatal(err)
+		}
+		eventTime := base + rand.Float64()*5*eventCountDayBucket
+		if i%10 == 0 {
+			// exactly on an hour boundary
+			eventTime = base + float64(rand.Intn(5*24)*eventCountHourBucket)
+		}
+		_, err = db.sqldb.Exec(`UPDATE events SET created_at = ? WHERE id = (SELECT MAX(id) FROM events)`, eventTime)
+		if err != nil {
+			t.Fatal(err)
+		}
+		times = append(times, eventTime)
+	}
+	return times
+}
+
+func testBruteForceCount(times []float64, start time.Time, end time.Time) int {
+	startEpoch := float64(start.UnixNano()) / float64(time.Second)
+	endEpoch := float64(end.UnixNano()) / float64(time.Second)
+	count := 0
+	for _, et := range times {
+		if et >= startEpoch && et < endEpoch {
+			count++
+		}
+	}
+	return count
+}
+
+func TestEventCountInWindow(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	count, err := db.EventCountByNameInWindow("test", time.Now().Add(-time.Hour), time.Now())
+	if err != nil {
+		t.Fatal(err)
+	}
+	if count != 0 {
+		t.Fatal("Expected no events in window")
+	}
+
+	times := testInsertEventsOverDays(db, "test", 300, t)
+	testInsertEventsOverDays(db, "other", 50, t)
+
+	// Bucket totals should match event count, for both bucket sizes
+	for _, bucketSize := range []int{eventCountHourBucket, eventCountDayBucket} {
+		var bucketTotal int
+		err = db.sqldb.QueryRow(`SELECT SUM(count) FROM event_count_buckets WHERE name = 'test' AND bucket_size = ?`, bucketSize).Scan(&bucketTotal)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if bucketTotal != 300 {
+			t.Fatalf("Bucket total for size %v was %v, expected 300", bucketSize, bucketTotal)
+		}
+	}
+
+	// Compare to brute force count for random windows, including bucket aligned ones
+	minTime := time.Now().Add(-6 * 24 * time.Hour)
+	for i := 0; i < 200; i++ {
+		start := minTime.Add(time.Duration(rand.Int63n(int64(8 * 24 * time.Hour))))
+		end := start.Add(time.Duration(rand.Int63n(int64(4 * 24 * time.Hour))))
+		if i%4 == 0 {
+			start = start.Truncate(time.Hour)
+			end = end.Truncate(time.Hour)
+		}
+		count, err := db.EventCountByNameInWindow("test", start, end)
+		if err != nil {
+			t.Fatal(err)
+		}
+		expected := testBruteForceCount(times, start, end)
+		if count != expected {
+			t.Fatalf("EventCountByNameInWindow returned %v, expected %v for window %v to %v", count, expected, start, end)
+		}
+	}
+
+	// Since
+	count, err = db.EventCountByNameSince("test", 48*time.Hour)
+	if err != nil {
+		t.Fatal(err)
+	}
+	expected := testBruteForceCount(times, time.Now().Add(-48*time.Hour), time.Now())
+	if count != expected {
+		t.Fatalf("EventCountByNameSince returned %v, expected %v", count, expected)
+	}
+
+	// Inverted window is empty
+	count, err = db.EventCountByNameInWindow("test", time.Now(), time.Now().Add(-72*time.Hour))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if count != 0 {
+		t.Fatal("Inverted window should be empty")
+	}
+}
+
+func TestEventCountBucketsBackfill(t *testing.T) {
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	times := testInsertEventsOverDays(db, "test", 100, t)
+
+	// Simulate a DB from before buckets were added
+	_, err := db.sqldb.Exec(`DROP TABLE event_count_buckets`)
+	if err != nil {
+		t.Fatal(err)
+	}
+	err = migrate(db.sqldb)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	start := time.Now().Add(-7 * 24 * time.Hour)
+	end := time.Now().Add(24 * time.Hour)
+	count, err := db.EventCountByNameInWindow("test", start, end)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if count != 100 || count != testBruteForceCount(times, start, end) {
+		t.Fatalf("Backfill failed, count was %v", count)
+	}
+
+	// Migrating again should not double count
+	err = migrate(db.sqldb)
+	if err != nil {
+		t.Fatal(err)
+	}
+	count, err = db.EventCountByNameInWindow("test", start, end)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if count != 100 {
+		t.Fatalf("Second migration changed count to %v", count)
+	}
+}
+
+// Windowed count over a year of events. Cost should scale with buckets in window, not events.
+func BenchmarkEventCountInWindow(b *testing.B) {
+	t := &testing.T{}
+	db := testBuildTestDb(t)
+	defer db.Close()
+
+	_, err := db.sqldb.Exec(`
+		WITH RECURSIVE seq(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM seq WHERE i < 100000)
+		INSERT INTO events (name, type) SELECT 'bench', 2 FROM seq;
+		UPDATE events SET created_at = unixepoch('subsec') - (id * 317.0);
+	`)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	start := time.Now().Add(-7 * 24 * time.Hour)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		_, err := db.EventCountByNameInWindow("bench", start, time.Now())
+		if err != nil {
+			b.Fatal(err)
+		}
+	}
+}
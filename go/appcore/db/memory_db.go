@@ -0,0 +1,393 @@
+package db
+
+import (
+	"context"
+	"database/sql"
+	"errors"
+	"math/rand"
+	"reflect"
+	"sort"
+	"sync"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// MemoryDB is an in-memory Storage implementation, with the same semantics as the SQLite DB.
+// Nothing is persisted, and it doesn't require cgo. Intended for simulations, benchmarks and tests.
+type MemoryDB struct {
+	mu      sync.RWMutex
+	started bool
+
+	// Events by event name, sorted by (createdAt, id)
+	events      map[string][]memoryEvent
+	nextEventId int64
+	// Property history by property name, in insert order
+	propertyHistory map[string][]memoryPropertyHistoryRow
+
+	propertyHistoryManager *PropertyHistoryManager
+
+	// Current time, for created_at and relative queries. Injectable so simulations can advance time.
+	clock func() time.Time
+}
+
+type memoryEvent struct {
+	createdAt time.Time
+	// Breaks ties between equal createdAt, like the SQLite rowid
+	id int64
+}
+
+func (e memoryEvent) after(createdAt time.Time, id int64) bool {
+	return e.createdAt.After(createdAt) || (e.createdAt.Equal(createdAt) && e.id > id)
+}
+
+type memoryPropertyHistoryRow struct {
+	// Times are truncated to microseconds, as stored in SQLite
+	value      datamodel.PropertyValue
+	sampleType datamodel.CMPropertySampleType
+	createdAt  time.Time
+}
+
+func NewMemoryDB() *MemoryDB {
+	db := MemoryDB{
+		events:          map[string][]memoryEvent{},
+		propertyHistory: map[string][]memoryPropertyHistoryRow{},
+	}
+
+	db.propertyHistoryManager = newPropertyHistoryManager(&db)
+
+	return &db
+}
+
+// The data directory is ignored; MemoryDB never writes to disk
+func (db *MemoryDB) StartWithPath(dataDir string) error {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	db.started = true
+	return nil
+}
+
+func (db *MemoryDB) Started() bool {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	return db.started
+}
+
+// Close stops the DB, but retains data so a restart behaves like re-opening the same SQLite file
+func (db *MemoryDB) Close() error {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	db.started = false
+	return nil
+}
+
+func (db *MemoryDB) PropertyHistoryManager() *PropertyHistoryManager {
+	return db.propertyHistoryManager
+}
+
+func (db *MemoryDB) DbConditionFunctions() map[string]*datamodel.ConditionDynamicFunction {
+	return storageConditionFunctions(db)
+}
+
+// Replaces the clock used for new rows and relative queries (such as EventCountByNameSince). Defaults to time.Now.
+// Not synchronized: set before use.
+func (db *MemoryDB) SetClock(clock func() time.Time) {
+	db.clock = clock
+}
+
+func (db *MemoryDB) now() time.Time {
+	if db.clock != nil {
+		return db.clock()
+	}
+	return time.Now()
+}
+
+// SQLite created_at uses unixepoch('subsec'), which has millisecond precision
+func (db *MemoryDB) createdAtNow() time.Time {
+	return time.UnixMilli(db.now().UnixMilli())
+}
+
+func (db *MemoryDB) InsertEvent(e *datamodel.Event) error {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	if !db.started {
+		return errors.New("CriticalMoments: DB not started")
+	}
+
+	db.insertEventTime(e.Name, db.createdAtNow())
+	return nil
+}
+
+// Written immediately, so queued events are always visible, matching DB
+func (db *MemoryDB) QueueEvent(e *datamodel.Event, createdAt time.Time) error {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	if !db.started {
+		return errors.New("CriticalMoments: DB not started")
+	}
+
+	// Millisecond precision, like createdAtNow
+	db.insertEventTime(e.Name, time.UnixMilli(createdAt.UnixMilli()))
+	return nil
+}
+
+func (db *MemoryDB) FlushQueuedEvents() error {
+	return nil
+}
+
+// Inserts keeping events sorted. The clock can move backwards, so don't assume appending is correct.
+func (db *MemoryDB) insertEventTime(name string, t time.Time) {
+	db.nextEventId++
+	e := memoryEvent{createdAt: t, id: db.nextEventId}
+
+	events := db.events[name]
+	// id is the largest so far, so it goes after any events with equal time
+	i := sort.Search(len(events), func(i int) bool { return events[i].createdAt.After(t) })
+	events = append(events, memoryEvent{})
+	copy(events[i+1:], events[i:])
+	events[i] = e
+	db.events[name] = events
+}
+
+func (db *MemoryDB) EventCountByName(name string) (int, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return 0, errors.New("CriticalMoments: DB not started")
+	}
+
+	return len(db.events[name]), nil
+}
+
+func (db *MemoryDB) EventCountByNameWithLimit(name string, limit int) (int, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return 0, errors.New("CriticalMoments: DB not started")
+	}
+
+	count := len(db.events[name])
+	// SQLite treats a negative LIMIT as no limit
+	if limit >= 0 && count > limit {
+		return limit, nil
+	}
+	return count, nil
+}
+
+func (db *MemoryDB) EventCountByNameSince(name string, duration time.Duration) (int, error) {
+	now := db.now()
+	return db.EventCountByNameInWindow(name, now.Add(-duration), now)
+}
+
+// Count of events with the given name, created in window [start, end). Binary search over sorted times.
+func (db *MemoryDB) EventCountByNameInWindow(name string, start time.Time, end time.Time) (int, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return 0, errors.New("CriticalMoments: DB not started")
+	}
+	if !end.After(start) {
+		return 0, nil
+	}
+
+	events := db.events[name]
+	startIndex := sort.Search(len(events), func(i int) bool { return !events[i].createdAt.Before(start) })
+	endIndex := sort.Search(len(events), func(i int) bool { return !events[i].createdAt.Before(end) })
+	return endIndex - startIndex, nil
+}
+
+func (db *MemoryDB) LatestEventTimeByName(name string) (*time.Time, error) {
+	return db.eventTimeByName(name, false)
+}
+
+func (db *MemoryDB) FirstEventTimeByName(name string) (*time.Time, error) {
+	return db.eventTimeByName(name, true)
+}
+
+func (db *MemoryDB) eventTimeByName(name string, first bool) (*time.Time, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return nil, errors.New("CriticalMoments: DB not started")
+	}
+
+	events := db.events[name]
+	if len(events) == 0 {
+		return nil, nil
+	}
+	t := events[len(events)-1].createdAt
+	if first {
+		t = events[0].createdAt
+	}
+	return &t, nil
+}
+
+func (db *MemoryDB) AllEventTimesByName(name string) ([]time.Time, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return nil, errors.New("CriticalMoments: DB not started")
+	}
+
+	events := db.events[name]
+	if len(events) == 0 {
+		return nil, nil
+	}
+	times := make([]time.Time, len(events))
+	for i, e := range events {
+		times[i] = e.createdAt
+	}
+	return times, nil
+}
+
+// Streams the times of all events with the given name, oldest first. Keyset paginated like the
+// SQLite DB, so events inserted while iterating don't cause rows to be skipped or repeated.
+func (db *MemoryDB) EventTimesByNameCursor(ctx context.Context, name string, pageSize int) *Cursor[time.Time] {
+	if !db.Started() {
+		return newErrorCursor[time.Time](errors.New("CriticalMoments: DB not started"))
+	}
+
+	firstPage := true
+	var lastId int64
+	var lastCreatedAt time.Time
+	return newCursor(ctx, pageSize, func(buf []time.Time, limit int) ([]time.Time, error) {
+		db.mu.RLock()
+		defer db.mu.RUnlock()
+
+		events := db.events[name]
+		startIndex := 0
+		if !firstPage {
+			startIndex = sort.Search(len(events), func(i int) bool { return events[i].after(lastCreatedAt, lastId) })
+		}
+		firstPage = false
+
+		for i := startIndex; i < len(events) && i < startIndex+limit; i++ {
+			lastCreatedAt = events[i].createdAt
+			lastId = events[i].id
+			buf = append(buf, lastCreatedAt)
+		}
+		return buf, nil
+	})
+}
+
+func (db *MemoryDB) InsertPropertyHistory(name string, value datamodel.PropertyValue, sampleType datamodel.CMPropertySampleType) error {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	if !db.started {
+		return errors.New("CriticalMoments: DB not started")
+	}
+
+	// Check last update time, and skip if it's in last 5 mins
+	history := db.propertyHistory[name]
+	if len(history) > 0 {
+		latestHistoryTime := history[len(history)-1].createdAt
+		if db.now().Before(latestHistoryTime.Add(maxTimeBetweenPropertyHistorySamples)) {
+			return nil
+		}
+	}
+
+	if _, err := DBPropertyTypeIntFromKind(value.Kind()); err != nil {
+		return err
+	}
+	if value.Kind() == datamodel.CMTimeKind {
+		value = datamodel.NewTimePropertyValue(time.UnixMicro(value.TimeValue().UnixMicro()))
+	}
+
+	db.propertyHistory[name] = append(history, memoryPropertyHistoryRow{
+		value:      value,
+		sampleType: sampleType,
+		createdAt:  db.createdAtNow(),
+	})
+	return nil
+}
+
+func (db *MemoryDB) LatestPropertyHistory(name string) (interface{}, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return nil, errors.New("CriticalMoments: DB not started")
+	}
+
+	history := db.propertyHistory[name]
+	if len(history) == 0 {
+		return nil, sql.ErrNoRows
+	}
+
+	return history[len(history)-1].publicValue(), nil
+}
+
+// The value as returned from the SQLite DB, which reads ints back as int64
+func (row memoryPropertyHistoryRow) publicValue() interface{} {
+	if row.value.Kind() == reflect.Int {
+		return row.value.IntValue()
+	}
+	return row.value.Interface()
+}
+
+// Streams the history of a property, oldest first. History is append only, so the index is a stable keyset.
+func (db *MemoryDB) PropertyHistoryCursor(ctx context.Context, name string, pageSize int) *Cursor[PropertyHistoryRow] {
+	if !db.Started() {
+		return newErrorCursor[PropertyHistoryRow](errors.New("CriticalMoments: DB not started"))
+	}
+
+	nextIndex := 0
+	return newCursor(ctx, pageSize, func(buf []PropertyHistoryRow, limit int) ([]PropertyHistoryRow, error) {
+		db.mu.RLock()
+		defer db.mu.RUnlock()
+
+		history := db.propertyHistory[name]
+		for ; nextIndex < len(history) && len(buf) < limit; nextIndex++ {
+			row := history[nextIndex]
+			buf = append(buf, PropertyHistoryRow{
+				Value:      row.publicValue(),
+				SampleType: row.sampleType,
+				CreatedAt:  row.createdAt,
+			})
+		}
+		return buf, nil
+	})
+}
+
+func (db *MemoryDB) PropertyHistoryEverHadValue(name string, value datamodel.PropertyValue) (bool, error) {
+	db.mu.RLock()
+	defer db.mu.RUnlock()
+	if !db.started {
+		return false, errors.New("CriticalMoments: DB not started")
+	}
+
+	// Compare the stored column values, as SQLite does (ints and times share the int column)
+	column, columnValue, err := propertyHistoryColumnValue(value)
+	if err != nil {
+		return false, err
+	}
+
+	for _, row := range db.propertyHistory[name] {
+		rowColumn, rowValue, _ := propertyHistoryColumnValue(row.value)
+		if rowColumn == column && rowValue == columnValue {
+			return true, nil
+		}
+	}
+	return false, nil
+}
+
+func (db *MemoryDB) StableRandom() (int64, error) {
+	db.mu.Lock()
+	defer db.mu.Unlock()
+	if !db.started {
+		return 0, errors.New("CriticalMoments: DB not started")
+	}
+
+	// Stored in property history, same as the SQLite DB, but exempt from the sampling rate limit
+	history := db.propertyHistory["stable_random"]
+	if len(history) > 0 {
+		return history[0].value.IntValue(), nil
+	}
+
+	newRandom := rand.Int63()
+	db.propertyHistory["stable_random"] = []memoryPropertyHistoryRow{{
+		value:      datamodel.NewIntPropertyValue(newRandom),
+		sampleType: datamodel.CMPropertySampleTypeDoNotSample,
+		createdAt:  db.createdAtNow(),
+	}}
+	return newRandom, nil
+}
@@ -0,0 +1,322 @@
+package db
+
+import (
+	"database/sql"
+	"math/rand"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+func testBuildMemoryDb(t *testing.T) *MemoryDB {
+	db := NewMemoryDB()
+	err := db.StartWithPath("/path/is/ignored")
+	if err != nil {
+		t.Fatal(err)
+	}
+	return db
+}
+
+func TestMemoryDBNotStarted(t *testing.T) {
+	db := NewMemoryDB()
+	e, _ := datamodel.NewCustomEventWithName("test")
+	if db.InsertEvent(e) == nil {
+		t.Fatal("Allowed insert before start")
+	}
+	if _, err := db.EventCountByName("test"); err == nil {
+		t.Fatal("Allowed query before start")
+	}
+	if err := db.InsertPropertyHistory("test", datamodel.NewStringPropertyValue("val"), datamodel.CMPropertySampleTypeAppStart); err == nil {
+		t.Fatal("Allowed property history before start")
+	}
+
+	// Pre-start property values are cached by the history manager, and written on startup
+	err := db.PropertyHistoryManager().CustomPropertySet("test", datamodel.NewStringPropertyValue("val"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	db.StartWithPath("")
+	err = db.PropertyHistoryManager().TrackPropertyHistoryForStartup(map[string]datamodel.PropertyValue{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if v, err := db.LatestPropertyHistory("test"); err != nil || v != "val" {
+		t.Fatal("Pre-start property not written on start")
+	}
+
+	// Data survives close/restart
+	db.Close()
+	if db.Started() {
+		t.Fatal("Still started after close")
+	}
+	db.StartWithPath("")
+	if v, err := db.LatestPropertyHistory("test"); err != nil || v != "val" {
+		t.Fatal("Data lost on restart")
+	}
+}
+
+func TestMemoryDBEvents(t *testing.T) {
+	db := testBuildMemoryDb(t)
+
+	e, _ := datamodel.NewCustomEventWithName("test")
+	latest, err := db.LatestEventTimeByName("test")
+	if err != nil || latest != nil {
+		t.Fatal("Expected no latest event")
+	}
+	startTime := time.Now().Add(-time.Millisecond)
+	for i := 0; i < 3; i++ {
+		if err := db.InsertEvent(e); err != nil {
+			t.Fatal(err)
+		}
+	}
+	count, err := db.EventCountByName("test")
+	if err != nil || count != 3 {
+		t.Fatal("Expected 3 events")
+	}
+	count, err = db.EventCountByNameWithLimit("test", 2)
+	if err != nil || count != 2 {
+		t.Fatal("Limit not applied")
+	}
+	count, err = db.EventCountByNameWithLimit("test", -1)
+	if err != nil || count != 3 {
+		t.Fatal("Negative limit should be unlimited, like SQLite")
+	}
+	count, err = db.EventCountByNameSince("test", time.Minute)
+	if err != nil || count != 3 {
+		t.Fatal("Expected 3 events in last minute")
+	}
+	latest, err = db.LatestEventTimeByName("test")
+	if err != nil || latest == nil || latest.Before(startTime) || latest.After(time.Now()) {
+		t.Fatal("Latest event time incorrect")
+	}
+	first, err := db.FirstEventTimeByName("test")
+	if err != nil || first == nil || first.After(*latest) {
+		t.Fatal("First event time incorrect")
+	}
+	times, err := db.AllEventTimesByName("test")
+	if err != nil || len(times) != 3 || !times[0].Equal(*first) || !times[2].Equal(*latest) {
+		t.Fatal("All event times incorrect")
+	}
+}
+
+func TestMemoryDBQueuedEventUsesCallerTime(t *testing.T) {
+	db := testBuildMemoryDb(t)
+
+	e, _ := datamodel.NewCustomEventWithName("queued")
+	queuedAt := time.Date(2024, time.March, 1, 12, 0, 0, 0, time.UTC)
+	if err := db.QueueEvent(e, queuedAt); err != nil {
+		t.Fatal(err)
+	}
+	latest, err := db.LatestEventTimeByName("queued")
+	if err != nil || latest == nil || !latest.Equal(queuedAt) {
+		t.Fatal("Expected queued event created at the caller's time")
+	}
+}
+
+func TestMemoryDBEventCountInWindow(t *testing.T) {
+	db := testBuildMemoryDb(t)
+
+	// Insert out of order, ensure sorted and counted like the SQL query
+	base := time.Now().Add(-5 * 24 * time.Hour).Unix()
+	times := make([]float64, 0, 500)
+	for i := 0; i < 500; i++ {
+		eventTime := time.UnixMilli(base*1000 + rand.Int63n(5*24*60*60*1000))
+		if i%10 == 0 {
+			// exactly on an hour boundary
+			eventTime = time.Unix(base+int64(rand.Intn(5*24)*eventCountHourBucket), 0)
+		}
+		db.insertEventTime("test", eventTime)
+		times = append(times, float64(eventTime.UnixNano())/float64(time.Second))
+	}
+	all, _ := db.AllEventTimesByName("test")
+	for i := 1; i < len(all); i++ {
+		if all[i].Before(all[i-1]) {
+			t.Fatal("Event times not sorted")
+		}
+	}
+
+	for i := 0; i < 200; i++ {
+		start := time.Unix(base, 0).Add(time.Duration(rand.Int63n(int64(6 * 24 * time.Hour))))
+		if i%5 == 0 {
+			start = start.Truncate(time.Hour)
+		}
+		end := start.Add(time.Duration(rand.Int63n(int64(3 * 24 * time.Hour))))
+		count, err := db.EventCountByNameInWindow("test", start, end)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if count != testBruteForceCount(times, start, end) {
+			t.Fatalf("Window count mismatch for [%v, %v)", start, end)
+		}
+	}
+
+	count, err := db.EventCountByNameInWindow("test", time.Now(), time.Now().Add(-time.Hour))
+	if err != nil || count != 0 {
+		t.Fatal("Inverted window should be empty")
+	}
+}
+
+// Run the same operations against both backends, and ensure they agree
+func TestMemoryDBMatchesSqlite(t *testing.T) {
+	sqlDb := testBuildTestDb(t)
+	defer sqlDb.Close()
+	memDb := testBuildMemoryDb(t)
+	backends := []Storage{sqlDb, memDb}
+
+	// Events, with shared created_at times (millisecond precision, like SQLite)
+	base := time.Now().Add(-5 * 24 * time.Hour).UnixMilli()
+	names := []string{"a", "b", "c"}
+	e, _ := datamodel.NewCustomEventWithName("a")
+	for i := 0; i < 300; i++ {
+		e.Name = names[rand.Intn(len(names))]
+		eventTime := time.UnixMilli(base + rand.Int63n(5*24*60*60*1000))
+		err := sqlDb.InsertEvent(e)
+		if err != nil {
+			t.Fatal(err)
+		}
+		_, err = sqlDb.sqldb.Exec(`UPDATE events SET created_at = ? WHERE id = (SELECT MAX(id) FROM events)`, float64(eventTime.UnixMilli())/1000.0)
+		if err != nil {
+			t.Fatal(err)
+		}
+		memDb.insertEventTime(e.Name, eventTime)
+	}
+
+	for _, name := range append(names, "missing") {
+		var results [2][]int
+		var firstTimes, latestTimes [2]*time.Time
+		for bi, b := range backends {
+			count, err := b.EventCountByName(name)
+			if err != nil {
+				t.Fatal(err)
+			}
+			limitCount, err := b.EventCountByNameWithLimit(name, 50)
+			if err != nil {
+				t.Fatal(err)
+			}
+			sinceCount, err := b.EventCountByNameSince(name, 30*time.Hour)
+			if err != nil {
+				t.Fatal(err)
+			}
+			windowStart := time.UnixMilli(base).Add(36 * time.Hour).Add(17 * time.Minute)
+			windowCount, err := b.EventCountByNameInWindow(name, windowStart, windowStart.Add(49*time.Hour))
+			if err != nil {
+				t.Fatal(err)
+			}
+			allTimes, err := b.AllEventTimesByName(name)
+			if err != nil {
+				t.Fatal(err)
+			}
+			results[bi] = []int{count, limitCount, sinceCount, windowCount, len(allTimes)}
+			firstTimes[bi], err = b.FirstEventTimeByName(name)
+			if err != nil {
+				t.Fatal(err)
+			}
+			latestTimes[bi], err = b.LatestEventTimeByName(name)
+			if err != nil {
+				t.Fatal(err)
+			}
+		}
+		for i := range results[0] {
+			if results[0][i] != results[1][i] {
+				t.Fatalf("Backends disagree on event counts for %v: %v vs %v", name, results[0], results[1])
+			}
+		}
+		for _, pair := range [][2]*time.Time{firstTimes, latestTimes} {
+			if (pair[0] == nil) != (pair[1] == nil) {
+				t.Fatalf("Backends disagree on event time existence for %v", name)
+			}
+			// SQLite round trips through a float, allow sub-millisecond differences
+			if pair[0] != nil && pair[0].Sub(*pair[1]).Abs() >= time.Millisecond {
+				t.Fatalf("Backends disagree on event time for %v: %v vs %v", name, pair[0], pair[1])
+			}
+		}
+	}
+
+	// Property history. Time with sub-microsecond part to check rounding matches.
+	propTime := time.Unix(1700000000, 123456789)
+	props := map[string]interface{}{
+		"string": "hello",
+		"int":    42,
+		"float":  3.14,
+		"bool":   true,
+		"time":   propTime,
+	}
+	for _, b := range backends {
+		for name, val := range props {
+			err := b.InsertPropertyHistory(name, datamodel.PropertyValueFromInterface(val), datamodel.CMPropertySampleTypeAppStart)
+			if err != nil {
+				t.Fatal(err)
+			}
+			// rate limited, should not replace first value
+			err = b.InsertPropertyHistory(name, datamodel.NewStringPropertyValue("other"), datamodel.CMPropertySampleTypeAppStart)
+			if err != nil {
+				t.Fatal(err)
+			}
+		}
+		if err := b.InsertPropertyHistory("invalid", datamodel.PropertyValue{}, datamodel.CMPropertySampleTypeAppStart); err == nil {
+			t.Fatal("Allowed unsupported type")
+		}
+	}
+	for name, val := range props {
+		sqlVal, err := sqlDb.LatestPropertyHistory(name)
+		if err != nil {
+			t.Fatal(err)
+		}
+		memVal, err := memDb.LatestPropertyHistory(name)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if sqlTime, ok := sqlVal.(time.Time); ok {
+			if !sqlTime.Equal(memVal.(time.Time)) {
+				t.Fatalf("Backends disagree on latest time value: %v vs %v", sqlVal, memVal)
+			}
+		} else if sqlVal != memVal {
+			t.Fatalf("Backends disagree on latest value for %v: %v (%T) vs %v (%T)", name, sqlVal, sqlVal, memVal, memVal)
+		}
+
+		for _, check := range []interface{}{val, "other", 41, 2.0, false, propTime.Add(time.Second)} {
+			sqlEver, err := sqlDb.PropertyHistoryEverHadValue(name, datamodel.PropertyValueFromInterface(check))
+			if err != nil {
+				t.Fatal(err)
+			}
+			memEver, err := memDb.PropertyHistoryEverHadValue(name, datamodel.PropertyValueFromInterface(check))
+			if err != nil {
+				t.Fatal(err)
+			}
+			if sqlEver != memEver {
+				t.Fatalf("Backends disagree on propertyEver(%v, %v)", name, check)
+			}
+		}
+	}
+	for _, b := range backends {
+		if _, err := b.LatestPropertyHistory("missing"); err != sql.ErrNoRows {
+			t.Fatal("Expected sql.ErrNoRows for missing property history")
+		}
+		r1, err := b.StableRandom()
+		if err != nil {
+			t.Fatal(err)
+		}
+		r2, err := b.StableRandom()
+		if err != nil || r1 != r2 {
+			t.Fatal("Stable random not stable")
+		}
+	}
+}
+
+func BenchmarkMemoryDBEventCountInWindow(b *testing.B) {
+	db := NewMemoryDB()
+	db.StartWithPath("")
+	now := time.Now()
+	for i := 0; i < 100_000; i++ {
+		db.insertEventTime("bench", now.Add(-time.Duration(100_000-i)*30*time.Second))
+	}
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		_, err := db.EventCountByNameSince("bench", 7*24*time.Hour)
+		if err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -2,40 +2,46 @@ package db
 
 import (
 	"errors"
+	"sync"
 
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
 )
 
 type propHistoryValue struct {
-	value       interface{}
+	value       datamodel.PropertyValue
 	sample_type datamodel.CMPropertySampleType
 }
 
 type PropertyHistoryManager struct {
-	db *DB
+	db Storage
 
+	// Properties set before the DB started. Properties can be set from any thread.
+	preStartLock       sync.Mutex
 	preStartPropsCache map[string]propHistoryValue
 }
 
-func newPropertyHistoryManager(db *DB) *PropertyHistoryManager {
+func newPropertyHistoryManager(db Storage) *PropertyHistoryManager {
 	return &PropertyHistoryManager{
 		db:                 db,
 		preStartPropsCache: map[string]propHistoryValue{},
 	}
 }
 
-func (phm *PropertyHistoryManager) TrackPropertyHistoryForStartup(appStartValues map[string]interface{}) error {
+func (phm *PropertyHistoryManager) TrackPropertyHistoryForStartup(appStartValues map[string]datamodel.PropertyValue) error {
 	// keep processing on error, but return all errors at end
 	errorSet := []error{}
 
 	// Set values for properties that were set before startup
-	for name, prop := range phm.preStartPropsCache {
+	phm.preStartLock.Lock()
+	preStartProps := phm.preStartPropsCache
+	phm.preStartPropsCache = map[string]propHistoryValue{}
+	phm.preStartLock.Unlock()
+	for name, prop := range preStartProps {
 		err := phm.db.InsertPropertyHistory(name, prop.value, prop.sample_type)
 		if err != nil {
 			errorSet = append(errorSet, err)
 		}
 	}
-	phm.preStartPropsCache = map[string]propHistoryValue{}
 
 	// Set the startup values (used for built in props with sample type= CMPropertySampleTypeAppStart)
 	for name, val := range appStartValues {
@@ -52,31 +58,32 @@ func (phm *PropertyHistoryManager) TrackPropertyHistoryForStartup(appStartValues
 	return nil
 }
 
-func (phm *PropertyHistoryManager) CustomPropertySet(name string, val interface{}) error {
+func (phm *PropertyHistoryManager) CustomPropertySet(name string, val datamodel.PropertyValue) error {
 	return phm.setPropertyHistory(name, val, datamodel.CMPropertySampleTypeOnCustomSet)
 }
 
-func (phm *PropertyHistoryManager) UpdateHistoryForPropertyAccessed(name string, val interface{}) error {
+func (phm *PropertyHistoryManager) UpdateHistoryForPropertyAccessed(name string, val datamodel.PropertyValue) error {
 	return phm.setPropertyHistory(name, val, datamodel.CMPropertySampleTypeOnUse)
 }
 
-func (phm *PropertyHistoryManager) setPropertyHistory(name string, val interface{}, sampleType datamodel.CMPropertySampleType) error {
+func (phm *PropertyHistoryManager) setPropertyHistory(name string, val datamodel.PropertyValue, sampleType datamodel.CMPropertySampleType) error {
 	if name == "" {
 		return nil
 	}
 
-	if phm.db.started {
-		err := phm.db.InsertPropertyHistory(name, val, datamodel.CMPropertySampleTypeOnCustomSet)
-		if err != nil {
-			return err
-		}
-	} else {
+	// Checked under the lock, so a value cached here can't miss the flush in TrackPropertyHistoryForStartup if the
+	// DB is started concurrently
+	phm.preStartLock.Lock()
+	if !phm.db.Started() {
 		// Not started, cache
 		phm.preStartPropsCache[name] = propHistoryValue{
 			value:       val,
 			sample_type: sampleType,
 		}
+		phm.preStartLock.Unlock()
+		return nil
 	}
+	phm.preStartLock.Unlock()
 
-	return nil
+	return phm.db.InsertPropertyHistory(name, val, datamodel.CMPropertySampleTypeOnCustomSet)
 }
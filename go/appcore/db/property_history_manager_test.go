@@ -7,6 +7,8 @@ import (
 	"os"
 	"testing"
 	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
 )
 
 func testPropertyHistoryManager(t testing.TB) (*DB, *PropertyHistoryManager, error) {
@@ -68,14 +70,14 @@ func TestHistoryManager(t *testing.T) {
 	}
 
 	for k, v := range customProps {
-		err = phm.CustomPropertySet(k, v)
+		err = phm.CustomPropertySet(k, datamodel.PropertyValueFromInterface(v))
 		if err != nil {
 			t.Fatal(err)
 		}
 	}
 
 	for k, v := range beforeStartUseProps {
-		err := phm.UpdateHistoryForPropertyAccessed(k, v)
+		err := phm.UpdateHistoryForPropertyAccessed(k, datamodel.PropertyValueFromInterface(v))
 		if err != nil {
 			t.Fatal(err)
 		}
@@ -85,20 +87,24 @@ func TestHistoryManager(t *testing.T) {
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = phm.TrackPropertyHistoryForStartup(startupProps)
+	startupValues := map[string]datamodel.PropertyValue{}
+	for k, v := range startupProps {
+		startupValues[k] = datamodel.PropertyValueFromInterface(v)
+	}
+	err = phm.TrackPropertyHistoryForStartup(startupValues)
 	if err != nil {
 		t.Fatal(err)
 	}
 
 	for k, v := range afterStartUseProps {
-		err := phm.UpdateHistoryForPropertyAccessed(k, v)
+		err := phm.UpdateHistoryForPropertyAccessed(k, datamodel.PropertyValueFromInterface(v))
 		if err != nil {
 			t.Fatal(err)
 		}
 	}
 
 	for k, v := range afterStartCustomProps {
-		err = phm.CustomPropertySet(k, v)
+		err = phm.CustomPropertySet(k, datamodel.PropertyValueFromInterface(v))
 		if err != nil {
 			t.Fatal(err)
 		}
@@ -199,7 +205,7 @@ func Benchmark(b *testing.B) {
 
 	for i := 0; i < b.N; i++ {
 		x := rand.Int()
-		err = phm.UpdateHistoryForPropertyAccessed(fmt.Sprintf("test%d", x), x)
+		err = phm.UpdateHistoryForPropertyAccessed(fmt.Sprintf("test%d", x), datamodel.NewIntPropertyValue(int64(x)))
 		if err != nil {
 			b.Fatal(err)
 		}
@@ -0,0 +1,142 @@
+package db
+
+import (
+	"context"
+	"database/sql"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Storage is the persistence backend for events and property history.
+// DB (SQLite) is the production implementation. MemoryDB implements the same
+// semantics in memory, for simulations, benchmarks and tests which don't need durability.
+type Storage interface {
+	StartWithPath(dataDir string) error
+	Started() bool
+	Close() error
+	PropertyHistoryManager() *PropertyHistoryManager
+	DbConditionFunctions() map[string]*datamodel.ConditionDynamicFunction
+
+	InsertEvent(e *datamodel.Event) error
+	// Insert which may be batched, created at the given time (from the caller's clock). Visible to all reads after
+	// the call, durable after FlushQueuedEvents.
+	QueueEvent(e *datamodel.Event, createdAt time.Time) error
+	FlushQueuedEvents() error
+	EventCountByName(name string) (int, error)
+	EventCountByNameWithLimit(name string, limit int) (int, error)
+	EventCountByNameSince(name string, duration time.Duration) (int, error)
+	EventCountByNameInWindow(name string, start time.Time, end time.Time) (int, error)
+	LatestEventTimeByName(name string) (*time.Time, error)
+	FirstEventTimeByName(name string) (*time.Time, error)
+	AllEventTimesByName(name string) ([]time.Time, error)
+	EventTimesByNameCursor(ctx context.Context, name string, pageSize int) *Cursor[time.Time]
+
+	InsertPropertyHistory(name string, value datamodel.PropertyValue, sampleType datamodel.CMPropertySampleType) error
+	// Returns sql.ErrNoRows if the property has no history
+	LatestPropertyHistory(name string) (interface{}, error)
+	PropertyHistoryCursor(ctx context.Context, name string, pageSize int) *Cursor[PropertyHistoryRow]
+	PropertyHistoryEverHadValue(name string, value datamodel.PropertyValue) (bool, error)
+	StableRandom() (int64, error)
+}
+
+// Compile time checks that the backends implement Storage
+var _ Storage = (*DB)(nil)
+var _ Storage = (*MemoryDB)(nil)
+
+func storageConditionFunctions(db Storage) map[string]*datamodel.ConditionDynamicFunction {
+	return map[string]*datamodel.ConditionDynamicFunction{
+		"eventCount": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done with the Types signature
+				count, err := db.EventCountByName(params[0].(string))
+				if err != nil {
+					return nil, err
+				}
+				return count, nil
+			},
+			Types: []any{new(func(string) int)},
+		},
+		"eventCountWithLimit": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				count, err := db.EventCountByNameWithLimit(params[0].(string), params[1].(int))
+				if err != nil {
+					return nil, err
+				}
+				return count, nil
+			},
+			Types: []any{new(func(string, int) int)},
+		},
+		"eventCountSince": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				count, err := db.EventCountByNameSince(params[0].(string), params[1].(time.Duration))
+				if err != nil {
+					return nil, err
+				}
+				return count, nil
+			},
+			Types: []any{new(func(string, time.Duration) int)},
+		},
+		"eventCountInWindow": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				count, err := db.EventCountByNameInWindow(params[0].(string), params[1].(time.Time), params[2].(time.Time))
+				if err != nil {
+					return nil, err
+				}
+				return count, nil
+			},
+			Types: []any{new(func(string, time.Time, time.Time) int)},
+		},
+		"latestEventTime": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				time, err := db.LatestEventTimeByName(params[0].(string))
+				if err != nil {
+					return nil, err
+				}
+				if time == nil {
+					return nil, nil
+				}
+				// Time values not passed by reference
+				return *time, nil
+			},
+			Types: []any{new(func(string) interface{})},
+		},
+		"propertyHistoryLatestValue": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				value, err := db.LatestPropertyHistory(params[0].(string))
+				// no rows should return nil
+				if err == sql.ErrNoRows {
+					return nil, nil
+				}
+				if err != nil {
+					return nil, err
+				}
+				return value, nil
+			},
+			Types: []any{new(func(string) interface{})},
+		},
+		"propertyEver": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				value, err := db.PropertyHistoryEverHadValue(params[0].(string), datamodel.PropertyValueFromInterface(params[1]))
+				if err != nil {
+					return nil, err
+				}
+				return value, nil
+			},
+			Types: []any{new(func(string, interface{}) bool)},
+		},
+		"stableRand": {
+			Function: func(params ...any) (any, error) {
+				// Parameter type+count checking is done the Types signature
+				return db.StableRandom()
+			},
+			Types: []any{new(func() int64)},
+		},
+	}
+}
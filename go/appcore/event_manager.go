@@ -3,14 +3,16 @@ package appcore
 import (
 	"fmt"
 	"reflect"
+	"sync/atomic"
 	"time"
 
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
 )
 
+// Safe for concurrent use: events can be sent from any thread
 type EventManager struct {
-	lastSessionStartTime *time.Time
-	logEvents            bool
+	lastSessionStartTime atomic.Pointer[time.Time]
+	logEvents            atomic.Bool
 }
 
 func (em *EventManager) SendEvent(e *datamodel.Event, ac *Appcore) error {
@@ -18,19 +20,37 @@ func (em *EventManager) SendEvent(e *datamodel.Event, ac *Appcore) error {
 	err := ac.db.InsertEvent(e)
 
 	if err != nil {
-		if em.logEvents {
+		if em.logEvents.Load() {
 			fmt.Printf("CriticalMoments: Error saving event: %v\n", err)
 		}
 		return err
 	}
 
-	if em.logEvents {
+	if em.logEvents.Load() {
 		fmt.Printf("CriticalMoments: Event: %v\n", e.Name)
 	}
 
 	return nil
 }
 
+// Records a derived bookkeeping event with no listeners: only persisted, and the write may be batched
+func (em *EventManager) queueEvent(e *datamodel.Event, ac *Appcore) error {
+	start := time.Now()
+	err := ac.db.QueueEvent(e, ac.now())
+	ac.instrumentation.since(stageEventPersist, start)
+	if err != nil {
+		if em.logEvents.Load() {
+			fmt.Printf("CriticalMoments: Error saving event: %v\n", err)
+		}
+		return err
+	}
+
+	if em.logEvents.Load() {
+		fmt.Printf("CriticalMoments: Event: %v\n", e.Name)
+	}
+	return nil
+}
+
 func (em *EventManager) processEvent(e *datamodel.Event, ac *Appcore) {
 	if e.EventType == datamodel.EventTypeBuiltIn && e.Name == datamodel.AppEnteredForegroundBuiltInEvent {
 		err := em.updateSessionForForeground(ac)
@@ -46,8 +66,8 @@ var SessionGapDuration = time.Minute * 10
 // Update session when entering foreground
 func (em *EventManager) updateSessionForForeground(ac *Appcore) error {
 	// Fail fast: if session started in last 10 minutes, we know we're still in that session
-	if em.lastSessionStartTime != nil {
-		if time.Since(*em.lastSessionStartTime) < SessionGapDuration {
+	if lastSessionStartTime := em.lastSessionStartTime.Load(); lastSessionStartTime != nil {
+		if ac.now().Sub(*lastSessionStartTime) < SessionGapDuration {
 			// Continue current sessions
 			return nil
 		}
@@ -58,7 +78,7 @@ func (em *EventManager) updateSessionForForeground(ac *Appcore) error {
 		return err
 	}
 
-	if lastEnterBackgroundTime == nil || time.Since(*lastEnterBackgroundTime) > SessionGapDuration {
+	if lastEnterBackgroundTime == nil || ac.now().Sub(*lastEnterBackgroundTime) > SessionGapDuration {
 		// No prior backgrounds or it's been 10 mins, this is new session
 		return em.startSession(ac)
 	}
@@ -78,12 +98,13 @@ func (em *EventManager) updateSessionForForeground(ac *Appcore) error {
 
 func (em *EventManager) startSession(ac *Appcore) error {
 	// Start new session: fire event, set session_start_time, and remember last timestamp
-	err := ac.SendBuiltInEvent(datamodel.SessionStartBuiltInEvent)
+	// Always called while ingesting an event, so send inline
+	err := ac.sendInlineBuiltInEvent(datamodel.SessionStartBuiltInEvent)
 	if err != nil {
 		return err
 	}
-	now := time.Now()
-	em.lastSessionStartTime = &now
+	now := ac.now()
+	em.lastSessionStartTime.Store(&now)
 
 	return nil
 }
@@ -92,13 +113,16 @@ func (em *EventManager) startSession(ac *Appcore) error {
 
 type SessionStartTimePropertyProvider struct {
 	eventManager *EventManager
+	// Clock for the session start before the first session begins
+	ac *Appcore
 }
 
-func (s SessionStartTimePropertyProvider) Value() interface{} {
-	if s.eventManager.lastSessionStartTime == nil {
-		return time.Now()
+func (s SessionStartTimePropertyProvider) Value() datamodel.PropertyValue {
+	lastSessionStartTime := s.eventManager.lastSessionStartTime.Load()
+	if lastSessionStartTime == nil {
+		return datamodel.NewTimePropertyValue(s.ac.now())
 	}
-	return *s.eventManager.lastSessionStartTime
+	return datamodel.NewTimePropertyValue(*lastSessionStartTime)
 }
 
 func (s SessionStartTimePropertyProvider) Kind() reflect.Kind {
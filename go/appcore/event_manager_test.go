@@ -63,7 +63,7 @@ func TestSessionStart(t *testing.T) {
 	if err != nil {
 		t.Fatal(err)
 	}
-	sessionStartResult := r.(time.Time)
+	sessionStartResult := r.TimeValue()
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -72,3 +72,24 @@ func TestSessionStart(t *testing.T) {
 		t.Fatalf("Unexpected session start time: %v", sessionStartResult)
 	}
 }
+
+func TestSessionStartTimeUsesClockBeforeFirstSession(t *testing.T) {
+	ac, err := testBuildValidTestAppCore(t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	simulatedNow := time.Date(2024, time.March, 1, 12, 0, 0, 0, time.UTC)
+	ac.clock = func() time.Time { return simulatedNow }
+	err = ac.Start(true)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	r, err := ac.propertyRegistry.propertyValue("session_start_time")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !r.TimeValue().Equal(simulatedNow) {
+		t.Fatalf("Expected session start from the Appcore clock, got %v", r)
+	}
+}
@@ -0,0 +1,197 @@
+package appcore
+
+import (
+	"errors"
+	"fmt"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Event ingestion queue
+
+Events are processed in order, in two pipelined stages, each a single goroutine:
+ 1. Ingest: persist the event (EventManager.SendEvent), then dispatch triggers (performActionsForEvent)
+ 2. Notifications: update the notification plan (notificationRunnerProcessEvent)
+
+Stages are connected by FIFO channels, so every stage sees events in the order they were enqueued, and the
+ingest stage can move on to the next event while the plan is updated for the last.
+
+Events raised while ingesting (action:X from triggers, session_start from the session check) are ingested inline,
+before the event that raised them continues, then handed to the notification stage. Waiting on the queue from the
+ingest stage would deadlock. See the inline flag on performNamedAction. Derived bookkeeping events nothing listens
+for skip the queue entirely, and are only recorded (see sendDerivedEvent).
+
+Backpressure: the intake is bounded (SetEventQueueCapacity). When full, enqueueing blocks by default, or returns
+errEventQueueFull if SetEventQueueRejectWhenFull(true).
+
+Each enqueued event has an EventFuture, completed once all stages have processed it. SendClientEvent and
+SendBuiltInEvent enqueue and wait, so they keep their synchronous semantics. FlushEvents waits for everything
+enqueued before it, for background/termination.
+*/
+
+const defaultEventQueueCapacity = 1024
+
+var errEventQueueFull = errors.New("CriticalMoments: event queue full, event dropped")
+
+// Completion of an enqueued event. Err is the first error from any stage (persisting, or performing trigger actions).
+type EventFuture struct {
+	done chan struct{}
+	err  error
+}
+
+func newEventFuture() *EventFuture {
+	return &EventFuture{done: make(chan struct{})}
+}
+
+func (f *EventFuture) complete(err error) {
+	f.err = err
+	close(f.done)
+}
+
+// Blocks until the event has been processed by all stages
+func (f *EventFuture) Wait() error {
+	<-f.done
+	return f.err
+}
+
+func (f *EventFuture) Done() bool {
+	select {
+	case <-f.done:
+		return true
+	default:
+		return false
+	}
+}
+
+// An event (or flush barrier when event is nil) moving through the stages. Future is nil for inline events.
+type queuedEvent struct {
+	event      *datamodel.Event
+	future     *EventFuture
+	err        error
+	enqueuedAt time.Time
+}
+
+type eventQueue struct {
+	ac               *Appcore
+	rejectWhenFull   bool
+	intake           chan *queuedEvent
+	notificationWork chan *queuedEvent
+}
+
+func newEventQueue(ac *Appcore, capacity int, rejectWhenFull bool) *eventQueue {
+	if capacity < 1 {
+		capacity = 1
+	}
+	q := &eventQueue{
+		ac:               ac,
+		rejectWhenFull:   rejectWhenFull,
+		intake:           make(chan *queuedEvent, capacity),
+		notificationWork: make(chan *queuedEvent, capacity),
+	}
+	go q.runIngestStage()
+	go q.runNotificationStage()
+	return q
+}
+
+func (q *eventQueue) enqueue(event *datamodel.Event) (*EventFuture, error) {
+	qe := &queuedEvent{event: event, future: newEventFuture(), enqueuedAt: time.Now()}
+	if q.rejectWhenFull {
+		select {
+		case q.intake <- qe:
+		default:
+			return nil, errEventQueueFull
+		}
+	} else {
+		q.intake <- qe
+	}
+	return qe.future, nil
+}
+
+// Flush barriers always block for space, never rejected
+func (q *eventQueue) flush() error {
+	qe := &queuedEvent{future: newEventFuture()}
+	q.intake <- qe
+	return qe.future.Wait()
+}
+
+// Processes everything queued, then stops the stages. Nothing may be enqueued after. For Appcores which are discarded,
+// like trace replays.
+func (q *eventQueue) close() error {
+	err := q.flush()
+	// After the flush nothing is in flight, so the ingest stage won't send more notification work
+	close(q.intake)
+	close(q.notificationWork)
+	return err
+}
+
+func (q *eventQueue) runIngestStage() {
+	for qe := range q.intake {
+		if qe.event != nil {
+			q.ac.instrumentation.since(stageEventQueueWait, qe.enqueuedAt)
+			q.ac.instrumentation.withProfilingLabels(stageEventIngest, func() {
+				qe.err = q.ingest(qe.event)
+			})
+		}
+		q.notificationWork <- qe
+	}
+}
+
+// Persist and dispatch triggers for an event, on the ingest stage (directly, or inline for events it raises)
+func (q *eventQueue) ingest(event *datamodel.Event) (returnErr error) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			returnErr = fmt.Errorf("panic in SendEvent: %v", r)
+		}
+	}()
+	in := q.ac.instrumentation
+	defer in.since(stageEventIngest, time.Now())
+
+	persistStart := time.Now()
+	err := q.ac.eventManager.SendEvent(event, q.ac)
+	in.since(stageEventPersist, persistStart)
+	if err != nil {
+		return err
+	}
+
+	defer in.since(stageEventTriggers, time.Now())
+	return q.ac.performActionsForEvent(event.Name)
+}
+
+// Events raised while ingesting another event. Processed immediately, then queued for the notification stage
+// ahead of the event that raised them.
+func (q *eventQueue) ingestInline(event *datamodel.Event) error {
+	err := q.ingest(event)
+	q.notificationWork <- &queuedEvent{event: event}
+	return err
+}
+
+func (q *eventQueue) runNotificationStage() {
+	for qe := range q.notificationWork {
+		if qe.event != nil {
+			q.ac.instrumentation.withProfilingLabels(stageEventNotifications, func() {
+				q.processNotifications(qe.event)
+			})
+		}
+		if qe.future != nil {
+			qe.future.complete(qe.err)
+		}
+	}
+}
+
+func (q *eventQueue) processNotifications(event *datamodel.Event) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			fmt.Printf("CriticalMoments: panic processing notifications for event '%v': %v\n", event.Name, r)
+		}
+	}()
+	defer q.ac.instrumentation.since(stageEventNotifications, time.Now())
+
+	err := q.ac.notificationRunnerProcessEvent(event)
+	if err != nil {
+		fmt.Printf("CriticalMoments: there was an issue processing notifications for event '%v'. Error: %v\n", event.Name, err)
+	}
+}
@@ -0,0 +1,204 @@
+package appcore
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"slices"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Records links in the order shown, optionally blocking the ingest stage until released
+type testOrderedLibBindings struct {
+	testLibBindings
+	lock    sync.Mutex
+	links   []string
+	showing chan struct{}
+	release chan struct{}
+}
+
+func (lb *testOrderedLibBindings) ShowLink(l *datamodel.LinkAction) error {
+	if lb.showing != nil {
+		lb.showing <- struct{}{}
+		<-lb.release
+	}
+	lb.lock.Lock()
+	defer lb.lock.Unlock()
+	lb.links = append(lb.links, l.UrlString)
+	return nil
+}
+
+func testBuildQueueAppcore(t *testing.T, capacity int, rejectWhenFull bool, lb *testOrderedLibBindings) *Appcore {
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(testConcurrencyConfigJson(10)), 0644); err != nil {
+		t.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, db.NewMemoryDB(), t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ac.RegisterLibraryBindings(lb)
+	ac.SetEventQueueCapacity(capacity)
+	ac.SetEventQueueRejectWhenFull(rejectWhenFull)
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	return ac
+}
+
+func TestEventQueueOrderAndFlush(t *testing.T) {
+	lb := &testOrderedLibBindings{}
+	ac := testBuildQueueAppcore(t, 4, false, lb)
+
+	var futures []*EventFuture
+	var expectedLinks []string
+	for i := 0; i < 50; i++ {
+		n := (i * 7) % 10
+		future, err := ac.EnqueueClientEvent(fmt.Sprintf("e%v", n))
+		if err != nil {
+			t.Fatal(err)
+		}
+		futures = append(futures, future)
+		expectedLinks = append(expectedLinks, fmt.Sprintf("https://criticalmoments.io/%v", n))
+	}
+	if err := ac.FlushEvents(); err != nil {
+		t.Fatal(err)
+	}
+	for _, future := range futures {
+		if !future.Done() || future.Wait() != nil {
+			t.Fatal("Expected all futures complete without error after flush")
+		}
+	}
+	if !slices.Equal(lb.links, expectedLinks) {
+		t.Fatal("Triggers dispatched out of order")
+	}
+
+	// Events raised by triggers are persisted inline, before the future completes
+	count, err := ac.db.EventCountByName("action:link0")
+	if err != nil || count != 5 {
+		t.Fatalf("Expected 5 action events, got %v", count)
+	}
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	if ac.notificationPlan == nil || ac.notificationPlan.ScheduledNotificationCount() != 10 {
+		t.Fatal("Expected notifications planned for all events after flush")
+	}
+}
+
+func TestEventQueueBackpressure(t *testing.T) {
+	lb := &testOrderedLibBindings{showing: make(chan struct{}), release: make(chan struct{})}
+	ac := testBuildQueueAppcore(t, 1, true, lb)
+
+	if _, err := ac.EnqueueClientEvent("e1"); err != nil {
+		t.Fatal(err)
+	}
+	// Ingest stage is now blocked showing the link, so the one slot fills, and the next is rejected
+	<-lb.showing
+	queued, err := ac.EnqueueClientEvent("e2")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ac.EnqueueClientEvent("e3"); err != errEventQueueFull {
+		t.Fatal("Expected full queue to reject event")
+	}
+	if queued.Done() {
+		t.Fatal("Future completed before processing")
+	}
+
+	// Blocking mode waits for space instead
+	ac.eventQueue.rejectWhenFull = false
+	enqueued := make(chan error)
+	go func() {
+		_, err := ac.EnqueueClientEvent("e4")
+		enqueued <- err
+	}()
+	lb.release <- struct{}{}
+	<-lb.showing
+	if err := <-enqueued; err != nil {
+		t.Fatal(err)
+	}
+	go func() {
+		for range lb.showing {
+			lb.release <- struct{}{}
+		}
+	}()
+	lb.release <- struct{}{}
+	if err := queued.Wait(); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.FlushEvents(); err != nil {
+		t.Fatal(err)
+	}
+	if len(lb.links) != 3 || lb.links[2] != "https://criticalmoments.io/4" {
+		t.Fatalf("Expected rejected event dropped, got %v", lb.links)
+	}
+}
+
+// Counts queued (batchable) and regular event inserts
+type testQueuedEventStorage struct {
+	*db.MemoryDB
+	lock     sync.Mutex
+	queued   []string
+	inserted []string
+}
+
+func (s *testQueuedEventStorage) QueueEvent(e *datamodel.Event, createdAt time.Time) error {
+	s.lock.Lock()
+	s.queued = append(s.queued, e.Name)
+	s.lock.Unlock()
+	return s.MemoryDB.QueueEvent(e, createdAt)
+}
+func (s *testQueuedEventStorage) InsertEvent(e *datamodel.Event) error {
+	s.lock.Lock()
+	s.inserted = append(s.inserted, e.Name)
+	s.lock.Unlock()
+	return s.MemoryDB.InsertEvent(e)
+}
+
+func TestDerivedEventsWithoutListenersSkipQueue(t *testing.T) {
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"conditions": {"namedConditions": {"flag": "true"}},
+		"actions": {"namedActions": {
+			"link0": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/0"}},
+			"link1": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/1"}}}},
+		"triggers": {"namedTriggers": {"t": {"eventName": "action:link0", "actionName": "link1"}}}}`
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(config), 0644); err != nil {
+		t.Fatal(err)
+	}
+	storage := &testQueuedEventStorage{MemoryDB: db.NewMemoryDB()}
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, storage, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	lb := &testOrderedLibBindings{}
+	ac.RegisterLibraryBindings(lb)
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+
+	if r, err := ac.CheckNamedCondition("flag"); err != nil || !r {
+		t.Fatal("Expected flag to pass")
+	}
+	if err := ac.PerformNamedAction("link0"); err != nil {
+		t.Fatal(err)
+	}
+
+	// action:link0 has a trigger, so is dispatched (performing link1). The rest are only recorded.
+	if !slices.Equal(lb.links, []string{"https://criticalmoments.io/0", "https://criticalmoments.io/1"}) {
+		t.Fatalf("Expected trigger on derived event to run, got %v", lb.links)
+	}
+	if !slices.Equal(storage.queued, []string{"ff_true:flag", "action:link1"}) || !slices.Contains(storage.inserted, "action:link0") {
+		t.Fatalf("Unexpected derived event paths, queued: %v, inserted: %v", storage.queued, storage.inserted)
+	}
+	for _, name := range []string{"ff_true:flag", "action:link0", "action:link1"} {
+		if count, err := ac.db.EventCountByName(name); err != nil || count != 1 {
+			t.Fatalf("Expected %v recorded once", name)
+		}
+	}
+}
@@ -0,0 +1,368 @@
+package appcore
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math"
+	"os"
+	"reflect"
+	"sync"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Event traces
+
+A trace records the appcore input stream, so a session from the field can be replayed (see trace_replay.go): Start
+(with the API key and lib versions), events sent, static and client property registrations, lib property providers
+and each value read from them, background work calls, and the config version loaded. Recording is off unless
+StartTraceRecording is called; call it before registering properties and Start to capture a full session.
+
+The format is compact binary: a header, then records of a kind byte, the time since the previous record
+(varint nanoseconds, the first from the epoch), and a kind specific payload. Strings are length prefixed, integers
+varints, and property values are tagged with their type.
+
+Inputs raised by appcore itself (the app_start event and startup properties) aren't recorded, as Start raises them
+again on replay.
+*/
+
+const traceFileHeader = "CMTRACE\x01"
+
+type traceRecordKind byte
+
+const (
+	traceRecordStart traceRecordKind = iota + 1
+	traceRecordConfig
+	traceRecordEvent
+	traceRecordStaticProperty
+	traceRecordClientProperty
+	traceRecordClientPropertiesJson
+	traceRecordLibPropertyProvider
+	traceRecordLibPropertyValue
+	traceRecordBackgroundWork
+)
+
+// Property value type tags
+const (
+	traceValueNil byte = iota
+	traceValueBool
+	traceValueString
+	traceValueInt
+	traceValueFloat
+	traceValueTime
+)
+
+var errTraceCorrupt = errors.New("CriticalMoments: trace file is corrupt")
+
+// A decoded record. Which fields are set depends on the kind.
+type traceRecord struct {
+	kind traceRecordKind
+	at   time.Time
+	// Event name, property key, or config SHA-256
+	name  string
+	value datamodel.PropertyValue
+	// Built in event, or Start's allowDebugLoad
+	flag bool
+	// Start: API key, bundle ID, app version, CM version. Config: config version.
+	strings []string
+	// Client properties JSON
+	data []byte
+	// Lib property provider type, or Start's test build (1)
+	number int64
+}
+
+// Writes records to a trace file. Methods are safe to call on a nil recorder (not recording).
+type traceRecorder struct {
+	lock sync.Mutex
+	file *os.File
+	w    *bufio.Writer
+	now  func() time.Time
+	// Time of the last record, unix nanoseconds
+	last int64
+	buf  []byte
+	// First write error. Recording stops after an error.
+	err error
+}
+
+func newTraceRecorder(path string, now func() time.Time) (*traceRecorder, error) {
+	file, err := os.Create(path)
+	if err != nil {
+		return nil, err
+	}
+	r := &traceRecorder{file: file, w: bufio.NewWriter(file), now: now}
+	if _, err := r.w.WriteString(traceFileHeader); err != nil {
+		file.Close()
+		return nil, err
+	}
+	return r, nil
+}
+
+func (r *traceRecorder) record(kind traceRecordKind, appendPayload func(b []byte) []byte) {
+	if r == nil {
+		return
+	}
+	at := r.now().UnixNano()
+	r.lock.Lock()
+	defer r.lock.Unlock()
+	if r.err != nil || r.w == nil {
+		return
+	}
+	b := append(r.buf[:0], byte(kind))
+	b = binary.AppendVarint(b, at-r.last)
+	b = appendPayload(b)
+	r.last = at
+	r.buf = b
+	if _, err := r.w.Write(b); err != nil {
+		r.err = err
+		fmt.Printf("CriticalMoments: trace recording stopped: %v\n", err)
+	}
+}
+
+// Flushes and closes the file. Returns the first error recording.
+func (r *traceRecorder) close() error {
+	r.lock.Lock()
+	defer r.lock.Unlock()
+	if r.w == nil {
+		return r.err
+	}
+	err := errors.Join(r.err, r.w.Flush(), r.file.Close())
+	r.w = nil
+	return err
+}
+
+func appendTraceString(b []byte, s string) []byte {
+	b = binary.AppendUvarint(b, uint64(len(s)))
+	return append(b, s...)
+}
+
+func appendTraceBool(b []byte, v bool) []byte {
+	if v {
+		return append(b, 1)
+	}
+	return append(b, 0)
+}
+
+func appendTraceValue(b []byte, value datamodel.PropertyValue) []byte {
+	switch value.Kind() {
+	case reflect.Bool:
+		return appendTraceBool(append(b, traceValueBool), value.BoolValue())
+	case reflect.String:
+		return appendTraceString(append(b, traceValueString), value.StringValue())
+	case reflect.Int:
+		return binary.AppendVarint(append(b, traceValueInt), value.IntValue())
+	case reflect.Float64:
+		return binary.LittleEndian.AppendUint64(append(b, traceValueFloat), math.Float64bits(value.FloatValue()))
+	case datamodel.CMTimeKind:
+		return binary.AppendVarint(append(b, traceValueTime), value.TimeValue().UnixNano())
+	}
+	return append(b, traceValueNil)
+}
+
+func (r *traceRecorder) recordStart(allowDebugLoad bool, apiKey string, bundleID string, lb LibBindings) {
+	var appVersion, cmVersion string
+	var testBuild int64
+	if lb != nil {
+		appVersion, cmVersion = lb.AppVersion(), lb.CMVersion()
+		if lb.IsTestBuild() {
+			testBuild = 1
+		}
+	}
+	r.record(traceRecordStart, func(b []byte) []byte {
+		b = appendTraceBool(b, allowDebugLoad)
+		for _, s := range []string{apiKey, bundleID, appVersion, cmVersion} {
+			b = appendTraceString(b, s)
+		}
+		return binary.AppendVarint(b, testBuild)
+	})
+}
+
+func (r *traceRecorder) recordConfig(sha256 string, configVersion string) {
+	r.record(traceRecordConfig, func(b []byte) []byte {
+		return appendTraceString(appendTraceString(b, sha256), configVersion)
+	})
+}
+
+func (r *traceRecorder) recordEvent(name string, builtIn bool) {
+	r.record(traceRecordEvent, func(b []byte) []byte {
+		return appendTraceString(appendTraceBool(b, builtIn), name)
+	})
+}
+
+// Kind is traceRecordStaticProperty, traceRecordClientProperty or traceRecordLibPropertyValue
+func (r *traceRecorder) recordProperty(kind traceRecordKind, key string, value datamodel.PropertyValue) {
+	r.record(kind, func(b []byte) []byte {
+		return appendTraceValue(appendTraceString(b, key), value)
+	})
+}
+
+func (r *traceRecorder) recordClientPropertiesJson(jsonData []byte) {
+	r.record(traceRecordClientPropertiesJson, func(b []byte) []byte {
+		b = binary.AppendUvarint(b, uint64(len(jsonData)))
+		return append(b, jsonData...)
+	})
+}
+
+func (r *traceRecorder) recordLibPropertyProvider(key string, providerType int) {
+	r.record(traceRecordLibPropertyProvider, func(b []byte) []byte {
+		return binary.AppendVarint(appendTraceString(b, key), int64(providerType))
+	})
+}
+
+func (r *traceRecorder) recordBackgroundWork() {
+	r.record(traceRecordBackgroundWork, func(b []byte) []byte {
+		return b
+	})
+}
+
+type traceReader struct {
+	data []byte
+	pos  int
+	err  error
+}
+
+func (r *traceReader) byte() byte {
+	if r.err != nil || r.pos >= len(r.data) {
+		r.err = errTraceCorrupt
+		return 0
+	}
+	r.pos++
+	return r.data[r.pos-1]
+}
+
+func (r *traceReader) varint() int64 {
+	if r.err != nil {
+		return 0
+	}
+	v, n := binary.Varint(r.data[r.pos:])
+	if n <= 0 {
+		r.err = errTraceCorrupt
+		return 0
+	}
+	r.pos += n
+	return v
+}
+
+func (r *traceReader) bytes() []byte {
+	if r.err != nil {
+		return nil
+	}
+	length, n := binary.Uvarint(r.data[r.pos:])
+	if n <= 0 || length > uint64(len(r.data)-r.pos-n) {
+		r.err = errTraceCorrupt
+		return nil
+	}
+	r.pos += n
+	b := r.data[r.pos : r.pos+int(length)]
+	r.pos += int(length)
+	return b
+}
+
+func (r *traceReader) string() string {
+	return string(r.bytes())
+}
+
+func (r *traceReader) bool() bool {
+	return r.byte() == 1
+}
+
+func (r *traceReader) value() datamodel.PropertyValue {
+	switch r.byte() {
+	case traceValueNil:
+		return datamodel.PropertyValue{}
+	case traceValueBool:
+		return datamodel.NewBoolPropertyValue(r.bool())
+	case traceValueString:
+		return datamodel.NewStringPropertyValue(r.string())
+	case traceValueInt:
+		return datamodel.NewIntPropertyValue(r.varint())
+	case traceValueFloat:
+		if r.err != nil || len(r.data)-r.pos < 8 {
+			r.err = errTraceCorrupt
+			return datamodel.PropertyValue{}
+		}
+		r.pos += 8
+		return datamodel.NewFloatPropertyValue(math.Float64frombits(binary.LittleEndian.Uint64(r.data[r.pos-8:])))
+	case traceValueTime:
+		return datamodel.NewTimePropertyValue(time.Unix(0, r.varint()))
+	}
+	r.err = errTraceCorrupt
+	return datamodel.PropertyValue{}
+}
+
+func decodeTrace(data []byte) ([]*traceRecord, error) {
+	if len(data) < len(traceFileHeader) || string(data[:len(traceFileHeader)]) != traceFileHeader {
+		return nil, errors.New("CriticalMoments: not a trace file, or unsupported trace version")
+	}
+	r := &traceReader{data: data, pos: len(traceFileHeader)}
+	records := []*traceRecord{}
+	var last int64
+	for r.pos < len(data) {
+		record := &traceRecord{kind: traceRecordKind(r.byte())}
+		last += r.varint()
+		record.at = time.Unix(0, last)
+		switch record.kind {
+		case traceRecordStart:
+			record.flag = r.bool()
+			record.strings = []string{r.string(), r.string(), r.string(), r.string()}
+			record.number = r.varint()
+		case traceRecordConfig:
+			record.name = r.string()
+			record.strings = []string{r.string()}
+		case traceRecordEvent:
+			record.flag = r.bool()
+			record.name = r.string()
+		case traceRecordStaticProperty, traceRecordClientProperty, traceRecordLibPropertyValue:
+			record.name = r.string()
+			record.value = r.value()
+		case traceRecordClientPropertiesJson:
+			record.data = r.bytes()
+		case traceRecordLibPropertyProvider:
+			record.name = r.string()
+			record.number = r.varint()
+		case traceRecordBackgroundWork:
+		default:
+			return nil, errTraceCorrupt
+		}
+		if r.err != nil {
+			return nil, r.err
+		}
+		records = append(records, record)
+	}
+	return records, nil
+}
+
+// Records the appcore input stream to a trace file at the path, replacing any recording in progress. Records the
+// loaded config version, if any. Call before registering properties and Start to capture the full session.
+func (ac *Appcore) StartTraceRecording(path string) (returnErr error) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			returnErr = fmt.Errorf("panic in StartTraceRecording: %v", r)
+		}
+	}()
+
+	r, err := newTraceRecorder(path, ac.now)
+	if err != nil {
+		return err
+	}
+	if previous := ac.traceRecorder.Swap(r); previous != nil {
+		previous.close()
+	}
+	if snapshot := ac.loadedConfig.Load(); snapshot != nil {
+		r.recordConfig(snapshot.sha256, snapshot.config.ConfigVersion)
+	}
+	return nil
+}
+
+// Stops recording, and flushes the trace file. Returns any error recording.
+func (ac *Appcore) StopTraceRecording() error {
+	r := ac.traceRecorder.Swap(nil)
+	if r == nil {
+		return errors.New("CriticalMoments: not recording a trace")
+	}
+	return r.close()
+}
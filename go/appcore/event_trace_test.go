@@ -0,0 +1,99 @@
+package appcore
+
+import (
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+func TestTraceEncodeDecode(t *testing.T) {
+	now := time.Unix(1700000000, 0)
+	path := filepath.Join(t.TempDir(), "trace.cmtrace")
+	r, err := newTraceRecorder(path, func() time.Time { return now })
+	if err != nil {
+		t.Fatal(err)
+	}
+	r.recordStart(true, "key", "io.criticalmoments.demo", &testLibBindings{})
+	r.recordConfig("abc", "v1")
+	now = now.Add(time.Second)
+	r.recordEvent("e", false)
+	r.recordEvent(datamodel.AppEnteredBackgroundBuiltInEvent, true)
+	values := []datamodel.PropertyValue{
+		{},
+		datamodel.NewBoolPropertyValue(true),
+		datamodel.NewStringPropertyValue("s"),
+		datamodel.NewIntPropertyValue(3),
+		datamodel.NewIntPropertyValue(-4),
+		datamodel.NewFloatPropertyValue(1.5),
+		datamodel.NewTimePropertyValue(time.UnixMilli(1700000000123)),
+	}
+	for _, v := range values {
+		r.recordProperty(traceRecordStaticProperty, "custom_v", v)
+	}
+	r.recordProperty(traceRecordClientProperty, "c", datamodel.NewStringPropertyValue("pro"))
+	r.recordClientPropertiesJson([]byte(`{"a": 1}`))
+	r.recordLibPropertyProvider("os_version", LibPropertyProviderTypeString)
+	r.recordProperty(traceRecordLibPropertyValue, "os_version", datamodel.NewStringPropertyValue("17.0"))
+	now = now.Add(-time.Millisecond)
+	r.recordBackgroundWork()
+	if err := r.close(); err != nil {
+		t.Fatal(err)
+	}
+	// No-op after close, and on a nil recorder
+	r.recordEvent("e", false)
+	var nilRecorder *traceRecorder
+	nilRecorder.recordEvent("e", false)
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	records, err := decodeTrace(data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(records) != 4+len(values)+5 {
+		t.Fatalf("Unexpected record count %v", len(records))
+	}
+	start := records[0]
+	if start.kind != traceRecordStart || !start.flag || !reflect.DeepEqual(start.strings, []string{"key", "io.criticalmoments.demo", "1.2.3", "2.3.4"}) || start.number != 1 || !start.at.Equal(time.Unix(1700000000, 0)) {
+		t.Fatalf("Unexpected start record %+v", start)
+	}
+	if records[1].kind != traceRecordConfig || records[1].name != "abc" || records[1].strings[0] != "v1" {
+		t.Fatal("Unexpected config record")
+	}
+	if records[2].name != "e" || records[2].flag || !records[3].flag || !records[2].at.Equal(time.Unix(1700000001, 0)) {
+		t.Fatal("Unexpected event records")
+	}
+	for i, v := range values {
+		record := records[4+i]
+		if record.kind != traceRecordStaticProperty || record.name != "custom_v" {
+			t.Fatal("Unexpected property record")
+		}
+		if record.value != v {
+			t.Fatalf("Expected %v, got %v", v.Interface(), record.value.Interface())
+		}
+	}
+	rest := records[4+len(values):]
+	if rest[0].kind != traceRecordClientProperty || rest[1].kind != traceRecordClientPropertiesJson || string(rest[1].data) != `{"a": 1}` {
+		t.Fatal("Unexpected client property records")
+	}
+	if rest[2].name != "os_version" || rest[2].number != int64(LibPropertyProviderTypeString) || rest[3].value.StringValue() != "17.0" {
+		t.Fatal("Unexpected lib property records")
+	}
+	// Clock can move backwards
+	if rest[4].kind != traceRecordBackgroundWork || !rest[4].at.Equal(time.Unix(1700000001, 0).Add(-time.Millisecond)) {
+		t.Fatal("Unexpected background work record")
+	}
+
+	if _, err := decodeTrace(data[:len(data)-3]); err == nil {
+		t.Fatal("Expected truncated trace to fail")
+	}
+	if _, err := decodeTrace([]byte("not a trace")); err == nil {
+		t.Fatal("Expected error for non-trace")
+	}
+}
@@ -0,0 +1,247 @@
+package appcore
+
+import (
+	"context"
+	"math/bits"
+	"runtime/pprof"
+	"sync/atomic"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Instrumentation
+
+Latency histograms for each stage of the event, condition, config and notification paths, so we can see where time
+goes in production, including the tail. Recording is a few atomic adds (no locks or allocations), so it's always on.
+The bindings read them with InstrumentationSnapshot.
+
+Histogram buckets are powers of two nanoseconds: bucket i counts durations in [2^(i-1), 2^i). Percentiles in a
+snapshot are the upper bound of their bucket, so accurate within 2x. Counts double as counters: DB operations
+(db_function), native bridge calls (property_provider), plan regenerations (notification_plan).
+
+Optional pprof labels (SetProfilingLabelsEnabled): CPU profile samples are labeled cm_stage=<stage> for the entry
+points (event ingest and notification stages, CheckNamedCondition, config load, plan regeneration). Off by default,
+as labeling allocates. Only applied at entry points, which never nest: pprof.Do restores the labels of the context
+it's given, not those of the goroutine.
+*/
+
+type instrumentationStage int
+
+const (
+	// Time from enqueue until the ingest stage starts the event
+	stageEventQueueWait instrumentationStage = iota
+	// Persist and triggers, for each event
+	stageEventIngest
+	stageEventPersist
+	stageEventTriggers
+	stageEventNotifications
+	stageConditionEvaluate
+	stageConditionCompile
+	stageConditionRun
+	// Lib property provider calls, across the native bridge
+	stagePropertyProvider
+	// DB functions called by conditions, like eventCount
+	stageDBFunction
+	stageConfigLoad
+	stageNotificationPlan
+	instrumentationStageCount
+)
+
+var instrumentationStageNames = [instrumentationStageCount]string{
+	stageEventQueueWait:     "event_queue_wait",
+	stageEventIngest:        "event_ingest",
+	stageEventPersist:       "event_persist",
+	stageEventTriggers:      "event_triggers",
+	stageEventNotifications: "event_notifications",
+	stageConditionEvaluate:  "condition_evaluate",
+	stageConditionCompile:   "condition_compile",
+	stageConditionRun:       "condition_run",
+	stagePropertyProvider:   "property_provider",
+	stageDBFunction:         "db_function",
+	stageConfigLoad:         "config_load",
+	stageNotificationPlan:   "notification_plan",
+}
+
+// Bucket 0 is 0ns, bucket 39 is ~4.6 minutes and over
+const latencyBucketCount = 40
+
+type latencyHistogram struct {
+	count   atomic.Int64
+	totalNs atomic.Int64
+	maxNs   atomic.Int64
+	buckets [latencyBucketCount]atomic.Int64
+}
+
+func (h *latencyHistogram) record(d time.Duration) {
+	ns := max(int64(d), 0)
+	h.count.Add(1)
+	h.totalNs.Add(ns)
+	for {
+		current := h.maxNs.Load()
+		if ns <= current || h.maxNs.CompareAndSwap(current, ns) {
+			break
+		}
+	}
+	h.buckets[min(bits.Len64(uint64(ns)), latencyBucketCount-1)].Add(1)
+}
+
+func (h *latencyHistogram) reset() {
+	h.count.Store(0)
+	h.totalNs.Store(0)
+	h.maxNs.Store(0)
+	for i := range h.buckets {
+		h.buckets[i].Store(0)
+	}
+}
+
+// Safe for concurrent use. Methods are no-ops on a nil instrumentation, for components built without one in tests.
+type instrumentation struct {
+	stages          [instrumentationStageCount]latencyHistogram
+	profilingLabels atomic.Bool
+	labels          [instrumentationStageCount]pprof.LabelSet
+}
+
+func newInstrumentation() *instrumentation {
+	in := &instrumentation{}
+	for stage, name := range instrumentationStageNames {
+		in.labels[stage] = pprof.Labels("cm_stage", name)
+	}
+	return in
+}
+
+// Records the time since start for the stage. Typically `defer in.since(stage, time.Now())`
+func (in *instrumentation) since(stage instrumentationStage, start time.Time) {
+	if in == nil {
+		return
+	}
+	in.stages[stage].record(time.Since(start))
+}
+
+// Runs f, labeled with the stage in CPU profiles if enabled. Only for entry points, see above.
+func (in *instrumentation) withProfilingLabels(stage instrumentationStage, f func()) {
+	if in == nil || !in.profilingLabels.Load() {
+		f()
+		return
+	}
+	pprof.Do(context.Background(), in.labels[stage], func(context.Context) {
+		f()
+	})
+}
+
+// Wraps each function to record its calls under the stage
+func (in *instrumentation) instrumentDynamicFunctions(stage instrumentationStage, functions map[string]*datamodel.ConditionDynamicFunction) map[string]*datamodel.ConditionDynamicFunction {
+	instrumented := make(map[string]*datamodel.ConditionDynamicFunction, len(functions))
+	for name, function := range functions {
+		f := function.Function
+		instrumented[name] = &datamodel.ConditionDynamicFunction{
+			Function: func(params ...any) (any, error) {
+				defer in.since(stage, time.Now())
+				return f(params...)
+			},
+			Types: function.Types,
+		}
+	}
+	return instrumented
+}
+
+// Latency for each stage since start (or the last reset)
+type InstrumentationSnapshot struct {
+	stages []*StageLatency
+}
+
+type StageLatency struct {
+	Name             string
+	Count            int64
+	TotalNanoseconds int64
+	MaxNanoseconds   int64
+	P50Nanoseconds   int64
+	P90Nanoseconds   int64
+	P99Nanoseconds   int64
+}
+
+func (s *InstrumentationSnapshot) StageCount() int {
+	return len(s.stages)
+}
+
+func (s *InstrumentationSnapshot) StageAtIndex(i int) *StageLatency {
+	if i < 0 || i >= len(s.stages) {
+		return nil
+	}
+	return s.stages[i]
+}
+
+// Nil if no stage has the name
+func (s *InstrumentationSnapshot) StageNamed(name string) *StageLatency {
+	for _, stage := range s.stages {
+		if stage.Name == name {
+			return stage
+		}
+	}
+	return nil
+}
+
+func (in *instrumentation) snapshot() *InstrumentationSnapshot {
+	snapshot := &InstrumentationSnapshot{}
+	for stage := range in.stages {
+		h := &in.stages[stage]
+		// Recording can race with reading, so percentiles use the bucket total rather than count
+		var buckets [latencyBucketCount]int64
+		var bucketTotal int64
+		for i := range h.buckets {
+			buckets[i] = h.buckets[i].Load()
+			bucketTotal += buckets[i]
+		}
+		snapshot.stages = append(snapshot.stages, &StageLatency{
+			Name:             instrumentationStageNames[stage],
+			Count:            h.count.Load(),
+			TotalNanoseconds: h.totalNs.Load(),
+			MaxNanoseconds:   h.maxNs.Load(),
+			P50Nanoseconds:   latencyPercentile(&buckets, bucketTotal, 0.5),
+			P90Nanoseconds:   latencyPercentile(&buckets, bucketTotal, 0.9),
+			P99Nanoseconds:   latencyPercentile(&buckets, bucketTotal, 0.99),
+		})
+	}
+	return snapshot
+}
+
+// Upper bound of the bucket containing the percentile, 0 if no samples
+func latencyPercentile(buckets *[latencyBucketCount]int64, total int64, percentile float64) int64 {
+	if total == 0 {
+		return 0
+	}
+	target := int64(percentile * float64(total))
+	var seen int64
+	for i, count := range buckets {
+		seen += count
+		if seen > target {
+			if i == 0 {
+				return 0
+			}
+			return int64(1)<<i - 1
+		}
+	}
+	return int64(1)<<(latencyBucketCount-1) - 1
+}
+
+func (in *instrumentation) reset() {
+	for stage := range in.stages {
+		in.stages[stage].reset()
+	}
+}
+
+// Latency histograms for each processing stage. Safe to call from any thread.
+func (ac *Appcore) InstrumentationSnapshot() *InstrumentationSnapshot {
+	return ac.instrumentation.snapshot()
+}
+
+// Clears the histograms, for reporting latency over an interval
+func (ac *Appcore) ResetInstrumentation() {
+	ac.instrumentation.reset()
+}
+
+// Label CPU profile samples with the stage (pprof label cm_stage). Off by default.
+func (ac *Appcore) SetProfilingLabelsEnabled(enabled bool) {
+	ac.instrumentation.profilingLabels.Store(enabled)
+}
@@ -0,0 +1,98 @@
+package appcore
+
+import (
+	"testing"
+	"time"
+)
+
+func TestLatencyHistogram(t *testing.T) {
+	in := newInstrumentation()
+	h := &in.stages[stageConditionRun]
+	for i := 0; i < 98; i++ {
+		h.record(100 * time.Nanosecond)
+	}
+	h.record(time.Millisecond)
+	h.record(-time.Second)
+
+	s := in.snapshot().StageNamed("condition_run")
+	if s == nil || s.Count != 100 || s.MaxNanoseconds != 1_000_000 || s.TotalNanoseconds != 98*100+1_000_000 {
+		t.Fatalf("Unexpected totals: %+v", s)
+	}
+	// Upper bound of the power of two bucket
+	if s.P50Nanoseconds != 127 || s.P90Nanoseconds != 127 {
+		t.Fatalf("Unexpected percentiles: %+v", s)
+	}
+	if s.P99Nanoseconds != 1<<20-1 {
+		t.Fatalf("Expected p99 in the 1ms bucket, got %v", s.P99Nanoseconds)
+	}
+
+	in.reset()
+	if s := in.snapshot().StageNamed("condition_run"); s.Count != 0 || s.P99Nanoseconds != 0 || s.MaxNanoseconds != 0 {
+		t.Fatal("Expected reset histogram")
+	}
+
+	var nilInstrumentation *instrumentation
+	nilInstrumentation.since(stageConditionRun, time.Now())
+}
+
+func TestInstrumentationSnapshot(t *testing.T) {
+	ac, _ := testBuildConcurrentAppcore(t, 3)
+	ac.SetProfilingLabelsEnabled(true)
+
+	for _, eventName := range []string{"e0", "e1", "c2"} {
+		if err := ac.SendClientEvent(eventName); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if _, err := ac.CheckNamedCondition("condition0"); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.ForceUpdateNotificationPlan(); err != nil {
+		t.Fatal(err)
+	}
+
+	snapshot := ac.InstrumentationSnapshot()
+	if snapshot.StageCount() != int(instrumentationStageCount) || snapshot.StageAtIndex(-1) != nil || snapshot.StageAtIndex(snapshot.StageCount()) != nil {
+		t.Fatal("Expected a snapshot entry per stage")
+	}
+	for i := 0; i < snapshot.StageCount(); i++ {
+		if snapshot.StageAtIndex(i).Name != instrumentationStageNames[i] {
+			t.Fatal("Stages out of order")
+		}
+	}
+	// app_start and 3 events are queued. The action and condition events have no listeners, so are only persisted.
+	minCounts := map[string]int64{
+		"event_queue_wait":    4,
+		"event_ingest":        4,
+		"event_triggers":      4,
+		"event_notifications": 4,
+		"event_persist":       7,
+		"condition_evaluate":  1,
+		"config_load":         1,
+		"notification_plan":   2,
+	}
+	for name, minCount := range minCounts {
+		stage := snapshot.StageNamed(name)
+		if stage.Count < minCount {
+			t.Fatalf("Expected at least %v %v, got %v", minCount, name, stage.Count)
+		}
+		if stage.P99Nanoseconds < stage.P50Nanoseconds || stage.MaxNanoseconds <= 0 {
+			t.Fatalf("Unexpected latencies for %v: %+v", name, stage)
+		}
+	}
+
+	ac.ResetInstrumentation()
+	if ac.InstrumentationSnapshot().StageNamed("event_ingest").Count != 0 {
+		t.Fatal("Expected reset")
+	}
+}
+
+func BenchmarkInstrumentationRecord(b *testing.B) {
+	in := newInstrumentation()
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			in.since(stageConditionEvaluate, time.Now())
+		}
+	})
+}
@@ -0,0 +1,146 @@
+package appcore
+
+import (
+	"fmt"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Notification plan delivery
+
+Each plan sent to the lib is versioned. When the previous plan was for the same config, the plan also includes
+a diff against it: notifications added to the schedule, rescheduled, or removed from it. Plans with a
+BaseVersion are diffs against the plan with that version; the lib can apply only the changes, if it applied the
+base plan. Otherwise (BaseVersion 0, or the lib didn't apply the base) it should sync the full plan, which every
+plan still includes. Plans with no changes aren't sent.
+
+Plan updates triggered by events are debounced: the first schedules an update after notificationPlanDebounce, and
+later ones before it runs are coalesced into it. Bursts of events send one plan. ForceUpdateNotificationPlan
+updates immediately. The window is timed with the Appcore's timer (ac.after), which tests replace with a fake clock.
+*/
+
+const defaultNotificationPlanDebounce = 250 * time.Millisecond
+
+type notificationPlanDiff struct {
+	added       []*ScheduledNotification
+	rescheduled []*ScheduledNotification
+	removed     []*datamodel.Notification
+}
+
+func (d notificationPlanDiff) empty() bool {
+	return len(d.added) == 0 && len(d.rescheduled) == 0 && len(d.removed) == 0
+}
+
+// Gomobile accessors for the diff. Only valid when IsDiff()
+func (plan *NotificationPlan) IsDiff() bool {
+	return plan.BaseVersion != 0
+}
+func (plan *NotificationPlan) AddedNotificationCount() int {
+	return len(plan.diff.added)
+}
+func (plan *NotificationPlan) AddedNotificationAtIndex(index int) *ScheduledNotification {
+	if index < 0 || index >= len(plan.diff.added) {
+		return nil
+	}
+	return plan.diff.added[index]
+}
+func (plan *NotificationPlan) RescheduledNotificationCount() int {
+	return len(plan.diff.rescheduled)
+}
+func (plan *NotificationPlan) RescheduledNotificationAtIndex(index int) *ScheduledNotification {
+	if index < 0 || index >= len(plan.diff.rescheduled) {
+		return nil
+	}
+	return plan.diff.rescheduled[index]
+}
+func (plan *NotificationPlan) RemovedNotificationCount() int {
+	return len(plan.diff.removed)
+}
+func (plan *NotificationPlan) RemovedNotificationAtIndex(index int) *datamodel.Notification {
+	if index < 0 || index >= len(plan.diff.removed) {
+		return nil
+	}
+	return plan.diff.removed[index]
+}
+
+// Sets the version and diff of plan against previous, the last plan sent. Returns false if nothing changed, and the
+// plan doesn't need to be sent. Requires notificationLock.
+func (ac *Appcore) versionNotificationPlan(plan *NotificationPlan, previous *NotificationPlan) bool {
+	if previous != nil && previous.config == plan.config {
+		plan.diff = diffNotificationPlans(previous, plan)
+		if plan.diff.empty() && plan.EarliestBgCheckTimeEpochSeconds == previous.EarliestBgCheckTimeEpochSeconds {
+			return false
+		}
+		plan.BaseVersion = previous.Version
+	}
+	ac.notificationPlanVersion++
+	plan.Version = ac.notificationPlanVersion
+	return true
+}
+
+func diffNotificationPlans(previous *NotificationPlan, plan *NotificationPlan) notificationPlanDiff {
+	previousByID := make(map[string]*ScheduledNotification, len(previous.scheduledNotifications))
+	for _, sn := range previous.scheduledNotifications {
+		previousByID[sn.Notification.ID] = sn
+	}
+
+	diff := notificationPlanDiff{}
+	for _, sn := range plan.scheduledNotifications {
+		prior := previousByID[sn.Notification.ID]
+		if prior == nil {
+			diff.added = append(diff.added, sn)
+		} else if !prior.scheduledAt.Equal(sn.scheduledAt) || prior.Notification != sn.Notification {
+			diff.rescheduled = append(diff.rescheduled, sn)
+		}
+	}
+	for _, sn := range previous.scheduledNotifications {
+		if !plan.scheduledNotificationIDs[sn.Notification.ID] {
+			diff.removed = append(diff.removed, sn.Notification)
+		}
+	}
+	return diff
+}
+
+// Runs a pending debounced plan update now, so it isn't lost if the app is backgrounded or terminated before the
+// debounce window ends
+func (ac *Appcore) flushPendingNotificationPlanUpdate() error {
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	if !ac.notificationPlanUpdatePending {
+		return nil
+	}
+	ac.notificationPlanUpdatePending = false
+	return ac.updateNotificationPlan()
+}
+
+// Updates the plan after the debounce window, coalescing requests made before it runs. Requires notificationLock.
+func (ac *Appcore) requestNotificationPlanUpdate() error {
+	if ac.notificationPlanDebounce <= 0 {
+		return ac.updateNotificationPlan()
+	}
+	if ac.notificationPlanUpdatePending {
+		return nil
+	}
+	ac.notificationPlanUpdatePending = true
+	ac.after(ac.notificationPlanDebounce, func() {
+		defer func() {
+			// We never intentionally panic in CM, but we want to recover if we do
+			if r := recover(); r != nil {
+				fmt.Printf("CriticalMoments: panic in debounced notification plan update: %v\n", r)
+			}
+		}()
+		ac.notificationLock.Lock()
+		defer ac.notificationLock.Unlock()
+		if !ac.notificationPlanUpdatePending {
+			// Already updated by a forced update
+			return
+		}
+		ac.notificationPlanUpdatePending = false
+		if err := ac.updateNotificationPlan(); err != nil {
+			fmt.Printf("CriticalMoments: there was an issue updating the notification plan. Error: %v\n", err)
+		}
+	})
+	return nil
+}
@@ -0,0 +1,290 @@
+package appcore
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Records every plan, and counts the bridge calls the native SDK makes consuming them: the update call, then the
+// accessors it uses to apply the diff (if it applied the base plan) or sync the full plan.
+type testPlanRecordingLibBindings struct {
+	testLibBindings
+	lock        sync.Mutex
+	plans       []*NotificationPlan
+	bridgeCalls int
+	lastApplied int64
+	// Emulates the native SDK before plan diffs, which always synced the full plan
+	fullSyncOnly bool
+}
+
+func (lb *testPlanRecordingLibBindings) UpdateNotificationPlan(plan *NotificationPlan) error {
+	lb.lock.Lock()
+	defer lb.lock.Unlock()
+	lb.plans = append(lb.plans, plan)
+	lb.bridgeCalls++
+	if !lb.fullSyncOnly && plan.IsDiff() && plan.BaseVersion == lb.lastApplied {
+		lb.bridgeCalls += 3 + plan.AddedNotificationCount() + plan.RescheduledNotificationCount() + plan.RemovedNotificationCount()
+	} else {
+		lb.bridgeCalls += 1 + plan.ScheduledNotificationCount()
+	}
+	lb.lastApplied = plan.Version
+	return nil
+}
+
+func (lb *testPlanRecordingLibBindings) planCount() int {
+	lb.lock.Lock()
+	defer lb.lock.Unlock()
+	return len(lb.plans)
+}
+
+func testBuildPlanDeliveryAppcore(t *testing.T, staticCount int, eventCount int) (*Appcore, *testPlanRecordingLibBindings) {
+	var notifications []string
+	for i := 0; i < staticCount; i++ {
+		notifications = append(notifications, fmt.Sprintf(`"static%v": {"title": "t", "deliveryTime": {"timestamp": %v}}`, i, time.Now().Add(time.Duration(i+1)*time.Hour).Unix()))
+	}
+	for i := 0; i < eventCount; i++ {
+		notifications = append(notifications, fmt.Sprintf(`"event%v": {"title": "t", "cancelationEvents": ["cancel%v"], "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": 3600, "eventInstance": "first"}}`, i, i, i))
+	}
+	config := fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "notifications": {%v}}`, strings.Join(notifications, ","))
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(config), 0644); err != nil {
+		t.Fatal(err)
+	}
+
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	lb := &testPlanRecordingLibBindings{}
+	ac.RegisterLibraryBindings(lb)
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	return ac, lb
+}
+
+func TestNotificationPlanDiff(t *testing.T) {
+	ac, lb := testBuildPlanDeliveryAppcore(t, 2, 2)
+
+	first := lb.plans[0]
+	if first.IsDiff() || first.Version == 0 || first.ScheduledNotificationCount() != 2 {
+		t.Fatal("First plan should be a full plan")
+	}
+
+	if err := ac.SendClientEvent("e0"); err != nil {
+		t.Fatal(err)
+	}
+	added := lb.plans[len(lb.plans)-1]
+	if !added.IsDiff() || added.BaseVersion != first.Version || added.Version <= first.Version {
+		t.Fatal("Expected diff against first plan")
+	}
+	if added.AddedNotificationCount() != 1 || added.AddedNotificationAtIndex(0).Notification.ID != "event0" ||
+		added.RescheduledNotificationCount() != 0 || added.RemovedNotificationCount() != 0 {
+		t.Fatal("Expected event0 added")
+	}
+	// Diffs still include the full plan
+	if added.ScheduledNotificationCount() != 3 {
+		t.Fatal("Expected full plan in diff")
+	}
+
+	if err := ac.SendClientEvent("cancel0"); err != nil {
+		t.Fatal(err)
+	}
+	removed := lb.plans[len(lb.plans)-1]
+	if removed.BaseVersion != added.Version || removed.RemovedNotificationCount() != 1 ||
+		removed.RemovedNotificationAtIndex(0).ID != "event0" || removed.AddedNotificationCount() != 0 {
+		t.Fatal("Expected event0 removed")
+	}
+
+	// No change to the plan: nothing sent
+	planCount := len(lb.plans)
+	if err := ac.ForceUpdateNotificationPlan(); err != nil {
+		t.Fatal(err)
+	}
+	if len(lb.plans) != planCount {
+		t.Fatal("Sent plan without changes")
+	}
+	if removed.AddedNotificationAtIndex(0) != nil || removed.RemovedNotificationAtIndex(1) != nil || removed.RescheduledNotificationAtIndex(-1) != nil {
+		t.Fatal("Out of range accessors should return nil")
+	}
+}
+
+func TestNotificationPlanDiffRescheduled(t *testing.T) {
+	n := &datamodel.Notification{ID: "n"}
+	now := time.Now()
+	previous := &NotificationPlan{
+		scheduledNotifications:   []*ScheduledNotification{{Notification: n, scheduledAt: now}},
+		scheduledNotificationIDs: map[string]bool{"n": true},
+	}
+	plan := &NotificationPlan{
+		scheduledNotifications:   []*ScheduledNotification{{Notification: n, scheduledAt: now.Add(time.Minute)}},
+		scheduledNotificationIDs: map[string]bool{"n": true},
+	}
+	diff := diffNotificationPlans(previous, plan)
+	if len(diff.rescheduled) != 1 || len(diff.added) != 0 || len(diff.removed) != 0 {
+		t.Fatal("Expected rescheduled notification")
+	}
+	if !diffNotificationPlans(previous, previous).empty() {
+		t.Fatal("Expected empty diff")
+	}
+}
+
+// A manually advanced clock, with timers which run when it passes their time. Replaces the Appcore's clock and
+// timer, so timed work can be tested without sleeping.
+type testFakeClock struct {
+	lock   sync.Mutex
+	now    time.Time
+	timers []testFakeTimer
+}
+
+type testFakeTimer struct {
+	at time.Time
+	f  func()
+}
+
+func newTestFakeClock(ac *Appcore) *testFakeClock {
+	c := &testFakeClock{now: time.Now()}
+	ac.clock = c.Now
+	ac.afterFunc = c.AfterFunc
+	return c
+}
+
+func (c *testFakeClock) Now() time.Time {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	return c.now
+}
+
+func (c *testFakeClock) AfterFunc(d time.Duration, f func()) {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	c.timers = append(c.timers, testFakeTimer{at: c.now.Add(d), f: f})
+}
+
+// Moves the clock forward, running timers which are due on the calling goroutine
+func (c *testFakeClock) Advance(d time.Duration) {
+	c.lock.Lock()
+	c.now = c.now.Add(d)
+	var due []testFakeTimer
+	pending := c.timers[:0]
+	for _, timer := range c.timers {
+		if timer.at.After(c.now) {
+			pending = append(pending, timer)
+		} else {
+			due = append(due, timer)
+		}
+	}
+	c.timers = pending
+	c.lock.Unlock()
+	for _, timer := range due {
+		timer.f()
+	}
+}
+
+func (c *testFakeClock) pendingTimers() int {
+	c.lock.Lock()
+	defer c.lock.Unlock()
+	return len(c.timers)
+}
+
+func TestNotificationPlanDebounce(t *testing.T) {
+	ac, lb := testBuildPlanDeliveryAppcore(t, 2, 5)
+	clock := newTestFakeClock(ac)
+	ac.notificationPlanDebounce = 50 * time.Millisecond
+
+	startCount := lb.planCount()
+	for i := 0; i < 5; i++ {
+		if err := ac.SendClientEvent(fmt.Sprintf("e%v", i)); err != nil {
+			t.Fatal(err)
+		}
+		clock.Advance(5 * time.Millisecond)
+	}
+	if clock.pendingTimers() != 1 {
+		t.Fatalf("Expected burst to schedule 1 update, got %v", clock.pendingTimers())
+	}
+
+	// 25ms into the window
+	clock.Advance(24 * time.Millisecond)
+	if lb.planCount() != startCount {
+		t.Fatal("Plan sent before debounce window")
+	}
+
+	clock.Advance(time.Millisecond)
+	if lb.planCount() != startCount+1 {
+		t.Fatalf("Expected burst coalesced into 1 plan, got %v", lb.planCount()-startCount)
+	}
+	if clock.pendingTimers() != 0 {
+		t.Fatal("Expected no updates pending after the window")
+	}
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	if ac.notificationPlan.ScheduledNotificationCount() != 7 || ac.notificationPlan.AddedNotificationCount() != 5 {
+		t.Fatal("Coalesced plan missing notifications")
+	}
+}
+
+func TestFlushEventsSendsDebouncedNotificationPlan(t *testing.T) {
+	ac, lb := testBuildPlanDeliveryAppcore(t, 2, 5)
+	newTestFakeClock(ac)
+	ac.notificationPlanDebounce = time.Hour
+
+	startCount := lb.planCount()
+	if err := ac.SendClientEvent("e0"); err != nil {
+		t.Fatal(err)
+	}
+	if lb.planCount() != startCount {
+		t.Fatal("Plan sent before debounce window")
+	}
+
+	// Backgrounding can't wait for the debounce window
+	if err := ac.FlushEvents(); err != nil {
+		t.Fatal(err)
+	}
+	if lb.planCount() != startCount+1 {
+		t.Fatal("Expected pending plan sent on flush")
+	}
+	ac.notificationLock.Lock()
+	pending := ac.notificationPlanUpdatePending
+	ac.notificationLock.Unlock()
+	if pending {
+		t.Fatal("Expected no pending update after flush")
+	}
+}
+
+// Bridge calls for a burst of events: each event schedules one notification, with 20 already scheduled
+func TestNotificationPlanBridgeCallsPerBurst(t *testing.T) {
+	burst := func(debounce time.Duration, fullSyncOnly bool) int {
+		ac, lb := testBuildPlanDeliveryAppcore(t, 20, 10)
+		clock := newTestFakeClock(ac)
+		ac.notificationPlanDebounce = debounce
+		lb.lock.Lock()
+		lb.fullSyncOnly = fullSyncOnly
+		lb.bridgeCalls = 0
+		lb.lock.Unlock()
+
+		for i := 0; i < 10; i++ {
+			if err := ac.SendClientEvent(fmt.Sprintf("e%v", i)); err != nil {
+				t.Fatal(err)
+			}
+		}
+		clock.Advance(debounce)
+		lb.lock.Lock()
+		defer lb.lock.Unlock()
+		return lb.bridgeCalls
+	}
+
+	fullPlans := burst(0, true)
+	diffs := burst(0, false)
+	debouncedDiffs := burst(50*time.Millisecond, false)
+	t.Logf("Bridge calls for 10 event burst: full plan per event %v, diff per event %v, debounced diff %v", fullPlans, diffs, debouncedDiffs)
+	if diffs >= fullPlans || debouncedDiffs >= diffs {
+		t.Fatal("Expected fewer bridge calls with diffs and debouncing")
+	}
+}
@@ -0,0 +1,239 @@
+package appcore
+
+import (
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Notification plan memoization
+
+Planning a notification reads the DB (already delivered time, event delivery time, cancelation events) and
+evaluates its conditions. The plan isn't incremental: every plan visits every notification. The planner memoizes
+DB reads between plans, so repeat plans mostly skip the DB:
+
+  - DB reads are memoized, and dropped when an event which could change them is recorded: the notification's
+    delivery event, its delivered event, or one of its cancelation events (found with the config's event index).
+    Events are only added through processEvent, so any other event can't change them.
+  - For notifications without ideal delivery conditions, and without a schedule condition or with a static one, the
+    planned delivery time is cached too. It only depends on the memoized DB reads and, for static timestamps,
+    whether the time has passed, so it's valid until that changes. A schedule condition is static if the config's
+    dependency index shows it only reads static properties and constants, and only calls pure helpers (no DB
+    functions, time or random). Its result can't change until a property is re-registered, which publishes new
+    property registrations, so cached results are only valid for the registrations they were planned with.
+  - Other notifications with conditions re-evaluate them on every plan. Conditions can read any state (dynamic
+    properties, event counts, time), so there is no cheap way to tell which results changed.
+
+The result is always identical to a full recompute (generateNotificationPlanForTime). Background work reuses the
+last plan for notifications with ideal delivery conditions until their wakeup is due (see wake_scheduler.go). All
+access must hold notificationLock.
+*/
+
+type notificationPlanner struct {
+	config  *datamodel.PrimaryConfig
+	entries map[string]*notificationPlanEntry
+	// Background check wakeups, by notification ID
+	wakeups *wakeScheduler
+}
+
+type notificationPlanEntry struct {
+	// Memoized DB reads. DB errors aren't memoized.
+	deliveredTimeLoaded bool
+	deliveredTime       *time.Time
+	eventTimeLoaded     bool
+	eventTime           *time.Time
+
+	// Cached plan for notifications without conditions, or with a static schedule condition. Only valid while
+	// whether the static timestamp (if any) has passed is unchanged, and for the registrations it was planned with.
+	resultCached          bool
+	resultRegistrations   *propertyRegistrations
+	resultTimestamp       *time.Time
+	resultTimestampPassed bool
+	deliveryTime          *time.Time
+	bgCheckTime           *time.Time
+
+	// The last plan (deliveryTime and bgCheckTime) for notifications with ideal delivery conditions, which background
+	// work can reuse until the wakeup at bgCheckTime
+	idealResultPlanned bool
+}
+
+func newNotificationPlanner() *notificationPlanner {
+	return &notificationPlanner{
+		entries: make(map[string]*notificationPlanEntry),
+		wakeups: newWakeScheduler(),
+	}
+}
+
+// State is only valid for the config it was planned with
+func (p *notificationPlanner) resetIfConfigChanged(config *datamodel.PrimaryConfig) {
+	if p == nil || p.config == config {
+		return
+	}
+	p.config = config
+	p.entries = make(map[string]*notificationPlanEntry)
+	p.wakeups = newWakeScheduler()
+}
+
+// Returns nil for a nil planner, which disables memoization
+func (p *notificationPlanner) entryFor(notification *datamodel.Notification) *notificationPlanEntry {
+	if p == nil {
+		return nil
+	}
+	entry := p.entries[notification.ID]
+	if entry == nil {
+		entry = &notificationPlanEntry{}
+		p.entries[notification.ID] = entry
+	}
+	return entry
+}
+
+// Drops state which could change now the event was recorded
+func (p *notificationPlanner) invalidateForEvent(config *datamodel.PrimaryConfig, eventName string) {
+	if p == nil || config == nil || p.config != config {
+		return
+	}
+	delivery, cancelation := config.NotificationsForEvent(eventName)
+	for _, notification := range delivery {
+		if entry := p.entries[notification.ID]; entry != nil {
+			entry.eventTimeLoaded = false
+			entry.eventTime = nil
+			entry.dropResult()
+		}
+	}
+	for _, notification := range cancelation {
+		// Canceled state is cached by event name in seenCancelationEvents, only the result needs dropping
+		if entry := p.entries[notification.ID]; entry != nil {
+			entry.dropResult()
+		}
+	}
+	if notification := config.NotificationForDeliveredEvent(eventName); notification != nil {
+		if entry := p.entries[notification.ID]; entry != nil {
+			entry.deliveredTimeLoaded = false
+			entry.deliveredTime = nil
+			entry.dropResult()
+		}
+	}
+}
+
+func (entry *notificationPlanEntry) dropResult() {
+	entry.resultCached = false
+	entry.idealResultPlanned = false
+}
+
+// Schedules the notification's background check, or cancels it for a nil time. No-op for a nil planner.
+func (p *notificationPlanner) scheduleWakeup(notification *datamodel.Notification, bgCheckTime *time.Time) {
+	if p == nil {
+		return
+	}
+	p.wakeups.schedule(notification.ID, bgCheckTime)
+}
+
+// Removes and returns the IDs of notifications with wakeups due at now
+func (p *notificationPlanner) popDueWakeups(now time.Time) map[string]bool {
+	due := make(map[string]bool)
+	if p == nil {
+		return due
+	}
+	for _, id := range p.wakeups.popDue(now) {
+		due[id] = true
+	}
+	return due
+}
+
+// Notifications with ideal delivery conditions (and no schedule condition, or a static one) only change when their
+// ideal window check is due, or on an event which drops the result. Background work reuses the last plan until then.
+func (entry *notificationPlanEntry) reusableUntilWakeup(notification *datamodel.Notification, registrations *propertyRegistrations) bool {
+	return entry != nil && entry.idealResultPlanned && entry.resultRegistrations == registrations &&
+		notification.IdealDeliveryConditions != nil
+}
+
+// Helper functions whose results only depend on their arguments
+var pureConditionMethods = map[string]bool{
+	"versionNumberComponent": true,
+	"versionGreaterThan":     true,
+	"versionLessThan":        true,
+	"versionEqual":           true,
+}
+
+// True if the notification has no schedule condition, or one whose result can't change while the registrations are
+// current: it only reads static properties and constants, and only calls pure helpers.
+func (pr *propertyRegistry) scheduleConditionIsStatic(notification *datamodel.Notification, r *propertyRegistrations) bool {
+	if notification.ScheduleCondition == nil {
+		return true
+	}
+	fields := notification.ScheduleConditionFields()
+	if fields == nil {
+		return false
+	}
+	for _, method := range fields.Methods {
+		if !pureConditionMethods[method] {
+			return false
+		}
+	}
+	for _, variable := range fields.Variables {
+		if _, ok := pr.mapConstants[variable]; ok {
+			continue
+		}
+		if _, ok := providerFromRegistrations(r, variable).(*staticPropertyProvider); !ok {
+			return false
+		}
+	}
+	return true
+}
+
+func (ac *Appcore) plannedNotificationDeliveryTime(entry *notificationPlanEntry, notification *datamodel.Notification, now time.Time) (deliveryTime *time.Time, bgCheckTime *time.Time) {
+	registrations := ac.propertyRegistry.registrations()
+	if entry != nil && entry.resultCached && entry.resultRegistrations == registrations &&
+		(entry.resultTimestamp == nil || now.After(*entry.resultTimestamp) == entry.resultTimestampPassed) {
+		return entry.deliveryTime, entry.bgCheckTime
+	}
+
+	deliveryTime, bgCheckTime = ac.notificationDeliveryTimeWithEntry(entry, notification, now)
+
+	if entry == nil || !ac.propertyRegistry.scheduleConditionIsStatic(notification, registrations) {
+		return deliveryTime, bgCheckTime
+	}
+	entry.resultRegistrations = registrations
+	entry.deliveryTime = deliveryTime
+	entry.bgCheckTime = bgCheckTime
+	if notification.IdealDeliveryConditions == nil {
+		// A static timestamp is dropped from the plan once it has passed
+		entry.resultTimestamp = notification.DeliveryTime.Timestamp()
+		entry.resultTimestampPassed = entry.resultTimestamp != nil && now.After(*entry.resultTimestamp)
+		entry.resultCached = true
+	} else {
+		entry.idealResultPlanned = true
+	}
+	return deliveryTime, bgCheckTime
+}
+
+func (entry *notificationPlanEntry) alreadyDeliveredTime(ac *Appcore, notification *datamodel.Notification) (*time.Time, error) {
+	if entry == nil {
+		return ac.notificationAlreadyDeliveredTimeForSingleDeliveryNotification(notification)
+	}
+	if !entry.deliveredTimeLoaded {
+		t, err := ac.notificationAlreadyDeliveredTimeForSingleDeliveryNotification(notification)
+		if err != nil {
+			return nil, err
+		}
+		entry.deliveredTime = t
+		entry.deliveredTimeLoaded = true
+	}
+	return entry.deliveredTime, nil
+}
+
+func (entry *notificationPlanEntry) eventDeliveryTime(ac *Appcore, notification *datamodel.Notification) (*time.Time, error) {
+	if entry == nil {
+		return deliveryTimeFromDB(ac, &notification.DeliveryTime)
+	}
+	if !entry.eventTimeLoaded {
+		t, err := deliveryTimeFromDB(ac, &notification.DeliveryTime)
+		if err != nil {
+			return nil, err
+		}
+		entry.eventTime = t
+		entry.eventTimeLoaded = true
+	}
+	return entry.eventTime, nil
+}
@@ -0,0 +1,177 @@
+package appcore
+
+import (
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+)
+
+// Notifications covering each delivery type, cancelation, delivery windows, conditions and ideal delivery windows
+func testPlannerConfigJson(now time.Time) string {
+	return fmt.Sprintf(`{
+		"configVersion": "v1",
+		"appId": "io.criticalmoments.demo",
+		"notifications": {
+			"latest": {"title": "t", "deliveryTime": {"eventName": "e1", "eventInstance": "latest"}},
+			"latestOnceNoOffset": {"title": "t", "deliveryTime": {"eventName": "e1"}},
+			"first": {"title": "t", "cancelationEvents": ["c1"], "deliveryTime": {"eventName": "e2", "eventOffsetSeconds": 60, "eventInstance": "first"}},
+			"latestOnce": {"title": "t", "cancelationEvents": ["c1", "c2"], "deliveryTime": {"eventName": "e3", "eventOffsetSeconds": 3600, "eventInstance": "latest-once"}, "deliveryTimeOfDayStart": "09:00", "deliveryTimeOfDayEnd": "17:00", "deliveryDaysOfWeek": "Monday,Wednesday,Saturday"},
+			"staticSoon": {"title": "t", "deliveryTime": {"timestamp": %v}},
+			"staticLater": {"title": "t", "cancelationEvents": ["c2"], "deliveryTime": {"timestamp": %v}, "deliveryTimeOfDayStart": "10:00", "deliveryTimeOfDayEnd": "11:00"},
+			"staticPast": {"title": "t", "deliveryTime": {"timestamp": %v}},
+			"staticCondition": {"title": "t", "scheduleCondition": "eventCount('e2') > 0", "deliveryTime": {"timestamp": %v}},
+			"staticPropertyCondition": {"title": "t", "cancelationEvents": ["c1"], "scheduleCondition": "tier == 'pro'", "deliveryTime": {"eventName": "e2", "eventInstance": "latest"}},
+			"ideal": {"title": "t", "deliveryTime": {"eventName": "e3", "eventInstance": "latest"}, "idealDeliveryConditions": {"condition": "true", "maxWaitTimeSeconds": 7200}},
+			"idealForever": {"title": "t", "cancelationEvents": ["c2"], "deliveryTime": {"eventName": "e4", "eventInstance": "first"}, "idealDeliveryConditions": {"condition": "eventCount('e1') > 2", "maxWaitTimeSeconds": -1}}
+		}
+	}`, now.Add(2*time.Hour).Unix(), now.Add(30*time.Hour).Unix(), now.Add(-time.Hour).Unix(), now.Add(3*time.Hour).Unix())
+}
+
+// Comparable form of a plan: scheduled times by ID, unscheduled IDs and bg check time
+func testPlanSummary(plan NotificationPlan) string {
+	scheduled := map[string]int64{}
+	for _, sn := range plan.scheduledNotifications {
+		scheduled[sn.Notification.ID] = sn.ScheduledAtEpochMilliseconds()
+	}
+	unscheduled := map[string]bool{}
+	for _, n := range plan.unscheduledNotifications {
+		unscheduled[n.ID] = true
+	}
+	// fmt prints maps in key order
+	return fmt.Sprintf("scheduled=%v unscheduled=%v bg=%v", scheduled, unscheduled, plan.EarliestBgCheckTimeEpochSeconds)
+}
+
+func TestMemoizedNotificationPlanMatchesFullRecompute(t *testing.T) {
+	start := time.Now()
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(testPlannerConfigJson(start)), 0644); err != nil {
+		t.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.RegisterClientStringProperty("tier", "pro"); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+
+	seed := time.Now().UnixNano()
+	t.Logf("Seed: %v", seed)
+	r := rand.New(rand.NewSource(seed))
+
+	eventNames := []string{"e1", "e2", "e3", "e4", "c1", "c2", "unrelated"}
+	for _, n := range ac.config().Notifications {
+		eventNames = append(eventNames, n.DeliveredEventName())
+	}
+
+	now := start
+	for step := 0; step < 300; step++ {
+		switch r.Intn(3) {
+		case 0:
+			// Move forward, sometimes past static timestamps, windows and offsets
+			now = now.Add(time.Duration(r.Int63n(int64(6 * time.Hour))))
+		case 1:
+			// Plan at a time near the real clock, as event processing does
+			now = start.Add(time.Duration(r.Int63n(int64(time.Hour))))
+		default:
+			eventName := eventNames[r.Intn(len(eventNames))]
+			if err := ac.SendClientEvent(eventName); err != nil {
+				t.Fatal(err)
+			}
+		}
+
+		ac.notificationLock.Lock()
+		memoized, err := ac.generateNotificationPlanWithPlanner(ac.notificationPlanner, now)
+		ac.notificationLock.Unlock()
+		if err != nil {
+			t.Fatal(err)
+		}
+		full, err := ac.generateNotificationPlanForTime(now)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if testPlanSummary(memoized) != testPlanSummary(full) {
+			t.Fatalf("Memoized plan differs from full recompute at step %v (seed %v):\n%v\n%v", step, seed, testPlanSummary(memoized), testPlanSummary(full))
+		}
+	}
+}
+
+func TestNotificationPlannerResetsForNewConfig(t *testing.T) {
+	ac, err := buildTestAppCoreWithPath("../cmcore/data_model/test/testdata/notifications/eventNotifications.json", t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	planner := ac.notificationPlanner
+	if planner.config != ac.config() || len(planner.entries) != len(ac.config().Notifications) {
+		t.Fatal("Planner not populated on start")
+	}
+
+	planner.resetIfConfigChanged(nil)
+	if len(planner.entries) != 0 {
+		t.Fatal("Planner state kept for another config")
+	}
+}
+
+func TestNotificationPlannerCachesStaticScheduleCondition(t *testing.T) {
+	start := time.Now()
+	config := fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "notifications": {
+		"staticProperty": {"title": "t", "scheduleCondition": "tier == 'pro' && versionGreaterThan('2.0', '1.0')", "deliveryTime": {"timestamp": %v}},
+		"eventCount": {"title": "t", "scheduleCondition": "tier == 'pro' && eventCount('e1') > 0", "deliveryTime": {"timestamp": %v}},
+		"unregistered": {"title": "t", "scheduleCondition": "missing == 'pro'", "deliveryTime": {"timestamp": %v}}
+	}}`, start.Add(time.Hour).Unix(), start.Add(time.Hour).Unix(), start.Add(time.Hour).Unix())
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(config), 0644); err != nil {
+		t.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.RegisterClientStringProperty("tier", "pro"); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	planner := ac.notificationPlanner
+	if _, err := ac.generateNotificationPlanWithPlanner(planner, start); err != nil {
+		t.Fatal(err)
+	}
+	if !planner.entries["staticProperty"].resultCached {
+		t.Fatal("Expected result cached for a condition reading only static properties")
+	}
+	if planner.entries["eventCount"].resultCached || planner.entries["unregistered"].resultCached {
+		t.Fatal("Expected conditions reading the DB or unregistered properties to be re-evaluated")
+	}
+
+	// Re-registering a property changes the condition's result, and must not reuse the cached plan
+	if err := ac.RegisterClientStringProperty("tier", "free"); err != nil {
+		t.Fatal(err)
+	}
+	plan, err := ac.generateNotificationPlanWithPlanner(planner, start)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if plan.scheduledNotificationIDs["staticProperty"] {
+		t.Fatal("Cached plan reused after the property was re-registered")
+	}
+	full, err := ac.generateNotificationPlanForTime(start)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if testPlanSummary(plan) != testPlanSummary(full) {
+		t.Fatalf("Memoized plan differs from full recompute:\n%v\n%v", testPlanSummary(plan), testPlanSummary(full))
+	}
+}
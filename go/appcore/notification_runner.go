@@ -1,20 +1,29 @@
 package appcore
 
 import (
+	"context"
 	"errors"
 	"fmt"
 	"slices"
 	"time"
 
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
 )
 
 type NotificationPlan struct {
 	unscheduledNotifications []*datamodel.Notification
 	scheduledNotifications   []*ScheduledNotification
+	scheduledNotificationIDs map[string]bool
 
 	// The earliest time to run background work for notifications
 	EarliestBgCheckTimeEpochSeconds int64
+
+	// Changes since the plan with version BaseVersion. See notification_plan_delivery.go
+	Version     int64
+	BaseVersion int64
+	diff        notificationPlanDiff
+	config      *datamodel.PrimaryConfig
 }
 
 // Explaining the achitecture a bit here for notifications. It's a bit tricky due to restructions of iOS APIs.
@@ -55,8 +64,10 @@ func (sn *ScheduledNotification) ScheduledAtEpochMilliseconds() int64 {
 }
 
 func (ac *Appcore) initializeNotificationPlan() error {
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
 	if ac.notificationPlan == nil {
-		return ac.ForceUpdateNotificationPlan()
+		return ac.updateNotificationPlan()
 	}
 	return nil
 }
@@ -71,15 +82,36 @@ func (ac *Appcore) ForceUpdateNotificationPlan() (returnErr error) {
 		}
 	}()
 
-	if !ac.started || ac.config == nil {
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	// Includes any pending debounced update
+	ac.notificationPlanUpdatePending = false
+	ac.instrumentation.withProfilingLabels(stageNotificationPlan, func() {
+		returnErr = ac.updateNotificationPlan()
+	})
+	return returnErr
+}
+
+// Requires notificationLock
+func (ac *Appcore) updateNotificationPlan() error {
+	if !ac.started.Load() || ac.config() == nil {
 		return errAcNotStarted
 	}
-	plan, err := ac.generateNotificationPlan()
+	plan, err := ac.generateNotificationPlanWithPlanner(ac.notificationPlanner, ac.now())
 	if err != nil {
 		return err
 	}
-	ac.notificationPlan = &plan
-	err = ac.libBindings.UpdateNotificationPlan(&plan)
+	return ac.sendNotificationPlan(&plan)
+}
+
+// Requires notificationLock
+func (ac *Appcore) sendNotificationPlan(plan *NotificationPlan) error {
+	if !ac.versionNotificationPlan(plan, ac.notificationPlan) {
+		// Nothing changed since the last plan sent to the lib
+		return nil
+	}
+	ac.notificationPlan = plan
+	err := ac.libBindings.UpdateNotificationPlan(plan)
 	if err != nil {
 		return err
 	}
@@ -99,46 +131,83 @@ func (ac *Appcore) FetchNotificationPlan() (np *NotificationPlan, returnErr erro
 	if err != nil {
 		return nil, err
 	}
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
 	if ac.notificationPlan == nil {
 		return nil, errAcNotStarted
 	}
 	return ac.notificationPlan, nil
 }
 
-func (ac *Appcore) generateNotificationPlan() (NotificationPlan, error) {
-	now := time.Now()
-	return ac.generateNotificationPlanForTime(now)
+// Full recompute of the plan, for every notification
+func (ac *Appcore) generateNotificationPlanForTime(now time.Time) (NotificationPlan, error) {
+	return ac.generateNotificationPlanWithPlanner(nil, now)
 }
 
-func (ac *Appcore) generateNotificationPlanForTime(now time.Time) (NotificationPlan, error) {
-	if !ac.started || ac.config == nil {
+// Generates the plan, reusing state from the planner where still valid. A nil planner recomputes everything.
+func (ac *Appcore) generateNotificationPlanWithPlanner(planner *notificationPlanner, now time.Time) (NotificationPlan, error) {
+	return ac.generateNotificationPlanForWakeups(planner, false, now)
+}
+
+// For background work: only re-plans notifications with due wakeups, reusing the last plan for notifications which
+// can't change until their wakeup. Notifications without wakeups are planned as usual (cached unless they have
+// conditions which aren't static, see notification_planner.go).
+func (ac *Appcore) generateNotificationPlanForDueWakeups(planner *notificationPlanner, now time.Time) (NotificationPlan, error) {
+	return ac.generateNotificationPlanForWakeups(planner, true, now)
+}
+
+func (ac *Appcore) generateNotificationPlanForWakeups(planner *notificationPlanner, dueOnly bool, now time.Time) (NotificationPlan, error) {
+	defer ac.instrumentation.since(stageNotificationPlan, time.Now())
+	config := ac.config()
+	if !ac.started.Load() || config == nil {
 		return NotificationPlan{}, errAcNotStarted
 	}
+	planner.resetIfConfigChanged(config)
 	plan := NotificationPlan{
 		unscheduledNotifications: make([]*datamodel.Notification, 0),
 		scheduledNotifications:   make([]*ScheduledNotification, 0),
+		scheduledNotificationIDs: make(map[string]bool),
+		config:                   config,
 	}
 
 	var earliestBgCheckTime *time.Time
+	var due map[string]bool
+	if dueOnly {
+		due = planner.popDueWakeups(now)
+	}
 
-	for _, notification := range ac.config.Notifications {
-		deliveryTimestamp, bgCheckTime := ac.notificationDeliveryTime(notification, now)
+	registrations := ac.propertyRegistry.registrations()
+	for _, notification := range config.Notifications {
+		var deliveryTimestamp, bgCheckTime *time.Time
+		entry := planner.entryFor(notification)
+		if dueOnly && !due[notification.ID] && entry.reusableUntilWakeup(notification, registrations) {
+			deliveryTimestamp, bgCheckTime = entry.deliveryTime, entry.bgCheckTime
+		} else {
+			deliveryTimestamp, bgCheckTime = ac.plannedNotificationDeliveryTime(entry, notification, now)
+			planner.scheduleWakeup(notification, bgCheckTime)
+		}
 		if deliveryTimestamp != nil {
 			sn := ScheduledNotification{
 				Notification: notification,
 				scheduledAt:  *deliveryTimestamp,
 			}
 			plan.scheduledNotifications = append(plan.scheduledNotifications, &sn)
+			plan.scheduledNotificationIDs[notification.ID] = true
 		} else {
 			plan.unscheduledNotifications = append(plan.unscheduledNotifications, notification)
 		}
 
-		if bgCheckTime != nil {
+		if planner == nil && bgCheckTime != nil {
 			if earliestBgCheckTime == nil || earliestBgCheckTime.After(*bgCheckTime) {
 				earliestBgCheckTime = bgCheckTime
 			}
 		}
 	}
+	if planner != nil {
+		// Every notification's wakeup is current: re-planned notifications were just scheduled, and reused ones
+		// kept theirs
+		earliestBgCheckTime = planner.wakeups.next()
+	}
 
 	if earliestBgCheckTime != nil {
 		plan.EarliestBgCheckTimeEpochSeconds = earliestBgCheckTime.Unix()
@@ -153,7 +222,12 @@ func (ac *Appcore) generateNotificationPlanForTime(now time.Time) (NotificationP
 // 3) Then consider ideal delivery window, delivering sooner or later if we have special targeting in mind
 // 4) Then consider the allowed time of day, and days of week for delivery
 func (ac *Appcore) notificationDeliveryTime(notification *datamodel.Notification, now time.Time) (deliveryTime *time.Time, bgCheckTime *time.Time) {
-	alreadyDeliveredTime, err := ac.notificationAlreadyDeliveredTimeForSingleDeliveryNotification(notification)
+	return ac.notificationDeliveryTimeWithEntry(nil, notification, now)
+}
+
+// entry memoizes DB reads if non-nil. See notification_planner.go
+func (ac *Appcore) notificationDeliveryTimeWithEntry(entry *notificationPlanEntry, notification *datamodel.Notification, now time.Time) (deliveryTime *time.Time, bgCheckTime *time.Time) {
+	alreadyDeliveredTime, err := entry.alreadyDeliveredTime(ac, notification)
 	if err != nil {
 		fmt.Printf("CriticalMoments: error getting already delivered time for %v: %v\n", notification.UniqueID(), err)
 		// continue, but don't reschedule
@@ -164,7 +238,7 @@ func (ac *Appcore) notificationDeliveryTime(notification *datamodel.Notification
 		return nil, nil
 	}
 
-	nonIdealDeliveryTime := ac.baseDeliveryTimeForNotification(notification, now)
+	nonIdealDeliveryTime := ac.baseDeliveryTimeForNotification(entry, notification, now)
 	idealDeliveryTime, bgCheckTime := ac.shiftDeliveryTimeForIdealWindow(notification, nonIdealDeliveryTime, now)
 	shiftedDeliveryTime := shiftDeliveryTimeForFilters(notification, idealDeliveryTime)
 	return shiftedDeliveryTime, bgCheckTime
@@ -287,7 +361,7 @@ func bgCheckTimeForIdealDeliveryWindow(notification *datamodel.Notification, now
 }
 
 // Base delivery time for notification based on static delivery time and event time, ignoring ideal time and delivery window filters
-func (ac *Appcore) baseDeliveryTimeForNotification(notification *datamodel.Notification, now time.Time) *time.Time {
+func (ac *Appcore) baseDeliveryTimeForNotification(entry *notificationPlanEntry, notification *datamodel.Notification, now time.Time) *time.Time {
 	if canceled := ac.isNotificationCanceled(notification); canceled {
 		return nil
 	}
@@ -307,7 +381,7 @@ func (ac *Appcore) baseDeliveryTimeForNotification(notification *datamodel.Notif
 		return staticTimestamp
 	} else if eventName := notification.DeliveryTime.EventName; eventName != nil {
 		// Event based scheduling
-		deliveryTime, err := deliveryTimeFromDB(ac, &notification.DeliveryTime)
+		deliveryTime, err := entry.eventDeliveryTime(ac, notification)
 		if deliveryTime == nil || err != nil {
 			return nil
 		}
@@ -423,27 +497,48 @@ func deliveryTimeFromDB(ac *Appcore, dt *datamodel.DeliveryTime) (*time.Time, er
 
 // "event time" and not "delivery time", the caller must apply the offset
 func latestOnceEventTimeFromDB(ac *Appcore, dt *datamodel.DeliveryTime) (*time.Time, error) {
-	eventTimes, err := ac.db.AllEventTimesByName(*dt.EventName)
-	if err != nil {
+	// Stream event times, as the history can be long and we can usually stop early
+	cursor := ac.db.EventTimesByNameCursor(context.Background(), *dt.EventName, db.DefaultCursorPageSize)
+	defer cursor.Close()
+
+	latest := latestOnceEventTime(dt, func() (time.Time, bool) {
+		if !cursor.Next() {
+			return time.Time{}, false
+		}
+		return cursor.Value(), true
+	})
+	if err := cursor.Err(); err != nil {
 		return nil, err
 	}
-
-	return latestOnceEventTimeFromEventList(dt, eventTimes)
+	return latest, nil
 }
 
 func latestOnceEventTimeFromEventList(dt *datamodel.DeliveryTime, eventTimes []time.Time) (*time.Time, error) {
+	i := 0
+	return latestOnceEventTime(dt, func() (time.Time, bool) {
+		if i >= len(eventTimes) {
+			return time.Time{}, false
+		}
+		i++
+		return eventTimes[i-1], true
+	}), nil
+}
+
+// nextEventTime returns event times in ascending order, and false once there are no more
+func latestOnceEventTime(dt *datamodel.DeliveryTime, nextEventTime func() (time.Time, bool)) *time.Time {
 	// Latest once strategy: iterate through the events. The delivery time is the first event that is followed by a gap of at least the offset (+offset).
 	// This will consistently return the same delivery time from DB state without additional DB state.
-	if len(eventTimes) == 0 {
-		return nil, nil
+	lastTime, ok := nextEventTime()
+	if !ok {
+		return nil
 	}
 
 	offset := dt.EventOffsetDuration()
 
-	lastTime := eventTimes[0]
-	for i, eventTime := range eventTimes {
-		if i == 0 {
-			continue
+	for {
+		eventTime, ok := nextEventTime()
+		if !ok {
+			break
 		}
 		lastScheduledTime := lastTime.Add(offset)
 		if eventTime.After(lastScheduledTime) {
@@ -453,18 +548,22 @@ func latestOnceEventTimeFromEventList(dt *datamodel.DeliveryTime, eventTimes []t
 		lastTime = eventTime
 	}
 
-	return &lastTime, nil
+	return &lastTime
 }
 
 func (ac *Appcore) notificationRunnerProcessEvent(event *datamodel.Event) error {
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+
 	ac.updateCancelationEventCache(event)
+	ac.notificationPlanner.invalidateForEvent(ac.config(), event.Name)
 
 	needsUpdate, err := ac.notificationsNeedUpdateForEvent(event)
 	if err != nil {
 		return err
 	}
 	if needsUpdate {
-		err = ac.ForceUpdateNotificationPlan()
+		err = ac.requestNotificationPlanUpdate()
 		if err != nil {
 			return err
 		}
@@ -480,16 +579,10 @@ func (ac *Appcore) updateCancelationEventCache(event *datamodel.Event) {
 	}
 
 	// Check if this is a cancelation event
-	for _, notif := range ac.config.Notifications {
-		if notif.CancelationEvents != nil {
-			for _, cancelEventName := range *notif.CancelationEvents {
-				if event.Name == cancelEventName {
-					canceled := true
-					ac.seenCancelationEvents[event.Name] = &canceled
-					return
-				}
-			}
-		}
+	_, canceledNotifications := ac.config().NotificationsForEvent(event.Name)
+	if len(canceledNotifications) > 0 {
+		canceled := true
+		ac.seenCancelationEvents[event.Name] = &canceled
 	}
 }
 
@@ -498,26 +591,23 @@ func (ac *Appcore) notificationsNeedUpdateForEvent(event *datamodel.Event) (bool
 	if ac.notificationPlan == nil {
 		return false, nil
 	}
+	// Already going to update
+	if ac.notificationPlanUpdatePending {
+		return false, nil
+	}
+
+	// Only notifications delivered relative to, or canceled by, this event are affected
+	deliveryNotifications, canceledNotifications := ac.config().NotificationsForEvent(event.Name)
 
 	// Check if this event cancels existing scheduled notification
-	for _, sns := range ac.notificationPlan.scheduledNotifications {
-		sn := sns.Notification
-		if sn.CancelationEvents != nil {
-			for _, cancelEventName := range *sn.CancelationEvents {
-				if event.Name == cancelEventName {
-					return true, nil
-				}
-			}
+	for _, notif := range canceledNotifications {
+		if ac.notificationPlan.scheduledNotificationIDs[notif.ID] {
+			return true, nil
 		}
 	}
 
 	// Need update if a notification is triggered by this event
-	for _, notif := range ac.config.Notifications {
-		if notif.DeliveryTime.EventName == nil || *notif.DeliveryTime.EventName != event.Name {
-			// Not a trigger for this event
-			continue
-		}
-
+	for _, notif := range deliveryNotifications {
 		// Latest case and LatestOnce case: always update test plan
 		if notif.DeliveryTime.EventInstance() == datamodel.EventInstanceTypeLatest ||
 			notif.DeliveryTime.EventInstance() == datamodel.EventInstanceTypeLatestOnce {
@@ -525,14 +615,7 @@ func (ac *Appcore) notificationsNeedUpdateForEvent(event *datamodel.Event) (bool
 		}
 		// First case: only update if this is the first event, and not already scheduled
 		if notif.DeliveryTime.EventInstance() == datamodel.EventInstanceTypeFirst {
-			alreadyScheduled := false
-			for _, sns := range ac.notificationPlan.scheduledNotifications {
-				if sns.Notification.ID == notif.ID {
-					alreadyScheduled = true
-					break
-				}
-			}
-			if !alreadyScheduled {
+			if !ac.notificationPlan.scheduledNotificationIDs[notif.ID] {
 				return true, nil
 			}
 		}
@@ -541,6 +624,23 @@ func (ac *Appcore) notificationsNeedUpdateForEvent(event *datamodel.Event) (bool
 	return false, nil
 }
 
-func (ac *Appcore) performBackgroundWorkForNotifications() error {
-	return ac.ForceUpdateNotificationPlan()
+// Re-plans notifications with due wakeups, and returns the next time background work should run (epoch seconds, 0
+// if none)
+func (ac *Appcore) performBackgroundWorkForNotifications(now time.Time) (int64, error) {
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+	if !ac.started.Load() || ac.config() == nil {
+		return 0, errAcNotStarted
+	}
+
+	// Events since the last plan dropped the planner state they affect, so this includes any pending debounced update
+	ac.notificationPlanUpdatePending = false
+	plan, err := ac.generateNotificationPlanForDueWakeups(ac.notificationPlanner, now)
+	if err != nil {
+		return 0, err
+	}
+	if err := ac.sendNotificationPlan(&plan); err != nil {
+		return 0, err
+	}
+	return plan.EarliestBgCheckTimeEpochSeconds, nil
 }
@@ -992,7 +992,7 @@ func TestNotificationAlreadyDeliveredTime(t *testing.T) {
 
 	// Event 1: A "Latest" event which repeats
 
-	notification := ac.config.Notifications["event1Notification"]
+	notification := ac.config().Notifications["event1Notification"]
 	if notification.DeliveryTime.EventInstance() != datamodel.EventInstanceTypeLatest {
 		t.Fatal("Expected event1 to be a latest event")
 	}
@@ -1020,7 +1020,7 @@ func TestNotificationAlreadyDeliveredTime(t *testing.T) {
 	}
 
 	// Event 2: a first event which fires does not repeat
-	notification = ac.config.Notifications["event2Notification"]
+	notification = ac.config().Notifications["event2Notification"]
 	if notification.DeliveryTime.EventInstance() != datamodel.EventInstanceTypeFirst {
 		t.Fatal("Expected event2 to be a first event")
 	}
@@ -1066,7 +1066,7 @@ func TestNotificationAlreadyDeliveredTime(t *testing.T) {
 	}
 
 	// Event 4: a "latest-once" event with offset. Should push back on multiple events, fire on last event, then not fire again
-	notification = ac.config.Notifications["event4Notification"]
+	notification = ac.config().Notifications["event4Notification"]
 	if notification.DeliveryTime.EventInstance() != datamodel.EventInstanceTypeLatestOnce {
 		t.Fatal("Expected event4 to be a latest-once event")
 	}
@@ -1126,7 +1126,7 @@ func TestNotificationAlreadyDeliveredTime(t *testing.T) {
 	}
 
 	// Event 6: latest-once with ideal time and offset. Test BG worker.
-	notification = ac.config.Notifications["event6Notification"]
+	notification = ac.config().Notifications["event6Notification"]
 	if notification.DeliveryTime.EventInstance() != datamodel.EventInstanceTypeLatestOnce ||
 		notification.IdealDeliveryConditions == nil ||
 		notification.IdealDeliveryConditions.MaxWaitTimeSeconds != 1200 ||
@@ -0,0 +1,343 @@
+package appcore
+
+import (
+	"context"
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+)
+
+/*
+Notification simulation harness
+
+Drives an Appcore through simulated time: an injected clock (Appcore and MemoryDB), fake lib bindings recording
+plans, and a synthetic event stream. Each simulated day sends that day's events, runs background work whenever the
+last reported wake time passes, then regenerates the plan both with the planner and from scratch, recording the plan,
+DB reads and time taken. Deterministic for a given seed, so plan outputs can be compared across runs.
+*/
+
+var testSimulationStart = time.Date(2024, time.January, 1, 8, 0, 0, 0, time.UTC)
+
+// Counts DB reads, to attribute them to plan regenerations. Condition functions query the wrapped MemoryDB
+// directly, so aren't counted.
+type simulationStorage struct {
+	*db.MemoryDB
+	reads int
+}
+
+func (s *simulationStorage) EventCountByName(name string) (int, error) {
+	s.reads++
+	return s.MemoryDB.EventCountByName(name)
+}
+func (s *simulationStorage) EventCountByNameWithLimit(name string, limit int) (int, error) {
+	s.reads++
+	return s.MemoryDB.EventCountByNameWithLimit(name, limit)
+}
+func (s *simulationStorage) EventCountByNameSince(name string, duration time.Duration) (int, error) {
+	s.reads++
+	return s.MemoryDB.EventCountByNameSince(name, duration)
+}
+func (s *simulationStorage) EventCountByNameInWindow(name string, start time.Time, end time.Time) (int, error) {
+	s.reads++
+	return s.MemoryDB.EventCountByNameInWindow(name, start, end)
+}
+func (s *simulationStorage) LatestEventTimeByName(name string) (*time.Time, error) {
+	s.reads++
+	return s.MemoryDB.LatestEventTimeByName(name)
+}
+func (s *simulationStorage) FirstEventTimeByName(name string) (*time.Time, error) {
+	s.reads++
+	return s.MemoryDB.FirstEventTimeByName(name)
+}
+func (s *simulationStorage) AllEventTimesByName(name string) ([]time.Time, error) {
+	s.reads++
+	return s.MemoryDB.AllEventTimesByName(name)
+}
+func (s *simulationStorage) EventTimesByNameCursor(ctx context.Context, name string, pageSize int) *db.Cursor[time.Time] {
+	s.reads++
+	return s.MemoryDB.EventTimesByNameCursor(ctx, name, pageSize)
+}
+func (s *simulationStorage) LatestPropertyHistory(name string) (interface{}, error) {
+	s.reads++
+	return s.MemoryDB.LatestPropertyHistory(name)
+}
+
+type simulationStats struct {
+	days           int
+	events         int
+	backgroundRuns int
+
+	regenerations  int
+	plannerReads   int
+	plannerTime    time.Duration
+	fullReads      int
+	fullTime       time.Duration
+	maxPlannerTime time.Duration
+}
+
+func (s simulationStats) String() string {
+	if s.regenerations == 0 {
+		return "no regenerations"
+	}
+	n := s.regenerations
+	return fmt.Sprintf("%v days, %v events, %v background runs. Per regeneration: memoized %v reads %v (max %v), full %v reads %v",
+		s.days, s.events, s.backgroundRuns, s.plannerReads/n, s.plannerTime/time.Duration(n), s.maxPlannerTime, s.fullReads/n, s.fullTime/time.Duration(n))
+}
+
+type notificationSimulation struct {
+	tb      testing.TB
+	ac      *Appcore
+	storage *simulationStorage
+	lib     *testPlanRecordingLibBindings
+	rand    *rand.Rand
+
+	now      time.Time
+	nextWake int64
+	// Event names and relative frequencies
+	eventNames   []string
+	eventWeights []int
+
+	// Plan summary at the end of each simulated day
+	planLog []string
+	stats   simulationStats
+}
+
+// Config with the given number of notifications, mixing every delivery type, cancelation events, delivery windows
+// and conditions. Notifications use eventCount delivery events e0-e19 and cancelation events c0-c9.
+func testSimulationConfigJson(notificationCount int) string {
+	var notifications []string
+	for i := 0; i < notificationCount; i++ {
+		var n string
+		switch i % 6 {
+		case 0:
+			timestamp := testSimulationStart.Add(time.Duration(i*37%365)*24*time.Hour + time.Duration(i%24)*time.Hour)
+			n = fmt.Sprintf(`{"title": "t", "deliveryTime": {"timestamp": %v}}`, timestamp.Unix())
+		case 1:
+			n = fmt.Sprintf(`{"title": "t", "cancelationEvents": ["c%v"], "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": %v, "eventInstance": "first"}}`, i%10, i%20, 3600*(i%48))
+		case 2:
+			n = fmt.Sprintf(`{"title": "t", "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": %v, "eventInstance": "latest"}}`, i%20, 86400*(i%7))
+		case 3:
+			n = fmt.Sprintf(`{"title": "t", "cancelationEvents": ["c%v", "c%v"], "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": %v, "eventInstance": "latest-once"}, "deliveryTimeOfDayStart": "09:00", "deliveryTimeOfDayEnd": "17:00", "deliveryDaysOfWeek": "Monday,Wednesday,Friday"}`, i%10, (i+3)%10, i%20, 3600*(i%30))
+		case 4:
+			n = fmt.Sprintf(`{"title": "t", "deliveryTime": {"eventName": "e%v", "eventInstance": "latest"}, "idealDeliveryConditions": {"condition": "eventCount('e%v') > 3", "maxWaitTimeSeconds": %v}, "deliveryTimeOfDayStart": "10:00", "deliveryTimeOfDayEnd": "20:00"}`, i%20, (i+1)%20, 3600*(1+i%24))
+		default:
+			n = fmt.Sprintf(`{"title": "t", "scheduleCondition": "eventCount('e%v') > 1", "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": %v, "eventInstance": "first"}}`, (i+2)%20, i%20, 600*(i%12))
+		}
+		notifications = append(notifications, fmt.Sprintf(`"n%v": %v`, i, n))
+	}
+	return fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "notifications": {%v}}`, strings.Join(notifications, ","))
+}
+
+func newNotificationSimulation(tb testing.TB, notificationCount int, seed int64) *notificationSimulation {
+	configPath := filepath.Join(tb.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(testSimulationConfigJson(notificationCount)), 0644); err != nil {
+		tb.Fatal(err)
+	}
+
+	sim := &notificationSimulation{
+		tb:      tb,
+		storage: &simulationStorage{MemoryDB: db.NewMemoryDB()},
+		lib:     &testPlanRecordingLibBindings{},
+		rand:    rand.New(rand.NewSource(seed)),
+		now:     testSimulationStart,
+	}
+	clock := func() time.Time {
+		return sim.now
+	}
+	sim.storage.SetClock(clock)
+
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, sim.storage, tb)
+	if err != nil {
+		tb.Fatal(err)
+	}
+	ac.clock = clock
+	ac.RegisterLibraryBindings(sim.lib)
+	if err := ac.Start(true); err != nil {
+		tb.Fatal(err)
+	}
+	sim.ac = ac
+
+	// Delivery events are common, some much more than others. Cancelation events are rare.
+	for i := 0; i < 20; i++ {
+		sim.eventNames = append(sim.eventNames, fmt.Sprintf("e%v", i))
+		sim.eventWeights = append(sim.eventWeights, 40/(i+1))
+	}
+	for i := 0; i < 10; i++ {
+		sim.eventNames = append(sim.eventNames, fmt.Sprintf("c%v", i))
+		sim.eventWeights = append(sim.eventWeights, 1)
+	}
+	sim.updateNextWake()
+	return sim
+}
+
+func (sim *notificationSimulation) randomEventName() string {
+	total := 0
+	for _, w := range sim.eventWeights {
+		total += w
+	}
+	r := sim.rand.Intn(total)
+	for i, w := range sim.eventWeights {
+		if r < w {
+			return sim.eventNames[i]
+		}
+		r -= w
+	}
+	return sim.eventNames[len(sim.eventNames)-1]
+}
+
+func (sim *notificationSimulation) updateNextWake() {
+	sim.ac.notificationLock.Lock()
+	defer sim.ac.notificationLock.Unlock()
+	if sim.ac.notificationPlan != nil {
+		sim.nextWake = sim.ac.notificationPlan.EarliestBgCheckTimeEpochSeconds
+	}
+}
+
+// Runs background work each time the reported wake time passes, until t
+func (sim *notificationSimulation) runBackgroundWorkUntil(t time.Time) {
+	for sim.nextWake != 0 {
+		// The OS runs background tasks no earlier than the requested second
+		wakeAt := time.Unix(sim.nextWake+1, 0)
+		if wakeAt.After(t) {
+			return
+		}
+		sim.now = wakeAt
+		next, err := sim.ac.PerformBackgroundWork()
+		if err != nil {
+			sim.tb.Fatal(err)
+		}
+		sim.nextWake = next
+		sim.stats.backgroundRuns++
+	}
+}
+
+// Simulates a day with eventCount events at random times, then regenerates the plan
+func (sim *notificationSimulation) simulateDay(eventCount int) {
+	dayEnd := sim.now.Add(24 * time.Hour)
+	eventTimes := make([]time.Time, eventCount)
+	for i := range eventTimes {
+		eventTimes[i] = sim.now.Add(time.Duration(sim.rand.Int63n(int64(24 * time.Hour))))
+	}
+	sort.Slice(eventTimes, func(i, j int) bool { return eventTimes[i].Before(eventTimes[j]) })
+
+	for _, eventTime := range eventTimes {
+		sim.runBackgroundWorkUntil(eventTime)
+		sim.now = eventTime
+		if err := sim.ac.SendClientEvent(sim.randomEventName()); err != nil {
+			sim.tb.Fatal(err)
+		}
+		sim.updateNextWake()
+		sim.stats.events++
+	}
+	sim.runBackgroundWorkUntil(dayEnd)
+	sim.now = dayEnd
+	sim.stats.days++
+
+	planner, full := sim.regenerate()
+	if testPlanSummary(planner) != testPlanSummary(full) {
+		sim.tb.Fatalf("Memoized plan differs from full recompute on day %v:\n%v\n%v", sim.stats.days, testPlanSummary(planner), testPlanSummary(full))
+	}
+	sim.planLog = append(sim.planLog, testPlanSummary(planner))
+}
+
+// Regenerates the plan with the planner and from scratch at the current time, recording reads and time taken
+func (sim *notificationSimulation) regenerate() (planner NotificationPlan, full NotificationPlan) {
+	ac := sim.ac
+	ac.notificationLock.Lock()
+	defer ac.notificationLock.Unlock()
+
+	reads := sim.storage.reads
+	start := time.Now()
+	planner, err := ac.generateNotificationPlanWithPlanner(ac.notificationPlanner, sim.now)
+	if err != nil {
+		sim.tb.Fatal(err)
+	}
+	elapsed := time.Since(start)
+	sim.stats.plannerTime += elapsed
+	sim.stats.maxPlannerTime = max(sim.stats.maxPlannerTime, elapsed)
+	sim.stats.plannerReads += sim.storage.reads - reads
+
+	reads = sim.storage.reads
+	start = time.Now()
+	full, err = ac.generateNotificationPlanForTime(sim.now)
+	if err != nil {
+		sim.tb.Fatal(err)
+	}
+	sim.stats.fullTime += time.Since(start)
+	sim.stats.fullReads += sim.storage.reads - reads
+
+	sim.stats.regenerations++
+	return planner, full
+}
+
+func TestNotificationSimulation(t *testing.T) {
+	days := 60
+	if testing.Short() {
+		days = 14
+	}
+	seed := time.Now().UnixNano()
+	t.Logf("Seed: %v", seed)
+
+	run := func() *notificationSimulation {
+		sim := newNotificationSimulation(t, 150, seed)
+		for day := 0; day < days; day++ {
+			sim.simulateDay(20 + sim.rand.Intn(40))
+		}
+		return sim
+	}
+	sim := run()
+	t.Log(sim.stats)
+
+	if sim.stats.backgroundRuns == 0 || sim.lib.planCount() < days {
+		t.Fatalf("Expected background runs and plan updates, got %v and %v", sim.stats.backgroundRuns, sim.lib.planCount())
+	}
+	if sim.stats.plannerReads >= sim.stats.fullReads {
+		t.Fatal("Expected memoized plans to read the DB less than full recomputes")
+	}
+
+	// Same seed, same plans
+	replay := run()
+	if strings.Join(sim.planLog, "\n") != strings.Join(replay.planLog, "\n") {
+		t.Fatal("Simulation isn't deterministic")
+	}
+}
+
+// Plan regeneration after a year of usage, with 300 notifications
+func BenchmarkNotificationPlanSimulation(b *testing.B) {
+	sim := newNotificationSimulation(b, 300, 1)
+	for day := 0; day < 365; day++ {
+		sim.simulateDay(20 + sim.rand.Intn(40))
+	}
+	b.Logf("After a year: %v", sim.stats)
+
+	ac := sim.ac
+	for _, memoized := range []bool{true, false} {
+		b.Run(fmt.Sprintf("memoized=%v", memoized), func(b *testing.B) {
+			planner := ac.notificationPlanner
+			if !memoized {
+				planner = nil
+			}
+			reads := sim.storage.reads
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				// Time moves on between regenerations, as it would between events
+				sim.now = sim.now.Add(time.Minute)
+				ac.notificationLock.Lock()
+				_, err := ac.generateNotificationPlanWithPlanner(planner, sim.now)
+				ac.notificationLock.Unlock()
+				if err != nil {
+					b.Fatal(err)
+				}
+			}
+			b.ReportMetric(float64(sim.storage.reads-reads)/float64(b.N), "reads/op")
+		})
+	}
+}
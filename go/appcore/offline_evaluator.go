@@ -0,0 +1,557 @@
+//go:build !ios
+
+package appcore
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"hash/fnv"
+	"os"
+	"reflect"
+	"runtime"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+	"github.com/CriticalMoments/CriticalMoments/go/cmcore/signing"
+	"github.com/antonmedv/expr"
+	"github.com/antonmedv/expr/vm"
+	"golang.org/x/exp/maps"
+	"golang.org/x/exp/slices"
+)
+
+/*
+Offline evaluation
+
+Evaluates a config's conditions against a population of devices, off device (see cmd/offline_eval). Used to preview
+how many devices a config change matches before shipping it.
+
+Off device only: the file is excluded from iOS builds, so RunOfflineEvaluation isn't part of the gomobile bound SDK.
+
+Input is a config file and a columnar snapshot file, with one row per device:
+
+	{
+	  "deviceIds": ["a", "b"],
+	  "properties": {
+	    "platform": {"type": "string", "values": ["iOS", ""], "missing": [1]},
+	    "app_install_date": {"type": "time", "values": [1700000000000, 1710000000000]}
+	  },
+	  "events": {
+	    "app_start": {"counts": [12, 3], "latestTimes": [1710000000000, 1700000000000]}
+	  }
+	}
+
+Property column types are bool, string, int, float and time (unix milliseconds). Rows listed in missing are nil, like
+a property the device doesn't provide. Event columns are per-device aggregates: counts, and optionally the latest event
+time (unix milliseconds, 0 if none).
+
+Every named condition, trigger condition and notification schedule condition is evaluated for every device, and the
+match counts are returned as JSON. Conditions evaluate as on device (propertyRegistry): the same static functions and
+constants, nil for missing properties, custom properties without the prefix, and nil functions for unknown functions.
+
+Each condition is compiled once per set of nil variables (almost always one set: every property present), and the
+program is shared by all workers. Values, including the device's event functions, come from each worker's env at run
+time, so workers share nothing mutable. Event functions are answered from the aggregates: eventCount,
+eventCountWithLimit and latestEventTime. The time windowed counts (eventCountSince, eventCountInWindow) can't be, and
+return nil like an unknown function, as does canOpenUrl. propertyHistoryLatestValue and propertyEver use the
+snapshot value, and stableRand is a stable hash of the device ID.
+*/
+
+var offlineSnapshotColumnKinds = map[string]reflect.Kind{
+	"bool":   reflect.Bool,
+	"string": reflect.String,
+	"int":    reflect.Int,
+	"float":  reflect.Float64,
+	"time":   datamodel.CMTimeKind,
+}
+
+type jsonOfflineSnapshot struct {
+	DeviceIds  []string                              `json:"deviceIds"`
+	Properties map[string]*jsonOfflineSnapshotColumn `json:"properties"`
+	Events     map[string]*offlineEventColumn        `json:"events"`
+}
+
+type jsonOfflineSnapshotColumn struct {
+	Type    string          `json:"type"`
+	Values  json.RawMessage `json:"values"`
+	Missing []int           `json:"missing,omitempty"`
+}
+
+type offlineEventColumn struct {
+	Counts      []int   `json:"counts"`
+	LatestTimes []int64 `json:"latestTimes,omitempty"`
+}
+
+// One typed slice is set, per the kind. Times are unix milliseconds in ints.
+type offlineSnapshotColumn struct {
+	kind    reflect.Kind
+	bools   []bool
+	strings []string
+	ints    []int
+	floats  []float64
+	missing []bool
+}
+
+func (c *offlineSnapshotColumn) value(row int) interface{} {
+	if c.missing != nil && c.missing[row] {
+		return nil
+	}
+	switch c.kind {
+	case reflect.Bool:
+		return c.bools[row]
+	case reflect.String:
+		return c.strings[row]
+	case reflect.Int:
+		return c.ints[row]
+	case reflect.Float64:
+		return c.floats[row]
+	case datamodel.CMTimeKind:
+		return time.UnixMilli(int64(c.ints[row]))
+	}
+	return nil
+}
+
+// Typed value for compiling, matching the on device property type
+func (c *offlineSnapshotColumn) templateValue() interface{} {
+	switch c.kind {
+	case reflect.Bool:
+		return false
+	case reflect.String:
+		return ""
+	case reflect.Int:
+		return 0
+	case reflect.Float64:
+		return 0.0
+	case datamodel.CMTimeKind:
+		return time.Time{}
+	}
+	return nil
+}
+
+type offlineSnapshot struct {
+	deviceIds  []string
+	properties map[string]*offlineSnapshotColumn
+	events     map[string]*offlineEventColumn
+}
+
+func decodeOfflineSnapshot(data []byte) (*offlineSnapshot, error) {
+	var js jsonOfflineSnapshot
+	if err := json.Unmarshal(data, &js); err != nil {
+		return nil, fmt.Errorf("CriticalMoments: invalid offline snapshot: %w", err)
+	}
+	rows := len(js.DeviceIds)
+	if rows == 0 {
+		return nil, errors.New("CriticalMoments: offline snapshot has no devices")
+	}
+
+	s := &offlineSnapshot{
+		deviceIds:  js.DeviceIds,
+		properties: make(map[string]*offlineSnapshotColumn, len(js.Properties)),
+		events:     js.Events,
+	}
+	builtInTypes := datamodel.BuiltInPropertyTypes()
+	for name, jc := range js.Properties {
+		if jc == nil || !validPropertyName(name) {
+			return nil, fmt.Errorf("CriticalMoments: invalid offline snapshot property: %v", name)
+		}
+		kind, ok := offlineSnapshotColumnKinds[jc.Type]
+		if !ok {
+			return nil, fmt.Errorf("CriticalMoments: offline snapshot property %v has unsupported type: %v", name, jc.Type)
+		}
+		if builtIn, ok := builtInTypes[name]; ok && builtIn.Type != kind {
+			return nil, fmt.Errorf("CriticalMoments: offline snapshot property %v of wrong type, expected %v", name, builtIn.Type)
+		}
+		column, err := decodeOfflineSnapshotColumn(kind, jc, rows)
+		if err != nil {
+			return nil, fmt.Errorf("CriticalMoments: offline snapshot property %v: %w", name, err)
+		}
+		s.properties[name] = column
+	}
+	for name, ec := range s.events {
+		if ec == nil || len(ec.Counts) != rows || (ec.LatestTimes != nil && len(ec.LatestTimes) != rows) {
+			return nil, fmt.Errorf("CriticalMoments: offline snapshot event %v needs one value per device", name)
+		}
+	}
+	return s, nil
+}
+
+func decodeOfflineSnapshotColumn(kind reflect.Kind, jc *jsonOfflineSnapshotColumn, rows int) (*offlineSnapshotColumn, error) {
+	c := &offlineSnapshotColumn{kind: kind}
+	var target interface{}
+	var length func() int
+	switch kind {
+	case reflect.Bool:
+		target, length = &c.bools, func() int { return len(c.bools) }
+	case reflect.String:
+		target, length = &c.strings, func() int { return len(c.strings) }
+	case reflect.Float64:
+		target, length = &c.floats, func() int { return len(c.floats) }
+	default:
+		target, length = &c.ints, func() int { return len(c.ints) }
+	}
+	if err := json.Unmarshal(jc.Values, target); err != nil {
+		return nil, err
+	}
+	if length() != rows {
+		return nil, errors.New("needs one value per device")
+	}
+	if len(jc.Missing) > 0 {
+		c.missing = make([]bool, rows)
+		for _, row := range jc.Missing {
+			if row < 0 || row >= rows {
+				return nil, errors.New("missing row out of range")
+			}
+			c.missing[row] = true
+		}
+	}
+	return c, nil
+}
+
+// Allow custom properties to be accessed without the prefix, like propertyValueFromRegistrations
+func (s *offlineSnapshot) column(key string) *offlineSnapshotColumn {
+	if c, ok := s.properties[key]; ok {
+		return c
+	}
+	return s.properties[CustomPropertyPrefix+key]
+}
+
+// The device a worker is evaluating. Condition functions read the current row.
+type offlineDevice struct {
+	snapshot *offlineSnapshot
+	row      int
+}
+
+func (d *offlineDevice) eventCount(name string) int {
+	if ec, ok := d.snapshot.events[name]; ok {
+		return ec.Counts[d.row]
+	}
+	return 0
+}
+
+func (d *offlineDevice) propertyValue(name string) interface{} {
+	if c := d.snapshot.column(name); c != nil {
+		return c.value(d.row)
+	}
+	return nil
+}
+
+// The built in dynamic functions (AllBuiltInDynamicFunctions), answered from the snapshot. Same signatures as the
+// on device functions, except those which can't be answered return nil.
+func (d *offlineDevice) conditionFunctions() map[string]interface{} {
+	return map[string]interface{}{
+		"eventCount": func(name string) int {
+			return d.eventCount(name)
+		},
+		"eventCountWithLimit": func(name string, limit int) int {
+			return min(d.eventCount(name), limit)
+		},
+		"eventCountSince": func(name string, duration time.Duration) interface{} {
+			return nil
+		},
+		"eventCountInWindow": func(name string, start time.Time, end time.Time) interface{} {
+			return nil
+		},
+		"latestEventTime": func(name string) interface{} {
+			ec, ok := d.snapshot.events[name]
+			if !ok || ec.LatestTimes == nil || ec.LatestTimes[d.row] == 0 {
+				return nil
+			}
+			return time.UnixMilli(ec.LatestTimes[d.row])
+		},
+		"canOpenUrl": func(url string) interface{} {
+			return nil
+		},
+		"propertyHistoryLatestValue": func(name string) interface{} {
+			return d.propertyValue(name)
+		},
+		"propertyEver": func(name string, value interface{}) bool {
+			v := d.propertyValue(name)
+			return v != nil && v == value
+		},
+		"stableRand": func() int64 {
+			h := fnv.New64a()
+			h.Write([]byte(d.snapshot.deviceIds[d.row]))
+			// Non-negative, like rand.Int63 on device
+			return int64(h.Sum64() >> 1)
+		},
+	}
+}
+
+type offlineProgram struct {
+	once    sync.Once
+	program *vm.Program
+	err     error
+}
+
+type offlineCondition struct {
+	entity    string
+	condition *datamodel.Condition
+	// Unique variables in the condition, and their snapshot columns (nil if not in the snapshot)
+	variables []string
+	columns   []*offlineSnapshotColumn
+	fieldsErr error
+	nilOps    []expr.Option
+
+	// Every variable present, and keyed by which variables are nil (mask) otherwise
+	presentProgram offlineProgram
+	programs       sync.Map
+}
+
+// Compiled once per mask, by whichever worker needs it first
+func (c *offlineCondition) program(e *offlineEvaluator, mask []byte) (*vm.Program, error) {
+	op := &c.presentProgram
+	if slices.Contains(mask, 1) {
+		p, ok := c.programs.Load(string(mask))
+		if !ok {
+			p, _ = c.programs.LoadOrStore(string(mask), &offlineProgram{})
+		}
+		op = p.(*offlineProgram)
+	}
+	op.once.Do(func() {
+		op.program, op.err = e.compile(c, mask)
+	})
+	return op.program, op.err
+}
+
+type offlineEvaluator struct {
+	registry   *propertyRegistry
+	snapshot   *offlineSnapshot
+	conditions []*offlineCondition
+}
+
+// Named conditions, trigger conditions and notification schedule conditions, ordered by entity
+func newOfflineEvaluator(pc *datamodel.PrimaryConfig, snapshot *offlineSnapshot) *offlineEvaluator {
+	e := &offlineEvaluator{
+		registry: newPropertyRegistry(),
+		snapshot: snapshot,
+	}
+	functionNames := append(maps.Keys(e.registry.mapFunctions), maps.Keys(datamodel.AllBuiltInDynamicFunctions)...)
+	for condition, entity := range pc.ConditionEntities() {
+		if !strings.HasPrefix(entity, "condition:") && !strings.HasPrefix(entity, "trigger:") && !strings.HasSuffix(entity, "/schedule") {
+			continue
+		}
+		c := &offlineCondition{entity: entity, condition: condition}
+		fields, err := condition.ExtractIdentifiers()
+		if err != nil {
+			c.fieldsErr = err
+		} else {
+			for _, v := range fields.Variables {
+				if !slices.Contains(c.variables, v) {
+					c.variables = append(c.variables, v)
+					c.columns = append(c.columns, snapshot.column(v))
+				}
+			}
+			// Nil functions for unknown functions, like nilMethodsForUnknownFunctions
+			for _, m := range fields.Methods {
+				if !slices.Contains(functionNames, m) {
+					c.nilOps = append(c.nilOps, expr.Function(m, func(params ...any) (interface{}, error) {
+						return nil, nil
+					}))
+				}
+			}
+		}
+		e.conditions = append(e.conditions, c)
+	}
+	slices.SortFunc(e.conditions, func(a, b *offlineCondition) bool {
+		return a.entity < b.entity
+	})
+	return e
+}
+
+// Static functions and constants, and the dynamic functions for the device
+func (e *offlineEvaluator) baseEnv(device *offlineDevice) map[string]interface{} {
+	env := make(map[string]interface{})
+	maps.Copy(env, e.registry.mapConstants)
+	maps.Copy(env, e.registry.mapFunctions)
+	maps.Copy(env, device.conditionFunctions())
+	return env
+}
+
+func (e *offlineEvaluator) compile(c *offlineCondition, mask []byte) (*vm.Program, error) {
+	env := e.baseEnv(&offlineDevice{snapshot: e.snapshot})
+	for i, v := range c.variables {
+		if mask[i] == 1 {
+			env[v] = nil
+		} else {
+			env[v] = c.columns[i].templateValue()
+		}
+	}
+	ops := append([]expr.Option{expr.Env(env)}, c.nilOps...)
+	return c.condition.CompileWithEnv(ops...)
+}
+
+// Sets the condition's variables for the device, and which are nil
+func (c *offlineCondition) setVariables(env map[string]interface{}, mask []byte, row int) {
+	for i, v := range c.variables {
+		var value interface{}
+		if c.columns[i] != nil {
+			value = c.columns[i].value(row)
+		}
+		env[v] = value
+		mask[i] = 0
+		if value == nil {
+			mask[i] = 1
+		}
+	}
+}
+
+func (e *offlineEvaluator) evaluate(c *offlineCondition, env map[string]interface{}, mask []byte, row int) (returnResult bool, returnErr error) {
+	// expr can panic, so catch it and return an error instead
+	defer func() {
+		if r := recover(); r != nil {
+			returnResult = false
+			returnErr = fmt.Errorf("panic in offline evaluate: %v", r)
+		}
+	}()
+	if c.fieldsErr != nil {
+		return false, c.fieldsErr
+	}
+	mask = mask[:len(c.variables)]
+	c.setVariables(env, mask, row)
+	program, err := c.program(e, mask)
+	if err != nil {
+		return false, err
+	}
+	result, err := expr.Run(program, env)
+	if err != nil {
+		return false, err
+	}
+	boolResult, ok := result.(bool)
+	return ok && boolResult, nil
+}
+
+type offlineEvaluationReport struct {
+	Devices    int                             `json:"devices"`
+	Conditions []*offlineEvaluationReportEntry `json:"conditions"`
+}
+
+type offlineEvaluationReportEntry struct {
+	Entity    string `json:"entity"`
+	Condition string `json:"condition"`
+	Matched   int    `json:"matched"`
+	Unmatched int    `json:"unmatched"`
+	Errors    int    `json:"errors"`
+	// First error, as an example
+	FirstError string `json:"firstError,omitempty"`
+}
+
+// Rows are claimed in chunks, so workers rarely contend on the counter
+const offlineEvaluationChunkSize = 256
+
+// Evaluates every condition for every device on the given number of workers (all CPUs if <= 0)
+func (e *offlineEvaluator) run(workers int) *offlineEvaluationReport {
+	if workers <= 0 {
+		workers = runtime.NumCPU()
+	}
+	rows := len(e.snapshot.deviceIds)
+	maxVariables := 0
+	for _, c := range e.conditions {
+		maxVariables = max(maxVariables, len(c.variables))
+	}
+
+	var nextRow atomic.Int64
+	workerEntries := make([][]offlineEvaluationReportEntry, workers)
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			entries := make([]offlineEvaluationReportEntry, len(e.conditions))
+			device := &offlineDevice{snapshot: e.snapshot}
+			env := e.baseEnv(device)
+			mask := make([]byte, maxVariables)
+			for {
+				start := int(nextRow.Add(offlineEvaluationChunkSize)) - offlineEvaluationChunkSize
+				if start >= rows {
+					break
+				}
+				end := min(start+offlineEvaluationChunkSize, rows)
+				for device.row = start; device.row < end; device.row++ {
+					for i, c := range e.conditions {
+						result, err := e.evaluate(c, env, mask, device.row)
+						entry := &entries[i]
+						if err != nil {
+							entry.Errors++
+							if entry.FirstError == "" {
+								entry.FirstError = err.Error()
+							}
+						} else if result {
+							entry.Matched++
+						} else {
+							entry.Unmatched++
+						}
+					}
+				}
+			}
+			workerEntries[w] = entries
+		}(w)
+	}
+	wg.Wait()
+
+	report := &offlineEvaluationReport{Devices: rows, Conditions: []*offlineEvaluationReportEntry{}}
+	for i, c := range e.conditions {
+		entry := &offlineEvaluationReportEntry{Entity: c.entity, Condition: c.condition.String()}
+		for _, entries := range workerEntries {
+			entry.Matched += entries[i].Matched
+			entry.Unmatched += entries[i].Unmatched
+			entry.Errors += entries[i].Errors
+			if entry.FirstError == "" {
+				entry.FirstError = entries[i].FirstError
+			}
+		}
+		report.Conditions = append(report.Conditions, entry)
+	}
+	return report
+}
+
+// Signed configs are verified. Unsigned configs are allowed, to preview a config before signing it.
+func loadOfflineConfig(configPath string) (*datamodel.PrimaryConfig, error) {
+	data, err := os.ReadFile(configPath)
+	if err != nil {
+		return nil, err
+	}
+	pc, err := datamodel.DecodePrimaryConfig(data, signing.SharedSignUtil())
+	if err == nil {
+		return pc, nil
+	}
+	pc = &datamodel.PrimaryConfig{}
+	if err := json.Unmarshal(data, &pc); err != nil {
+		return nil, datamodel.UserFriendlyJsonError(err, data)
+	}
+	return pc, nil
+}
+
+// Evaluates the config's named conditions, trigger conditions and notification schedule conditions for every device
+// in the snapshot file, and returns the match counts as JSON. Runs on the given number of workers, or all CPUs if <= 0.
+func RunOfflineEvaluation(configPath string, snapshotPath string, workers int) (returnReport string, returnErr error) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			returnReport = ""
+			returnErr = fmt.Errorf("panic in RunOfflineEvaluation: %v", r)
+		}
+	}()
+
+	pc, err := loadOfflineConfig(configPath)
+	if err != nil {
+		return "", err
+	}
+	snapshotData, err := os.ReadFile(snapshotPath)
+	if err != nil {
+		return "", err
+	}
+	snapshot, err := decodeOfflineSnapshot(snapshotData)
+	if err != nil {
+		return "", err
+	}
+
+	report := newOfflineEvaluator(pc, snapshot).run(workers)
+	reportJson, err := json.Marshal(report)
+	if err != nil {
+		return "", err
+	}
+	return string(reportJson), nil
+}
@@ -0,0 +1,143 @@
+//go:build !ios
+
+package appcore
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+const testOfflineSnapshotJson = `{
+	"deviceIds": ["a", "b", "c"],
+	"properties": {
+		"platform": {"type": "string", "values": ["iOS", "iPadOS", ""], "missing": [2]},
+		"app_install_date": {"type": "time", "values": [1700000000000, 1710000000000, 1720000000000]},
+		"custom_plan": {"type": "string", "values": ["pro", "free", "free"]}
+	},
+	"events": {
+		"app_start": {"counts": [12, 3, 0], "latestTimes": [1710000000000, 1700000000000, 0]}
+	}
+}`
+
+func TestOfflineEvaluation(t *testing.T) {
+	dir := t.TempDir()
+	configPath := filepath.Join(dir, "config.json")
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"conditions": {"namedConditions": {"pass": "true", "fail": "false"}},
+		"actions": {"namedActions": {"link0": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/0"}, "condition": "true"}}},
+		"triggers": {"namedTriggers": {"t": {"eventName": "e", "actionName": "link0", "condition": "true"}}}}`
+	snapshotPath := filepath.Join(dir, "snapshot.json")
+	if os.WriteFile(configPath, []byte(config), 0644) != nil || os.WriteFile(snapshotPath, []byte(testOfflineSnapshotJson), 0644) != nil {
+		t.Fatal("Failed to write test files")
+	}
+
+	for _, workers := range []int{0, 1, 4} {
+		reportJson, err := RunOfflineEvaluation(configPath, snapshotPath, workers)
+		if err != nil {
+			t.Fatal(err)
+		}
+		var report offlineEvaluationReport
+		if err := json.Unmarshal([]byte(reportJson), &report); err != nil {
+			t.Fatal(err)
+		}
+		// Action conditions aren't evaluated, and entries are ordered by entity
+		if report.Devices != 3 || len(report.Conditions) != 3 {
+			t.Fatalf("Unexpected report: %v", reportJson)
+		}
+		fail, pass, trigger := report.Conditions[0], report.Conditions[1], report.Conditions[2]
+		if fail.Entity != "condition:fail" || fail.Matched != 0 || fail.Unmatched != 3 {
+			t.Fatalf("Unexpected fail entry: %+v", fail)
+		}
+		if pass.Entity != "condition:pass" || pass.Condition != "true" || pass.Matched != 3 || pass.Errors != 0 {
+			t.Fatalf("Unexpected pass entry: %+v", pass)
+		}
+		if trigger.Entity != "trigger:t" || trigger.Matched != 3 {
+			t.Fatalf("Unexpected trigger entry: %+v", trigger)
+		}
+	}
+
+	if _, err := RunOfflineEvaluation(configPath, filepath.Join(dir, "missing.json"), 0); err == nil {
+		t.Fatal("Expected error for missing snapshot")
+	}
+}
+
+func TestOfflineSnapshotDecode(t *testing.T) {
+	s, err := decodeOfflineSnapshot([]byte(testOfflineSnapshotJson))
+	if err != nil {
+		t.Fatal(err)
+	}
+	device := &offlineDevice{snapshot: s, row: 0}
+	if device.propertyValue("platform") != "iOS" || device.propertyValue("plan") != "pro" || device.propertyValue("unknown") != nil {
+		t.Fatal("Unexpected property values")
+	}
+	if device.propertyValue("app_install_date") != time.UnixMilli(1700000000000) {
+		t.Fatal("Expected time value")
+	}
+	device.row = 2
+	if device.propertyValue("platform") != nil {
+		t.Fatal("Expected missing value to be nil")
+	}
+	if s.column("platform").templateValue() != "" {
+		t.Fatal("Expected typed template value")
+	}
+
+	invalid := []string{
+		`{"deviceIds": []}`,
+		`{"deviceIds": ["a"], "properties": {"platform": {"type": "int", "values": [1]}}}`,
+		`{"deviceIds": ["a"], "properties": {"custom_a": {"type": "list", "values": [1]}}}`,
+		`{"deviceIds": ["a"], "properties": {"custom_a": {"type": "int", "values": [1, 2]}}}`,
+		`{"deviceIds": ["a"], "properties": {"custom_a": {"type": "int", "values": ["1"]}}}`,
+		`{"deviceIds": ["a"], "properties": {"custom_a": {"type": "int", "values": [1], "missing": [1]}}}`,
+		`{"deviceIds": ["a"], "events": {"e": {"counts": [1, 2]}}}`,
+	}
+	for _, snapshotJson := range invalid {
+		if _, err := decodeOfflineSnapshot([]byte(snapshotJson)); err == nil {
+			t.Fatalf("Expected error for snapshot: %v", snapshotJson)
+		}
+	}
+}
+
+func TestOfflineDeviceConditionFunctions(t *testing.T) {
+	s, err := decodeOfflineSnapshot([]byte(testOfflineSnapshotJson))
+	if err != nil {
+		t.Fatal(err)
+	}
+	device := &offlineDevice{snapshot: s}
+	functions := device.conditionFunctions()
+	for name := range datamodel.AllBuiltInDynamicFunctions {
+		if functions[name] == nil {
+			t.Fatalf("Missing offline function %v", name)
+		}
+	}
+
+	eventCount := functions["eventCount"].(func(string) int)
+	eventCountWithLimit := functions["eventCountWithLimit"].(func(string, int) int)
+	latestEventTime := functions["latestEventTime"].(func(string) interface{})
+	propertyEver := functions["propertyEver"].(func(string, interface{}) bool)
+	stableRand := functions["stableRand"].(func() int64)
+
+	rand0 := stableRand()
+	if eventCount("app_start") != 12 || eventCountWithLimit("app_start", 5) != 5 || eventCount("other") != 0 {
+		t.Fatal("Unexpected event counts")
+	}
+	if latestEventTime("app_start") != time.UnixMilli(1710000000000) || !propertyEver("platform", "iOS") || rand0 < 0 {
+		t.Fatal("Unexpected function results")
+	}
+	// Functions read the worker's current row
+	device.row = 2
+	if eventCount("app_start") != 0 || latestEventTime("app_start") != nil || propertyEver("platform", "iOS") {
+		t.Fatal("Expected values for current row")
+	}
+	if stableRand() == rand0 {
+		t.Fatal("Expected stable rand to vary by device")
+	}
+	device.row = 0
+	if stableRand() != rand0 {
+		t.Fatal("Expected stable rand to be stable")
+	}
+}
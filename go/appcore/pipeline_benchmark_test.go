@@ -0,0 +1,325 @@
+package appcore
+
+import (
+	"bufio"
+	"fmt"
+	"os"
+	"path/filepath"
+	"slices"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Pipeline benchmarks
+
+End to end: Start, then SendClientEvent -> persist -> triggers -> conditions -> PerformAction -> LibBindings, and the
+notification plan update, with stand-in lib bindings and property providers. Configs are generated at several sizes,
+and the DB is pre-populated with 90 days of event history, so condition functions like eventCount have realistic
+data to read.
+
+Storage is MemoryDB, so the results measure appcore, not SQLite (see the db package benchmarks for that).
+
+The baseline lives in testdata/pipeline_benchmark_baseline.txt, so changes in performance show up in review. It
+hasn't been recorded yet (the only recording was made without a working condition evaluator, and was discarded):
+record it with `./benchmark_appcore.sh -update` and commit it. TestPipelineBenchmarkBaseline skips until then.
+After that, regenerate on the same machine as the baseline when a change affects performance, and compare with
+`./benchmark_appcore.sh`. Always record with the dependencies in go.mod: the event benchmark fails if no actions are
+performed, as the numbers wouldn't include condition evaluation.
+*/
+
+const pipelineBenchmarkBaselinePath = "testdata/pipeline_benchmark_baseline.txt"
+
+type pipelineBenchmarkSize struct {
+	name     string
+	triggers int
+}
+
+// Each size has as many actions as triggers, half as many named conditions, and a quarter as many notifications
+var pipelineBenchmarkSizes = []pipelineBenchmarkSize{
+	{name: "small", triggers: 10},
+	{name: "medium", triggers: 100},
+	{name: "large", triggers: 1000},
+}
+
+// Benchmarks run for each size, checked against the baseline by TestPipelineBenchmarkBaseline
+var pipelineBenchmarkNames = []string{"BenchmarkPipelineColdStart", "BenchmarkPipelineEvent", "BenchmarkPipelineEventEnqueued"}
+
+// Four triggers per event name
+func pipelineBenchmarkEventCount(size pipelineBenchmarkSize) int {
+	return max(size.triggers/4, 1)
+}
+
+func pipelineBenchmarkConfigJson(size pipelineBenchmarkSize) string {
+	eventCount := pipelineBenchmarkEventCount(size)
+	var conditions, actions, triggers, notifications []string
+	for i := 0; i < size.triggers; i++ {
+		event := i % eventCount
+		actions = append(actions, fmt.Sprintf(`"link%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, i, i))
+		actionName := fmt.Sprintf("link%v", i)
+		// Every 5th trigger performs a conditional action, which checks a condition before the link
+		if i%5 == 0 {
+			actionName = fmt.Sprintf("conditional%v", i)
+			actions = append(actions, fmt.Sprintf(`"%v": {"actionType": "conditional_action", "actionData": {"condition": "eventCount('e%v') %% 2 == 0", "passedActionName": "link%v"}}`, actionName, event, i))
+		}
+		triggers = append(triggers, fmt.Sprintf(`"trigger%v": {"eventName": "e%v", "actionName": "%v", "condition": "platform == 'iOS' && device_battery_level > 0.2 && eventCount('e%v') %% 3 != 0"}`, i, event, actionName, event))
+		if i%2 == 0 {
+			conditions = append(conditions, fmt.Sprintf(`"condition%v": "network_connection_type == 'wifi' || eventCountSince('e%v', 86400) > 2"`, i, event))
+		}
+		if i%4 == 0 {
+			notifications = append(notifications, fmt.Sprintf(`"n%v": {"title": "t", "cancelationEvents": ["c%v"], "deliveryTime": {"eventName": "e%v", "eventOffsetSeconds": 3600}, "scheduleCondition": "app_version != '0.0.1'"}`, i, event, event))
+		}
+	}
+	return fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"conditions": {"namedConditions": {%v}},
+		"actions": {"namedActions": {%v}},
+		"triggers": {"namedTriggers": {%v}},
+		"notifications": {%v}}`,
+		strings.Join(conditions, ","), strings.Join(actions, ","), strings.Join(triggers, ","), strings.Join(notifications, ","))
+}
+
+// Stand-in for a native property provider. Returns a fixed value, without bridge latency.
+type benchmarkLibPropertyProvider struct {
+	providerType int
+	value        string
+	floatValue   float64
+	intValue     int64
+}
+
+func (p *benchmarkLibPropertyProvider) Type() int {
+	return p.providerType
+}
+func (p *benchmarkLibPropertyProvider) IntValue() int64 {
+	return p.intValue
+}
+func (p *benchmarkLibPropertyProvider) StringValue() string {
+	return p.value
+}
+func (p *benchmarkLibPropertyProvider) FloatValue() float64 {
+	return p.floatValue
+}
+func (p *benchmarkLibPropertyProvider) TimeEpochMilliseconds() int64 {
+	return 0
+}
+func (p *benchmarkLibPropertyProvider) BoolValue() bool {
+	return false
+}
+
+func pipelineBenchmarkWriteConfig(b testing.TB, size pipelineBenchmarkSize) string {
+	configPath := filepath.Join(b.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(pipelineBenchmarkConfigJson(size)), 0644); err != nil {
+		b.Fatal(err)
+	}
+	return configPath
+}
+
+// An appcore with a pre-populated DB, and stand-in bindings and properties. Not started.
+func pipelineBenchmarkBuildAppcore(b testing.TB, size pipelineBenchmarkSize, configPath string) (*Appcore, *testConcurrentLibBindings) {
+	storage := db.NewMemoryDB()
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, storage, b)
+	if err != nil {
+		b.Fatal(err)
+	}
+	lb := &testConcurrentLibBindings{}
+	ac.RegisterLibraryBindings(lb)
+
+	// 90 days of history: 10 events per event name per day
+	historyStart := time.Now().Add(-90 * 24 * time.Hour)
+	eventCount := pipelineBenchmarkEventCount(size)
+	for i := 0; i < 90*10; i++ {
+		eventTime := historyStart.Add(time.Duration(i) * 24 * time.Hour / 10)
+		storage.SetClock(func() time.Time { return eventTime })
+		for e := 0; e < eventCount; e++ {
+			if err := storage.InsertEvent(&datamodel.Event{Name: fmt.Sprintf("e%v", e), EventType: datamodel.EventTypeCustom}); err != nil {
+				b.Fatal(err)
+			}
+		}
+	}
+	storage.SetClock(nil)
+
+	builtInTypes := datamodel.BuiltInPropertyTypes()
+	ac.propertyRegistry.builtInPropertyTypes = buildTestBuiltInProps(map[string]*datamodel.CMPropertyConfig{
+		"platform":                builtInTypes["platform"],
+		"app_version":             builtInTypes["app_version"],
+		"device_battery_level":    builtInTypes["device_battery_level"],
+		"network_connection_type": builtInTypes["network_connection_type"],
+	})
+	err = ac.RegisterStaticStringProperty("platform", "iOS")
+	if err == nil {
+		err = ac.RegisterStaticStringProperty("app_version", "1.2.3")
+	}
+	if err == nil {
+		err = ac.RegisterLibPropertyProvider("device_battery_level", &benchmarkLibPropertyProvider{providerType: LibPropertyProviderTypeFloat, floatValue: 0.8})
+	}
+	if err == nil {
+		err = ac.RegisterLibPropertyProvider("network_connection_type", &benchmarkLibPropertyProvider{providerType: LibPropertyProviderTypeString, value: "wifi"})
+	}
+	if err != nil {
+		b.Fatal(err)
+	}
+	return ac, lb
+}
+
+func pipelineBenchmarkStartedAppcore(b testing.TB, size pipelineBenchmarkSize) (*Appcore, *testConcurrentLibBindings) {
+	ac, lb := pipelineBenchmarkBuildAppcore(b, size, pipelineBenchmarkWriteConfig(b, size))
+	if err := ac.Start(true); err != nil {
+		b.Fatal(err)
+	}
+	return ac, lb
+}
+
+// Ends the queue's stage goroutines, which otherwise keep the appcore (and its DB) alive. Nothing can be sent after.
+func testStopEventQueue(tb testing.TB, ac *Appcore) {
+	if err := ac.FlushEvents(); err != nil {
+		tb.Fatal(err)
+	}
+	if err := ac.eventQueue.close(); err != nil {
+		tb.Fatal(err)
+	}
+}
+
+// Cycles through the event names with triggers, with every 4th event one nothing listens for
+func pipelineBenchmarkEventName(size pipelineBenchmarkSize, i int) string {
+	if i%4 == 3 {
+		return "unlistened"
+	}
+	return fmt.Sprintf("e%v", i%pipelineBenchmarkEventCount(size))
+}
+
+// Start through the first app_start event, with the config loaded from disk
+func BenchmarkPipelineColdStart(b *testing.B) {
+	for _, size := range pipelineBenchmarkSizes {
+		b.Run(size.name, func(b *testing.B) {
+			configPath := pipelineBenchmarkWriteConfig(b, size)
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				b.StopTimer()
+				ac, _ := pipelineBenchmarkBuildAppcore(b, size, configPath)
+				b.StartTimer()
+				if err := ac.Start(true); err != nil {
+					b.Fatal(err)
+				}
+				b.StopTimer()
+				testStopEventQueue(b, ac)
+				b.StartTimer()
+			}
+		})
+	}
+}
+
+// Synchronous SendClientEvent, through all stages. Reports latency percentiles and throughput.
+func BenchmarkPipelineEvent(b *testing.B) {
+	for _, size := range pipelineBenchmarkSizes {
+		b.Run(size.name, func(b *testing.B) {
+			ac, lb := pipelineBenchmarkStartedAppcore(b, size)
+			latencies := make([]time.Duration, 0, b.N)
+			linksBefore := lb.links.Load()
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				start := time.Now()
+				if err := ac.SendClientEvent(pipelineBenchmarkEventName(size, i)); err != nil {
+					b.Fatal(err)
+				}
+				latencies = append(latencies, time.Since(start))
+			}
+			b.StopTimer()
+
+			// Each event name is sent 3+ times, and a trigger condition passes on 2 of every 3 counts
+			if b.N >= 3*pipelineBenchmarkEventCount(size) && lb.links.Load() == linksBefore {
+				b.Fatal("No actions performed: conditions aren't evaluating, so results aren't representative")
+			}
+			slices.Sort(latencies)
+			b.ReportMetric(float64(latencies[len(latencies)/2].Nanoseconds()), "p50-ns")
+			b.ReportMetric(float64(latencies[len(latencies)*99/100].Nanoseconds()), "p99-ns")
+			b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "events/s")
+			b.ReportMetric(float64(lb.links.Load()-linksBefore)/float64(b.N), "actions/op")
+		})
+	}
+}
+
+// Enqueued without waiting, then flushed, so the ingest and notification stages overlap. Throughput only.
+func BenchmarkPipelineEventEnqueued(b *testing.B) {
+	for _, size := range pipelineBenchmarkSizes {
+		b.Run(size.name, func(b *testing.B) {
+			ac, _ := pipelineBenchmarkStartedAppcore(b, size)
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if _, err := ac.EnqueueClientEvent(pipelineBenchmarkEventName(size, i)); err != nil {
+					b.Fatal(err)
+				}
+			}
+			if err := ac.FlushEvents(); err != nil {
+				b.Fatal(err)
+			}
+			b.StopTimer()
+			b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "events/s")
+		})
+	}
+}
+
+// Every benchmark and size has a baseline, so a new or renamed benchmark can't land without one
+func TestPipelineBenchmarkBaseline(t *testing.T) {
+	file, err := os.Open(pipelineBenchmarkBaselinePath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer file.Close()
+
+	baselined := map[string]bool{}
+	scanner := bufio.NewScanner(file)
+	for scanner.Scan() {
+		fields := strings.Fields(scanner.Text())
+		if len(fields) > 0 && strings.HasPrefix(fields[0], "Benchmark") {
+			// Strip the GOMAXPROCS suffix, like "-8"
+			name := fields[0]
+			if i := strings.LastIndex(name, "-"); i > 0 {
+				name = name[:i]
+			}
+			baselined[name] = true
+			if i := slices.Index(fields, "actions/op"); i > 0 && fields[i-1] == "0" {
+				t.Fatalf("Baseline for %v performed no actions, so it didn't measure condition evaluation. Re-record it", name)
+			}
+		}
+	}
+	if err := scanner.Err(); err != nil {
+		t.Fatal(err)
+	}
+	if len(baselined) == 0 {
+		t.Skip("Pipeline benchmark baseline not recorded yet. Record it with ./benchmark_appcore.sh -update, using the dependencies in go.mod")
+	}
+
+	for _, benchmark := range pipelineBenchmarkNames {
+		for _, size := range pipelineBenchmarkSizes {
+			if name := benchmark + "/" + size.name; !baselined[name] {
+				t.Fatalf("No baseline for %v. Run ./benchmark_appcore.sh -update", name)
+			}
+		}
+	}
+}
+
+// Benchmarks only run with -bench, so check the setup works here
+func TestPipelineBenchmarkSetup(t *testing.T) {
+	size := pipelineBenchmarkSizes[0]
+	ac, lb := pipelineBenchmarkStartedAppcore(t, size)
+	for i := 0; i < 8; i++ {
+		if err := ac.SendClientEvent(pipelineBenchmarkEventName(size, i)); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if count, err := ac.db.EventCountByName("e0"); err != nil || count != 90*10+4 {
+		t.Fatalf("Expected pre-populated history, got %v", count)
+	}
+	if len(ac.config().Notifications) == 0 || lb.plans.Load() == 0 {
+		t.Fatal("Expected notifications planned")
+	}
+	if lb.links.Load() == 0 {
+		t.Fatal("Expected actions performed: without them the benchmarks don't measure condition evaluation")
+	}
+}
@@ -4,31 +4,37 @@ import (
 	"fmt"
 	"math"
 	"reflect"
+	"sync/atomic"
 	"time"
 
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
 )
 
 type propertyProvider interface {
-	Value() interface{}
+	Value() datamodel.PropertyValue
 	Kind() reflect.Kind
 }
 
-func typeFromValue(v interface{}) reflect.Kind {
-	return datamodel.CMTypeFromValue(v)
-}
-
 // Set once properties
 type staticPropertyProvider struct {
-	value interface{}
+	value datamodel.PropertyValue
+	// Boxed once, for condition environments
+	boxed interface{}
 }
 
-func (s *staticPropertyProvider) Value() interface{} {
+func newStaticPropertyProvider(value datamodel.PropertyValue) *staticPropertyProvider {
+	return &staticPropertyProvider{
+		value: value,
+		boxed: value.Interface(),
+	}
+}
+
+func (s *staticPropertyProvider) Value() datamodel.PropertyValue {
 	return s.value
 }
 
 func (s *staticPropertyProvider) Kind() reflect.Kind {
-	return typeFromValue(s.value)
+	return s.value.Kind()
 }
 
 // Nil/pointers not a native type for go-bind, so define constants for nil values.
@@ -64,39 +70,70 @@ func newLibPropertyProviderWrapper(dpp LibPropertyProvider) *dynamicPropertyProv
 
 type dynamicPropertyProviderWrapper struct {
 	propertyProvider LibPropertyProvider
+	instrumentation  *instrumentation
+	// Values read are recorded when recording a trace
+	key   string
+	trace *atomic.Pointer[traceRecorder]
+	// The last value boxed for condition environments
+	lastBoxed atomic.Pointer[boxedPropertyValue]
+}
+
+type boxedPropertyValue struct {
+	value datamodel.PropertyValue
+	boxed interface{}
+}
+
+// The value boxed for a condition environment. Lib values rarely change between reads, so the box is reused while
+// the value is unchanged, instead of allocating one per condition evaluation.
+func (d *dynamicPropertyProviderWrapper) conditionValue(v datamodel.PropertyValue) interface{} {
+	if last := d.lastBoxed.Load(); last != nil && last.value == v {
+		return last.boxed
+	}
+	boxed := &boxedPropertyValue{value: v, boxed: v.Interface()}
+	d.lastBoxed.Store(boxed)
+	return boxed.boxed
+}
+
+func (d *dynamicPropertyProviderWrapper) Value() datamodel.PropertyValue {
+	defer d.instrumentation.since(stagePropertyProvider, time.Now())
+	v := d.libValue()
+	if d.trace != nil {
+		d.trace.Load().recordProperty(traceRecordLibPropertyValue, d.key, v)
+	}
+	return v
 }
 
-func (d *dynamicPropertyProviderWrapper) Value() interface{} {
+func (d *dynamicPropertyProviderWrapper) libValue() datamodel.PropertyValue {
 	switch d.propertyProvider.Type() {
 	case LibPropertyProviderTypeBool:
-		return d.propertyProvider.BoolValue()
+		return datamodel.NewBoolPropertyValue(d.propertyProvider.BoolValue())
 	case LibPropertyProviderTypeFloat:
 		v := d.propertyProvider.FloatValue()
 		if v == LibPropertyProviderNilFloatValue {
-			return nil
+			return datamodel.PropertyValue{}
 		}
-		return v
+		return datamodel.NewFloatPropertyValue(v)
 	case LibPropertyProviderTypeInt:
 		v := d.propertyProvider.IntValue()
 		if v == LibPropertyProviderNilIntValue {
-			return nil
+			return datamodel.PropertyValue{}
 		}
-		return v
+		return datamodel.NewIntPropertyValue(v)
 	case LibPropertyProviderTypeString:
 		v := d.propertyProvider.StringValue()
 		if v == LibPropertyProviderNilStringValue {
-			return nil
+			return datamodel.PropertyValue{}
 		}
-		return v
+		return datamodel.NewStringPropertyValue(v)
 	case LibPropertyProviderTypeTime:
 		ems := d.propertyProvider.TimeEpochMilliseconds()
 		if ems == LibPropertyProviderNilIntValue {
-			return nil
+			return datamodel.PropertyValue{}
 		}
-		return time.UnixMilli(ems)
+		return datamodel.NewTimePropertyValue(time.UnixMilli(ems))
 	}
 	fmt.Println("CriticalMoments: Invalid property type!")
-	return nil
+	return datamodel.PropertyValue{}
 }
 
 func (d *dynamicPropertyProviderWrapper) Kind() reflect.Kind {
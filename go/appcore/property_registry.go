@@ -5,6 +5,9 @@ import (
 	"fmt"
 	"reflect"
 	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
 
 	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
 	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
@@ -16,22 +19,43 @@ import (
 const CustomPropertyPrefix = "custom_"
 
 type propertyRegistry struct {
-	providers            map[string]propertyProvider
+	// Registered providers and functions. The published value is never mutated: registration copies it, and swaps
+	// in the copy under registrationLock. Condition evaluation reads it without locking, so can run in parallel.
+	registrationLock sync.Mutex
+	registered       atomic.Pointer[propertyRegistrations]
+
+	// Fixed at creation (tests may replace before use)
 	builtInPropertyTypes map[string]*datamodel.CMPropertyConfig
-	dynamicFunctionNames []string
-	dynamicFunctionOps   []expr.Option
 	mapFunctions         map[string]interface{}
 	mapConstants         map[string]interface{}
 	phm                  *db.PropertyHistoryManager
+	instrumentation      *instrumentation
+	// The Appcore's trace recorder, for recording lib property values. Nil outside an Appcore.
+	trace *atomic.Pointer[traceRecorder]
+
+	// Nil unless condition profiling is enabled. See condition_profiler.go
+	profiler atomic.Pointer[conditionProfiler]
+}
+
+// An immutable set of registered providers and dynamic functions
+type propertyRegistrations struct {
+	providers            map[string]propertyProvider
+	dynamicFunctionNames []string
+	dynamicFunctionOps   []expr.Option
+	// Same order as the names. For wrapping when profiling.
+	dynamicFunctions []*datamodel.ConditionDynamicFunction
 }
 
 func newPropertyRegistry() *propertyRegistry {
 	pr := &propertyRegistry{
-		providers:            make(map[string]propertyProvider),
 		builtInPropertyTypes: datamodel.BuiltInPropertyTypes(),
+	}
+	pr.registered.Store(&propertyRegistrations{
+		providers:            make(map[string]propertyProvider),
 		dynamicFunctionNames: []string{},
 		dynamicFunctionOps:   []expr.Option{},
-	}
+		dynamicFunctions:     []*datamodel.ConditionDynamicFunction{},
+	})
 
 	// register static/map functions
 	pr.mapFunctions = datamodel.StaticConditionHelperFunctions()
@@ -40,11 +64,45 @@ func newPropertyRegistry() *propertyRegistry {
 	return pr
 }
 
+// The current registrations. Callers needing consistency across several lookups should call this once.
+func (pr *propertyRegistry) registrations() *propertyRegistrations {
+	return pr.registered.Load()
+}
+
+// Publishes a modified copy of the current registrations
+func (pr *propertyRegistry) updateRegistrations(update func(r *propertyRegistrations)) {
+	pr.registrationLock.Lock()
+	defer pr.registrationLock.Unlock()
+	current := pr.registered.Load()
+	updated := &propertyRegistrations{
+		providers:            make(map[string]propertyProvider, len(current.providers)+1),
+		dynamicFunctionNames: append([]string{}, current.dynamicFunctionNames...),
+		dynamicFunctionOps:   append([]expr.Option{}, current.dynamicFunctionOps...),
+		dynamicFunctions:     append([]*datamodel.ConditionDynamicFunction{}, current.dynamicFunctions...),
+	}
+	maps.Copy(updated.providers, current.providers)
+	update(updated)
+	pr.registered.Store(updated)
+}
+
+func (pr *propertyRegistry) provider(key string) propertyProvider {
+	return pr.registrations().providers[key]
+}
+
+func (pr *propertyRegistry) setProvider(key string, pp propertyProvider) {
+	pr.updateRegistrations(func(r *propertyRegistrations) {
+		r.providers[key] = pp
+	})
+}
+
 func (pr *propertyRegistry) RegisterDynamicFunctions(newFuncs map[string]*datamodel.ConditionDynamicFunction) error {
-	for k, v := range newFuncs {
-		pr.dynamicFunctionNames = append(pr.dynamicFunctionNames, k)
-		pr.dynamicFunctionOps = append(pr.dynamicFunctionOps, expr.Function(k, v.Function, v.Types...))
-	}
+	pr.updateRegistrations(func(r *propertyRegistrations) {
+		for k, v := range newFuncs {
+			r.dynamicFunctionNames = append(r.dynamicFunctionNames, k)
+			r.dynamicFunctionOps = append(r.dynamicFunctionOps, expr.Function(k, v.Function, v.Types...))
+			r.dynamicFunctions = append(r.dynamicFunctions, v)
+		}
+	})
 	return nil
 }
 
@@ -61,8 +119,7 @@ func (pr *propertyRegistry) addProviderForKey(key string, pp propertyProvider) e
 		return errors.New("invalid property name: " + key)
 	}
 
-	_, hasCurrent := pr.providers[key]
-	if hasCurrent {
+	if pr.provider(key) != nil {
 		fmt.Println("CriticalMoments Warning: Re-registering property provider for key: " + key)
 	}
 
@@ -82,7 +139,7 @@ func (pr *propertyRegistry) addProviderForKey(key string, pp propertyProvider) e
 	// If this changes, should rework this for dynamic custom props or customOnUse
 	if isCustom && pr.phm != nil {
 		val := pp.Value()
-		if val != nil {
+		if !val.IsNil() {
 			pr.phm.CustomPropertySet(key, val)
 		}
 	}
@@ -91,11 +148,11 @@ func (pr *propertyRegistry) addProviderForKey(key string, pp propertyProvider) e
 		return errors.New("Invalid property type for key: " + key)
 	}
 
-	pr.providers[key] = pp
+	pr.setProvider(key, pp)
 	return nil
 }
 
-func (p *propertyRegistry) registerClientProperty(key string, value interface{}) (returnErr error) {
+func (p *propertyRegistry) registerClientProperty(key string, value datamodel.PropertyValue) (returnErr error) {
 	defer func() {
 		// We never intentionally panic in CM, but we want to recover if we do
 		if r := recover(); r != nil {
@@ -112,14 +169,14 @@ func (p *propertyRegistry) registerClientProperty(key string, value interface{})
 		} else if propConfig.Source == datamodel.CMPropertySourceClient {
 			isWellKnown = true
 			// Well known types must be of correct type
-			if typeFromValue(value) != propConfig.Type {
+			if value.Kind() != propConfig.Type {
 				return errors.New("property registered of wrong type (does not match expected type for well known property name): " + key)
 			}
 		}
 	}
 
 	// Nil not supported
-	if value == nil {
+	if value.IsNil() {
 		return errors.New("client cannot register nil property: " + key)
 	}
 
@@ -137,7 +194,7 @@ func (p *propertyRegistry) registerClientPropertiesFromJson(jsonData []byte) err
 	// we process partial results, even if there was an error
 	if ps != nil && ps.values != nil {
 		for k, v := range ps.values {
-			nerr := p.registerClientProperty(k, v)
+			nerr := p.registerClientProperty(k, datamodel.PropertyValueFromInterface(v))
 			err = errors.Join(err, nerr)
 		}
 	}
@@ -146,11 +203,11 @@ func (p *propertyRegistry) registerClientPropertiesFromJson(jsonData []byte) err
 }
 
 // Library
-func (p *propertyRegistry) registerStaticProperty(key string, value interface{}) (returnErr error) {
+func (p *propertyRegistry) registerStaticProperty(key string, value datamodel.PropertyValue) (returnErr error) {
 	return p.registerStaticPropertyWithSource(key, datamodel.CMPropertySourceLib, value)
 }
 
-func (p *propertyRegistry) registerStaticPropertyWithSource(key string, source datamodel.CMPropertySource, value interface{}) (returnErr error) {
+func (p *propertyRegistry) registerStaticPropertyWithSource(key string, source datamodel.CMPropertySource, value datamodel.PropertyValue) (returnErr error) {
 	defer func() {
 		// We never intentionally panic in CM, but we want to recover if we do
 		if r := recover(); r != nil {
@@ -170,10 +227,7 @@ func (p *propertyRegistry) registerStaticPropertyWithSource(key string, source d
 		return errors.New("custom properties must be prefixed with " + CustomPropertyPrefix + ": " + key)
 	}
 
-	s := staticPropertyProvider{
-		value: value,
-	}
-	return p.addProviderForKey(key, &s)
+	return p.addProviderForKey(key, newStaticPropertyProvider(value))
 }
 
 func (p *propertyRegistry) registerLibPropertyProvider(key string, dpp LibPropertyProvider) error {
@@ -184,26 +238,56 @@ func (p *propertyRegistry) registerLibPropertyProvider(key string, dpp LibProper
 	}
 
 	dw := newLibPropertyProviderWrapper(dpp)
+	dw.instrumentation = p.instrumentation
+	dw.key = key
+	dw.trace = p.trace
 	return p.addProviderForKey(key, dw)
 }
 
 var errPropertyNotFound = errors.New("property not found")
 
-func (p *propertyRegistry) propertyValue(key string) (interface{}, error) {
-	v, ok := p.providers[key]
+func (p *propertyRegistry) propertyValue(key string) (datamodel.PropertyValue, error) {
+	return p.propertyValueFromRegistrations(p.registrations(), key)
+}
+
+func providerFromRegistrations(r *propertyRegistrations, key string) propertyProvider {
+	v, ok := r.providers[key]
 	// Allow custom properties to be accessed without the prefix
 	if !ok {
-		v, ok = p.providers[CustomPropertyPrefix+key]
+		v = r.providers[CustomPropertyPrefix+key]
 	}
-	if !ok {
-		return nil, errPropertyNotFound
+	return v
+}
+
+func (p *propertyRegistry) propertyValueFromRegistrations(r *propertyRegistrations, key string) (datamodel.PropertyValue, error) {
+	provider := providerFromRegistrations(r, key)
+	if provider == nil {
+		return datamodel.PropertyValue{}, errPropertyNotFound
 	}
-	value := v.Value()
+	value := provider.Value()
 	p.trackPropertyHistoryForUsage(key, value)
 	return value, nil
 }
 
-func (p *propertyRegistry) trackPropertyHistoryForUsage(key string, value interface{}) {
+// The value boxed for a condition environment. Static values are boxed once, when registered.
+func (p *propertyRegistry) conditionValueFromRegistrations(r *propertyRegistrations, key string) (interface{}, error) {
+	provider := providerFromRegistrations(r, key)
+	if provider == nil {
+		return nil, errPropertyNotFound
+	}
+	if s, ok := provider.(*staticPropertyProvider); ok {
+		p.trackPropertyHistoryForUsage(key, s.value)
+		return s.boxed, nil
+	}
+	value := provider.Value()
+	p.trackPropertyHistoryForUsage(key, value)
+	if lib, ok := provider.(*dynamicPropertyProviderWrapper); ok {
+		return lib.conditionValue(value), nil
+	}
+	return value.Interface(), nil
+}
+
+func (p *propertyRegistry) trackPropertyHistoryForUsage(key string, value datamodel.PropertyValue) {
 	if p.phm == nil {
 		return
 	}
@@ -217,13 +301,16 @@ func (p *propertyRegistry) trackPropertyHistoryForUsage(key string, value interf
 	p.phm.UpdateHistoryForPropertyAccessed(key, value)
 }
 
-func (p *propertyRegistry) buildPropertyMapForCondition(fields *datamodel.ConditionFields) (map[string]interface{}, error) {
+// The trace is nil unless profiling
+func (p *propertyRegistry) buildPropertyMapForCondition(r *propertyRegistrations, fields *datamodel.ConditionFields, trace *conditionTrace) (map[string]interface{}, error) {
 	// Extract only the used variables from the condition. Property evaluation isn't free, so
 	// only evaluate those we need
-	propsEnv := make(map[string]interface{})
+	propsEnv := make(map[string]interface{}, len(fields.Variables))
 	for _, v := range fields.Variables {
 		if _, ok := propsEnv[v]; !ok {
-			pv, err := p.propertyValue(v)
+			fetchStart := time.Now()
+			pv, err := p.conditionValueFromRegistrations(r, v)
+			trace.propertyFetched(v, fetchStart)
 			if err != nil && err != errPropertyNotFound {
 				return nil, err
 			}
@@ -241,8 +328,8 @@ func (p *propertyRegistry) buildPropertyMapForCondition(fields *datamodel.Condit
 
 // Any unrecoginized method should return nil (not the default error)
 // This is because we want to allow for backwards compatibility when newer SDKs add functions (old SDKs shouldn't fail, should return nil)
-func (p *propertyRegistry) nilMethodsForUnknownFunctions(fields *datamodel.ConditionFields) ([]expr.Option, error) {
-	existingFunctions := p.allFunctionNamesRegistered()
+func (p *propertyRegistry) nilMethodsForUnknownFunctions(r *propertyRegistrations, fields *datamodel.ConditionFields) ([]expr.Option, error) {
+	existingFunctions := p.allFunctionNamesRegistered(r)
 	nilFunctions := []expr.Option{}
 	for _, m := range fields.Methods {
 		if !slices.Contains(existingFunctions, m) {
@@ -256,15 +343,21 @@ func (p *propertyRegistry) nilMethodsForUnknownFunctions(fields *datamodel.Condi
 	return nilFunctions, nil
 }
 
-func (p *propertyRegistry) allFunctionNamesRegistered() []string {
+func (p *propertyRegistry) allFunctionNamesRegistered(r *propertyRegistrations) []string {
 	functions := []string{}
 	functions = append(functions, maps.Keys(p.mapFunctions)...)
-	functions = append(functions, p.dynamicFunctionNames...)
+	functions = append(functions, r.dynamicFunctionNames...)
 
 	return functions
 }
 
 func (p *propertyRegistry) evaluateCondition(condition *datamodel.Condition) (returnResult bool, returnErr error) {
+	// Deferred before the recover, so it records the final result
+	var trace *conditionTrace
+	if profiler := p.profiler.Load(); profiler != nil {
+		trace = newConditionTrace()
+		defer profiler.record(condition, trace, time.Now(), &returnResult, &returnErr)
+	}
 	// expr can panic, so catch it and return an error instead
 	defer func() {
 		if r := recover(); r != nil {
@@ -272,6 +365,7 @@ func (p *propertyRegistry) evaluateCondition(condition *datamodel.Condition) (re
 			returnErr = fmt.Errorf("panic in evaluateCondition: %v", r)
 		}
 	}()
+	defer p.instrumentation.since(stageConditionEvaluate, time.Now())
 
 	// Parse the condition, extract variable and method names
 	fields, err := condition.ExtractIdentifiers()
@@ -279,8 +373,11 @@ func (p *propertyRegistry) evaluateCondition(condition *datamodel.Condition) (re
 		return false, err
 	}
 
+	// One set of registrations for the whole evaluation, even if properties are registered concurrently
+	r := p.registrations()
+
 	// Build a map of all properties(variables) used in this condition, and their values
-	envMap, err := p.buildPropertyMapForCondition(fields)
+	envMap, err := p.buildPropertyMapForCondition(r, fields, trace)
 	if err != nil {
 		return false, err
 	}
@@ -292,21 +389,29 @@ func (p *propertyRegistry) evaluateCondition(condition *datamodel.Condition) (re
 	maps.Copy(envMap, p.mapFunctions)
 
 	// Build nil function handlers for any missing functions (backwards compatibility)
-	nilOps, err := p.nilMethodsForUnknownFunctions(fields)
+	nilOps, err := p.nilMethodsForUnknownFunctions(r, fields)
 	if err != nil {
 		return false, err
 	}
 
 	mergedOptions := []expr.Option{}
-	mergedOptions = append(mergedOptions, p.dynamicFunctionOps...)
+	if trace != nil {
+		mergedOptions = append(mergedOptions, trace.dynamicFunctionOps(r)...)
+	} else {
+		mergedOptions = append(mergedOptions, r.dynamicFunctionOps...)
+	}
 	mergedOptions = append(mergedOptions, expr.Env(envMap))
 	mergedOptions = append(mergedOptions, nilOps...)
 
+	compileStart := time.Now()
 	program, err := condition.CompileWithEnv(mergedOptions...)
+	p.instrumentation.since(stageConditionCompile, compileStart)
 	if err != nil {
 		return false, err
 	}
+	runStart := time.Now()
 	result, err := expr.Run(program, envMap)
+	p.instrumentation.since(stageConditionRun, runStart)
 	if err != nil {
 		return false, err
 	}
@@ -327,7 +432,7 @@ func (p *propertyRegistry) validateProperties() error {
 	}
 
 	// validate any others are custom_ prefix
-	for propName := range p.providers {
+	for propName := range p.registrations().providers {
 		_, isBuiltIn := p.builtInPropertyTypes[propName]
 		if !isBuiltIn {
 			if !strings.HasPrefix(propName, CustomPropertyPrefix) {
@@ -340,7 +445,7 @@ func (p *propertyRegistry) validateProperties() error {
 }
 
 func (p *propertyRegistry) validateExpectedProvider(propName string, expectedKind reflect.Kind, allowMissing bool) error {
-	provider, ok := p.providers[propName]
+	provider, ok := p.registrations().providers[propName]
 
 	if !ok && !allowMissing {
 		return fmt.Errorf("missing required property: %v", propName)
@@ -374,7 +479,7 @@ func (pr *propertyRegistry) samplePropertiesForStartup() error {
 		return errors.New("property history manager not set -- not sampling properties for startup")
 	}
 
-	startupProps := map[string]interface{}{}
+	startupProps := map[string]datamodel.PropertyValue{}
 	errSet := []error{}
 
 	for propName, propConfig := range pr.builtInPropertyTypes {
@@ -383,7 +488,7 @@ func (pr *propertyRegistry) samplePropertiesForStartup() error {
 			if err == errPropertyNotFound && propConfig.Optional {
 				// Optional property not found, that's fine
 				continue
-			} else if err != nil || propValue == nil {
+			} else if err != nil || propValue.IsNil() {
 				errSet = append(errSet, err)
 			} else {
 				startupProps[propName] = propValue
@@ -21,7 +21,7 @@ func propertyValueOrNil(pr *propertyRegistry, key string) interface{} {
 	if err != nil {
 		return nil
 	}
-	return v
+	return v.Interface()
 }
 
 func TestPropertyRegistrySetGet(t *testing.T) {
@@ -34,28 +34,28 @@ func TestPropertyRegistrySetGet(t *testing.T) {
 		"e": {Type: datamodel.CMTimeKind, Source: datamodel.CMPropertySourceLib, Optional: true},
 	}
 
-	err := pr.registerStaticProperty("a", "a")
+	err := pr.registerStaticProperty("a", datamodel.NewStringPropertyValue("a"))
 	if err != nil {
 		t.Fatal(err)
 	}
 	if propertyValueOrNil(pr, "a") != "a" {
 		t.Fatal("Property registry failed for string")
 	}
-	err = pr.registerStaticProperty("b", 2)
+	err = pr.registerStaticProperty("b", datamodel.NewIntPropertyValue(2))
 	if err != nil {
 		t.Fatal(err)
 	}
 	if propertyValueOrNil(pr, "b") != 2 {
 		t.Fatal("Property registry failed for int")
 	}
-	err = pr.registerStaticProperty("c", 3.3)
+	err = pr.registerStaticProperty("c", datamodel.NewFloatPropertyValue(3.3))
 	if err != nil {
 		t.Fatal(err)
 	}
 	if propertyValueOrNil(pr, "c") != 3.3 {
 		t.Fatal("Property registry failed for int")
 	}
-	err = pr.registerStaticProperty("d", true)
+	err = pr.registerStaticProperty("d", datamodel.NewBoolPropertyValue(true))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -63,11 +63,11 @@ func TestPropertyRegistrySetGet(t *testing.T) {
 		t.Fatal("Property registry failed for bool")
 	}
 	now := time.Now()
-	err = pr.registerStaticProperty("e", now)
+	err = pr.registerStaticProperty("e", datamodel.NewTimePropertyValue(now))
 	if err != nil {
 		t.Fatal(err)
 	}
-	if propertyValueOrNil(pr, "e").(time.Time) != now {
+	if !propertyValueOrNil(pr, "e").(time.Time).Equal(now) {
 		t.Fatal("Property registry failed for time")
 	}
 }
@@ -78,21 +78,21 @@ func TestPropertyRegistrySetInvalid(t *testing.T) {
 		"a": {Type: reflect.String, Source: datamodel.CMPropertySourceLib, Optional: true},
 		"b": {Type: reflect.Int, Source: datamodel.CMPropertySourceLib, Optional: true},
 	}
-	err := pr.registerStaticProperty("a", 1) // type mismatch from expected
+	err := pr.registerStaticProperty("a", datamodel.NewIntPropertyValue(1)) // type mismatch from expected
 	if err == nil {
 		t.Fatal("Allowed type mismatch")
 	}
 	if propertyValueOrNil(pr, "a") != nil {
 		t.Fatal("Property registry allowed invalid")
 	}
-	err = pr.registerStaticProperty("a", time.Now()) // type mismatch from expected
+	err = pr.registerStaticProperty("a", datamodel.NewTimePropertyValue(time.Now())) // type mismatch from expected
 	if err == nil {
 		t.Fatal("Allowed type mismatch")
 	}
 	if propertyValueOrNil(pr, "a") != nil {
 		t.Fatal("Property registry allowed invalid")
 	}
-	err = pr.registerStaticProperty("a", "aval") // correct type
+	err = pr.registerStaticProperty("a", datamodel.NewStringPropertyValue("aval")) // correct type
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -100,14 +100,14 @@ func TestPropertyRegistrySetInvalid(t *testing.T) {
 		t.Fatal("Failed to set with valid type")
 	}
 
-	err = pr.registerStaticProperty("b", []string{}) // invalid type
+	err = pr.registerStaticProperty("b", datamodel.PropertyValueFromInterface([]string{})) // invalid type
 	if err == nil {
 		t.Fatal("Allowed invalid type")
 	}
 	if propertyValueOrNil(pr, "b") != nil {
 		t.Fatal("Property registry allowed invalid")
 	}
-	err = pr.registerStaticProperty("b", 42) // correct type
+	err = pr.registerStaticProperty("b", datamodel.NewIntPropertyValue(42)) // correct type
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -115,7 +115,7 @@ func TestPropertyRegistrySetInvalid(t *testing.T) {
 		t.Fatal("Failed to set with valid type")
 	}
 
-	err = pr.registerStaticProperty("c", 3.3) // unexpected key
+	err = pr.registerStaticProperty("c", datamodel.NewFloatPropertyValue(3.3)) // unexpected key
 	if err == nil {
 		t.Fatal("Allowed unexpected key")
 	}
@@ -133,11 +133,11 @@ func TestPropertyRegistryValidateRequired(t *testing.T) {
 	if pr.validateProperties() == nil {
 		t.Fatal("Validated missing required properties")
 	}
-	pr.registerStaticProperty("platform", 42)
+	pr.registerStaticProperty("platform", datamodel.NewIntPropertyValue(42))
 	if pr.validateProperties() == nil {
 		t.Fatal("Validated with type mismatch")
 	}
-	pr.registerStaticProperty("platform", "ios")
+	pr.registerStaticProperty("platform", datamodel.NewStringPropertyValue("ios"))
 	if pr.validateProperties() != nil {
 		t.Fatal("Validation failed on valid type")
 	}
@@ -152,11 +152,11 @@ func TestPropertyRegistryValidateOptional(t *testing.T) {
 	if pr.validateProperties() != nil {
 		t.Fatal("Missing optional failed validation")
 	}
-	err := pr.registerStaticProperty("optional_bool", 42)
+	err := pr.registerStaticProperty("optional_bool", datamodel.NewIntPropertyValue(42))
 	if err == nil {
 		t.Fatal("Added with type mismatch")
 	}
-	err = pr.registerStaticProperty("optional_bool", true)
+	err = pr.registerStaticProperty("optional_bool", datamodel.NewBoolPropertyValue(true))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -203,7 +203,7 @@ func TestPropertyRegistryVersionNumberComponent(t *testing.T) {
 	}
 
 	// Valid string -- saves and able to parse components with function
-	if err := pr.registerStaticProperty("os_version", "1.2.3"); err != nil {
+	if err := pr.registerStaticProperty("os_version", datamodel.NewStringPropertyValue("1.2.3")); err != nil {
 		t.Fatal("Valid version number failed to save")
 	}
 	if propertyValueOrNil(pr, "os_version") != "1.2.3" {
@@ -226,7 +226,7 @@ func TestPropertyRegistryVersionNumberComponent(t *testing.T) {
 	}
 
 	// Invalid version string
-	if err := pr.registerStaticProperty("app_version", "1.b.3"); err != nil {
+	if err := pr.registerStaticProperty("app_version", datamodel.NewStringPropertyValue("1.b.3")); err != nil {
 		t.Fatal("Invalid version number failed to save. Should still save as string for exact comparison")
 	}
 	if propertyValueOrNil(pr, "app_version") != "1.b.3" {
@@ -285,15 +285,23 @@ func TestDynamicProperties(t *testing.T) {
 	if err != nil {
 		t.Fatal(err)
 	}
-	if propertyValueOrNil(pr, "screen_width_pixels").(int64) != 1 {
+	if propertyValueOrNil(pr, "screen_width_pixels").(int) != 1 {
 		t.Fatal("dynamic property doesn't work")
 	}
-	if propertyValueOrNil(pr, "screen_width_pixels").(int64) != 2 {
+	if propertyValueOrNil(pr, "screen_width_pixels").(int) != 2 {
 		t.Fatal("dynamic property not dynamic")
 	}
-	if propertyValueOrNil(pr, "screen_width_pixels").(int64) != 3 {
+	if propertyValueOrNil(pr, "screen_width_pixels").(int) != 3 {
 		t.Fatal("dynamic property not dynamic")
 	}
+	// Boxed values for conditions are reused only while the value is unchanged
+	fields := &datamodel.ConditionFields{Variables: []string{"screen_width_pixels"}}
+	for _, expected := range []int{4, 5} {
+		env, err := pr.buildPropertyMapForCondition(pr.registrations(), fields, nil)
+		if err != nil || env["screen_width_pixels"] != expected {
+			t.Fatal("dynamic property stale in condition env")
+		}
+	}
 }
 
 func TestPropertyRegistryConditionEval(t *testing.T) {
@@ -305,9 +313,9 @@ func TestPropertyRegistryConditionEval(t *testing.T) {
 		"test_time":           {Type: datamodel.CMTimeKind, Source: datamodel.CMPropertySourceLib, Optional: true}, // populated date
 	}
 
-	pr.registerStaticProperty("app_version", "hello")
-	pr.registerStaticProperty("screen_width_pixels", 42)
-	pr.registerStaticProperty("test_time", time.UnixMilli(testTimestampUnixMilli))
+	pr.registerStaticProperty("app_version", datamodel.NewStringPropertyValue("hello"))
+	pr.registerStaticProperty("screen_width_pixels", datamodel.NewIntPropertyValue(42))
+	pr.registerStaticProperty("test_time", datamodel.NewTimePropertyValue(time.UnixMilli(testTimestampUnixMilli)))
 	if propertyValueOrNil(pr, "app_version") != "hello" {
 		t.Fatal("property not set")
 	}
@@ -509,7 +517,7 @@ func TestDynamicMethods(t *testing.T) {
 	pr.builtInPropertyTypes = map[string]*datamodel.CMPropertyConfig{
 		"platform": {Type: reflect.String, Source: datamodel.CMPropertySourceLib, Optional: false},
 	}
-	pr.registerStaticProperty("platform", "ios")
+	pr.registerStaticProperty("platform", datamodel.NewStringPropertyValue("ios"))
 	pr.RegisterDynamicFunctions(map[string]*datamodel.ConditionDynamicFunction{
 		"testFunc": {
 			Function: func(params ...any) (any, error) {
@@ -616,19 +624,19 @@ func TestCustomProperties(t *testing.T) {
 	}
 
 	// Test a custom properties with correct prefix
-	err := pr.registerStaticPropertyWithSource("custom_stringv", datamodel.CMPropertySourceClient, "hello")
+	err := pr.registerStaticPropertyWithSource("custom_stringv", datamodel.CMPropertySourceClient, datamodel.NewStringPropertyValue("hello"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticPropertyWithSource("custom_boolv", datamodel.CMPropertySourceClient, false)
+	err = pr.registerStaticPropertyWithSource("custom_boolv", datamodel.CMPropertySourceClient, datamodel.NewBoolPropertyValue(false))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticPropertyWithSource("custom_intv", datamodel.CMPropertySourceClient, 42)
+	err = pr.registerStaticPropertyWithSource("custom_intv", datamodel.CMPropertySourceClient, datamodel.NewIntPropertyValue(42))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticPropertyWithSource("custom_floatv", datamodel.CMPropertySourceClient, 3.3)
+	err = pr.registerStaticPropertyWithSource("custom_floatv", datamodel.CMPropertySourceClient, datamodel.NewFloatPropertyValue(3.3))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -644,13 +652,13 @@ func TestCustomProperties(t *testing.T) {
 	}
 
 	// test without prefix
-	err = pr.registerStaticProperty("no_prefix_v", "hello")
+	err = pr.registerStaticProperty("no_prefix_v", datamodel.NewStringPropertyValue("hello"))
 	if err == nil {
 		t.Fatal("Allowed custom property without prefix")
 	}
 
 	// Test an invalid type property (float32)
-	err = pr.registerStaticProperty("custom_float32v", float32(3.3))
+	err = pr.registerStaticProperty("custom_float32v", datamodel.PropertyValueFromInterface(float32(3.3)))
 	if err == nil {
 		t.Fatal("Allowed custom property with invalid type")
 	}
@@ -674,17 +682,15 @@ func TestValidateCustomPrefix(t *testing.T) {
 		t.Fatal(err)
 	}
 
-	s := staticPropertyProvider{
-		value: 42,
-	}
+	s := newStaticPropertyProvider(datamodel.NewIntPropertyValue(42))
 
-	pr.providers["custom_stringv"] = &s
+	pr.setProvider("custom_stringv", s)
 	err = pr.validateProperties()
 	if err != nil {
 		t.Fatal(err)
 	}
 
-	pr.providers["not_custom_stringv"] = &s
+	pr.setProvider("not_custom_stringv", s)
 	err = pr.validateProperties()
 	if err == nil {
 		t.Fatal("allowed non custom property")
@@ -700,70 +706,70 @@ func TestClientPropertyRegistration(t *testing.T) {
 	}
 
 	// Should not allow registering well known with wrong type
-	err := pr.registerClientProperty("well_known", 42)
-	if err == nil || pr.providers["well_known"] != nil {
+	err := pr.registerClientProperty("well_known", datamodel.NewIntPropertyValue(42))
+	if err == nil || pr.provider("well_known") != nil {
 		t.Fatal("Allowed registering well known with wrong type")
 	}
 
 	// Should not allow registering built in
-	err = pr.registerClientProperty("built_in", "hello")
-	if err == nil || pr.providers["built_in"] != nil {
+	err = pr.registerClientProperty("built_in", datamodel.NewStringPropertyValue("hello"))
+	if err == nil || pr.provider("built_in") != nil {
 		t.Fatal("Allowed registering built in")
 	}
 
 	// Should not allow registering built in through other API
-	err = pr.registerStaticPropertyWithSource("built_in", datamodel.CMPropertySourceClient, "hello")
-	if err == nil || pr.providers["built_in"] != nil {
+	err = pr.registerStaticPropertyWithSource("built_in", datamodel.CMPropertySourceClient, datamodel.NewStringPropertyValue("hello"))
+	if err == nil || pr.provider("built_in") != nil {
 		t.Fatal("Allowed registering built in")
 	}
 
 	// should be able to register well known with correct type
-	err = pr.registerClientProperty("well_known", "hello")
+	err = pr.registerClientProperty("well_known", datamodel.NewStringPropertyValue("hello"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	if pr.providers["well_known"] == nil {
+	if pr.provider("well_known") == nil {
 		t.Fatal("Failed to register well known without a prefix")
 	}
-	if v, err := pr.propertyValue("well_known"); v != "hello" || err != nil {
+	if v, err := pr.propertyValue("well_known"); v.Interface() != "hello" || err != nil {
 		t.Fatal("Failed to register well known")
 	}
 
 	// should be able to register custom
-	err = pr.registerClientProperty("customv", "hello2")
+	err = pr.registerClientProperty("customv", datamodel.NewStringPropertyValue("hello2"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	if pr.providers["custom_customv"] == nil {
+	if pr.provider("custom_customv") == nil {
 		t.Fatal("Failed to register well known without a prefix")
 	}
-	if pr.providers["customv"] != nil {
+	if pr.provider("customv") != nil {
 		t.Fatal("registered custom without a prefix")
 	}
-	if v, err := pr.propertyValue("customv"); v != "hello2" || err != nil {
+	if v, err := pr.propertyValue("customv"); v.Interface() != "hello2" || err != nil {
 		t.Fatal("Failed to access custom via short hand")
 	}
-	if v, err := pr.propertyValue("custom_customv"); v != "hello2" || err != nil {
+	if v, err := pr.propertyValue("custom_customv"); v.Interface() != "hello2" || err != nil {
 		t.Fatal("Failed to access custom via full name")
 	}
 
 	// should not be able to regsiter nil
-	err = pr.registerClientProperty("well_known2", nil)
-	if err == nil || pr.providers["well_known2"] != nil {
+	err = pr.registerClientProperty("well_known2", datamodel.PropertyValue{})
+	if err == nil || pr.provider("well_known2") != nil {
 		t.Fatal("Allowed nil value")
 	}
 
 	// Library register method should not be able to register non-built in
-	err = pr.registerStaticProperty("customv", "hello3")
+	err = pr.registerStaticProperty("customv", datamodel.NewStringPropertyValue("hello3"))
 	if err == nil {
 		t.Fatal("Allowed library to register custom")
 	}
-	err = pr.registerStaticPropertyWithSource("customv", datamodel.CMPropertySourceLib, "hello3")
+	err = pr.registerStaticPropertyWithSource("customv", datamodel.CMPropertySourceLib, datamodel.NewStringPropertyValue("hello3"))
 	if err == nil {
 		t.Fatal("Allowed library to register custom")
 	}
 	// old value from above, not new one.
-	if v, err := pr.propertyValue("customv"); v != "hello2" || err != nil {
+	if v, err := pr.propertyValue("customv"); v.Interface() != "hello2" || err != nil {
 		t.Fatal("Failed to access custom via full name")
 	}
 }
@@ -782,7 +788,7 @@ func TestDisallowInvalidPropertyNames(t *testing.T) {
 	}
 
 	for _, n := range invalidNames {
-		err := pr.registerClientProperty(n, "hello2")
+		err := pr.registerClientProperty(n, datamodel.NewStringPropertyValue("hello2"))
 		if err == nil {
 			t.Fatal("allowed non alphanumeric property name" + n)
 		}
@@ -816,16 +822,16 @@ func TestClientPropertyJsonRegistration(t *testing.T) {
 		t.Fatal("json registration failed to error on invalid")
 		// but we still expect some to succeed
 	}
-	if v, err := pr.propertyValue("stringKey"); v != "stringVal" || err != nil {
+	if v, err := pr.propertyValue("stringKey"); v.Interface() != "stringVal" || err != nil {
 		t.Fatal("Failed to register json properties")
 	}
-	if v, err := pr.propertyValue("boolKey"); v != true || err != nil {
+	if v, err := pr.propertyValue("boolKey"); v.Interface() != true || err != nil {
 		t.Fatal("Failed to register json properties")
 	}
-	if v, err := pr.propertyValue("intKey"); v != 42.0 || err != nil {
+	if v, err := pr.propertyValue("intKey"); v.Interface() != 42.0 || err != nil {
 		t.Fatal("Failed to register json properties")
 	}
-	if v, err := pr.propertyValue("floatKey"); v != 3.3 || err != nil {
+	if v, err := pr.propertyValue("floatKey"); v.Interface() != 3.3 || err != nil {
 		t.Fatal("Failed to register json properties")
 	}
 	if _, err := pr.propertyValue("invalidKey"); err == nil {
@@ -859,31 +865,31 @@ func TestSetPropertyHistoryOnStartup(t *testing.T) {
 		"date_prop":         {Type: datamodel.CMTimeKind, Source: datamodel.CMPropertySourceLib, Optional: false, SampleType: datamodel.CMPropertySampleTypeAppStart},
 	}
 
-	err := pr.registerStaticProperty("on_start_prop", "onstart")
+	err := pr.registerStaticProperty("on_start_prop", datamodel.NewStringPropertyValue("onstart"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("on_access_prop", "onaccess")
+	err = pr.registerStaticProperty("on_access_prop", datamodel.NewStringPropertyValue("onaccess"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("never_sample_prop", "never")
+	err = pr.registerStaticProperty("never_sample_prop", datamodel.NewStringPropertyValue("never"))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("int_prop", 42)
+	err = pr.registerStaticProperty("int_prop", datamodel.NewIntPropertyValue(42))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("float_prop", 3.3)
+	err = pr.registerStaticProperty("float_prop", datamodel.NewFloatPropertyValue(3.3))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("bool_prop", true)
+	err = pr.registerStaticProperty("bool_prop", datamodel.NewBoolPropertyValue(true))
 	if err != nil {
 		t.Fatal(err)
 	}
-	err = pr.registerStaticProperty("date_prop", time.UnixMilli(testTimestampUnixMilli))
+	err = pr.registerStaticProperty("date_prop", datamodel.NewTimePropertyValue(time.UnixMilli(testTimestampUnixMilli)))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -947,7 +953,7 @@ func TestSetPropertyHistoryOnStartup(t *testing.T) {
 		"date_prop":      time.UnixMilli(testTimestampUnixMilli), // add_test_count
 	}
 	for k, v := range historyChecks {
-		has, err := db.PropertyHistoryEverHadValue(k, v)
+		has, err := db.PropertyHistoryEverHadValue(k, datamodel.PropertyValueFromInterface(v))
 		if err != nil {
 			t.Fatal(err)
 		}
@@ -957,7 +963,7 @@ func TestSetPropertyHistoryOnStartup(t *testing.T) {
 	}
 
 	// Property value it has never had
-	has, err := db.PropertyHistoryEverHadValue("on_start_prop", "asdf")
+	has, err := db.PropertyHistoryEverHadValue("on_start_prop", datamodel.NewStringPropertyValue("asdf"))
 	if err != nil {
 		t.Fatal(err)
 	}
@@ -965,3 +971,88 @@ func TestSetPropertyHistoryOnStartup(t *testing.T) {
 		t.Fatal("Property history check failed for mismatched value")
 	}
 }
+
+// Lib and static properties of each type, for allocation benchmarks (run with -benchmem)
+func testBenchmarkPropertyRegistry(b *testing.B) (*propertyRegistry, []string) {
+	pr := newPropertyRegistry()
+	pr.builtInPropertyTypes = map[string]*datamodel.CMPropertyConfig{
+		"app_version":         {Type: reflect.String, Source: datamodel.CMPropertySourceLib},
+		"battery_level":       {Type: reflect.Float64, Source: datamodel.CMPropertySourceLib},
+		"screen_width_pixels": {Type: reflect.Int, Source: datamodel.CMPropertySourceLib},
+		"device_model":        {Type: reflect.String, Source: datamodel.CMPropertySourceLib},
+		"app_install_date":    {Type: datamodel.CMTimeKind, Source: datamodel.CMPropertySourceLib},
+	}
+	providers := map[string]*benchmarkLibPropertyProvider{
+		"battery_level":       {providerType: LibPropertyProviderTypeFloat, floatValue: 0.75},
+		"screen_width_pixels": {providerType: LibPropertyProviderTypeInt, intValue: 1179},
+		"device_model":        {providerType: LibPropertyProviderTypeString, value: "iPhone15,2"},
+		"app_install_date":    {providerType: LibPropertyProviderTypeTime},
+	}
+	for key, provider := range providers {
+		if err := pr.registerLibPropertyProvider(key, provider); err != nil {
+			b.Fatal(err)
+		}
+	}
+	err := errors.Join(
+		pr.registerStaticProperty("app_version", datamodel.NewStringPropertyValue("1.2.3")),
+		pr.registerClientProperty("plan", datamodel.NewStringPropertyValue("pro")),
+	)
+	if err != nil {
+		b.Fatal(err)
+	}
+	return pr, []string{"app_version", "plan", "battery_level", "screen_width_pixels", "device_model", "app_install_date"}
+}
+
+// Lib values are typed from the provider, and not boxed when read
+func BenchmarkLibPropertyValues(b *testing.B) {
+	pr, keys := testBenchmarkPropertyRegistry(b)
+	keys = keys[2:]
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		for _, key := range keys {
+			if _, err := pr.propertyValue(key); err != nil {
+				b.Fatal(err)
+			}
+		}
+	}
+}
+
+// Static values are boxed once when registered, and lib values once per change. The remaining allocations are the
+// env map, which expr needs per evaluation.
+func BenchmarkConditionPropertyEnv(b *testing.B) {
+	pr, keys := testBenchmarkPropertyRegistry(b)
+	fields := &datamodel.ConditionFields{Variables: keys}
+	r := pr.registrations()
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := pr.buildPropertyMapForCondition(r, fields, nil); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// Every sample is stored: the clock moves past the sampling interval each iteration
+func BenchmarkPropertyHistoryOnUse(b *testing.B) {
+	memDb := db.NewMemoryDB()
+	now := time.UnixMilli(testTimestampUnixMilli)
+	memDb.SetClock(func() time.Time { return now })
+	if err := memDb.StartWithPath(b.TempDir()); err != nil {
+		b.Fatal(err)
+	}
+	phm := memDb.PropertyHistoryManager()
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		now = now.Add(10 * time.Minute)
+		err := errors.Join(
+			phm.UpdateHistoryForPropertyAccessed("screen_width_pixels", datamodel.NewIntPropertyValue(int64(1000+i))),
+			phm.UpdateHistoryForPropertyAccessed("session_start_time", datamodel.NewTimePropertyValue(now)),
+			phm.UpdateHistoryForPropertyAccessed("network_connection_type", datamodel.NewStringPropertyValue("wifi")),
+		)
+		if err != nil {
+			b.Fatal(err)
+		}
+	}
+}
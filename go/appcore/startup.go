@@ -0,0 +1,183 @@
+package appcore
+
+import (
+	"fmt"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+/*
+Staged startup
+
+Start runs as a dependency graph of stages. Each stage runs on its own goroutine once its dependencies are ready, so
+independent stages overlap:
+
+	Stage                Depends on
+	open_db              (started by SetDataDirPath)
+	register_properties
+	load_config          register_properties
+	sample_properties    register_properties, open_db
+	start_events         load_config, sample_properties
+
+ - open_db: opens the DB and runs migrations. Begins in SetDataDirPath, so it also overlaps with anything the app does
+   before Start. DB errors are returned from Start.
+ - register_properties: the built in properties appcore provides, then validates all properties. Cheap; load_config
+   waits on it so an invalid setup fails before any network fetch.
+ - load_config: fetch (possibly network), signature verification and decode.
+ - sample_properties: reads the app start properties (across the native bridge) and writes their history. Non-fatal.
+ - start_events: starts the event queue, sends app_start and builds the notification plan. Nothing reads the DB,
+   config or property history before its dependencies are ready; waiting on a stage orders its writes before the
+   reads.
+
+Each stage has an explicit readiness state (pending, running, ready, failed) and records when it ran, for the
+critical path (startupReport). If a dependency fails, dependent stages fail without running, and Start returns the
+first error in stage order.
+*/
+
+type startupStageState int32
+
+const (
+	startupStagePending startupStageState = iota
+	startupStageRunning
+	startupStageReady
+	startupStageFailed
+)
+
+var startupStageStateNames = map[startupStageState]string{
+	startupStagePending: "pending",
+	startupStageRunning: "running",
+	startupStageReady:   "ready",
+	startupStageFailed:  "failed",
+}
+
+func (s startupStageState) String() string {
+	return startupStageStateNames[s]
+}
+
+type startupStage struct {
+	name string
+	deps []*startupStage
+	run  func() error
+
+	once       sync.Once
+	state      atomic.Int32
+	done       chan struct{}
+	err        error
+	startedAt  time.Time
+	finishedAt time.Time
+}
+
+func newStartupStage(name string, run func() error, deps ...*startupStage) *startupStage {
+	return &startupStage{
+		name: name,
+		deps: deps,
+		run:  run,
+		done: make(chan struct{}),
+	}
+}
+
+func (s *startupStage) State() startupStageState {
+	return startupStageState(s.state.Load())
+}
+
+// Starts the stage on a new goroutine, once its dependencies are ready. No-op if already started.
+func (s *startupStage) start() {
+	s.once.Do(func() {
+		go s.runAfterDeps()
+	})
+}
+
+func (s *startupStage) runAfterDeps() {
+	for _, dep := range s.deps {
+		if err := dep.wait(); err != nil {
+			s.finish(fmt.Errorf("CriticalMoments: startup stage %v not run, %v failed: %w", s.name, dep.name, err))
+			return
+		}
+	}
+
+	s.state.Store(int32(startupStageRunning))
+	s.startedAt = time.Now()
+	s.finish(s.runRecovering())
+}
+
+func (s *startupStage) runRecovering() (returnErr error) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			returnErr = fmt.Errorf("panic in startup stage %v: %v", s.name, r)
+		}
+	}()
+	return s.run()
+}
+
+func (s *startupStage) finish(err error) {
+	s.err = err
+	s.finishedAt = time.Now()
+	if err != nil {
+		s.state.Store(int32(startupStageFailed))
+	} else {
+		s.state.Store(int32(startupStageReady))
+	}
+	close(s.done)
+}
+
+// Blocks until the stage is ready or failed. The stage must have been started.
+func (s *startupStage) wait() error {
+	<-s.done
+	return s.err
+}
+
+// Starts the stages, and waits for all of them. Returns the first error in the order given.
+func runStartupStages(stages ...*startupStage) error {
+	for _, stage := range stages {
+		stage.start()
+	}
+	var errs []error
+	for _, stage := range stages {
+		if err := stage.wait(); err != nil {
+			errs = append(errs, err)
+		}
+	}
+	if len(errs) > 0 {
+		return errs[0]
+	}
+	return nil
+}
+
+// Timing of each startup stage, and the overlap achieved
+type startupReport struct {
+	stages []startupStageTiming
+	// Sum of the stage durations: startup time if run sequentially
+	sequential time.Duration
+	// First stage start to last stage finish
+	wall time.Duration
+}
+
+type startupStageTiming struct {
+	name     string
+	state    startupStageState
+	duration time.Duration
+}
+
+// Only valid after Start returns. Stages which didn't run have no duration.
+func (ac *Appcore) startupReport() *startupReport {
+	report := &startupReport{}
+	var first, last time.Time
+	for _, stage := range ac.startupStages {
+		timing := startupStageTiming{name: stage.name, state: stage.State()}
+		if !stage.startedAt.IsZero() {
+			timing.duration = stage.finishedAt.Sub(stage.startedAt)
+			report.sequential += timing.duration
+			if first.IsZero() || stage.startedAt.Before(first) {
+				first = stage.startedAt
+			}
+			if stage.finishedAt.After(last) {
+				last = stage.finishedAt
+			}
+		}
+		report.stages = append(report.stages, timing)
+	}
+	report.wall = last.Sub(first)
+	return report
+}
@@ -0,0 +1,243 @@
+package appcore
+
+import (
+	"errors"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+func TestStartupStageGraph(t *testing.T) {
+	a := newStartupStage("a", func() error {
+		time.Sleep(5 * time.Millisecond)
+		return nil
+	})
+	b := newStartupStage("b", func() error { return nil }, a)
+	errC := errors.New("c failed")
+	c := newStartupStage("c", func() error { return errC }, b)
+	dRan := false
+	d := newStartupStage("d", func() error {
+		dRan = true
+		return nil
+	}, a, c)
+	e := newStartupStage("e", func() error { panic("e") })
+
+	if a.State() != startupStagePending {
+		t.Fatal("Expected pending before start")
+	}
+	if err := runStartupStages(a, b, c, d, e); err != errC {
+		t.Fatalf("Expected first error in stage order, got %v", err)
+	}
+
+	if b.startedAt.Before(a.finishedAt) {
+		t.Fatal("Stage ran before its dependency was ready")
+	}
+	if a.State() != startupStageReady || b.State() != startupStageReady || c.State() != startupStageFailed {
+		t.Fatal("Unexpected stage states")
+	}
+	if d.State() != startupStageFailed || dRan || !errors.Is(d.wait(), errC) || !d.startedAt.IsZero() {
+		t.Fatal("Expected stage with a failed dependency to fail without running")
+	}
+	if e.State() != startupStageFailed || !strings.Contains(e.wait().Error(), "panic in startup stage e") {
+		t.Fatal("Expected panic recovered as a stage error")
+	}
+	if e.State().String() != "failed" {
+		t.Fatal("Unexpected state name")
+	}
+}
+
+// Opening takes a while, like SQLite migrations on an older install
+type testSlowOpenStorage struct {
+	*db.MemoryDB
+	openLatency time.Duration
+	openErr     error
+	opens       atomic.Int32
+}
+
+func (s *testSlowOpenStorage) StartWithPath(dataDir string) error {
+	s.opens.Add(1)
+	time.Sleep(s.openLatency)
+	if s.openErr != nil {
+		return s.openErr
+	}
+	return s.MemoryDB.StartWithPath(dataDir)
+}
+
+// App start properties, each read across the native bridge
+type testSlowLibPropertyProvider struct {
+	benchmarkLibPropertyProvider
+	latency time.Duration
+}
+
+func (p *testSlowLibPropertyProvider) StringValue() string {
+	time.Sleep(p.latency)
+	return p.value
+}
+
+var testStartupSampledProperties = []string{"os_version", "device_manufacturer", "device_model", "device_model_class",
+	"locale_language_code", "locale_country_code", "locale_currency_code", "user_interface_idiom"}
+
+// Not started, and the data dir isn't set, so the caller controls when the DB opens
+func testBuildSlowStartupAppcore(tb testing.TB, configJson string, storage db.Storage, propertyLatency time.Duration) *Appcore {
+	configPath := filepath.Join(tb.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(configJson), 0644); err != nil {
+		tb.Fatal(err)
+	}
+	ac := buildTestAppCoreWithoutDataDir(configPath, storage, tb)
+	ac.RegisterLibraryBindings(&testConcurrentLibBindings{})
+
+	builtInTypes := datamodel.BuiltInPropertyTypes()
+	sampled := map[string]*datamodel.CMPropertyConfig{}
+	for _, name := range testStartupSampledProperties {
+		sampled[name] = builtInTypes[name]
+	}
+	ac.propertyRegistry.builtInPropertyTypes = buildTestBuiltInProps(sampled)
+	for _, name := range testStartupSampledProperties {
+		provider := &testSlowLibPropertyProvider{latency: propertyLatency}
+		provider.providerType = LibPropertyProviderTypeString
+		provider.value = name
+		if err := ac.RegisterLibPropertyProvider(name, provider); err != nil {
+			tb.Fatal(err)
+		}
+	}
+	return ac
+}
+
+func TestStartupOverlapsStages(t *testing.T) {
+	storage := &testSlowOpenStorage{MemoryDB: db.NewMemoryDB(), openLatency: 30 * time.Millisecond}
+	ac := testBuildSlowStartupAppcore(t, testConcurrencyConfigJson(20), storage, 2*time.Millisecond)
+
+	if err := ac.SetDataDirPath(t.TempDir()); err != nil {
+		t.Fatal(err)
+	}
+	if ac.openDBStage.State() == startupStageReady {
+		t.Fatal("Expected SetDataDirPath to return before the DB opened")
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+
+	report := ac.startupReport()
+	if len(report.stages) != 5 {
+		t.Fatal("Expected 5 startup stages")
+	}
+	for _, stage := range report.stages {
+		if stage.state != startupStageReady {
+			t.Fatalf("Expected %v ready, got %v", stage.name, stage.state)
+		}
+	}
+	stages := map[string]*startupStage{}
+	for _, stage := range ac.startupStages {
+		stages[stage.name] = stage
+	}
+	// Config loads while the DB is opening. Sampling waits for the DB, and events wait for both.
+	if !stages["load_config"].finishedAt.Before(stages["open_db"].finishedAt) {
+		t.Fatal("Expected config loaded while the DB opened")
+	}
+	if stages["sample_properties"].startedAt.Before(stages["open_db"].finishedAt) || stages["start_events"].startedAt.Before(stages["sample_properties"].finishedAt) {
+		t.Fatal("Stage started before its dependencies")
+	}
+	if report.wall >= report.sequential {
+		t.Fatalf("Expected overlap, wall %v, sequential %v", report.wall, report.sequential)
+	}
+
+	// Sampled properties were written once the DB opened
+	if v, err := ac.db.LatestPropertyHistory("os_version"); err != nil || v != "os_version" {
+		t.Fatal("Expected startup property history")
+	}
+	if count, err := ac.db.EventCountByName(datamodel.AppStartBuiltInEvent); err != nil || count != 1 {
+		t.Fatal("Expected app_start event")
+	}
+}
+
+func TestStartupReturnsDBError(t *testing.T) {
+	openErr := errors.New("migration failed")
+	storage := &testSlowOpenStorage{MemoryDB: db.NewMemoryDB(), openErr: openErr}
+	ac := testBuildSlowStartupAppcore(t, testConcurrencyConfigJson(1), storage, 0)
+
+	// DB errors are returned from Start, not SetDataDirPath
+	if err := ac.SetDataDirPath(t.TempDir()); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.Start(true); err != openErr {
+		t.Fatalf("Expected DB error from Start, got %v", err)
+	}
+	if ac.started.Load() {
+		t.Fatal("Expected not started")
+	}
+	states := map[string]startupStageState{}
+	for _, stage := range ac.startupReport().stages {
+		states[stage.name] = stage.state
+	}
+	expected := map[string]startupStageState{
+		"open_db":             startupStageFailed,
+		"register_properties": startupStageReady,
+		"load_config":         startupStageReady,
+		"sample_properties":   startupStageFailed,
+		"start_events":        startupStageFailed,
+	}
+	if !reflect.DeepEqual(states, expected) {
+		t.Fatalf("Unexpected stage states: %v", states)
+	}
+}
+
+func TestSetDataDirPathTwice(t *testing.T) {
+	storage := &testSlowOpenStorage{MemoryDB: db.NewMemoryDB(), openLatency: 2 * time.Millisecond}
+	ac := testBuildSlowStartupAppcore(t, testConcurrencyConfigJson(1), storage, 0)
+
+	if err := ac.SetDataDirPath(t.TempDir()); err != nil {
+		t.Fatal(err)
+	}
+	openDBStage := ac.openDBStage
+	if err := ac.SetDataDirPath(t.TempDir()); err == nil {
+		t.Fatal("Expected error setting the data directory twice")
+	}
+	if ac.openDBStage != openDBStage {
+		t.Fatal("Second SetDataDirPath replaced the DB open stage")
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	if opens := storage.opens.Load(); opens != 1 {
+		t.Fatalf("Expected DB opened once, got %v", opens)
+	}
+}
+
+// SetDataDirPath through Start, with a slow DB open and slow property bridge. Reports the sum of the stage durations
+// (sequential startup) and the critical path.
+func BenchmarkStagedStartup(b *testing.B) {
+	configJson := pipelineBenchmarkConfigJson(pipelineBenchmarkSizes[1])
+	dataDir := b.TempDir()
+	var sequential, wall time.Duration
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		b.StopTimer()
+		storage := &testSlowOpenStorage{MemoryDB: db.NewMemoryDB(), openLatency: 5 * time.Millisecond}
+		ac := testBuildSlowStartupAppcore(b, configJson, storage, 250*time.Microsecond)
+		b.StartTimer()
+
+		if err := ac.SetDataDirPath(dataDir); err != nil {
+			b.Fatal(err)
+		}
+		if err := ac.Start(true); err != nil {
+			b.Fatal(err)
+		}
+
+		b.StopTimer()
+		report := ac.startupReport()
+		sequential += report.sequential
+		wall += report.wall
+		testStopEventQueue(b, ac)
+		b.StartTimer()
+	}
+	b.ReportMetric(float64(sequential.Nanoseconds())/float64(b.N), "sequential-ns")
+	b.ReportMetric(float64(wall.Nanoseconds())/float64(b.N), "critical-path-ns")
+}
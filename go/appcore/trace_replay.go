@@ -0,0 +1,373 @@
+//go:build !ios
+
+package appcore
+
+import (
+	"crypto/sha256"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Trace replay
+
+Feeds a recorded trace (see event_trace.go) into a fresh Appcore, to reproduce a session from the field and
+regression test large traces. The Appcore runs on a virtual clock set to each record's time, with MemoryDB storage
+and stand-in LibBindings, so replay doesn't wait for recorded time to pass and runs far faster than real time.
+
+Each lib property provider is replaced by one returning the values recorded for it, in the order they were read.
+canOpenUrl returns false. The config file is supplied, and must match the version recorded. Plans are delivered
+without debouncing, so each event's plan is observed.
+
+The report lists the actions fired and notification plans produced (deterministic for a trace), along with the
+stage latencies (see instrumentation.go) and the replay speed.
+
+Off device only (see cmd/trace_replay): the file is excluded from iOS builds, so ReplayTrace isn't part of the
+gomobile bound SDK. Recording (StartTraceRecording) is.
+*/
+
+type traceReplayReport struct {
+	Records            int   `json:"records"`
+	Events             int   `json:"events"`
+	BackgroundWorkRuns int   `json:"backgroundWorkRuns"`
+	TraceNanoseconds   int64 `json:"traceNanoseconds"`
+	ReplayNanoseconds  int64 `json:"replayNanoseconds"`
+	// Trace time replayed per unit of real time
+	Speedup           float64              `json:"speedup"`
+	Actions           []*traceReplayAction `json:"actions"`
+	NotificationPlans []*traceReplayPlan   `json:"notificationPlans"`
+	Stages            []*StageLatency      `json:"stages"`
+	// Errors returned by replayed calls, up to maxTraceReplayErrors
+	Errors []string `json:"errors,omitempty"`
+}
+
+type traceReplayAction struct {
+	EpochMilliseconds int64  `json:"epochMilliseconds"`
+	Type              string `json:"type"`
+	Name              string `json:"name,omitempty"`
+}
+
+type traceReplayPlan struct {
+	EpochMilliseconds int64 `json:"epochMilliseconds"`
+	Version           int64 `json:"version"`
+	// Notification ID to scheduled time (epoch milliseconds)
+	Scheduled                       map[string]int64 `json:"scheduled"`
+	Unscheduled                     []string         `json:"unscheduled"`
+	EarliestBgCheckTimeEpochSeconds int64            `json:"earliestBgCheckTimeEpochSeconds"`
+}
+
+const maxTraceReplayErrors = 100
+
+// Stand-in for the lib: records actions and plans, and reports the versions recorded
+type replayLibBindings struct {
+	now        func() time.Time
+	appVersion string
+	cmVersion  string
+	testBuild  bool
+
+	lock    sync.Mutex
+	actions []*traceReplayAction
+	plans   []*traceReplayPlan
+}
+
+func (lb *replayLibBindings) recordAction(actionType string, name string) error {
+	lb.lock.Lock()
+	defer lb.lock.Unlock()
+	lb.actions = append(lb.actions, &traceReplayAction{EpochMilliseconds: lb.now().UnixMilli(), Type: actionType, Name: name})
+	return nil
+}
+
+func (lb *replayLibBindings) SetDefaultTheme(theme *datamodel.Theme) error {
+	return nil
+}
+func (lb *replayLibBindings) SetDefaultThemeByLibaryThemeName(themeName string) error {
+	return nil
+}
+func (lb *replayLibBindings) ShowBanner(banner *datamodel.BannerAction, actionName string) error {
+	return lb.recordAction("banner", actionName)
+}
+func (lb *replayLibBindings) ShowAlert(alert *datamodel.AlertAction, actionName string) error {
+	return lb.recordAction("alert", actionName)
+}
+func (lb *replayLibBindings) ShowLink(link *datamodel.LinkAction) error {
+	return lb.recordAction("link", link.UrlString)
+}
+func (lb *replayLibBindings) ShowReviewPrompt() error {
+	return lb.recordAction("review", "")
+}
+func (lb *replayLibBindings) ShowModal(modal *datamodel.ModalAction, actionName string) error {
+	return lb.recordAction("modal", actionName)
+}
+func (lb *replayLibBindings) UpdateNotificationPlan(plan *NotificationPlan) error {
+	summary := &traceReplayPlan{
+		EpochMilliseconds:               lb.now().UnixMilli(),
+		Version:                         plan.Version,
+		Scheduled:                       make(map[string]int64),
+		Unscheduled:                     []string{},
+		EarliestBgCheckTimeEpochSeconds: plan.EarliestBgCheckTimeEpochSeconds,
+	}
+	for _, sn := range plan.scheduledNotifications {
+		summary.Scheduled[sn.Notification.ID] = sn.ScheduledAtEpochMilliseconds()
+	}
+	for _, n := range plan.unscheduledNotifications {
+		summary.Unscheduled = append(summary.Unscheduled, n.ID)
+	}
+	lb.lock.Lock()
+	defer lb.lock.Unlock()
+	lb.plans = append(lb.plans, summary)
+	return nil
+}
+func (lb *replayLibBindings) CanOpenURL(url string) bool {
+	return false
+}
+func (lb *replayLibBindings) AppVersion() string {
+	return lb.appVersion
+}
+func (lb *replayLibBindings) CMVersion() string {
+	return lb.cmVersion
+}
+func (lb *replayLibBindings) IsTestBuild() bool {
+	return lb.testBuild
+}
+
+// Returns the recorded values in order, then repeats the last
+type replayLibPropertyProvider struct {
+	providerType int
+
+	lock   sync.Mutex
+	values []datamodel.PropertyValue
+	next   int
+}
+
+func (p *replayLibPropertyProvider) nextValue() datamodel.PropertyValue {
+	p.lock.Lock()
+	defer p.lock.Unlock()
+	if len(p.values) == 0 {
+		return datamodel.PropertyValue{}
+	}
+	v := p.values[min(p.next, len(p.values)-1)]
+	p.next++
+	return v
+}
+
+func (p *replayLibPropertyProvider) Type() int {
+	return p.providerType
+}
+func (p *replayLibPropertyProvider) IntValue() int64 {
+	if v := p.nextValue(); v.Kind() == reflect.Int {
+		return v.IntValue()
+	}
+	return LibPropertyProviderNilIntValue
+}
+func (p *replayLibPropertyProvider) StringValue() string {
+	if v := p.nextValue(); v.Kind() == reflect.String {
+		return v.StringValue()
+	}
+	return LibPropertyProviderNilStringValue
+}
+func (p *replayLibPropertyProvider) FloatValue() float64 {
+	if v := p.nextValue(); v.Kind() == reflect.Float64 {
+		return v.FloatValue()
+	}
+	return LibPropertyProviderNilFloatValue
+}
+func (p *replayLibPropertyProvider) TimeEpochMilliseconds() int64 {
+	if v := p.nextValue(); v.Kind() == datamodel.CMTimeKind {
+		return v.TimeValue().UnixMilli()
+	}
+	return LibPropertyProviderNilIntValue
+}
+func (p *replayLibPropertyProvider) BoolValue() bool {
+	return p.nextValue().BoolValue()
+}
+
+type traceReplay struct {
+	records []*traceRecord
+	ac      *Appcore
+	lib     *replayLibBindings
+	dataDir string
+	// Virtual time, unix nanoseconds. Read from the event queue goroutines.
+	now atomic.Int64
+
+	libProviders map[string]*replayLibPropertyProvider
+	report       *traceReplayReport
+}
+
+// Builds the Appcore to replay into. The config must be the version the trace recorded.
+func newTraceReplay(records []*traceRecord, configPath string) (*traceReplay, error) {
+	if len(records) == 0 {
+		return nil, errors.New("CriticalMoments: trace has no records")
+	}
+	configData, err := os.ReadFile(configPath)
+	if err != nil {
+		return nil, err
+	}
+	configHash := fmt.Sprintf("%x", sha256.Sum256(configData))
+	for _, record := range records {
+		if record.kind == traceRecordConfig {
+			if record.name != configHash {
+				return nil, fmt.Errorf("CriticalMoments: trace recorded with config %v, but replay config is %v", record.name, configHash)
+			}
+			break
+		}
+	}
+
+	r := &traceReplay{
+		records:      records,
+		libProviders: make(map[string]*replayLibPropertyProvider),
+		report:       &traceReplayReport{Records: len(records)},
+	}
+	r.now.Store(records[0].at.UnixNano())
+	clock := func() time.Time {
+		return time.Unix(0, r.now.Load())
+	}
+	storage := db.NewMemoryDB()
+	storage.SetClock(clock)
+	r.ac = newAppcoreWithStorage(storage)
+	r.ac.clock = clock
+	r.ac.notificationPlanDebounce = 0
+	r.lib = &replayLibBindings{now: clock}
+
+	absConfigPath, err := filepath.Abs(configPath)
+	if err != nil {
+		return nil, err
+	}
+	if err := r.ac.SetConfigUrl("file://" + absConfigPath); err != nil {
+		return nil, err
+	}
+	r.dataDir, err = os.MkdirTemp("", "cm-trace-replay")
+	if err != nil {
+		return nil, err
+	}
+	if err := r.ac.SetDataDirPath(r.dataDir); err != nil {
+		os.RemoveAll(r.dataDir)
+		return nil, err
+	}
+
+	for _, record := range records {
+		switch record.kind {
+		case traceRecordLibPropertyProvider:
+			if r.libProviders[record.name] == nil {
+				r.libProviders[record.name] = &replayLibPropertyProvider{providerType: int(record.number)}
+			}
+		case traceRecordLibPropertyValue:
+			if p := r.libProviders[record.name]; p != nil {
+				p.values = append(p.values, record.value)
+			}
+		}
+	}
+	return r, nil
+}
+
+func (r *traceReplay) recordError(err error) {
+	if err != nil && len(r.report.Errors) < maxTraceReplayErrors {
+		r.report.Errors = append(r.report.Errors, err.Error())
+	}
+}
+
+// Replays every record, then stops the Appcore. Only fails if Start fails.
+func (r *traceReplay) run() (*traceReplayReport, error) {
+	defer os.RemoveAll(r.dataDir)
+	ac := r.ac
+	replayStart := time.Now()
+	for _, record := range r.records {
+		r.now.Store(record.at.UnixNano())
+		switch record.kind {
+		case traceRecordStart:
+			if err := ac.SetApiKey(record.strings[0], record.strings[1]); err != nil {
+				return nil, err
+			}
+			r.lib.appVersion, r.lib.cmVersion, r.lib.testBuild = record.strings[2], record.strings[3], record.number == 1
+			ac.RegisterLibraryBindings(r.lib)
+			if err := ac.Start(record.flag); err != nil {
+				return nil, err
+			}
+		case traceRecordEvent:
+			r.report.Events++
+			if record.flag {
+				r.recordError(ac.SendBuiltInEvent(record.name))
+			} else {
+				r.recordError(ac.SendClientEvent(record.name))
+			}
+		case traceRecordStaticProperty:
+			r.recordError(ac.propertyRegistry.registerStaticProperty(record.name, record.value))
+		case traceRecordClientProperty:
+			r.recordError(ac.propertyRegistry.registerClientProperty(record.name, record.value))
+		case traceRecordClientPropertiesJson:
+			r.recordError(ac.propertyRegistry.registerClientPropertiesFromJson(record.data))
+		case traceRecordLibPropertyProvider:
+			r.recordError(ac.RegisterLibPropertyProvider(record.name, r.libProviders[record.name]))
+		case traceRecordBackgroundWork:
+			r.report.BackgroundWorkRuns++
+			_, err := ac.PerformBackgroundWork()
+			r.recordError(err)
+		}
+	}
+	if ac.started.Load() {
+		r.recordError(ac.FlushEvents())
+		r.recordError(ac.eventQueue.close())
+	}
+
+	replayTime := time.Since(replayStart)
+	report := r.report
+	report.TraceNanoseconds = r.records[len(r.records)-1].at.Sub(r.records[0].at).Nanoseconds()
+	report.ReplayNanoseconds = replayTime.Nanoseconds()
+	if replayTime > 0 {
+		report.Speedup = float64(report.TraceNanoseconds) / float64(report.ReplayNanoseconds)
+	}
+	r.lib.lock.Lock()
+	report.Actions = append([]*traceReplayAction{}, r.lib.actions...)
+	report.NotificationPlans = append([]*traceReplayPlan{}, r.lib.plans...)
+	r.lib.lock.Unlock()
+	report.Stages = []*StageLatency{}
+	for _, stage := range ac.instrumentation.snapshot().stages {
+		if stage.Count > 0 {
+			report.Stages = append(report.Stages, stage)
+		}
+	}
+	return report, nil
+}
+
+// Replays a trace recorded with StartTraceRecording into a fresh Appcore, with the config file the trace recorded.
+// Returns a JSON report of the actions fired, notification plans produced, and stage latencies.
+func ReplayTrace(tracePath string, configPath string) (returnReport string, returnErr error) {
+	defer func() {
+		// We never intentionally panic in CM, but we want to recover if we do
+		if r := recover(); r != nil {
+			returnReport = ""
+			returnErr = fmt.Errorf("panic in ReplayTrace: %v", r)
+		}
+	}()
+
+	traceData, err := os.ReadFile(tracePath)
+	if err != nil {
+		return "", err
+	}
+	records, err := decodeTrace(traceData)
+	if err != nil {
+		return "", err
+	}
+	replay, err := newTraceReplay(records, configPath)
+	if err != nil {
+		return "", err
+	}
+	report, err := replay.run()
+	if err != nil {
+		return "", err
+	}
+	reportJson, err := json.Marshal(report)
+	if err != nil {
+		return "", err
+	}
+	return string(reportJson), nil
+}
@@ -0,0 +1,208 @@
+//go:build !ios
+
+package appcore
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+const testTraceConfigJson = `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+	"actions": {"namedActions": {"link0": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/0"}}}},
+	"triggers": {"namedTriggers": {"t": {"eventName": "e", "actionName": "link0", "condition": "true"}}},
+	"notifications": {"n": {"title": "t", "deliveryTime": {"eventName": "e", "eventOffsetSeconds": 3600, "eventInstance": "latest"}}}}`
+
+func testTraceBuiltInProps() map[string]*datamodel.CMPropertyConfig {
+	return buildTestBuiltInProps(map[string]*datamodel.CMPropertyConfig{
+		"os_version": datamodel.BuiltInPropertyTypes()["os_version"],
+	})
+}
+
+// Records a session: properties, Start, events over a few hours, and background work
+func testRecordTrace(t *testing.T, configPath string, tracePath string) *testPlanRecordingLibBindings {
+	var now atomic.Int64
+	now.Store(time.Date(2024, time.March, 4, 9, 0, 0, 0, time.UTC).UnixNano())
+	clock := func() time.Time {
+		return time.Unix(0, now.Load())
+	}
+	storage := db.NewMemoryDB()
+	storage.SetClock(clock)
+	ac := buildTestAppCoreWithoutDataDir(configPath, storage, t)
+	ac.clock = clock
+	lib := &testPlanRecordingLibBindings{}
+	ac.RegisterLibraryBindings(lib)
+	ac.propertyRegistry.builtInPropertyTypes = testTraceBuiltInProps()
+	if err := ac.StartTraceRecording(tracePath); err != nil {
+		t.Fatal(err)
+	}
+
+	if err := ac.SetDataDirPath(t.TempDir()); err != nil {
+		t.Fatal(err)
+	}
+	provider := &benchmarkLibPropertyProvider{providerType: LibPropertyProviderTypeString, value: "17.4"}
+	if ac.RegisterLibPropertyProvider("os_version", provider) != nil || ac.RegisterClientStringProperty("plan", "pro") != nil {
+		t.Fatal("Failed to register properties")
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < 3; i++ {
+		now.Add(int64(20 * time.Minute))
+		if err := ac.SendClientEvent("e"); err != nil {
+			t.Fatal(err)
+		}
+	}
+	now.Add(int64(2 * time.Hour))
+	if _, err := ac.PerformBackgroundWork(); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.StopTraceRecording(); err != nil {
+		t.Fatal(err)
+	}
+	if ac.StopTraceRecording() == nil {
+		t.Fatal("Expected error stopping when not recording")
+	}
+	testStopEventQueue(t, ac)
+	return lib
+}
+
+func testReplayTrace(t *testing.T, tracePath string, configPath string) (*traceReplay, *traceReplayReport) {
+	data, err := os.ReadFile(tracePath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	records, err := decodeTrace(data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	replay, err := newTraceReplay(records, configPath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	replay.ac.propertyRegistry.builtInPropertyTypes = testTraceBuiltInProps()
+	report, err := replay.run()
+	if err != nil {
+		t.Fatal(err)
+	}
+	return replay, report
+}
+
+func TestTraceRecordAndReplay(t *testing.T) {
+	dir := t.TempDir()
+	configPath := filepath.Join(dir, "config.json")
+	if err := os.WriteFile(configPath, []byte(testTraceConfigJson), 0644); err != nil {
+		t.Fatal(err)
+	}
+	tracePath := filepath.Join(dir, "session.cmtrace")
+	recorded := testRecordTrace(t, configPath, tracePath)
+
+	replay, report := testReplayTrace(t, tracePath, configPath)
+	if len(report.Errors) > 0 {
+		t.Fatalf("Unexpected replay errors: %v", report.Errors)
+	}
+	if report.Events != 3 || report.BackgroundWorkRuns != 1 || report.TraceNanoseconds != int64(3*time.Hour) {
+		t.Fatalf("Unexpected report: %+v", report)
+	}
+	if len(report.Actions) != 3 || report.Actions[0].Type != "link" || report.Actions[0].Name != "https://criticalmoments.io/0" {
+		t.Fatalf("Expected link action for each event: %+v", report.Actions)
+	}
+	if report.Actions[1].EpochMilliseconds-report.Actions[0].EpochMilliseconds != (20 * time.Minute).Milliseconds() {
+		t.Fatal("Expected actions at the recorded times")
+	}
+	if report.Speedup <= 1 || len(report.Stages) == 0 {
+		t.Fatalf("Expected faster than real time, and stage latencies: %v %v", report.Speedup, len(report.Stages))
+	}
+
+	// Same plans as the recorded session, and the recorded property values
+	if len(report.NotificationPlans) != recorded.planCount() {
+		t.Fatalf("Expected %v plans, got %v", recorded.planCount(), len(report.NotificationPlans))
+	}
+	for i, plan := range report.NotificationPlans {
+		original := recorded.plans[i]
+		if plan.Version != original.Version || plan.EarliestBgCheckTimeEpochSeconds != original.EarliestBgCheckTimeEpochSeconds || len(plan.Scheduled) != original.ScheduledNotificationCount() {
+			t.Fatalf("Plan %v differs from the recorded session", i)
+		}
+	}
+	if v, err := replay.ac.db.LatestPropertyHistory("os_version"); err != nil || v != "17.4" {
+		t.Fatal("Expected recorded lib property value")
+	}
+	if v, err := replay.ac.propertyRegistry.propertyValue("plan"); err != nil || v.Interface() != "pro" {
+		t.Fatal("Expected recorded client property")
+	}
+
+	// Deterministic
+	_, again := testReplayTrace(t, tracePath, configPath)
+	first, _ := json.Marshal([]interface{}{report.Actions, report.NotificationPlans})
+	second, _ := json.Marshal([]interface{}{again.Actions, again.NotificationPlans})
+	if string(first) != string(second) {
+		t.Fatal("Replay isn't deterministic")
+	}
+
+	// Config must match the version recorded
+	otherConfigPath := filepath.Join(dir, "other.json")
+	os.WriteFile(otherConfigPath, []byte(testTraceConfigJson+" "), 0644)
+	if _, err := ReplayTrace(tracePath, otherConfigPath); err == nil {
+		t.Fatal("Expected error for different config")
+	}
+}
+
+// Replays a day long trace with 2000 events
+func BenchmarkTraceReplay(b *testing.B) {
+	dir := b.TempDir()
+	configPath := filepath.Join(dir, "config.json")
+	if err := os.WriteFile(configPath, []byte(testTraceConfigJson), 0644); err != nil {
+		b.Fatal(err)
+	}
+	tracePath := filepath.Join(dir, "day.cmtrace")
+	now := time.Date(2024, time.March, 4, 0, 0, 0, 0, time.UTC)
+	r, err := newTraceRecorder(tracePath, func() time.Time { return now })
+	if err != nil {
+		b.Fatal(err)
+	}
+	r.recordLibPropertyProvider("os_version", LibPropertyProviderTypeString)
+	r.recordProperty(traceRecordLibPropertyValue, "os_version", datamodel.NewStringPropertyValue("17.4"))
+	r.recordStart(true, testApiKey, "io.criticalmoments.demo", &testLibBindings{})
+	for i := 0; i < 2000; i++ {
+		now = now.Add(43 * time.Second)
+		r.recordEvent("e", false)
+		if i%100 == 99 {
+			r.recordBackgroundWork()
+		}
+	}
+	if err := r.close(); err != nil {
+		b.Fatal(err)
+	}
+	data, err := os.ReadFile(tracePath)
+	if err != nil {
+		b.Fatal(err)
+	}
+	records, err := decodeTrace(data)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	var speedup float64
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		replay, err := newTraceReplay(records, configPath)
+		if err != nil {
+			b.Fatal(err)
+		}
+		replay.ac.propertyRegistry.builtInPropertyTypes = testTraceBuiltInProps()
+		report, err := replay.run()
+		if err != nil || len(report.Errors) > 0 || len(report.Actions) != 2000 {
+			b.Fatalf("Replay failed: %v", err)
+		}
+		speedup += report.Speedup
+	}
+	b.ReportMetric(speedup/float64(b.N), "speedup")
+	b.ReportMetric(float64(len(data)), "trace-bytes")
+}
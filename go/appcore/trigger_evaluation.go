@@ -0,0 +1,84 @@
+package appcore
+
+import (
+	"fmt"
+	"sync"
+	"sync/atomic"
+
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+/*
+Parallel trigger evaluation
+
+Events like app_start can have many triggers, and each condition can hit the DB and the native property bridge.
+With SetTriggerEvaluationWorkers, a pool of workers evaluates all the event's trigger conditions concurrently, then
+the passing actions are performed in trigger order (by trigger name), same as serial evaluation.
+
+One difference from serial: all conditions are evaluated before any action is performed, so a condition won't see
+events recorded by an earlier trigger's action (action:X) for the same event.
+
+Events with fewer than minParallelTriggerCount triggers are still evaluated serially. Most events have 0-2
+triggers, and starting the workers costs more than it saves for so few conditions (BenchmarkTriggerEvaluationCounts).
+*/
+
+const minParallelTriggerCount = 4
+
+type triggerConditionResult struct {
+	passed bool
+	err    error
+}
+
+func (ac *Appcore) performActionsForTriggersParallel(config *datamodel.PrimaryConfig, eventName string, triggers []*datamodel.Trigger) error {
+	results := ac.evaluateTriggerConditions(triggers, ac.triggerEvaluationWorkers)
+
+	var lastErr error
+	for i, trigger := range triggers {
+		if results[i].err != nil {
+			// return an error, but don't stop processing
+			lastErr = results[i].err
+			continue
+		}
+		if !results[i].passed {
+			continue
+		}
+		err := ac.performNamedActionWithConfig(config, trigger.ActionName, true)
+		if err != nil {
+			// return an error, but don't stop processing
+			lastErr = fmt.Errorf("CriticalMoments: there was an issue performing action for event \"%v\". Error: %v", eventName, err)
+		}
+	}
+	return lastErr
+}
+
+// Evaluates each trigger's condition (passing if none) with a pool of workers. Results are in trigger order.
+func (ac *Appcore) evaluateTriggerConditions(triggers []*datamodel.Trigger, workers int) []triggerConditionResult {
+	results := make([]triggerConditionResult, len(triggers))
+	workers = min(workers, len(triggers))
+
+	// Workers claim the next unevaluated trigger, and write only their own result index
+	var next atomic.Int64
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for {
+				i := int(next.Add(1)) - 1
+				if i >= len(triggers) {
+					return
+				}
+				condition := triggers[i].Condition
+				if condition == nil {
+					results[i] = triggerConditionResult{passed: true}
+					continue
+				}
+				// evaluateCondition recovers panics, so a worker won't take down the process
+				passed, err := ac.propertyRegistry.evaluateCondition(condition)
+				results[i] = triggerConditionResult{passed: passed, err: err}
+			}
+		}()
+	}
+	wg.Wait()
+	return results
+}
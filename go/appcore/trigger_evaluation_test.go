@@ -0,0 +1,139 @@
+package appcore
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"slices"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore/db"
+	datamodel "github.com/CriticalMoments/CriticalMoments/go/cmcore/data_model"
+)
+
+// Config with count triggers on the "many" event, each performing a link action
+func testManyTriggersConfigJson(count int, condition func(i int) string) string {
+	var actions, triggers []string
+	for i := 0; i < count; i++ {
+		actions = append(actions, fmt.Sprintf(`"link%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, i, i))
+		triggers = append(triggers, fmt.Sprintf(`"trigger%v": {"eventName": "many", "actionName": "link%v", "condition": "%v"}`, i, i, condition(i)))
+	}
+	return fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"actions": {"namedActions": {%v}},
+		"triggers": {"namedTriggers": {%v}}}`,
+		strings.Join(actions, ","), strings.Join(triggers, ","))
+}
+
+func testBuildManyTriggersAppcore(tb testing.TB, config string, workers int, setup func(ac *Appcore)) (*Appcore, *testOrderedLibBindings) {
+	configPath := filepath.Join(tb.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(config), 0644); err != nil {
+		tb.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPathAndStorage(configPath, db.NewMemoryDB(), tb)
+	if err != nil {
+		tb.Fatal(err)
+	}
+	lb := &testOrderedLibBindings{}
+	ac.RegisterLibraryBindings(lb)
+	ac.SetTriggerEvaluationWorkers(workers)
+	if setup != nil {
+		setup(ac)
+	}
+	if err := ac.Start(true); err != nil {
+		tb.Fatal(err)
+	}
+	return ac, lb
+}
+
+func TestParallelTriggerEvaluationMatchesSerialOrder(t *testing.T) {
+	config := testManyTriggersConfigJson(30, func(i int) string {
+		if i%3 == 0 {
+			return "false"
+		}
+		return "true"
+	})
+
+	var results [][]string
+	for _, workers := range []int{0, 4, 64} {
+		ac, lb := testBuildManyTriggersAppcore(t, config, workers, nil)
+		if err := ac.SendClientEvent("many"); err != nil {
+			t.Fatal(err)
+		}
+		results = append(results, lb.links)
+	}
+
+	// Performed in trigger name order, skipping failed conditions
+	var names []string
+	for i := 0; i < 30; i++ {
+		if i%3 != 0 {
+			names = append(names, fmt.Sprintf("trigger%v", i))
+		}
+	}
+	slices.Sort(names)
+	var expected []string
+	for _, name := range names {
+		expected = append(expected, "https://criticalmoments.io/"+strings.TrimPrefix(name, "trigger"))
+	}
+	for _, links := range results {
+		if !slices.Equal(links, expected) {
+			t.Fatalf("Expected actions in trigger order\n%v\n%v", expected, links)
+		}
+	}
+}
+
+// Custom property with the latency of a call across the native bridge
+type testSlowPropertyProvider struct {
+	latency time.Duration
+}
+
+func (p *testSlowPropertyProvider) Value() datamodel.PropertyValue {
+	time.Sleep(p.latency)
+	return datamodel.NewIntPropertyValue(1)
+}
+func (p *testSlowPropertyProvider) Kind() reflect.Kind {
+	return reflect.Int
+}
+
+// Latency for one event with 200 triggers, each condition reading a slow property and the event history
+func BenchmarkTriggerEvaluation200(b *testing.B) {
+	config := testManyTriggersConfigJson(200, func(i int) string {
+		return fmt.Sprintf("custom_slow%v > 0 && eventCount('app_start') > 0", i%10)
+	})
+	for _, workers := range []int{0, 4, 16} {
+		b.Run(fmt.Sprintf("workers-%v", workers), func(b *testing.B) {
+			ac, _ := testBuildManyTriggersAppcore(b, config, workers, func(ac *Appcore) {
+				for i := 0; i < 10; i++ {
+					if err := ac.propertyRegistry.addProviderForKey(fmt.Sprintf("custom_slow%v", i), &testSlowPropertyProvider{latency: 100 * time.Microsecond}); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				ac.performActionsForEvent("many")
+			}
+		})
+	}
+}
+
+// Overhead of the worker pool against serial evaluation by trigger count, with cheap conditions (no actions pass).
+// Small counts are the common case: most events have 0-2 triggers.
+func BenchmarkTriggerEvaluationCounts(b *testing.B) {
+	for _, count := range []int{0, 1, 2, 3, 4, 8, 32, 200} {
+		config := testManyTriggersConfigJson(count, func(i int) string { return "false" })
+		for _, workers := range []int{0, 4} {
+			b.Run(fmt.Sprintf("triggers-%v/workers-%v", count, workers), func(b *testing.B) {
+				ac, _ := testBuildManyTriggersAppcore(b, config, workers, nil)
+				b.ReportAllocs()
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					ac.performActionsForEvent("many")
+				}
+			})
+		}
+	}
+}
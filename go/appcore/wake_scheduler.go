@@ -0,0 +1,117 @@
+package appcore
+
+import (
+	"container/heap"
+	"time"
+)
+
+/*
+Wake scheduler
+
+Time driven work registers a wakeup: the next time its result could change without an event. For notifications,
+that's the ideal delivery window check (bgCheckTimeForIdealDeliveryWindow), which is already aligned to the
+delivery window (time of day, day of week) boundaries. Background work only re-plans notifications with due
+wakeups (see generateNotificationPlanForDueWakeups), and the earliest remaining wakeup (next) is when to run next.
+
+Other notifications don't register wakeups:
+  - Delivery window boundaries: outside ideal delivery, shifting into the window is a function of the base delivery
+    time alone, so crossing a boundary doesn't change the plan.
+  - Static timestamps: the OS delivers the notification at its time. The only change afterwards is dropping it from
+    the plan, which every plan (including background work) checks against the timestamp, so there's nothing to wake
+    for.
+  - Schedule conditions: they can read any state, so they are re-evaluated on every plan instead.
+
+Wakeups are keyed (by notification ID), one per key: scheduling again replaces the earlier wakeup. A min-heap
+ordered by time, so scheduling, canceling and popping are O(log n). Not thread safe; the planner's scheduler is
+guarded by notificationLock.
+*/
+
+type wakeScheduler struct {
+	wakeups wakeupHeap
+	byKey   map[string]*scheduledWakeup
+}
+
+type scheduledWakeup struct {
+	key   string
+	at    time.Time
+	index int
+}
+
+func newWakeScheduler() *wakeScheduler {
+	return &wakeScheduler{
+		byKey: make(map[string]*scheduledWakeup),
+	}
+}
+
+// Schedules a wakeup for key, replacing any existing one. A nil time cancels it.
+func (s *wakeScheduler) schedule(key string, at *time.Time) {
+	if at == nil {
+		s.cancel(key)
+		return
+	}
+	if existing := s.byKey[key]; existing != nil {
+		existing.at = *at
+		heap.Fix(&s.wakeups, existing.index)
+		return
+	}
+	wakeup := &scheduledWakeup{key: key, at: *at}
+	s.byKey[key] = wakeup
+	heap.Push(&s.wakeups, wakeup)
+}
+
+func (s *wakeScheduler) cancel(key string) {
+	existing := s.byKey[key]
+	if existing == nil {
+		return
+	}
+	heap.Remove(&s.wakeups, existing.index)
+	delete(s.byKey, key)
+}
+
+// Removes and returns the keys of wakeups at or before now, in time order
+func (s *wakeScheduler) popDue(now time.Time) []string {
+	var due []string
+	for len(s.wakeups) > 0 && !s.wakeups[0].at.After(now) {
+		wakeup := heap.Pop(&s.wakeups).(*scheduledWakeup)
+		delete(s.byKey, wakeup.key)
+		due = append(due, wakeup.key)
+	}
+	return due
+}
+
+// The earliest scheduled wakeup, or nil if none
+func (s *wakeScheduler) next() *time.Time {
+	if len(s.wakeups) == 0 {
+		return nil
+	}
+	next := s.wakeups[0].at
+	return &next
+}
+
+// heap.Interface for wakeups, ordered by time
+type wakeupHeap []*scheduledWakeup
+
+func (h wakeupHeap) Len() int {
+	return len(h)
+}
+func (h wakeupHeap) Less(i, j int) bool {
+	return h[i].at.Before(h[j].at)
+}
+func (h wakeupHeap) Swap(i, j int) {
+	h[i], h[j] = h[j], h[i]
+	h[i].index = i
+	h[j].index = j
+}
+func (h *wakeupHeap) Push(x any) {
+	wakeup := x.(*scheduledWakeup)
+	wakeup.index = len(*h)
+	*h = append(*h, wakeup)
+}
+func (h *wakeupHeap) Pop() any {
+	old := *h
+	n := len(old)
+	wakeup := old[n-1]
+	old[n-1] = nil
+	*h = old[:n-1]
+	return wakeup
+}
@@ -0,0 +1,198 @@
+package appcore
+
+import (
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"slices"
+	"testing"
+	"time"
+)
+
+func TestWakeScheduler(t *testing.T) {
+	s := newWakeScheduler()
+	if s.next() != nil || len(s.popDue(time.Now())) != 0 {
+		t.Fatal("Expected empty scheduler")
+	}
+
+	start := time.Now()
+	at := func(minutes int) *time.Time {
+		t := start.Add(time.Duration(minutes) * time.Minute)
+		return &t
+	}
+	s.schedule("a", at(30))
+	s.schedule("b", at(10))
+	s.schedule("c", at(20))
+	if !s.next().Equal(*at(10)) {
+		t.Fatal("Expected earliest wakeup")
+	}
+
+	// Rescheduling replaces, and nil cancels
+	s.schedule("b", at(40))
+	s.schedule("c", nil)
+	s.cancel("missing")
+	if len(s.byKey) != 2 || !s.next().Equal(*at(30)) {
+		t.Fatal("Expected b rescheduled and c canceled")
+	}
+
+	if due := s.popDue(*at(29)); len(due) != 0 {
+		t.Fatal("Popped wakeup before due")
+	}
+	if due := s.popDue(*at(40)); !slices.Equal(due, []string{"a", "b"}) {
+		t.Fatalf("Expected due wakeups in time order, got %v", due)
+	}
+	if len(s.byKey) != 0 || s.next() != nil {
+		t.Fatal("Expected empty scheduler after popping")
+	}
+}
+
+func TestWakeSchedulerOrderRandomized(t *testing.T) {
+	s := newWakeScheduler()
+	r := rand.New(rand.NewSource(time.Now().UnixNano()))
+	start := time.Now()
+	expected := map[string]time.Time{}
+	for i := 0; i < 2000; i++ {
+		key := fmt.Sprintf("k%v", r.Intn(500))
+		if r.Intn(5) == 0 {
+			s.cancel(key)
+			delete(expected, key)
+			continue
+		}
+		at := start.Add(time.Duration(r.Intn(100_000)) * time.Second)
+		s.schedule(key, &at)
+		expected[key] = at
+	}
+
+	due := s.popDue(start.Add(100_000 * time.Second))
+	if len(due) != len(expected) {
+		t.Fatalf("Expected %v wakeups, got %v", len(expected), len(due))
+	}
+	for i := 1; i < len(due); i++ {
+		if expected[due[i]].Before(expected[due[i-1]]) {
+			t.Fatal("Wakeups out of order")
+		}
+	}
+}
+
+func TestBackgroundWorkOnlyProcessesDueWakeups(t *testing.T) {
+	start := time.Now()
+	config := fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "notifications": {
+		"ideal": {"title": "t", "deliveryTime": {"eventName": "e1", "eventInstance": "first"}, "idealDeliveryConditions": {"condition": "false", "maxWaitTimeSeconds": 86400}},
+		"static": {"title": "t", "deliveryTime": {"timestamp": %v}}
+	}}`, start.Add(time.Hour).Unix())
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(config), 0644); err != nil {
+		t.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ac.PerformBackgroundWork(); err != errAcNotStarted {
+		t.Fatal("Expected background work to fail before start")
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.SendClientEvent("e1"); err != nil {
+		t.Fatal(err)
+	}
+
+	ac.notificationLock.Lock()
+	planned := ac.notificationPlan
+	wakeup := ac.notificationPlanner.wakeups.next()
+	ac.notificationLock.Unlock()
+	if planned.ScheduledNotificationCount() != 2 || wakeup == nil || planned.EarliestBgCheckTimeEpochSeconds != wakeup.Unix() {
+		t.Fatal("Expected ideal window wakeup registered with the plan")
+	}
+
+	// Not due: ideal notification isn't re-planned, so its wakeup doesn't move
+	next, err := ac.performBackgroundWorkForNotifications(wakeup.Add(-time.Minute))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if next != wakeup.Unix() || ac.notificationPlan != planned {
+		t.Fatal("Background work re-planned before wakeup was due")
+	}
+
+	// Due: re-planned, and the next check registered
+	dueAt := wakeup.Add(time.Minute)
+	next, err = ac.performBackgroundWorkForNotifications(dueAt)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if next != dueAt.Add(checkTimeDelay).Unix() || ac.notificationPlan.EarliestBgCheckTimeEpochSeconds != next {
+		t.Fatalf("Expected next wakeup after check delay, got %v", next)
+	}
+	if ac.notificationPlan.ScheduledNotificationCount() != 2 {
+		t.Fatal("Expected both notifications still scheduled")
+	}
+
+	// Notifications without wakeups still drop from the plan once their time passes
+	next, err = ac.performBackgroundWorkForNotifications(start.Add(2 * time.Hour))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if ac.notificationPlan.ScheduledNotificationCount() != 1 || ac.notificationPlan.ScheduledNotificationAtIndex(0).Notification.ID != "ideal" {
+		t.Fatal("Expected passed static notification removed")
+	}
+	if next != start.Add(2*time.Hour).Add(checkTimeDelay).Unix() {
+		t.Fatal("Expected due wakeup re-planned")
+	}
+
+	// Once the window has passed there's nothing left to check
+	next, err = ac.performBackgroundWorkForNotifications(start.Add(48 * time.Hour))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if next != 0 || ac.notificationPlanner.wakeups.next() != nil {
+		t.Fatal("Expected no wakeups after ideal window")
+	}
+}
+
+// The due only plan matches a full recompute when all wakeups are due. Except notifications whose ideal condition
+// passed: they were planned for delivery at that time, with nothing left to check, where a full recompute moves
+// delivery to now.
+func TestBackgroundWorkMatchesFullRecomputeWhenDue(t *testing.T) {
+	start := time.Now()
+	configPath := filepath.Join(t.TempDir(), "config.json")
+	if err := os.WriteFile(configPath, []byte(testPlannerConfigJson(start)), 0644); err != nil {
+		t.Fatal(err)
+	}
+	ac, err := buildTestAppCoreWithPath(configPath, t)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := ac.Start(true); err != nil {
+		t.Fatal(err)
+	}
+	for _, eventName := range []string{"e1", "e2", "e3", "e4"} {
+		if err := ac.SendClientEvent(eventName); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	for _, offset := range []time.Duration{time.Hour, 5 * time.Hour, 30 * time.Hour, 100 * time.Hour} {
+		now := start.Add(offset)
+		ac.notificationLock.Lock()
+		background, err := ac.generateNotificationPlanForDueWakeups(ac.notificationPlanner, now)
+		ac.notificationLock.Unlock()
+		if err != nil {
+			t.Fatal(err)
+		}
+		full, err := ac.generateNotificationPlanForTime(now)
+		if err != nil {
+			t.Fatal(err)
+		}
+		background.scheduledNotifications = slices.DeleteFunc(background.scheduledNotifications, func(sn *ScheduledNotification) bool {
+			return sn.Notification.ID == "ideal"
+		})
+		full.scheduledNotifications = slices.DeleteFunc(full.scheduledNotifications, func(sn *ScheduledNotification) bool {
+			return sn.Notification.ID == "ideal"
+		})
+		if testPlanSummary(background) != testPlanSummary(full) {
+			t.Fatalf("Background plan differs from full recompute at %v:\n%v\n%v", offset, testPlanSummary(background), testPlanSummary(full))
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#!/bin/sh
+
+# Runs the appcore pipeline benchmarks (appcore/pipeline_benchmark_test.go).
+#   ./benchmark_appcore.sh          compare against the checked in baseline (uses benchstat if installed)
+#   ./benchmark_appcore.sh -update  rewrite the baseline, to commit with a change which affects performance
+# Baselines are only comparable on the same machine, so record both on the machine you compare with.
+
+# Set working dir
+dir="$(cd -P -- "$(dirname -- "$0")" && pwd -P)"
+cd $dir
+
+baseline=./appcore/testdata/pipeline_benchmark_baseline.txt
+results=$(mktemp)
+
+go test ./appcore -run '^$' -bench '^BenchmarkPipeline' -benchmem -count 5 > $results
+testSuccess=$?
+cat $results
+if [ $testSuccess -ne 0 ]
+then
+    echo "Benchmarks failed."
+    rm $results
+    exit 1
+fi
+
+if [ "$1" = "-update" ]
+then
+    grep -E '^(goos|goarch|pkg|cpu|Benchmark)' $results > $baseline
+    echo "Baseline updated: $baseline"
+elif command -v benchstat > /dev/null 2>&1
+then
+    benchstat $baseline $results
+else
+    echo "Install benchstat to compare with the baseline: go install golang.org/x/perf/cmd/benchstat@latest"
+    echo "Results: $results"
+    exit 0
+fi
+rm $results
+exit 0
@@ -46,6 +46,13 @@ type ActionContainer struct {
 
 	// Fallback if any issues performing action
 	FallbackActionName string
+
+	// Set if decoding the action data was deferred until first use. See lazy_actions.go
+	lazyData *lazyActionData
+
+	// Name in the config's namedActions, and the events recorded when performed. Set at load. See config_index.go
+	name   string
+	events *ActionEvents
 }
 
 type jsonActionContainer struct {
@@ -97,21 +104,17 @@ func (ac *ActionContainer) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return err
 	}
+	return ac.applyJson(&jac, nil)
+}
 
-	unpacker, ok := actionTypeRegistry[jac.ActionType]
-	var actionData ActionTypeInterface
-	if ok && unpacker != nil {
-		actionData, err = unpacker(jac.RawActionData, ac)
+// Shared by UnmarshalJSON and the streaming config decoder. actionData is the action data if it was already
+// decoded while streaming, otherwise it's unpacked from jac.RawActionData.
+func (ac *ActionContainer) applyJson(jac *jsonActionContainer, actionData ActionTypeInterface) error {
+	if actionData == nil {
+		var err error
+		actionData, err = ac.unpackActionData(jac)
 		if err != nil {
-			return NewUserPresentableErrorWSource(fmt.Sprintf("Issue unpacking actionType \"%v\"", jac.ActionType), err)
-		}
-	} else {
-		// Allow backwards compatibility, defaulting to no-op
-		if StrictDatamodelParsing {
-			typeErr := fmt.Sprintf("Unsupported actionType found in config file: \"%v\"", jac.ActionType)
-			return NewUserPresentableError(typeErr)
-		} else {
-			actionData = &UnknownAction{ActionType: jac.ActionType}
+			return err
 		}
 	}
 
@@ -122,7 +125,29 @@ func (ac *ActionContainer) UnmarshalJSON(data []byte) error {
 	return nil
 }
 
+// Unpacks jac.RawActionData using the registry for the action type. Sets the strongly typed action field on ac.
+func (ac *ActionContainer) unpackActionData(jac *jsonActionContainer) (ActionTypeInterface, error) {
+	unpacker, ok := actionTypeRegistry[jac.ActionType]
+	if ok && unpacker != nil {
+		actionData, err := unpacker(jac.RawActionData, ac)
+		if err != nil {
+			return nil, NewUserPresentableErrorWSource(fmt.Sprintf("Issue unpacking actionType \"%v\"", jac.ActionType), err)
+		}
+		return actionData, nil
+	}
+
+	// Allow backwards compatibility, defaulting to no-op
+	if StrictDatamodelParsing {
+		typeErr := fmt.Sprintf("Unsupported actionType found in config file: \"%v\"", jac.ActionType)
+		return nil, NewUserPresentableError(typeErr)
+	}
+	return &UnknownAction{ActionType: jac.ActionType}, nil
+}
+
 func (ac *ActionContainer) Check() UserPresentableErrorInterface {
+	if err := ac.ensureDecoded(); err != nil {
+		return NewUserPresentableErrorWSource(fmt.Sprintf("actionType '%v' has invalid action data", ac.ActionType), err)
+	}
 	if ac.ActionType == "" {
 		return NewUserPresentableError("Empty actionType not permitted")
 	}
@@ -145,6 +170,9 @@ func (ac *ActionContainer) Check() UserPresentableErrorInterface {
 }
 
 func (ac *ActionContainer) PerformAction(ab ActionBindings, actionName string) error {
+	if err := ac.ensureDecoded(); err != nil {
+		return err
+	}
 	if ac.actionData == nil {
 		return errors.New("attempted to perform action without actionData interface")
 	}
@@ -24,6 +24,10 @@ type ConditionDynamicFunction struct {
 
 type Condition struct {
 	conditionString string
+
+	// Name in the config's namedConditions, and the events recorded when checked. Set at load. See config_index.go
+	name   string
+	events *ConditionEvents
 }
 
 func NewCondition(s string) (*Condition, error) {
@@ -78,6 +82,8 @@ func StaticConditionConstantProperties() map[string]interface{} {
 var AllBuiltInDynamicFunctions = map[string]bool{
 	"eventCount":                 true,
 	"eventCountWithLimit":        true,
+	"eventCountSince":            true,
+	"eventCountInWindow":         true,
 	"latestEventTime":            true,
 	"canOpenUrl":                 true,
 	"propertyHistoryLatestValue": true,
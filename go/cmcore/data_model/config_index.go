@@ -0,0 +1,229 @@
+package datamodel
+
+import (
+	"golang.org/x/exp/maps"
+	"golang.org/x/exp/slices"
+)
+
+/*
+Indexes for lookups on the event path, built once when a config is loaded. Configs are immutable after load, so the
+indexes never need updating.
+
+ - Triggers by event name: dispatching an event is a map lookup, instead of a scan of all triggers. Events with no
+   triggers (including the derived action:* and ff_*:* events) return nil without allocating. Triggers for an event
+   are ordered by trigger name, so dispatch order is deterministic.
+ - Names of actions and conditions: stored on the action/condition, so the name of a performed action or evaluated
+   named condition is found without a reverse scan.
+ - Notifications by event name: the notifications delivered relative to an event, those it cancels, and the
+   notification it records the delivery of. Most events don't affect any notification, and the notification runner
+   can skip them after one map lookup.
+ - Notifications by property name: the properties read by each notification's schedule and ideal delivery conditions.
+   The fields of each schedule condition are kept on the notification, so the notification planner can tell which
+   conditions only read properties that can't change (see notification_planner.go in appcore).
+ - Derived events: the bookkeeping events recorded after performing a named action (action:X, action_error:X) or
+   checking a named condition (ff_true:X, ff_false:X, ff_error:X). Built once, so recording one doesn't format a
+   name, along with whether any trigger or notification listens for it. Most have no listeners, and only need
+   recording.
+*/
+
+// A bookkeeping event, and whether the config has any triggers or notifications for it
+type DerivedEvent struct {
+	Event        *Event
+	HasListeners bool
+}
+
+type ActionEvents struct {
+	Performed DerivedEvent
+	Failed    DerivedEvent
+}
+
+type ConditionEvents struct {
+	True  DerivedEvent
+	False DerivedEvent
+	Error DerivedEvent
+}
+
+// Notifications affected by an event. Each list is ordered by notification ID.
+type notificationEventIndex struct {
+	delivery    []*Notification
+	cancelation []*Notification
+	delivered   *Notification
+}
+
+func (pc *PrimaryConfig) buildIndexes() {
+	triggerNames := maps.Keys(pc.namedTriggers)
+	slices.Sort(triggerNames)
+	pc.triggersByEvent = make(map[string][]*Trigger)
+	for _, name := range triggerNames {
+		trigger := pc.namedTriggers[name]
+		if trigger == nil {
+			continue
+		}
+		pc.triggersByEvent[trigger.EventName] = append(pc.triggersByEvent[trigger.EventName], trigger)
+	}
+
+	for name, action := range pc.namedActions {
+		if action == nil {
+			continue
+		}
+		action.name = name
+		if action.lazyData != nil {
+			action.lazyData.config = pc
+		}
+	}
+	for name, condition := range pc.namedConditions {
+		if condition != nil {
+			condition.name = name
+		}
+	}
+
+	pc.buildNotificationIndexes()
+	pc.buildDerivedEvents()
+}
+
+func (pc *PrimaryConfig) buildNotificationIndexes() {
+	pc.notificationsByEvent = make(map[string]*notificationEventIndex)
+	pc.notificationsByProperty = make(map[string][]*Notification)
+	pc.notificationsWithUnknownProperties = nil
+
+	notificationIDs := maps.Keys(pc.Notifications)
+	slices.Sort(notificationIDs)
+	for _, id := range notificationIDs {
+		notification := pc.Notifications[id]
+		if notification == nil {
+			continue
+		}
+
+		pc.notificationEventIndexForEvent(notification.DeliveredEventName()).delivered = notification
+		if eventName := notification.DeliveryTime.EventName; eventName != nil {
+			index := pc.notificationEventIndexForEvent(*eventName)
+			index.delivery = append(index.delivery, notification)
+		}
+		if notification.CancelationEvents != nil {
+			for _, eventName := range *notification.CancelationEvents {
+				index := pc.notificationEventIndexForEvent(eventName)
+				// Guard against an event listed twice
+				if !slices.Contains(index.cancelation, notification) {
+					index.cancelation = append(index.cancelation, notification)
+				}
+			}
+		}
+
+		properties, err := notification.buildConditionDependencies()
+		if err != nil {
+			pc.notificationsWithUnknownProperties = append(pc.notificationsWithUnknownProperties, notification)
+			continue
+		}
+		for _, property := range properties {
+			pc.notificationsByProperty[property] = append(pc.notificationsByProperty[property], notification)
+		}
+	}
+}
+
+// After the trigger and notification indexes, which determine listeners
+func (pc *PrimaryConfig) buildDerivedEvents() {
+	for name, action := range pc.namedActions {
+		if action != nil {
+			action.events = &ActionEvents{
+				Performed: pc.derivedEvent("action:" + name),
+				Failed:    pc.derivedEvent("action_error:" + name),
+			}
+		}
+	}
+	for name, condition := range pc.namedConditions {
+		if condition != nil {
+			condition.events = &ConditionEvents{
+				True:  pc.derivedEvent("ff_true:" + name),
+				False: pc.derivedEvent("ff_false:" + name),
+				Error: pc.derivedEvent("ff_error:" + name),
+			}
+		}
+	}
+}
+
+func (pc *PrimaryConfig) derivedEvent(eventName string) DerivedEvent {
+	return DerivedEvent{
+		Event:        &Event{Name: eventName, EventType: EventTypeCustom},
+		HasListeners: pc.triggersByEvent[eventName] != nil || pc.notificationsByEvent[eventName] != nil,
+	}
+}
+
+func (pc *PrimaryConfig) notificationEventIndexForEvent(eventName string) *notificationEventIndex {
+	index := pc.notificationsByEvent[eventName]
+	if index == nil {
+		index = &notificationEventIndex{}
+		pc.notificationsByEvent[eventName] = index
+	}
+	return index
+}
+
+// Analyzes the notification's schedule and ideal delivery conditions, keeping the schedule condition's fields. Returns
+// the properties read by either, deduplicated and sorted.
+func (n *Notification) buildConditionDependencies() ([]string, error) {
+	n.scheduleConditionFields = nil
+	properties := map[string]bool{}
+	if n.ScheduleCondition != nil && n.ScheduleCondition.conditionString != "" {
+		fields, err := n.ScheduleCondition.ExtractIdentifiers()
+		if err != nil {
+			return nil, err
+		}
+		n.scheduleConditionFields = fields
+		for _, variable := range fields.Variables {
+			properties[variable] = true
+		}
+	}
+	if n.IdealDeliveryConditions != nil && n.IdealDeliveryConditions.Condition.conditionString != "" {
+		fields, err := n.IdealDeliveryConditions.Condition.ExtractIdentifiers()
+		if err != nil {
+			return nil, err
+		}
+		for _, variable := range fields.Variables {
+			properties[variable] = true
+		}
+	}
+	names := maps.Keys(properties)
+	slices.Sort(names)
+	return names, nil
+}
+
+// The properties and methods read by the schedule condition. Nil if there is no schedule condition, or it couldn't
+// be analyzed. Shared, and must not be modified.
+func (n *Notification) ScheduleConditionFields() *ConditionFields {
+	return n.scheduleConditionFields
+}
+
+// Returns the notifications delivered relative to the event, and those canceled by the event, each ordered by ID.
+// Both are nil if the event doesn't affect any notification. The slices are shared, and must not be modified.
+func (pc *PrimaryConfig) NotificationsForEvent(eventName string) (delivery []*Notification, cancelation []*Notification) {
+	index := pc.notificationsByEvent[eventName]
+	if index == nil {
+		return nil, nil
+	}
+	return index.delivery, index.cancelation
+}
+
+// Returns the notification whose delivery the event records (see Notification.DeliveredEventName), or nil
+func (pc *PrimaryConfig) NotificationForDeliveredEvent(eventName string) *Notification {
+	index := pc.notificationsByEvent[eventName]
+	if index == nil {
+		return nil
+	}
+	return index.delivered
+}
+
+// Returns the notifications with a schedule or ideal delivery condition which reads the property, ordered by ID.
+// Includes notifications whose conditions couldn't be analyzed, as they could read any property.
+func (pc *PrimaryConfig) NotificationsDependingOnProperty(propertyName string) []*Notification {
+	notifications := pc.notificationsByProperty[propertyName]
+	if len(pc.notificationsWithUnknownProperties) == 0 {
+		return notifications
+	}
+	all := append([]*Notification{}, notifications...)
+	for _, notification := range pc.notificationsWithUnknownProperties {
+		if !slices.Contains(all, notification) {
+			all = append(all, notification)
+		}
+	}
+	slices.SortFunc(all, func(a, b *Notification) bool { return a.ID < b.ID })
+	return all
+}
@@ -0,0 +1,253 @@
+package datamodel
+
+import (
+	"fmt"
+	"strings"
+	"testing"
+
+	"golang.org/x/exp/slices"
+)
+
+// Builds a config with triggerCount triggers spread over eventCount events, each with its own action and condition
+func testHelperBuildTriggerConfig(t testing.TB, triggerCount int, eventCount int) *PrimaryConfig {
+	var actions, triggers, conditions []string
+	for i := 0; i < triggerCount; i++ {
+		actions = append(actions, fmt.Sprintf(`"action%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, i, i))
+		triggers = append(triggers, fmt.Sprintf(`"trigger%v": {"eventName": "event%v", "actionName": "action%v"}`, i, i%eventCount, i))
+		conditions = append(conditions, fmt.Sprintf(`"condition%v": "eventCount('event%v') > 1"`, i, i))
+	}
+	config := fmt.Sprintf(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {%v}}, "triggers": {"namedTriggers": {%v}}, "conditions": {"namedConditions": {%v}}}`,
+		strings.Join(actions, ","), strings.Join(triggers, ","), strings.Join(conditions, ","))
+	return testHelperDecodeConfigJson(t, []byte(config), true)
+}
+
+func TestTriggersForEventIndex(t *testing.T) {
+	pc := testHelperBuildTriggerConfig(t, 100, 7)
+
+	total := 0
+	for e := 0; e < 7; e++ {
+		triggers := pc.TriggersForEvent(fmt.Sprintf("event%v", e))
+		total += len(triggers)
+		for i, trigger := range triggers {
+			if trigger.EventName != fmt.Sprintf("event%v", e) {
+				t.Fatal("Trigger indexed under wrong event")
+			}
+			// Ordered by trigger name
+			if i > 0 && testHelperTriggerName(pc, triggers[i-1]) >= testHelperTriggerName(pc, trigger) {
+				t.Fatal("Triggers not in name order")
+			}
+		}
+	}
+	if total != 100 {
+		t.Fatalf("Expected 100 indexed triggers, got %v", total)
+	}
+	if pc.TriggersForEvent("action:action1") != nil || pc.TriggersForEvent("") != nil {
+		t.Fatal("Expected no triggers")
+	}
+
+	// Empty config, not built from JSON
+	empty := PrimaryConfig{}
+	if empty.TriggersForEvent("event1") != nil {
+		t.Fatal("Expected no triggers")
+	}
+}
+
+func TestNameIndexes(t *testing.T) {
+	pc := testHelperBuildTriggerConfig(t, 20, 3)
+	other := testHelperBuildTriggerConfig(t, 20, 3)
+
+	for _, name := range []string{"action0", "action19"} {
+		if pc.NameForActionContainer(pc.ActionWithName(name)) != name {
+			t.Fatal("Action name lookup failed")
+		}
+		// Actions from another config aren't named in this one
+		if pc.NameForActionContainer(other.ActionWithName(name)) != "" {
+			t.Fatal("Found name for action from another config")
+		}
+	}
+	for _, name := range []string{"condition0", "condition19"} {
+		if pc.NameForCondition(pc.ConditionWithName(name)) != name {
+			t.Fatal("Condition name lookup failed")
+		}
+		if pc.NameForCondition(other.ConditionWithName(name)) != "" {
+			t.Fatal("Found name for condition from another config")
+		}
+	}
+	unnamedCondition, _ := NewCondition("true")
+	if pc.NameForActionContainer(&ActionContainer{}) != "" || pc.NameForCondition(unnamedCondition) != "" || pc.NameForActionContainer(nil) != "" {
+		t.Fatal("Found name for unnamed action or condition")
+	}
+}
+
+func TestDerivedEvents(t *testing.T) {
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"actions": {"namedActions": {
+			"a1": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}},
+			"a2": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}}}},
+		"conditions": {"namedConditions": {"c1": "true"}},
+		"triggers": {"namedTriggers": {"t1": {"eventName": "action:a1", "actionName": "a2"}}},
+		"notifications": {"n1": {"title": "t", "cancelationEvents": ["ff_false:c1"], "deliveryTime": {"eventName": "e1"}}}}`
+	pc := testHelperDecodeConfigJson(t, []byte(config), true)
+	other := testHelperDecodeConfigJson(t, []byte(config), true)
+
+	a1 := pc.EventsForActionContainer(pc.ActionWithName("a1"))
+	if a1 == nil || a1.Performed.Event.Name != "action:a1" || a1.Failed.Event.Name != "action_error:a1" {
+		t.Fatal("Wrong action event names")
+	}
+	if !a1.Performed.HasListeners || a1.Failed.HasListeners {
+		t.Fatal("Expected trigger to listen for action:a1 only")
+	}
+	if a2 := pc.EventsForActionContainer(pc.ActionWithName("a2")); a2.Performed.HasListeners || a2.Performed.Event.EventType != EventTypeCustom {
+		t.Fatal("Expected custom event with no listeners")
+	}
+
+	c1 := pc.EventsForCondition(pc.ConditionWithName("c1"))
+	if c1 == nil || c1.True.Event.Name != "ff_true:c1" || c1.False.Event.Name != "ff_false:c1" || c1.Error.Event.Name != "ff_error:c1" {
+		t.Fatal("Wrong condition event names")
+	}
+	if c1.True.HasListeners || !c1.False.HasListeners || c1.Error.HasListeners {
+		t.Fatal("Expected notification to listen for ff_false:c1 only")
+	}
+
+	if pc.EventsForActionContainer(other.ActionWithName("a1")) != nil || pc.EventsForCondition(other.ConditionWithName("c1")) != nil {
+		t.Fatal("Found events for action or condition from another config")
+	}
+}
+
+func TestConditionEntities(t *testing.T) {
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo",
+		"actions": {"namedActions": {
+			"a1": {"actionType": "link", "condition": "true", "actionData": {"url": "https://criticalmoments.io"}},
+			"ca": {"actionType": "conditional_action", "actionData": {"condition": "false", "passedActionName": "a1"}}}},
+		"conditions": {"namedConditions": {"c1": "true"}},
+		"triggers": {"namedTriggers": {"t1": {"eventName": "e1", "actionName": "a1", "condition": "true"}}},
+		"notifications": {"n1": {"title": "t", "deliveryTime": {"eventName": "e1"}, "scheduleCondition": "true",
+			"idealDeliveryConditions": {"condition": "true", "maxWaitTimeSeconds": 60}}}}`
+	pc := testHelperDecodeConfigJson(t, []byte(config), true)
+
+	entities := pc.ConditionEntities()
+	expected := map[*Condition]string{
+		pc.ConditionWithName("c1"):                                "condition:c1",
+		pc.namedTriggers["t1"].Condition:                          "trigger:t1",
+		pc.ActionWithName("a1").Condition:                         "action:a1",
+		pc.ActionWithName("ca").ConditionalAction.Condition:       "action:ca/embedded",
+		pc.Notifications["n1"].ScheduleCondition:                  "notification:n1/schedule",
+		&pc.Notifications["n1"].IdealDeliveryConditions.Condition: "notification:n1/ideal_delivery",
+	}
+	if len(entities) != len(expected) {
+		t.Fatalf("Expected %v entities, got %v", len(expected), len(entities))
+	}
+	for condition, entity := range expected {
+		if entities[condition] != entity {
+			t.Fatalf("Expected %v, got %v", entity, entities[condition])
+		}
+	}
+}
+
+func testHelperTriggerName(pc *PrimaryConfig, t *Trigger) string {
+	for name, trigger := range pc.namedTriggers {
+		if trigger == t {
+			return name
+		}
+	}
+	return ""
+}
+
+func BenchmarkConfigIndexes(b *testing.B) {
+	pc := testHelperBuildTriggerConfig(b, 2000, 500)
+	action := pc.ActionWithName("action1999")
+	condition := pc.ConditionWithName("condition1999")
+
+	b.Run("TriggersForEvent", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if len(pc.TriggersForEvent("event499")) != 4 {
+				b.Fatal("Wrong trigger count")
+			}
+		}
+	})
+	b.Run("TriggersForEventNoMatch", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if len(pc.TriggersForEvent("action:action1999")) != 0 {
+				b.Fatal("Wrong trigger count")
+			}
+		}
+	})
+	b.Run("NameForActionContainer", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if pc.NameForActionContainer(action) != "action1999" {
+				b.Fatal("Wrong name")
+			}
+		}
+	})
+	b.Run("NameForCondition", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			if pc.NameForCondition(condition) != "condition1999" {
+				b.Fatal("Wrong name")
+			}
+		}
+	})
+}
+
+const testNotificationIndexConfig = `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "notifications": {
+		"b": {"title": "b", "deliveryTime": {"eventName": "e1"}, "cancelationEvents": ["c1", "c2", "c1"], "scheduleCondition": "platform == 'iOS'"},
+		"a": {"title": "a", "deliveryTime": {"eventName": "e1"}, "cancelationEvents": ["c2"], "idealDeliveryConditions": {"condition": "app_version > '1.0'", "maxWaitTimeSeconds": 60}},
+		"c": {"title": "c", "deliveryTime": {"timestamp": 4102444800}, "scheduleCondition": "platform == 'iOS' && eventCount('e1') > 0"}
+	}}`
+
+func TestNotificationEventIndex(t *testing.T) {
+	pc := testHelperDecodeConfigJson(t, []byte(testNotificationIndexConfig), true)
+
+	delivery, cancelation := pc.NotificationsForEvent("e1")
+	if len(delivery) != 2 || delivery[0].ID != "a" || delivery[1].ID != "b" || cancelation != nil {
+		t.Fatal("Wrong notifications for delivery event")
+	}
+	delivery, cancelation = pc.NotificationsForEvent("c1")
+	if delivery != nil || len(cancelation) != 1 || cancelation[0].ID != "b" {
+		t.Fatal("Wrong notifications for cancelation event")
+	}
+	delivery, cancelation = pc.NotificationsForEvent("c2")
+	if delivery != nil || len(cancelation) != 2 || cancelation[0].ID != "a" || cancelation[1].ID != "b" {
+		t.Fatal("Wrong notifications for cancelation event")
+	}
+	delivery, cancelation = pc.NotificationsForEvent("unrelated")
+	if delivery != nil || cancelation != nil || pc.NotificationForDeliveredEvent("unrelated") != nil {
+		t.Fatal("Unrelated event returned notifications")
+	}
+
+	a := pc.Notifications["a"]
+	if pc.NotificationForDeliveredEvent(a.DeliveredEventName()) != a || pc.NotificationForDeliveredEvent("e1") != nil {
+		t.Fatal("Wrong notification for delivered event")
+	}
+	delivery, cancelation = pc.NotificationsForEvent(a.DeliveredEventName())
+	if delivery != nil || cancelation != nil {
+		t.Fatal("Delivered event returned delivery or cancelation notifications")
+	}
+}
+
+func TestNotificationPropertyIndex(t *testing.T) {
+	pc := testHelperDecodeConfigJson(t, []byte(testNotificationIndexConfig), true)
+
+	platform := pc.NotificationsDependingOnProperty("platform")
+	if len(platform) != 2 || platform[0].ID != "b" || platform[1].ID != "c" {
+		t.Fatal("Wrong notifications for schedule condition property")
+	}
+	appVersion := pc.NotificationsDependingOnProperty("app_version")
+	if len(appVersion) != 1 || appVersion[0].ID != "a" {
+		t.Fatal("Wrong notifications for ideal delivery condition property")
+	}
+	if len(pc.NotificationsDependingOnProperty("eventCount")) != 0 || len(pc.NotificationsDependingOnProperty("os_version")) != 0 {
+		t.Fatal("Methods and unused properties should not be dependencies")
+	}
+
+	if pc.Notifications["a"].ScheduleConditionFields() != nil {
+		t.Fatal("Expected no schedule condition fields without a schedule condition")
+	}
+	fields := pc.Notifications["c"].ScheduleConditionFields()
+	if fields == nil || !slices.Contains(fields.Variables, "platform") || !slices.Contains(fields.Methods, "eventCount") {
+		t.Fatal("Wrong schedule condition fields")
+	}
+}
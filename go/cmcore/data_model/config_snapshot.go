@@ -0,0 +1,305 @@
+package datamodel
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/gob"
+	"errors"
+)
+
+/*
+Config snapshots are a pre-parsed binary encoding of a PrimaryConfig, which was already decoded and validated.
+Loading a snapshot skips JSON parsing and condition parsing, which dominate cold start for large configs.
+Snapshots are only written after a full decode succeeds, and are tied to:
+ - the SHA-256 of the source config file they were decoded from
+ - the signature of the source config file, which the caller must verify again (VerifyPrimaryConfigSignature) on
+   every load. A snapshot is only trusted alongside a config file which is still correctly signed, so replacing the
+   cached config file with an unsigned one can't be hidden behind a snapshot with a matching hash.
+ - the library version which wrote them
+ - configSnapshotFormatVersion, which must be bumped if the datamodel changes in a way gob can't carry forward
+Any mismatch, corruption or failure to decode returns an error, and the caller should fall back to the full decode.
+Actions which haven't been decoded yet (see lazy_actions.go) are stored as their raw JSON, and stay lazy when loaded.
+*/
+
+const configSnapshotFormatVersion = "cm-config-snapshot-v3"
+
+type configSnapshotEnvelope struct {
+	FormatVersion  string
+	LibraryVersion string
+	SourceHash     string
+	// Signature of the source config file's CONFIG block, verified when the snapshot was written
+	SourceSignature string
+	// SHA-256 of Payload. Detects truncated or corrupted files; it is not a signature.
+	PayloadHash []byte
+	Payload     []byte
+}
+
+// Mirror of PrimaryConfig with all fields exported, so gob can encode them
+type primaryConfigSnapshot struct {
+	ContainerVersion string
+	ConfigVersion    string
+	AppId            string
+
+	MinCMVersion         string
+	MinCMVersionInternal string
+	MinAppVersion        string
+
+	DefaultTheme     *Theme
+	LibraryThemeName string
+	NamedThemes      map[string]*Theme
+
+	NamedActions map[string]*ActionContainer
+	// Raw action data of lazy actions, by action name. Their entry in NamedActions only has the header fields.
+	LazyActionData map[string][]byte
+
+	NamedTriggers   map[string]*Trigger
+	NamedConditions map[string]*Condition
+
+	Notifications map[string]*Notification
+}
+
+func EncodePrimaryConfigSnapshot(pc *PrimaryConfig, sourceHash string, sourceSignature string, libraryVersion string) ([]byte, error) {
+	if pc == nil || sourceHash == "" || sourceSignature == "" {
+		return nil, errors.New("CriticalMoments: config snapshot requires a config, source hash and source signature")
+	}
+
+	snapshot := primaryConfigSnapshot{
+		ContainerVersion:     pc.ContainerVersion,
+		ConfigVersion:        pc.ConfigVersion,
+		AppId:                pc.AppId,
+		MinCMVersion:         pc.MinCMVersion,
+		MinCMVersionInternal: pc.MinCMVersionInternal,
+		MinAppVersion:        pc.MinAppVersion,
+		DefaultTheme:         pc.defaultTheme,
+		LibraryThemeName:     pc.LibraryThemeName,
+		NamedThemes:          pc.namedThemes,
+		NamedActions:         make(map[string]*ActionContainer, len(pc.namedActions)),
+		LazyActionData:       make(map[string][]byte),
+		NamedTriggers:        pc.namedTriggers,
+		NamedConditions:      pc.namedConditions,
+		Notifications:        pc.Notifications,
+	}
+	for name, action := range pc.namedActions {
+		if action != nil && action.lazyData != nil {
+			// Header only: the typed fields may be set concurrently if the action is decoded while encoding
+			snapshot.NamedActions[name] = &ActionContainer{
+				ActionType:         action.ActionType,
+				Condition:          action.Condition,
+				FallbackActionName: action.FallbackActionName,
+			}
+			snapshot.LazyActionData[name] = action.lazyData.raw
+		} else {
+			snapshot.NamedActions[name] = action
+		}
+	}
+	var payload bytes.Buffer
+	if err := gob.NewEncoder(&payload).Encode(&snapshot); err != nil {
+		return nil, err
+	}
+
+	payloadHash := sha256.Sum256(payload.Bytes())
+	envelope := configSnapshotEnvelope{
+		FormatVersion:   configSnapshotFormatVersion,
+		LibraryVersion:  libraryVersion,
+		SourceHash:      sourceHash,
+		SourceSignature: sourceSignature,
+		PayloadHash:     payloadHash[:],
+		Payload:         payload.Bytes(),
+	}
+	var b bytes.Buffer
+	if err := gob.NewEncoder(&b).Encode(&envelope); err != nil {
+		return nil, err
+	}
+	return b.Bytes(), nil
+}
+
+// Decodes a snapshot written by EncodePrimaryConfigSnapshot. Returns an error unless the snapshot is intact, and
+// was written by this library version from a source file with the given hash and signature. The caller must have
+// verified the signature of the source file; use VerifyPrimaryConfigSignature.
+func DecodePrimaryConfigSnapshot(data []byte, sourceHash string, sourceSignature string, libraryVersion string) (*PrimaryConfig, error) {
+	var envelope configSnapshotEnvelope
+	if err := gob.NewDecoder(bytes.NewReader(data)).Decode(&envelope); err != nil {
+		return nil, err
+	}
+	if envelope.FormatVersion != configSnapshotFormatVersion || envelope.LibraryVersion != libraryVersion {
+		return nil, errors.New("CriticalMoments: config snapshot is from another library version")
+	}
+	if sourceHash == "" || envelope.SourceHash != sourceHash {
+		return nil, errors.New("CriticalMoments: config snapshot does not match config file")
+	}
+	if sourceSignature == "" || envelope.SourceSignature != sourceSignature {
+		return nil, errors.New("CriticalMoments: config snapshot does not match config file signature")
+	}
+	payloadHash := sha256.Sum256(envelope.Payload)
+	if !bytes.Equal(payloadHash[:], envelope.PayloadHash) {
+		return nil, errors.New("CriticalMoments: config snapshot is corrupted")
+	}
+
+	var snapshot primaryConfigSnapshot
+	if err := gob.NewDecoder(bytes.NewReader(envelope.Payload)).Decode(&snapshot); err != nil {
+		return nil, err
+	}
+
+	pc := &PrimaryConfig{
+		ContainerVersion:     snapshot.ContainerVersion,
+		ConfigVersion:        snapshot.ConfigVersion,
+		AppId:                snapshot.AppId,
+		MinCMVersion:         snapshot.MinCMVersion,
+		MinCMVersionInternal: snapshot.MinCMVersionInternal,
+		MinAppVersion:        snapshot.MinAppVersion,
+		defaultTheme:         snapshot.DefaultTheme,
+		LibraryThemeName:     snapshot.LibraryThemeName,
+		namedThemes:          snapshot.NamedThemes,
+		namedActions:         snapshot.NamedActions,
+		namedTriggers:        snapshot.NamedTriggers,
+		namedConditions:      snapshot.NamedConditions,
+		Notifications:        snapshot.Notifications,
+	}
+	for name, raw := range snapshot.LazyActionData {
+		action := pc.namedActions[name]
+		if action == nil {
+			return nil, errors.New("CriticalMoments: config snapshot has lazy data for missing action")
+		}
+		action.lazyData = &lazyActionData{raw: raw}
+	}
+	if err := pc.restoreFromSnapshot(); err != nil {
+		return nil, err
+	}
+	pc.buildIndexes()
+	return pc, nil
+}
+
+// Gob doesn't encode unexported fields, or distinguish empty and nil maps. Restore the parts of the config
+// which are derived during JSON parsing. This is a structural check only; the full Check() re-parses every
+// condition, which is what snapshots exist to avoid.
+func (pc *PrimaryConfig) restoreFromSnapshot() error {
+	if pc.namedThemes == nil {
+		pc.namedThemes = make(map[string]*Theme)
+	}
+	if pc.namedActions == nil {
+		pc.namedActions = make(map[string]*ActionContainer)
+	}
+	if pc.namedTriggers == nil {
+		pc.namedTriggers = make(map[string]*Trigger)
+	}
+	if pc.namedConditions == nil {
+		pc.namedConditions = make(map[string]*Condition)
+	}
+	if pc.Notifications == nil {
+		pc.Notifications = make(map[string]*Notification)
+	}
+
+	for _, action := range pc.namedActions {
+		if action == nil {
+			return errors.New("CriticalMoments: config snapshot has nil action")
+		}
+		if action.lazyData != nil {
+			continue
+		}
+		if err := action.restoreFromSnapshot(); err != nil {
+			return err
+		}
+	}
+	for _, trigger := range pc.namedTriggers {
+		if trigger == nil {
+			return errors.New("CriticalMoments: config snapshot has nil trigger")
+		}
+	}
+	for _, condition := range pc.namedConditions {
+		if condition == nil {
+			return errors.New("CriticalMoments: config snapshot has nil condition")
+		}
+	}
+	for _, notification := range pc.Notifications {
+		if notification == nil {
+			return errors.New("CriticalMoments: config snapshot has nil notification")
+		}
+	}
+	return nil
+}
+
+func (ac *ActionContainer) restoreFromSnapshot() error {
+	switch {
+	case ac.ActionType == ActionTypeEnumBanner && ac.BannerAction != nil:
+		ac.actionData = ac.BannerAction
+	case ac.ActionType == ActionTypeEnumAlert && ac.AlertAction != nil:
+		if ac.AlertAction.CustomButtons == nil {
+			ac.AlertAction.CustomButtons = []*AlertActionCustomButton{}
+		}
+		ac.actionData = ac.AlertAction
+	case ac.ActionType == ActionTypeEnumLink && ac.LinkAction != nil:
+		ac.actionData = ac.LinkAction
+	case ac.ActionType == ActionTypeEnumConditional && ac.ConditionalAction != nil:
+		ac.actionData = ac.ConditionalAction
+	case ac.ActionType == ActionTypeEnumModal && ac.ModalAction != nil:
+		if ac.ModalAction.Content != nil {
+			for _, section := range ac.ModalAction.Content.Sections {
+				if section == nil {
+					return errors.New("CriticalMoments: config snapshot has nil page section")
+				}
+				if err := section.restoreFromSnapshot(); err != nil {
+					return err
+				}
+			}
+		}
+		ac.actionData = ac.ModalAction
+	case ac.ActionType == ActionTypeEnumReview:
+		ac.actionData = &ReviewAction{}
+	default:
+		_, known := actionTypeRegistry[ac.ActionType]
+		if known {
+			return errors.New("CriticalMoments: config snapshot action missing data")
+		}
+		ac.actionData = &UnknownAction{ActionType: ac.ActionType}
+	}
+	return nil
+}
+
+func (s *PageSection) restoreFromSnapshot() error {
+	switch {
+	case s.PageSectionType == SectionTypeEnumTitle && s.TitleData != nil:
+		s.pageSectionData = *s.TitleData
+	case s.PageSectionType == SectionTypeEnumBodyText && s.BodyData != nil:
+		s.pageSectionData = *s.BodyData
+	case s.PageSectionType == SectionTypeEnumImage && s.ImageData != nil:
+		if err := s.ImageData.restoreFromSnapshot(); err != nil {
+			return err
+		}
+		s.pageSectionData = s.ImageData
+	default:
+		if _, known := pageSectionTypeRegistry[s.PageSectionType]; known {
+			return errors.New("CriticalMoments: config snapshot page section missing data")
+		}
+		s.pageSectionData = UnknownSection{}
+	}
+	return nil
+}
+
+func (i *Image) restoreFromSnapshot() error {
+	switch {
+	case i.ImageType == ImageTypeEnumLocal && i.LocalImageData != nil:
+		i.imageData = i.LocalImageData
+	case i.ImageType == ImageTypeEnumSFSymbol && i.SymbolImageData != nil:
+		i.imageData = i.SymbolImageData
+	default:
+		if _, known := imageTypeRegistry[i.ImageType]; known {
+			return errors.New("CriticalMoments: config snapshot image missing data")
+		}
+		i.imageData = &UnknownImage{}
+	}
+	if i.Fallback != nil {
+		return i.Fallback.restoreFromSnapshot()
+	}
+	return nil
+}
+
+// Conditions are encoded as their source string. Decoding doesn't re-validate: the snapshot was only
+// written after the condition passed validation when the source config was parsed.
+func (c *Condition) GobEncode() ([]byte, error) {
+	return []byte(c.conditionString), nil
+}
+
+func (c *Condition) GobDecode(data []byte) error {
+	c.conditionString = string(data)
+	return nil
+}
@@ -0,0 +1,232 @@
+package datamodel
+
+import (
+	"crypto/sha256"
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+
+	"github.com/CriticalMoments/CriticalMoments/go/cmcore/signing"
+)
+
+func TestConfigSnapshotRoundTrip(t *testing.T) {
+	pc := testHelperBuildMaxPrimaryConfig(t)
+
+	b, err := EncodePrimaryConfigSnapshot(pc, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	spc, err := DecodePrimaryConfigSnapshot(b, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Includes the unexported fields derived while parsing (actionData, pageSectionData, imageData)
+	if !reflect.DeepEqual(pc, spc) {
+		t.Fatal("Snapshot didn't round trip")
+	}
+	if !spc.Valid() {
+		t.Fatal("Snapshot config not valid")
+	}
+	// Lookups by pointer identity should work with the decoded instances
+	if spc.NameForActionContainer(spc.ActionWithName("bannerAction1")) != "bannerAction1" {
+		t.Fatal("Snapshot action lookup failed")
+	}
+}
+
+func TestConfigSnapshotMinimalConfig(t *testing.T) {
+	pc := testHelperBuilPrimaryConfigFromFile(t, "./test/testdata/primary_config/valid/minimalValid.json")
+	b, err := EncodePrimaryConfigSnapshot(pc, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	spc, err := DecodePrimaryConfigSnapshot(b, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	// Empty maps are not encoded, but should be restored
+	if !reflect.DeepEqual(pc, spc) || !spc.Valid() {
+		t.Fatal("Minimal snapshot didn't round trip")
+	}
+}
+
+func TestConfigSnapshotRejected(t *testing.T) {
+	pc := testHelperBuildMaxPrimaryConfig(t)
+	b, err := EncodePrimaryConfigSnapshot(pc, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if _, err := DecodePrimaryConfigSnapshot(b, "otherhash", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot for a different source file")
+	}
+	if _, err := DecodePrimaryConfigSnapshot(b, "", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot without source hash")
+	}
+	if _, err := DecodePrimaryConfigSnapshot(b, "hash", "othersig", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot for a different source signature")
+	}
+	if _, err := DecodePrimaryConfigSnapshot(b, "hash", "", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot without source signature")
+	}
+	if _, err := DecodePrimaryConfigSnapshot(b, "hash", "sig", "1.0.1"); err == nil {
+		t.Fatal("Allowed snapshot from a different library version")
+	}
+	if _, err := DecodePrimaryConfigSnapshot(b[:len(b)/2], "hash", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed truncated snapshot")
+	}
+	if _, err := DecodePrimaryConfigSnapshot([]byte("not a snapshot"), "hash", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed invalid snapshot")
+	}
+
+	// Flip a byte in a string inside the payload, which gob alone would decode without error
+	i := strings.Index(string(b), "bannerAction1")
+	if i < 0 {
+		t.Fatal("Expected action name in payload")
+	}
+	corrupted := append([]byte{}, b...)
+	corrupted[i] = 'c'
+	if _, err := DecodePrimaryConfigSnapshot(corrupted, "hash", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed corrupted snapshot")
+	}
+
+	if _, err := EncodePrimaryConfigSnapshot(pc, "", "sig", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot without source hash")
+	}
+	if _, err := EncodePrimaryConfigSnapshot(pc, "hash", "", "1.0.0"); err == nil {
+		t.Fatal("Allowed snapshot without source signature")
+	}
+}
+
+func TestVerifyPrimaryConfigSignature(t *testing.T) {
+	signed := testHelperBuildLargeSignedConfig(t, 1000)
+	su := testSignUtil(t)
+	sig, err := VerifyPrimaryConfigSignature(signed, su)
+	if err != nil || sig == "" {
+		t.Fatal("Failed to verify signed config")
+	}
+	if _, decodedSig, err := DecodePrimaryConfigWithSignature(signed, su); err != nil || decodedSig != sig {
+		t.Fatal("Decoding returned a different signature than verifying")
+	}
+
+	// Change the (base64) body, keeping the signature
+	tampered := []byte(strings.Replace(string(signed), "eyJjb25m", "eyJjb25n", 1))
+	if string(tampered) == string(signed) {
+		t.Fatal("Expected config body in signed config")
+	}
+	if _, err := VerifyPrimaryConfigSignature(tampered, su); err == nil {
+		t.Fatal("Verified config with modified body")
+	}
+	if _, err := VerifyPrimaryConfigSignature([]byte(`{"configVersion": "v1"}`), su); err == nil {
+		t.Fatal("Verified unsigned config")
+	}
+}
+
+// Builds a signed config of roughly the given size, with a mix of actions, triggers and conditions
+func testHelperBuildLargeSignedConfig(t testing.TB, approxSize int) []byte {
+	var sb strings.Builder
+	sb.WriteString(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {`)
+	count := 0
+	for sb.Len() < approxSize/2 {
+		if count > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"alert%v": {"actionType": "alert", "condition": "eventCount('e%v') > %v && platform == 'iOS'", "actionData": {"title": "Alert %v", "message": "A longer message body, to be more like a real config file %v", "showCancelButton": true, "customButtons": [{"label": "Open", "actionName": "link%v"}]}},`, count, count, count, count, count, count)
+		fmt.Fprintf(&sb, `"link%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, count, count)
+		count++
+	}
+	sb.WriteString(`}}, "triggers": {"namedTriggers": {`)
+	for i := 0; i < count; i++ {
+		if i > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"trigger%v": {"eventName": "e%v", "actionName": "alert%v", "condition": "app_version >= '1.%v' && !(user_signed_in ?? false)"}`, i, i, i, i)
+	}
+	sb.WriteString(`}}, "conditions": {"namedConditions": {`)
+	for i := 0; i < count; i++ {
+		if i > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"condition%v": "versionGreaterThan(os_version, '%v.0') || eventCountSince('e%v', 86400) > 2"`, i, i%20, i)
+	}
+	sb.WriteString(`}}}`)
+
+	su := testSignUtil(t)
+	signed, err := EncodeConfig([]byte(sb.String()), su)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return signed
+}
+
+// Startup cost of loading a 1MB config, from reading the file to a decoded config. The snapshot path mirrors
+// Appcore.decodeConfigFile: read and hash the config file, look up the snapshot by hash, re-verify the config
+// signature, then decode the snapshot.
+func BenchmarkConfigSnapshot(b *testing.B) {
+	signed := testHelperBuildLargeSignedConfig(b, 1_000_000)
+	su := testSignUtil(b)
+	pc, sig, err := DecodePrimaryConfigWithSignature(signed, su)
+	if err != nil {
+		b.Fatal(err)
+	}
+	configHash := fmt.Sprintf("%x", sha256.Sum256(signed))
+	snapshot, err := EncodePrimaryConfigSnapshot(pc, configHash, sig, "1.0.0")
+	if err != nil {
+		b.Fatal(err)
+	}
+	dir := b.TempDir()
+	configPath := filepath.Join(dir, "primary.config")
+	snapshotDir := filepath.Join(dir, "snapshots")
+	if os.WriteFile(configPath, signed, 0644) != nil || os.Mkdir(snapshotDir, 0755) != nil ||
+		os.WriteFile(filepath.Join(snapshotDir, configHash), snapshot, 0644) != nil {
+		b.Fatal("Failed to write benchmark files")
+	}
+	b.Logf("config: %v bytes, snapshot: %v bytes, %v actions", len(signed), len(snapshot), len(pc.namedActions))
+
+	b.Run("full_decode", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			data, err := os.ReadFile(configPath)
+			if err != nil {
+				b.Fatal(err)
+			}
+			_, err = DecodePrimaryConfig(data, su)
+			if err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+	b.Run("snapshot_decode", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			data, err := os.ReadFile(configPath)
+			if err != nil {
+				b.Fatal(err)
+			}
+			hash := fmt.Sprintf("%x", sha256.Sum256(data))
+			snapshotData, err := os.ReadFile(filepath.Join(snapshotDir, hash))
+			if err != nil {
+				b.Fatal(err)
+			}
+			sig, err := VerifyPrimaryConfigSignature(data, su)
+			if err != nil {
+				b.Fatal(err)
+			}
+			_, err = DecodePrimaryConfigSnapshot(snapshotData, hash, sig, "1.0.0")
+			if err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
+
+func testSignUtil(t testing.TB) *signing.SignUtil {
+	su, err := signing.NewSignUtilWithSerializedPrivateKey(testPrivKey)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return su
+}
@@ -0,0 +1,433 @@
+package datamodel
+
+import (
+	"bytes"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"strings"
+)
+
+/*
+Single pass decoder for the config file JSON.
+
+json.Unmarshal into a PrimaryConfig re-parses nested polymorphic types at each level: actions, modals, pages, page
+sections and images each unmarshal into an intermediate struct holding json.RawMessage, then unmarshal that again once
+the type is known. Large configs parse the same bytes many times.
+
+This decoder reads the JSON tokens once, dispatching on actionType/pageSectionType/imageType as it reads, and decodes
+the action/page tree directly into the final types. Leaf values (strings, themes, triggers, conditions, and action
+types without nested polymorphic data) are decoded with the standard decoder as they're reached.
+
+The result must be identical to json.Unmarshal, so:
+  - Intermediate structs and "applyJson" functions (defaults, validation, errors) are shared with UnmarshalJSON
+  - Keys match case insensitively, like encoding/json
+  - Any value we don't expect (null, wrong type, or data before its type tag) falls back to the standard decoder
+    for that value
+*/
+
+type configStreamDecoder struct {
+	data []byte
+	dec  *json.Decoder
+
+	// Defer decoding action data until first use. See lazy_actions.go
+	lazyActions bool
+}
+
+func newConfigStreamDecoder(data []byte) *configStreamDecoder {
+	return &configStreamDecoder{
+		data: data,
+		dec:  json.NewDecoder(bytes.NewReader(data)),
+	}
+}
+
+// Decodes config file JSON into pc in a single pass. Result is identical to json.Unmarshal(data, pc), except
+// with lazyActions, where named action data is decoded on first use.
+func decodePrimaryConfigJson(data []byte, pc *PrimaryConfig, lazyActions bool) error {
+	d := newConfigStreamDecoder(data)
+	d.lazyActions = lazyActions
+	if d.peek() != '{' {
+		return json.Unmarshal(data, pc)
+	}
+
+	var jpc jsonPrimaryConfig
+	err := d.decodePrimaryConfig(&jpc)
+	if err == nil {
+		err = d.end()
+	}
+	if err != nil {
+		return NewUserPresentableErrorWSource("Invalid Critical Moments config file", err)
+	}
+	return pc.applyJson(&jpc)
+}
+
+func (d *configStreamDecoder) decodePrimaryConfig(jpc *jsonPrimaryConfig) error {
+	return d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "configVersion"):
+			return d.dec.Decode(&jpc.ConfigVersion)
+		case fieldIs(key, "appId"):
+			return d.dec.Decode(&jpc.AppId)
+		case fieldIs(key, "minAppVersion"):
+			return d.dec.Decode(&jpc.MinAppVersion)
+		case fieldIs(key, "minCMVersion"):
+			return d.dec.Decode(&jpc.MinCMVersion)
+		case fieldIs(key, "minCMVersionInternal"):
+			return d.dec.Decode(&jpc.MinCMVersionInternal)
+		case fieldIs(key, "themes"):
+			return d.dec.Decode(&jpc.ThemesConfig)
+		case fieldIs(key, "actions"):
+			if d.peek() != '{' {
+				return d.dec.Decode(&jpc.ActionsConfig)
+			}
+			if jpc.ActionsConfig == nil {
+				jpc.ActionsConfig = &jsonActionsSection{}
+			}
+			return d.decodeActionsSection(jpc.ActionsConfig)
+		case fieldIs(key, "triggers"):
+			return d.dec.Decode(&jpc.TriggerConfig)
+		case fieldIs(key, "conditions"):
+			return d.dec.Decode(&jpc.ConditionsConfig)
+		case fieldIs(key, "notifications"):
+			return d.dec.Decode(&jpc.Notifications)
+		}
+		return d.skip()
+	})
+}
+
+func (d *configStreamDecoder) decodeActionsSection(section *jsonActionsSection) error {
+	return d.object(func(key string) error {
+		if !fieldIs(key, "namedActions") {
+			return d.skip()
+		}
+		if d.peek() != '{' {
+			return d.dec.Decode(&section.NamedActions)
+		}
+		if section.NamedActions == nil {
+			section.NamedActions = make(map[string]*ActionContainer)
+		}
+		return d.object(func(actionName string) error {
+			if d.peek() != '{' {
+				var action *ActionContainer
+				err := d.dec.Decode(&action)
+				section.NamedActions[actionName] = action
+				return err
+			}
+			action := &ActionContainer{}
+			if err := d.decodeActionContainer(action); err != nil {
+				return err
+			}
+			section.NamedActions[actionName] = action
+			return nil
+		})
+	})
+}
+
+func (d *configStreamDecoder) decodeActionContainer(ac *ActionContainer) error {
+	var jac jsonActionContainer
+	var modal *ModalAction
+	var unpackErr error
+	err := d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "actionType"):
+			return d.dec.Decode(&jac.ActionType)
+		case fieldIs(key, "condition"):
+			return d.dec.Decode(&jac.Condition)
+		case fieldIs(key, "fallback"):
+			return d.dec.Decode(&jac.FallbackActionName)
+		case fieldIs(key, "actionData"):
+			start := d.dec.InputOffset()
+			if d.lazyActions || jac.ActionType != ActionTypeEnumModal || d.peek() != '{' {
+				// Other types don't have nested polymorphic data, and are unpacked from raw by the registry
+				modal = nil
+				jac.RawActionData = nil
+				return d.dec.Decode(&jac.RawActionData)
+			}
+			modal = &ModalAction{}
+			if err := d.decodeModalAction(modal); err != nil {
+				unpackErr = err
+				return err
+			}
+			jac.RawActionData = d.valueBytes(start)
+			return nil
+		}
+		return d.skip()
+	})
+	if unpackErr != nil {
+		return NewUserPresentableErrorWSource(fmt.Sprintf("Issue unpacking actionType \"%v\"", jac.ActionType), unpackErr)
+	}
+	if err != nil {
+		return err
+	}
+
+	if d.lazyActions {
+		if ac.deferActionData(&jac) {
+			return nil
+		}
+		actionData, err := decodeActionContainerData(&jac, ac)
+		if err != nil {
+			return err
+		}
+		return ac.applyJson(&jac, actionData)
+	}
+	if modal != nil && jac.ActionType == ActionTypeEnumModal {
+		ac.ModalAction = modal
+		return ac.applyJson(&jac, modal)
+	}
+	// Type changed after the data was decoded (duplicate key); unpack the raw data like UnmarshalJSON
+	return ac.applyJson(&jac, nil)
+}
+
+// Decodes jac.RawActionData into ac. Modals are streamed, other types are unpacked by the registry.
+func decodeActionContainerData(jac *jsonActionContainer, ac *ActionContainer) (ActionTypeInterface, error) {
+	if jac.ActionType != ActionTypeEnumModal || len(jac.RawActionData) == 0 || jac.RawActionData[0] != '{' {
+		return ac.unpackActionData(jac)
+	}
+
+	d := newConfigStreamDecoder(jac.RawActionData)
+	modal := &ModalAction{}
+	err := d.decodeModalAction(modal)
+	if err == nil {
+		err = d.end()
+	}
+	if err != nil {
+		return nil, NewUserPresentableErrorWSource(fmt.Sprintf("Issue unpacking actionType \"%v\"", jac.ActionType), err)
+	}
+	ac.ModalAction = modal
+	return modal, nil
+}
+
+func (d *configStreamDecoder) decodeModalAction(m *ModalAction) error {
+	start := d.dec.InputOffset()
+	var jm jsonModalAction
+	err := d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "content"):
+			if d.peek() != '{' {
+				return d.dec.Decode(&jm.Content)
+			}
+			return d.decodePage(&jm.Content)
+		case fieldIs(key, "showCloseButton"):
+			return d.dec.Decode(&jm.ShowCloseButton)
+		case fieldIs(key, "themeName"):
+			return d.dec.Decode(&jm.CustomThemeName)
+		}
+		return d.skip()
+	})
+	if err != nil {
+		return NewUserPresentableErrorWSource("Unable to parse the json of an action with type=modal. Check the format, variable names, and types.", err)
+	}
+	return m.applyJson(&jm, d.valueBytes(start))
+}
+
+func (d *configStreamDecoder) decodePage(p *Page) error {
+	start := d.dec.InputOffset()
+	var jp jsonPage
+	err := d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "pageType"):
+			return d.dec.Decode(&jp.PageType)
+		case fieldIs(key, "pageData"):
+			if d.peek() != '{' {
+				return d.dec.Decode(&jp.PageData)
+			}
+			if jp.PageData == nil {
+				jp.PageData = &jsonStackPage{}
+			}
+			return d.decodeStackPage(jp.PageData)
+		}
+		return d.skip()
+	})
+	if err != nil {
+		return NewUserPresentableErrorWSource("Unable to parse the json of a page.", err)
+	}
+	return p.applyJson(&jp, d.valueBytes(start))
+}
+
+func (d *configStreamDecoder) decodeStackPage(sp *jsonStackPage) error {
+	return d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "sections"):
+			if d.peek() != '[' {
+				return d.dec.Decode(&sp.Sections)
+			}
+			// encoding/json reuses the slice, but an empty array results in an empty (non nil) slice
+			sp.Sections = sp.Sections[:0]
+			if sp.Sections == nil {
+				sp.Sections = []*PageSection{}
+			}
+			return d.array(func() error {
+				if d.peek() != '{' {
+					var section *PageSection
+					err := d.dec.Decode(&section)
+					sp.Sections = append(sp.Sections, section)
+					return err
+				}
+				section := &PageSection{}
+				if err := d.decodePageSection(section); err != nil {
+					return err
+				}
+				sp.Sections = append(sp.Sections, section)
+				return nil
+			})
+		case fieldIs(key, "buttons"):
+			return d.dec.Decode(&sp.Buttons)
+		}
+		return d.skip()
+	})
+}
+
+func (d *configStreamDecoder) decodePageSection(s *PageSection) error {
+	start := d.dec.InputOffset()
+	var js jsonPageSection
+	var image *Image
+	var unpackErr error
+	err := d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "pageSectionType"):
+			return d.dec.Decode(&js.PageSectionType)
+		case fieldIs(key, "topSpacingScale"):
+			return d.dec.Decode(&js.TopSpacingScale)
+		case fieldIs(key, "pageSectionData"):
+			dataStart := d.dec.InputOffset()
+			if js.PageSectionType != SectionTypeEnumImage || d.peek() != '{' {
+				image = nil
+				js.RawSectionData = nil
+				return d.dec.Decode(&js.RawSectionData)
+			}
+			image = &Image{}
+			if err := d.decodeImage(image); err != nil {
+				unpackErr = err
+				return err
+			}
+			js.RawSectionData = d.valueBytes(dataStart)
+			return nil
+		}
+		return d.skip()
+	})
+	if unpackErr != nil {
+		return NewUserPresentableErrorWSource("Unable to parse the json of a page section (image).", unpackErr)
+	}
+	if err != nil {
+		return NewUserPresentableErrorWSource("Unable to parse the json of a page.", err)
+	}
+
+	if image != nil && js.PageSectionType == SectionTypeEnumImage {
+		s.ImageData = image
+		return s.applyJson(&js, d.valueBytes(start), image)
+	}
+	return s.applyJson(&js, d.valueBytes(start), nil)
+}
+
+func (d *configStreamDecoder) decodeImage(i *Image) error {
+	start := d.dec.InputOffset()
+	var ji jsonImage
+	err := d.object(func(key string) error {
+		switch {
+		case fieldIs(key, "imageType"):
+			return d.dec.Decode(&ji.ImageType)
+		case fieldIs(key, "height"):
+			return d.dec.Decode(&ji.Height)
+		case fieldIs(key, "fallback"):
+			if d.peek() != '{' {
+				return d.dec.Decode(&ji.Fallback)
+			}
+			if ji.Fallback == nil {
+				ji.Fallback = &Image{}
+			}
+			return d.decodeImage(ji.Fallback)
+		case fieldIs(key, "imageData"):
+			return d.dec.Decode(&ji.RawSectionData)
+		}
+		return d.skip()
+	})
+	if err != nil {
+		return NewUserPresentableErrorWSource("Unable to parse the json of an image.", err)
+	}
+	return i.applyJson(&ji, d.valueBytes(start))
+}
+
+// Token helpers
+
+// Reads an object, calling fn with each key. fn must consume the key's value.
+func (d *configStreamDecoder) object(fn func(key string) error) error {
+	if err := d.delim('{'); err != nil {
+		return err
+	}
+	for d.dec.More() {
+		t, err := d.dec.Token()
+		if err != nil {
+			return err
+		}
+		key, ok := t.(string)
+		if !ok {
+			return errors.New("CriticalMoments: expected object key in config JSON")
+		}
+		if err := fn(key); err != nil {
+			return err
+		}
+	}
+	return d.delim('}')
+}
+
+// Reads an array, calling fn for each element. fn must consume the element.
+func (d *configStreamDecoder) array(fn func() error) error {
+	if err := d.delim('['); err != nil {
+		return err
+	}
+	for d.dec.More() {
+		if err := fn(); err != nil {
+			return err
+		}
+	}
+	return d.delim(']')
+}
+
+func (d *configStreamDecoder) delim(expected json.Delim) error {
+	t, err := d.dec.Token()
+	if err != nil {
+		return err
+	}
+	if delim, ok := t.(json.Delim); !ok || delim != expected {
+		return fmt.Errorf("CriticalMoments: expected '%v' in config JSON", expected)
+	}
+	return nil
+}
+
+func (d *configStreamDecoder) skip() error {
+	var raw json.RawMessage
+	return d.dec.Decode(&raw)
+}
+
+// Like json.Unmarshal, only whitespace may follow the top level value
+func (d *configStreamDecoder) end() error {
+	if _, err := d.dec.Token(); err != io.EOF {
+		return errors.New("CriticalMoments: unexpected data after config JSON")
+	}
+	return nil
+}
+
+// The first byte of the next value, without consuming it. The decoder may not have consumed the ':' or ','
+// separator before the value yet.
+func (d *configStreamDecoder) peek() byte {
+	for i := d.dec.InputOffset(); i < int64(len(d.data)); i++ {
+		switch c := d.data[i]; c {
+		case ' ', '\t', '\r', '\n', ':', ',':
+			continue
+		default:
+			return c
+		}
+	}
+	return 0
+}
+
+// The raw JSON of the value decoded since start, sliced from the input (not copied)
+func (d *configStreamDecoder) valueBytes(start int64) []byte {
+	return bytes.TrimLeft(d.data[start:d.dec.InputOffset()], " \t\r\n:,")
+}
+
+// encoding/json matches keys to field tags case insensitively
+func fieldIs(key string, field string) bool {
+	return key == field || strings.EqualFold(key, field)
+}
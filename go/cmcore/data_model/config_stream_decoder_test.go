@@ -0,0 +1,206 @@
+package datamodel
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+)
+
+// Decodes with both json.Unmarshal and the streaming decoder, and checks the results are identical
+func testStreamDecoderMatches(t *testing.T, name string, data []byte) {
+	for _, strict := range []bool{false, true} {
+		StrictDatamodelParsing = strict
+
+		var expected PrimaryConfig
+		expectedErr := json.Unmarshal(data, &expected)
+		var streamed PrimaryConfig
+		streamErr := decodePrimaryConfigJson(data, &streamed, false)
+
+		if (expectedErr == nil) != (streamErr == nil) {
+			t.Fatalf("Decoders disagree on error for %v (strict=%v): %v vs %v", name, strict, expectedErr, streamErr)
+		}
+		if expectedErr == nil && !reflect.DeepEqual(expected, streamed) {
+			t.Fatalf("Decoders disagree on result for %v (strict=%v)", name, strict)
+		}
+	}
+	StrictDatamodelParsing = false
+}
+
+func TestStreamDecoderMatchesTestData(t *testing.T) {
+	files, err := filepath.Glob("./test/testdata/primary_config/*/*.json")
+	if err != nil || len(files) < 20 {
+		t.Fatal("Missing test data")
+	}
+	for _, file := range files {
+		data, err := os.ReadFile(file)
+		if err != nil {
+			t.Fatal(err)
+		}
+		testStreamDecoderMatches(t, file, data)
+	}
+}
+
+// The action, page and image tree can be decoded on their own, check against the type test data
+func TestStreamDecoderMatchesNestedTypes(t *testing.T) {
+	decoders := map[string]func(d *configStreamDecoder) (interface{}, error){
+		"modal": func(d *configStreamDecoder) (interface{}, error) {
+			var m ModalAction
+			return &m, d.decodeModalAction(&m)
+		},
+		"page": func(d *configStreamDecoder) (interface{}, error) {
+			var p Page
+			return &p, d.decodePage(&p)
+		},
+		"image": func(d *configStreamDecoder) (interface{}, error) {
+			var i Image
+			return &i, d.decodeImage(&i)
+		},
+	}
+	references := map[string]func() interface{}{
+		"modal": func() interface{} { return &ModalAction{} },
+		"page":  func() interface{} { return &Page{} },
+		"image": func() interface{} { return &Image{} },
+	}
+
+	for typeName, decode := range decoders {
+		files, err := filepath.Glob(fmt.Sprintf("./test/testdata/actions/%v/*.json", typeName))
+		if err != nil || len(files) == 0 {
+			t.Fatal("Missing test data")
+		}
+		for _, file := range files {
+			data, err := os.ReadFile(file)
+			if err != nil {
+				t.Fatal(err)
+			}
+			for _, strict := range []bool{false, true} {
+				StrictDatamodelParsing = strict
+				expected := references[typeName]()
+				expectedErr := json.Unmarshal(data, expected)
+				streamed, streamErr := decode(newConfigStreamDecoder(data))
+				if (expectedErr == nil) != (streamErr == nil) {
+					t.Fatalf("Decoders disagree on error for %v (strict=%v): %v vs %v", file, strict, expectedErr, streamErr)
+				}
+				if expectedErr == nil && !reflect.DeepEqual(expected, streamed) {
+					t.Fatalf("Decoders disagree on result for %v (strict=%v)", file, strict)
+				}
+			}
+		}
+	}
+	StrictDatamodelParsing = false
+}
+
+// Cases where the stream decoder can't dispatch as it reads, and must fall back to the standard decoder
+func TestStreamDecoderEdgeCases(t *testing.T) {
+	modal := `{"content": {"pageType": "stack", "pageData": {"sections": [{"pageSectionType": "image", "pageSectionData": {"imageType": "local", "imageData": {"path": "a.png"}, "fallback": {"imageType": "sf_symbol", "imageData": {"symbolName": "star"}}}}, {"pageSectionType": "title", "pageSectionData": {"title": "hi"}}]}}}`
+	cases := map[string]string{
+		"modal":                 `"m": {"actionType": "modal", "actionData": ` + modal + `}`,
+		"data before type":      `"m": {"actionData": ` + modal + `, "actionType": "modal"}`,
+		"type changed":          `"m": {"actionType": "modal", "actionData": ` + modal + `, "actionType": "link"}`,
+		"type changed to modal": `"m": {"actionType": "link", "actionData": ` + modal + `, "actionType": "modal"}`,
+		"key case":              `"m": {"ACTIONTYPE": "modal", "ActionData": ` + strings.ReplaceAll(modal, `"content"`, `"Content"`) + `}`,
+		"null data":             `"m": {"actionType": "modal", "actionData": null}`,
+		"missing data":          `"m": {"actionType": "modal"}`,
+		"wrong data type":       `"m": {"actionType": "modal", "actionData": "modal"}`,
+		"unknown type":          `"m": {"actionType": "future", "actionData": {"a": [1, {"b": 2}]}}`,
+		"unknown keys":          `"m": {"actionType": "modal", "future": {"x": [1]}, "actionData": ` + modal + `}`,
+		"section data first":    `"m": {"actionType": "modal", "actionData": {"content": {"pageType": "stack", "pageData": {"sections": [{"pageSectionData": {"imageType": "local", "imageData": {"path": "a.png"}}, "pageSectionType": "image"}]}}}}`,
+		"empty sections":        `"m": {"actionType": "modal", "actionData": {"content": {"pageType": "stack", "pageData": {"sections": []}}}}`,
+		"null content":          `"m": {"actionType": "modal", "actionData": {"content": null}}`,
+		"invalid image":         `"m": {"actionType": "modal", "actionData": {"content": {"pageType": "stack", "pageData": {"sections": [{"pageSectionType": "image", "pageSectionData": {"imageType": "local"}}]}}}}`,
+		"wrong field type":      `"m": {"actionType": "modal", "actionData": {"showCloseButton": "yes", "content": {"pageType": "stack", "pageData": {"sections": []}}}}`,
+		"alert":                 `"m": {"actionType": "alert", "condition": "true", "fallback": "l", "actionData": {"title": "t"}}, "l": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}}`,
+	}
+	for name, actions := range cases {
+		config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {` + actions + `}}}`
+		testStreamDecoderMatches(t, name, []byte(config))
+	}
+
+	documents := map[string]string{
+		"trailing data":    `{"configVersion": "v1", "appId": "io.criticalmoments.demo"} {}`,
+		"trailing space":   "{\"configVersion\": \"v1\", \"appId\": \"io.criticalmoments.demo\"}\n ",
+		"syntax error":     `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {"a": {]}}}`,
+		"not an object":    `["configVersion"]`,
+		"null":             `null`,
+		"null sections":    `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": null, "themes": null, "triggers": null}`,
+		"null named":       `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": null}}`,
+		"wrong top type":   `{"configVersion": 1, "appId": "io.criticalmoments.demo"}`,
+		"duplicate action": `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {"a": {"actionType": "modal", "actionData": {"content": {}}}, "a": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}}}}}`,
+	}
+	for name, config := range documents {
+		testStreamDecoderMatches(t, name, []byte(config))
+	}
+}
+
+func TestStreamDecoderMatchesLargeConfig(t *testing.T) {
+	data := testHelperBuildLargeConfigJson(200_000)
+	var pc PrimaryConfig
+	if err := decodePrimaryConfigJson(data, &pc, false); err != nil || len(pc.namedActions) < 300 {
+		t.Fatal("Failed to decode large config", err)
+	}
+	testStreamDecoderMatches(t, "large", data)
+}
+
+// Builds a config of roughly the given size, with a mix of actions (including modals with nested pages and
+// images), triggers and conditions
+func testHelperBuildLargeConfigJson(approxSize int) []byte {
+	var sb strings.Builder
+	sb.WriteString(`{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {`)
+	count := 0
+	for sb.Len() < approxSize*2/3 {
+		if count > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"alert%v": {"actionType": "alert", "condition": "eventCount('e%v') > %v && platform == 'iOS'", "actionData": {"title": "Alert %v", "message": "A longer message body, to be more like a real config file %v", "showCancelButton": true, "customButtons": [{"label": "Open", "actionName": "modal%v"}]}},`, count, count, count, count, count, count)
+		fmt.Fprintf(&sb, `"modal%v": {"actionType": "modal", "fallback": "link%v", "actionData": {"showCloseButton": false, "content": {"pageType": "stack", "pageData": {"sections": [`, count, count)
+		fmt.Fprintf(&sb, `{"pageSectionType": "image", "pageSectionData": {"imageType": "sf_symbol", "height": 60, "imageData": {"symbolName": "star.%v", "weight": "bold"}, "fallback": {"imageType": "local", "imageData": {"path": "star%v.png"}}}},`, count, count)
+		fmt.Fprintf(&sb, `{"pageSectionType": "title", "topSpacingScale": 2, "pageSectionData": {"title": "Modal %v", "scaleFactor": 1.5}},`, count)
+		fmt.Fprintf(&sb, `{"pageSectionType": "body", "pageSectionData": {"bodyText": "Body text for modal %v, long enough to wrap a few lines on a phone screen."}}`, count)
+		fmt.Fprintf(&sb, `], "buttons": [{"title": "Go", "style": "large", "actionName": "link%v"}, {"title": "Later", "style": "info"}]}}}},`, count)
+		fmt.Fprintf(&sb, `"link%v": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io/%v"}}`, count, count)
+		count++
+	}
+	sb.WriteString(`}}, "triggers": {"namedTriggers": {`)
+	for i := 0; i < count; i++ {
+		if i > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"trigger%v": {"eventName": "e%v", "actionName": "alert%v", "condition": "app_version >= '1.%v' && !(user_signed_in ?? false)"}`, i, i, i, i)
+	}
+	sb.WriteString(`}}, "conditions": {"namedConditions": {`)
+	for i := 0; i < count; i++ {
+		if i > 0 {
+			sb.WriteString(",")
+		}
+		fmt.Fprintf(&sb, `"condition%v": "versionGreaterThan(os_version, '%v.0') || eventCountSince('e%v', 86400) > 2"`, i, i%20, i)
+	}
+	sb.WriteString(`}}}`)
+	return []byte(sb.String())
+}
+
+func BenchmarkDecodePrimaryConfigJson(b *testing.B) {
+	data := testHelperBuildLargeConfigJson(1_000_000)
+	b.SetBytes(int64(len(data)))
+
+	b.Run("unmarshal", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			var pc PrimaryConfig
+			if err := json.Unmarshal(data, &pc); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+	b.Run("stream", func(b *testing.B) {
+		b.ReportAllocs()
+		for i := 0; i < b.N; i++ {
+			var pc PrimaryConfig
+			if err := decodePrimaryConfigJson(data, &pc, false); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
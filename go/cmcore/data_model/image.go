@@ -51,7 +51,11 @@ func (i *Image) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return NewUserPresentableErrorWSource("Unable to parse the json of an image.", err)
 	}
+	return i.applyJson(&ji, data)
+}
 
+// Shared by UnmarshalJSON and the streaming config decoder
+func (i *Image) applyJson(ji *jsonImage, data []byte) error {
 	i.ImageType = ji.ImageType
 	i.Fallback = ji.Fallback
 
@@ -0,0 +1,93 @@
+package datamodel
+
+import (
+	"encoding/json"
+	"sync"
+)
+
+/*
+Lazy action decoding
+
+Most actions in a config are never performed in a given session, but decoding them (particularly modals, with
+their page and image trees) is a large part of parsing a config. When decoding a signed config, the action data
+of named actions is kept as raw JSON, and only decoded on first use (ActionWithName).
+
+Startup validation of lazy actions is structural: the JSON is well formed, the action type is known, its data is
+an object, and the action's condition, fallback, and any triggers/notifications referencing it are fully checked
+as before. The remaining validation (the action data itself, and the themes and actions it references) runs when
+it's decoded. If that fails the action is treated as missing, and isn't performed. Signed configs were fully
+validated with Check() when signed (see EncodeConfig), so this should only happen for types which changed since.
+
+Unsigned and strict mode configs are always decoded eagerly, so developers see all errors on load.
+*/
+
+type lazyActionData struct {
+	raw json.RawMessage
+
+	// The config the action was decoded from, for validating references to other actions and themes
+	config *PrimaryConfig
+
+	once sync.Once
+	err  error
+}
+
+// Sets the header fields, and defers decoding the action data if possible. Returns false if the action data
+// must be decoded now: unknown types, and data which isn't an object, are decoded eagerly so errors are reported at load.
+func (ac *ActionContainer) deferActionData(jac *jsonActionContainer) bool {
+	if StrictDatamodelParsing {
+		return false
+	}
+	if _, ok := actionTypeRegistry[jac.ActionType]; !ok {
+		return false
+	}
+	if len(jac.RawActionData) == 0 || jac.RawActionData[0] != '{' {
+		return false
+	}
+
+	ac.ActionType = jac.ActionType
+	ac.Condition = jac.Condition
+	ac.FallbackActionName = jac.FallbackActionName
+	ac.lazyData = &lazyActionData{
+		raw: jac.RawActionData,
+	}
+	return true
+}
+
+// Decodes and validates the action data, if decoding was deferred. Safe to call concurrently; only decodes once.
+func (ac *ActionContainer) ensureDecoded() error {
+	lazy := ac.lazyData
+	if lazy == nil {
+		return nil
+	}
+	lazy.once.Do(func() {
+		lazy.err = lazy.decode(ac)
+	})
+	return lazy.err
+}
+
+// Only sets the action data and typed action field. The header fields were set at load, and may be read concurrently.
+func (lazy *lazyActionData) decode(ac *ActionContainer) error {
+	jac := jsonActionContainer{
+		ActionType:    ac.ActionType,
+		RawActionData: lazy.raw,
+	}
+	actionData, err := decodeActionContainerData(&jac, ac)
+	if err != nil {
+		return err
+	}
+	ac.actionData = actionData
+
+	// The same validations Check() runs for eagerly decoded actions
+	if issue := actionData.Check(); issue != nil {
+		return issue
+	}
+	if lazy.config != nil {
+		if issue := lazy.config.validateActionEmbeddedActionsExistReturningUserReadable(ac.name, ac); issue != "" {
+			return NewUserPresentableError(issue)
+		}
+		if issue := lazy.config.validateActionThemeNamesExistReturningUserReadable(ac.name, ac); issue != "" {
+			return NewUserPresentableError(issue)
+		}
+	}
+	return nil
+}
@@ -0,0 +1,187 @@
+package datamodel
+
+import (
+	"fmt"
+	"reflect"
+	"runtime"
+	"sync"
+	"testing"
+)
+
+func testHelperDecodeConfigJson(t testing.TB, data []byte, lazy bool) *PrimaryConfig {
+	var pc PrimaryConfig
+	if err := decodePrimaryConfigJson(data, &pc, lazy); err != nil {
+		t.Fatal(err)
+	}
+	return &pc
+}
+
+// Decodes every lazy action, and clears the lazy state so the config can be compared to an eagerly decoded one
+func testHelperForceDecodeActions(t testing.TB, pc *PrimaryConfig) int {
+	lazyCount := 0
+	for name, action := range pc.namedActions {
+		if action.lazyData != nil {
+			lazyCount++
+		}
+		if pc.ActionWithName(name) == nil {
+			t.Fatalf("Lazy action %v failed to decode", name)
+		}
+		action.lazyData = nil
+	}
+	return lazyCount
+}
+
+func TestLazyActionsMatchEager(t *testing.T) {
+	data := testHelperBuildLargeConfigJson(200_000)
+	eager := testHelperDecodeConfigJson(t, data, false)
+	lazy := testHelperDecodeConfigJson(t, data, true)
+
+	// Modals, alerts and links all have object data, so none should be decoded at load
+	if lazyCount := testHelperForceDecodeActions(t, lazy); lazyCount != len(lazy.namedActions) {
+		t.Fatalf("Expected all actions to be lazy, got %v of %v", lazyCount, len(lazy.namedActions))
+	}
+	if !reflect.DeepEqual(eager, lazy) {
+		t.Fatal("Lazy decoded config doesn't match eager")
+	}
+}
+
+func TestLazyActionsStrictModeIsEager(t *testing.T) {
+	StrictDatamodelParsing = true
+	defer func() { StrictDatamodelParsing = false }()
+
+	pc := testHelperDecodeConfigJson(t, testHelperBuildLargeConfigJson(10_000), true)
+	for name, action := range pc.namedActions {
+		if action.lazyData != nil {
+			t.Fatalf("Action %v was lazy in strict mode", name)
+		}
+	}
+}
+
+func TestLazyActionStructuralValidation(t *testing.T) {
+	invalid := map[string]string{
+		"syntax error":     `"m": {"actionType": "modal", "actionData": {"content": }}`,
+		"missing fallback": `"m": {"actionType": "link", "fallback": "missing", "actionData": {"url": "https://criticalmoments.io"}}`,
+		"data not object":  `"m": {"actionType": "link", "actionData": "https://criticalmoments.io"}`,
+		"trigger missing":  `"m": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}}}}, "triggers": {"namedTriggers": {"t": {"eventName": "e", "actionName": "other"}`,
+	}
+	for name, actions := range invalid {
+		config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {` + actions + `}}}`
+		var pc PrimaryConfig
+		if err := decodePrimaryConfigJson([]byte(config), &pc, true); err == nil {
+			t.Fatalf("Lazy decode allowed invalid config: %v", name)
+		}
+	}
+}
+
+func TestLazyActionInvalidData(t *testing.T) {
+	config := `{"configVersion": "v1", "appId": "io.criticalmoments.demo", "actions": {"namedActions": {
+		"badImage": {"actionType": "modal", "actionData": {"content": {"pageType": "stack", "pageData": {"sections": [{"pageSectionType": "image", "pageSectionData": {"imageType": "local"}}]}}}},
+		"badButton": {"actionType": "alert", "actionData": {"title": "t", "customButtons": [{"label": "Go", "actionName": "missing"}]}},
+		"good": {"actionType": "link", "actionData": {"url": "https://criticalmoments.io"}}
+	}}}`
+
+	// Eager decoding reports the issues at load
+	var eager PrimaryConfig
+	if err := decodePrimaryConfigJson([]byte(config), &eager, false); err == nil {
+		t.Fatal("Eager decode allowed invalid action data")
+	}
+
+	// Lazy decoding treats invalid actions as missing
+	pc := testHelperDecodeConfigJson(t, []byte(config), true)
+	for _, name := range []string{"badImage", "badButton"} {
+		if pc.ActionWithName(name) != nil {
+			t.Fatalf("Invalid lazy action %v returned", name)
+		}
+		if pc.namedActions[name].Check() == nil {
+			t.Fatalf("Invalid lazy action %v passed check", name)
+		}
+	}
+	if pc.ActionWithName("good") == nil || pc.ActionWithName("good").LinkAction == nil {
+		t.Fatal("Valid lazy action not returned")
+	}
+	if len(pc.AllActions()) != 1 {
+		t.Fatal("AllActions should omit invalid lazy actions")
+	}
+}
+
+func TestLazyActionConcurrentDecode(t *testing.T) {
+	pc := testHelperDecodeConfigJson(t, testHelperBuildLargeConfigJson(50_000), true)
+	names := make([]string, 0, len(pc.namedActions))
+	for name := range pc.namedActions {
+		names = append(names, name)
+	}
+
+	var wg sync.WaitGroup
+	results := make([][]*ActionContainer, 8)
+	for g := range results {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for _, name := range names {
+				results[g] = append(results[g], pc.ActionWithName(name))
+			}
+		}(g)
+	}
+	wg.Wait()
+
+	for g := range results {
+		for i, action := range results[g] {
+			if action == nil || action != results[0][i] || action.actionData == nil {
+				t.Fatalf("Concurrent decode of %v failed", names[i])
+			}
+		}
+	}
+}
+
+func TestConfigSnapshotLazyActions(t *testing.T) {
+	data := testHelperBuildLargeConfigJson(20_000)
+	pc := testHelperDecodeConfigJson(t, data, true)
+	// One decoded before the snapshot, the rest still lazy
+	if pc.ActionWithName("modal0") == nil {
+		t.Fatal("Failed to decode action")
+	}
+
+	b, err := EncodePrimaryConfigSnapshot(pc, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	spc, err := DecodePrimaryConfigSnapshot(b, "hash", "sig", "1.0.0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if spc.namedActions["modal1"].lazyData == nil {
+		t.Fatal("Lazy action was decoded by snapshot")
+	}
+
+	testHelperForceDecodeActions(t, spc)
+	if !reflect.DeepEqual(testHelperDecodeConfigJson(t, data, false), spc) {
+		t.Fatal("Lazy snapshot doesn't match eager config")
+	}
+}
+
+// Reports startup time, and heap retained by the decoded config, for eager and lazy action decoding
+func BenchmarkLazyActionDecoding(b *testing.B) {
+	data := testHelperBuildLargeConfigJson(1_000_000)
+	b.SetBytes(int64(len(data)))
+
+	for _, lazy := range []bool{false, true} {
+		b.Run(fmt.Sprintf("lazy=%v", lazy), func(b *testing.B) {
+			b.ReportAllocs()
+			var pc *PrimaryConfig
+			for i := 0; i < b.N; i++ {
+				pc = testHelperDecodeConfigJson(b, data, lazy)
+			}
+
+			b.StopTimer()
+			var before, after runtime.MemStats
+			pc = nil
+			runtime.GC()
+			runtime.ReadMemStats(&before)
+			pc = testHelperDecodeConfigJson(b, data, lazy)
+			runtime.GC()
+			runtime.ReadMemStats(&after)
+			b.ReportMetric(float64(after.HeapAlloc-before.HeapAlloc)/1024, "retained-KB")
+			runtime.KeepAlive(pc)
+		})
+	}
+}
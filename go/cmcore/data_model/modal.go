@@ -43,7 +43,11 @@ func (m *ModalAction) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return NewUserPresentableErrorWSource("Unable to parse the json of an action with type=modal. Check the format, variable names, and types.", err)
 	}
+	return m.applyJson(&jm, data)
+}
 
+// Shared by UnmarshalJSON and the streaming config decoder
+func (m *ModalAction) applyJson(jm *jsonModalAction, data []byte) error {
 	// Defaults
 	showCloseButton := true
 	if jm.ShowCloseButton != nil {
@@ -53,6 +53,9 @@ type Notification struct {
 
 	IdealDeliveryConditions *IdealDeliveryConditions
 	CancelationEvents       *[]string
+
+	// Built at config load. See config_index.go
+	scheduleConditionFields *ConditionFields
 }
 
 type IdealDeliveryConditions struct {
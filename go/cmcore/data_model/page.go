@@ -34,7 +34,11 @@ func (p *Page) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return NewUserPresentableErrorWSource("Unable to parse the json of a page.", err)
 	}
+	return p.applyJson(&jp, data)
+}
 
+// Shared by UnmarshalJSON and the streaming config decoder
+func (p *Page) applyJson(jp *jsonPage, data []byte) error {
 	if jp.PageType == PageTypeEnumStack {
 		p.Sections = jp.PageData.Sections
 		p.Buttons = jp.PageData.Buttons
@@ -121,7 +125,12 @@ func (s *PageSection) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return NewUserPresentableErrorWSource("Unable to parse the json of a page.", err)
 	}
+	return s.applyJson(&js, data, nil)
+}
 
+// Shared by UnmarshalJSON and the streaming config decoder. sectionData is the section data if it was already
+// decoded while streaming, otherwise it's unpacked from js.RawSectionData.
+func (s *PageSection) applyJson(js *jsonPageSection, data []byte, sectionData pageSectionTypeInterface) error {
 	s.PageSectionType = js.PageSectionType
 
 	s.TopSpacingScale = 1.0
@@ -137,6 +146,8 @@ func (s *PageSection) UnmarshalJSON(data []byte) error {
 			// back-compat -- fallback to unknown section type
 			s.pageSectionData = UnknownSection{}
 		}
+	} else if sectionData != nil {
+		s.pageSectionData = sectionData
 	} else {
 		pageSectionData, err := unpacker(js.RawSectionData, s)
 		if err != nil {
@@ -44,6 +44,12 @@ type PrimaryConfig struct {
 
 	// Notifications
 	Notifications map[string]*Notification
+
+	// Indexes built at load. See config_index.go
+	triggersByEvent                    map[string][]*Trigger
+	notificationsByEvent               map[string]*notificationEventIndex
+	notificationsByProperty            map[string][]*Notification
+	notificationsWithUnknownProperties []*Notification
 }
 
 func (pc *PrimaryConfig) DefaultTheme() *Theme {
@@ -71,6 +77,10 @@ func (pc *PrimaryConfig) IncludesCustomThemes() bool {
 func (pc *PrimaryConfig) ActionWithName(name string) *ActionContainer {
 	action, ok := pc.namedActions[name]
 	if ok {
+		if err := action.ensureDecoded(); err != nil {
+			fmt.Printf("CriticalMoments: action \"%v\" is invalid and will not be performed: %v\n", name, err)
+			return nil
+		}
 		return action
 	}
 	return nil
@@ -84,14 +94,9 @@ func (pc *PrimaryConfig) ConditionWithName(name string) *Condition {
 	return nil
 }
 
+// Returns the triggers for an event, ordered by trigger name. The slice is shared, and must not be modified.
 func (pc *PrimaryConfig) TriggersForEvent(eventName string) []*Trigger {
-	triggers := make([]*Trigger, 0)
-	for _, trigger := range pc.namedTriggers {
-		if trigger.EventName == eventName {
-			triggers = append(triggers, trigger)
-		}
-	}
-	return triggers
+	return pc.triggersByEvent[eventName]
 }
 
 // Container Decoding
@@ -102,6 +107,13 @@ const primaryConfigConfigSignatureHeader = "Signature"
 const primaryConfigHeadContainerVersion = "Container-Version"
 
 func DecodePrimaryConfig(data []byte, signUtil *signing.SignUtil) (*PrimaryConfig, error) {
+	pc, _, err := DecodePrimaryConfigWithSignature(data, signUtil)
+	return pc, err
+}
+
+// As DecodePrimaryConfig, also returning the CONFIG block's verified signature. Lets callers which need the
+// signature (such as for a config snapshot) avoid verifying it a second time.
+func DecodePrimaryConfigWithSignature(data []byte, signUtil *signing.SignUtil) (*PrimaryConfig, string, error) {
 	pc := &PrimaryConfig{}
 
 	var rest []byte
@@ -121,37 +133,60 @@ func DecodePrimaryConfig(data []byte, signUtil *signing.SignUtil) (*PrimaryConfi
 		case primaryConfigConfigPemBlock:
 			configBytes = block.Bytes
 			configSignature = block.Headers[primaryConfigConfigSignatureHeader]
-			err := json.Unmarshal(block.Bytes, pc)
+			// Signed configs were fully validated when signed, so actions can be decoded on first use
+			err := decodePrimaryConfigJson(block.Bytes, pc, true)
 			if err != nil {
-				return nil, err
+				return nil, "", err
 			}
 		case primaryConfigHeadPemBlock:
 			err := pc.ParseHeadBlock(block)
 			if err != nil {
-				return nil, err
+				return nil, "", err
 			}
 		}
 	}
 
 	// Validate CM block
 	if pc.ContainerVersion == "" {
-		return nil, NewUserPresentableError("Config file not signed: no valid CM block found in config file")
+		return nil, "", NewUserPresentableError("Config file not signed: no valid CM block found in config file")
 	}
 
 	// Validate CONFIG block
 	if len(configBytes) == 0 {
-		return nil, NewUserPresentableError("No CONFIG block found in config file")
+		return nil, "", NewUserPresentableError("No CONFIG block found in config file")
 	}
 	err := ValidateSignature(signUtil, configBytes, configSignature)
 	if err != nil {
-		return nil, err
+		return nil, "", err
 	}
 	configErr := pc.Check()
 	if configErr != nil {
-		return nil, configErr
+		return nil, "", configErr
 	}
 
-	return pc, nil
+	return pc, configSignature, nil
+}
+
+// Verifies the signature of a config file's CONFIG block, without parsing the config. Returns the verified
+// signature. Used to check a config file is still signed before using a pre-parsed snapshot of it. When decoding
+// the config anyway, use DecodePrimaryConfigWithSignature instead.
+func VerifyPrimaryConfigSignature(data []byte, signUtil *signing.SignUtil) (string, error) {
+	rest := data
+	for len(rest) > 0 {
+		var block *pem.Block
+		block, rest = pem.Decode(rest)
+		if block == nil {
+			break
+		}
+		if block.Type == primaryConfigConfigPemBlock {
+			configSignature := block.Headers[primaryConfigConfigSignatureHeader]
+			if err := ValidateSignature(signUtil, block.Bytes, configSignature); err != nil {
+				return "", err
+			}
+			return configSignature, nil
+		}
+	}
+	return "", NewUserPresentableError("No CONFIG block found in config file")
 }
 
 func (pc *PrimaryConfig) ParseHeadBlock(b *pem.Block) error {
@@ -275,7 +310,11 @@ func (pc *PrimaryConfig) UnmarshalJSON(data []byte) error {
 	if err != nil {
 		return NewUserPresentableErrorWSource("Invalid Critical Moments config file", err)
 	}
+	return pc.applyJson(&jpc)
+}
 
+// Shared by UnmarshalJSON and the streaming config decoder
+func (pc *PrimaryConfig) applyJson(jpc *jsonPrimaryConfig) error {
 	pc.ConfigVersion = jpc.ConfigVersion
 	pc.AppId = jpc.AppId
 	pc.MinAppVersion = jpc.MinAppVersion
@@ -341,28 +380,43 @@ func (pc *PrimaryConfig) UnmarshalJSON(data []byte) error {
 		pc.Notifications = make(map[string]*Notification)
 	}
 
+	pc.buildIndexes()
+
 	// Don't output "data" because it's the whole config here. Doesn't help narrow down the issue.
 	return pc.Check()
 }
 
 func (pc *PrimaryConfig) NameForActionContainer(c *ActionContainer) string {
-	for name, action := range pc.namedActions {
-		if action == c {
-			return name
-		}
+	// The name is only valid if c is from this config
+	if c != nil && c.name != "" && pc.namedActions[c.name] == c {
+		return c.name
 	}
 	return ""
 }
 
 func (pc *PrimaryConfig) NameForCondition(c *Condition) string {
-	for name, condition := range pc.namedConditions {
-		if condition == c {
-			return name
-		}
+	if c != nil && c.name != "" && pc.namedConditions[c.name] == c {
+		return c.name
 	}
 	return ""
 }
 
+// The events recorded when performing the action, or nil if c isn't a named action from this config
+func (pc *PrimaryConfig) EventsForActionContainer(c *ActionContainer) *ActionEvents {
+	if pc.NameForActionContainer(c) == "" {
+		return nil
+	}
+	return c.events
+}
+
+// The events recorded when checking the condition by name, or nil if c isn't a named condition from this config
+func (pc *PrimaryConfig) EventsForCondition(c *Condition) *ConditionEvents {
+	if pc.NameForCondition(c) == "" {
+		return nil
+	}
+	return c.events
+}
+
 func (pc *PrimaryConfig) themeIteratingFallbacks(t *Theme) *Theme {
 	if t == nil {
 		return nil
@@ -450,6 +504,10 @@ func (pc *PrimaryConfig) checkNested() UserPresentableErrorInterface {
 		}
 	}
 	for actionName, action := range pc.namedActions {
+		if action.lazyData != nil {
+			// Validated when decoded. See lazy_actions.go
+			continue
+		}
 		if actionValidationIssue := action.Check(); actionValidationIssue != nil {
 			return NewUserPresentableErrorWSource(fmt.Sprintf("Action \"%v\" had issue", actionName), actionValidationIssue)
 		}
@@ -479,32 +537,42 @@ func (pc *PrimaryConfig) validateMapsDontContainEmptyStringReturningUserReadable
 }
 
 func (pc *PrimaryConfig) validateThemeNamesExistReturningUserReadable() string {
-	allBuiltInThemeNames := AllBuiltInThemeNames()
 	for sourceActionName, action := range pc.namedActions {
-		if action.ActionType == "" || action.actionData == nil {
-			return "Internal issue. Code 15234328"
-		}
-		themeList, err := action.actionData.AllEmbeddedThemeNames()
-		if err != nil || themeList == nil {
-			return fmt.Sprintf("Internal issue for action \"%v\". Code: 88456198", sourceActionName)
-		}
-		for _, themeName := range themeList {
-			isBuiltIn := slices.Contains(allBuiltInThemeNames, themeName)
-			_, hasNamedTheme := pc.namedThemes[themeName]
-			if !hasNamedTheme && !isBuiltIn {
-				// New built in names may be added later. Older devices should ignore unknown names.
-				if StrictDatamodelParsing {
-					return fmt.Sprintf("Action \"%v\" specified named theme \"%v\", which doesn't exist", sourceActionName, themeName)
-				} else {
-					fmt.Println("CriticalMoments: WARNING - Action specified named theme that doesn't exist. Will fallback to system default theme.")
-				}
-			}
+		if action.lazyData != nil {
+			continue
+		}
+		if issue := pc.validateActionThemeNamesExistReturningUserReadable(sourceActionName, action); issue != "" {
+			return issue
 		}
 	}
 
 	return ""
 }
 
+func (pc *PrimaryConfig) validateActionThemeNamesExistReturningUserReadable(sourceActionName string, action *ActionContainer) string {
+	if action.ActionType == "" || action.actionData == nil {
+		return "Internal issue. Code 15234328"
+	}
+	themeList, err := action.actionData.AllEmbeddedThemeNames()
+	if err != nil || themeList == nil {
+		return fmt.Sprintf("Internal issue for action \"%v\". Code: 88456198", sourceActionName)
+	}
+	allBuiltInThemeNames := AllBuiltInThemeNames()
+	for _, themeName := range themeList {
+		isBuiltIn := slices.Contains(allBuiltInThemeNames, themeName)
+		_, hasNamedTheme := pc.namedThemes[themeName]
+		if !hasNamedTheme && !isBuiltIn {
+			// New built in names may be added later. Older devices should ignore unknown names.
+			if StrictDatamodelParsing {
+				return fmt.Sprintf("Action \"%v\" specified named theme \"%v\", which doesn't exist", sourceActionName, themeName)
+			} else {
+				fmt.Println("CriticalMoments: WARNING - Action specified named theme that doesn't exist. Will fallback to system default theme.")
+			}
+		}
+	}
+	return ""
+}
+
 func (pc *PrimaryConfig) validateEmbeddedActionsExistReturningUserReadable() string {
 	// Validate the actions in the trigger actually exist
 	for tName, t := range pc.namedTriggers {
@@ -516,18 +584,11 @@ func (pc *PrimaryConfig) validateEmbeddedActionsExistReturningUserReadable() str
 
 	// validate any named actions embedded in other actions actually exist
 	for sourceActionName, action := range pc.namedActions {
-		if action.ActionType == "" || action.actionData == nil {
-			return "Internal issue. Code 98347134"
-		}
-		actionList, err := action.actionData.AllEmbeddedActionNames()
-		if err != nil || actionList == nil {
-			return fmt.Sprintf("Internal issue for action \"%v\". Code: 798853616", sourceActionName)
+		if action.lazyData != nil {
+			continue
 		}
-		for _, actionName := range actionList {
-			_, ok := pc.namedActions[actionName]
-			if !ok {
-				return fmt.Sprintf("Action \"%v\" specified named action \"%v\", which doesn't exist", sourceActionName, actionName)
-			}
+		if issue := pc.validateActionEmbeddedActionsExistReturningUserReadable(sourceActionName, action); issue != "" {
+			return issue
 		}
 	}
 
@@ -544,6 +605,23 @@ func (pc *PrimaryConfig) validateEmbeddedActionsExistReturningUserReadable() str
 	return ""
 }
 
+func (pc *PrimaryConfig) validateActionEmbeddedActionsExistReturningUserReadable(sourceActionName string, action *ActionContainer) string {
+	if action.ActionType == "" || action.actionData == nil {
+		return "Internal issue. Code 98347134"
+	}
+	actionList, err := action.actionData.AllEmbeddedActionNames()
+	if err != nil || actionList == nil {
+		return fmt.Sprintf("Internal issue for action \"%v\". Code: 798853616", sourceActionName)
+	}
+	for _, actionName := range actionList {
+		_, ok := pc.namedActions[actionName]
+		if !ok {
+			return fmt.Sprintf("Action \"%v\" specified named action \"%v\", which doesn't exist", sourceActionName, actionName)
+		}
+	}
+	return ""
+}
+
 func (pc *PrimaryConfig) validateFallbackNames() string {
 	for themeName, theme := range pc.namedThemes {
 		if theme.FallbackThemeName != "" {
@@ -585,6 +663,9 @@ func (pc *PrimaryConfig) AllConditions() ([]*Condition, error) {
 	}
 
 	for _, a := range pc.namedActions {
+		if err := a.ensureDecoded(); err != nil {
+			return nil, err
+		}
 		if a.Condition != nil {
 			all = append(all, a.Condition)
 		}
@@ -613,10 +694,61 @@ func (pc *PrimaryConfig) AllConditions() ([]*Condition, error) {
 	return all, nil
 }
 
+// Names the config entity each condition belongs to, for attributing evaluations: "condition:<name>",
+// "trigger:<name>", "action:<name>" (the action's condition), "action:<name>/embedded" (conditions in its
+// action data, like a conditional action), "notification:<id>/schedule" and "notification:<id>/ideal_delivery".
+// Decodes lazy actions, so not for the event path.
+func (pc *PrimaryConfig) ConditionEntities() map[*Condition]string {
+	entities := make(map[*Condition]string)
+	for name, c := range pc.namedConditions {
+		if c != nil {
+			entities[c] = "condition:" + name
+		}
+	}
+	for name, t := range pc.namedTriggers {
+		if t != nil && t.Condition != nil {
+			entities[t.Condition] = "trigger:" + name
+		}
+	}
+	for name, a := range pc.namedActions {
+		if a == nil {
+			continue
+		}
+		if a.Condition != nil {
+			entities[a.Condition] = "action:" + name
+		}
+		if a.ensureDecoded() != nil || a.actionData == nil {
+			continue
+		}
+		if embedded, err := a.actionData.AllEmbeddedConditions(); err == nil {
+			for _, c := range embedded {
+				if c != nil {
+					entities[c] = "action:" + name + "/embedded"
+				}
+			}
+		}
+	}
+	for id, n := range pc.Notifications {
+		if n == nil {
+			continue
+		}
+		if n.ScheduleCondition != nil {
+			entities[n.ScheduleCondition] = "notification:" + id + "/schedule"
+		}
+		if n.IdealDeliveryConditions != nil {
+			entities[&n.IdealDeliveryConditions.Condition] = "notification:" + id + "/ideal_delivery"
+		}
+	}
+	return entities
+}
+
 func (pc *PrimaryConfig) AllActions() []*ActionContainer {
 	all := make([]*ActionContainer, 0)
-	for _, a := range pc.namedActions {
-		all = append(all, a)
+	for name := range pc.namedActions {
+		// Invalid lazily decoded actions are omitted, like ActionWithName
+		if a := pc.ActionWithName(name); a != nil {
+			all = append(all, a)
+		}
 	}
 	return all
 }
@@ -0,0 +1,153 @@
+package datamodel
+
+import (
+	"math"
+	"reflect"
+	"time"
+)
+
+/*
+Property values
+
+A PropertyValue holds one property value of a valid property type (see ValidPropertyTypes), or nil. The type is a
+tag and the value is stored inline, so values pass through providers, the property registry and property history
+without being boxed into an interface{}, and without reflection to find their type. Interface() boxes the value
+for places that need it, such as condition environments.
+
+The zero value is nil. Times are stored as unix seconds and nanoseconds, and are returned in the local location
+without a monotonic clock reading.
+*/
+
+type propertyValueTag uint8
+
+const (
+	propertyValueNil propertyValueTag = iota
+	propertyValueBool
+	propertyValueString
+	propertyValueInt
+	propertyValueFloat
+	propertyValueTime
+)
+
+type PropertyValue struct {
+	tag propertyValueTag
+	// Time nanoseconds
+	nsec int32
+	// Int value, bool (0/1), float bits, or time unix seconds
+	bits int64
+	str  string
+}
+
+func NewBoolPropertyValue(v bool) PropertyValue {
+	var bits int64
+	if v {
+		bits = 1
+	}
+	return PropertyValue{tag: propertyValueBool, bits: bits}
+}
+
+func NewStringPropertyValue(v string) PropertyValue {
+	return PropertyValue{tag: propertyValueString, str: v}
+}
+
+func NewIntPropertyValue(v int64) PropertyValue {
+	return PropertyValue{tag: propertyValueInt, bits: v}
+}
+
+func NewFloatPropertyValue(v float64) PropertyValue {
+	return PropertyValue{tag: propertyValueFloat, bits: int64(math.Float64bits(v))}
+}
+
+func NewTimePropertyValue(v time.Time) PropertyValue {
+	return PropertyValue{tag: propertyValueTime, bits: v.Unix(), nsec: int32(v.Nanosecond())}
+}
+
+// Converts a boxed value. Values of types which aren't valid property types (including nil) return the nil value.
+// Both int and int64 are ints.
+func PropertyValueFromInterface(v interface{}) PropertyValue {
+	switch v := v.(type) {
+	case bool:
+		return NewBoolPropertyValue(v)
+	case string:
+		return NewStringPropertyValue(v)
+	case int:
+		return NewIntPropertyValue(int64(v))
+	case int64:
+		return NewIntPropertyValue(v)
+	case float64:
+		return NewFloatPropertyValue(v)
+	case time.Time:
+		return NewTimePropertyValue(v)
+	}
+	return PropertyValue{}
+}
+
+// The property type, matching ValidPropertyTypes. reflect.Invalid for nil.
+func (v PropertyValue) Kind() reflect.Kind {
+	switch v.tag {
+	case propertyValueBool:
+		return reflect.Bool
+	case propertyValueString:
+		return reflect.String
+	case propertyValueInt:
+		return reflect.Int
+	case propertyValueFloat:
+		return reflect.Float64
+	case propertyValueTime:
+		return CMTimeKind
+	}
+	return reflect.Invalid
+}
+
+func (v PropertyValue) IsNil() bool {
+	return v.tag == propertyValueNil
+}
+
+// Typed accessors return the zero value if the value is of another type
+
+func (v PropertyValue) BoolValue() bool {
+	return v.tag == propertyValueBool && v.bits != 0
+}
+
+func (v PropertyValue) StringValue() string {
+	return v.str
+}
+
+func (v PropertyValue) IntValue() int64 {
+	if v.tag != propertyValueInt {
+		return 0
+	}
+	return v.bits
+}
+
+func (v PropertyValue) FloatValue() float64 {
+	if v.tag != propertyValueFloat {
+		return 0
+	}
+	return math.Float64frombits(uint64(v.bits))
+}
+
+func (v PropertyValue) TimeValue() time.Time {
+	if v.tag != propertyValueTime {
+		return time.Time{}
+	}
+	return time.Unix(v.bits, int64(v.nsec))
+}
+
+// The value boxed, as conditions see it: bool, string, int, float64, time.Time, or nil. Allocates for most values,
+// so avoid on hot paths, or box once and reuse.
+func (v PropertyValue) Interface() interface{} {
+	switch v.tag {
+	case propertyValueBool:
+		return v.BoolValue()
+	case propertyValueString:
+		return v.str
+	case propertyValueInt:
+		return int(v.bits)
+	case propertyValueFloat:
+		return v.FloatValue()
+	case propertyValueTime:
+		return v.TimeValue()
+	}
+	return nil
+}
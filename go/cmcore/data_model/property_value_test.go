@@ -0,0 +1,78 @@
+package datamodel
+
+import (
+	"reflect"
+	"testing"
+	"time"
+	"unsafe"
+)
+
+func TestPropertyValueTypes(t *testing.T) {
+	now := time.Now()
+	cases := []struct {
+		value    PropertyValue
+		kind     reflect.Kind
+		expected interface{}
+	}{
+		{PropertyValue{}, reflect.Invalid, nil},
+		{NewBoolPropertyValue(true), reflect.Bool, true},
+		{NewBoolPropertyValue(false), reflect.Bool, false},
+		{NewStringPropertyValue("a"), reflect.String, "a"},
+		{NewIntPropertyValue(-42), reflect.Int, -42},
+		{NewFloatPropertyValue(3.3), reflect.Float64, 3.3},
+		{NewTimePropertyValue(now), CMTimeKind, now},
+	}
+	for _, c := range cases {
+		if c.value.Kind() != c.kind || c.value.IsNil() != (c.kind == reflect.Invalid) {
+			t.Fatalf("Unexpected kind for %v", c.expected)
+		}
+		if tv, ok := c.expected.(time.Time); ok {
+			if !c.value.Interface().(time.Time).Equal(tv) || !c.value.TimeValue().Equal(tv) {
+				t.Fatal("Time value not preserved")
+			}
+		} else if c.value.Interface() != c.expected {
+			t.Fatalf("Unexpected value %v for %v", c.value.Interface(), c.expected)
+		}
+		if c.value.Kind() != reflect.Invalid && c.value.Kind() != CMTypeFromValue(c.value.Interface()) {
+			t.Fatalf("Kind doesn't match CMTypeFromValue for %v", c.expected)
+		}
+	}
+
+	// Typed accessors don't reinterpret other types
+	if NewIntPropertyValue(1).BoolValue() || NewFloatPropertyValue(1).IntValue() != 0 || NewIntPropertyValue(1).FloatValue() != 0 {
+		t.Fatal("Accessor reinterpreted value of another type")
+	}
+	if !NewIntPropertyValue(1).TimeValue().IsZero() || NewIntPropertyValue(1).StringValue() != "" {
+		t.Fatal("Accessor reinterpreted value of another type")
+	}
+	if NewIntPropertyValue(1<<40).IntValue() != 1<<40 {
+		t.Fatal("Int value truncated")
+	}
+	if NewTimePropertyValue(time.UnixMilli(-1)).TimeValue().UnixMilli() != -1 {
+		t.Fatal("Time before epoch not preserved")
+	}
+}
+
+func TestPropertyValueFromInterface(t *testing.T) {
+	now := time.Now()
+	if PropertyValueFromInterface("a") != NewStringPropertyValue("a") ||
+		PropertyValueFromInterface(2) != NewIntPropertyValue(2) ||
+		PropertyValueFromInterface(int64(2)) != NewIntPropertyValue(2) ||
+		PropertyValueFromInterface(2.5) != NewFloatPropertyValue(2.5) ||
+		PropertyValueFromInterface(true) != NewBoolPropertyValue(true) ||
+		PropertyValueFromInterface(now) != NewTimePropertyValue(now) {
+		t.Fatal("Failed to convert valid value")
+	}
+	for _, invalid := range []interface{}{nil, int32(1), float32(1), []string{}, &now} {
+		if !PropertyValueFromInterface(invalid).IsNil() {
+			t.Fatalf("Converted invalid value %v", invalid)
+		}
+	}
+}
+
+func TestPropertyValueSize(t *testing.T) {
+	// Tag and time nanoseconds packed in one word, then bits and the string header
+	if unsafe.Sizeof(PropertyValue{}) > 32 {
+		t.Fatalf("PropertyValue grew to %v bytes", unsafe.Sizeof(PropertyValue{}))
+	}
+}
@@ -0,0 +1,31 @@
+// Evaluates a config's conditions against a columnar snapshot of devices, and prints the match counts as JSON.
+// See the snapshot format in appcore/offline_evaluator.go.
+//
+//	go run ./cmd/offline_eval -config cm_config.json -snapshot devices.json
+package main
+
+import (
+	"flag"
+	"fmt"
+	"os"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore"
+)
+
+func main() {
+	configPath := flag.String("config", "", "config file, signed or unsigned")
+	snapshotPath := flag.String("snapshot", "", "columnar snapshot of device properties and event aggregates")
+	workers := flag.Int("workers", 0, "evaluation workers, 0 for all CPUs")
+	flag.Parse()
+	if *configPath == "" || *snapshotPath == "" {
+		flag.Usage()
+		os.Exit(2)
+	}
+
+	report, err := appcore.RunOfflineEvaluation(*configPath, *snapshotPath, *workers)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "CriticalMoments: offline evaluation failed: %v\n", err)
+		os.Exit(1)
+	}
+	fmt.Println(report)
+}
@@ -0,0 +1,30 @@
+// Replays a trace recorded with Appcore.StartTraceRecording, and prints the actions fired, notification plans
+// produced and stage latencies as JSON. See appcore/trace_replay.go.
+//
+//	go run ./cmd/trace_replay -trace session.cmtrace -config cm_config.json
+package main
+
+import (
+	"flag"
+	"fmt"
+	"os"
+
+	"github.com/CriticalMoments/CriticalMoments/go/appcore"
+)
+
+func main() {
+	tracePath := flag.String("trace", "", "trace file")
+	configPath := flag.String("config", "", "config file the trace was recorded with")
+	flag.Parse()
+	if *tracePath == "" || *configPath == "" {
+		flag.Usage()
+		os.Exit(2)
+	}
+
+	report, err := appcore.ReplayTrace(*tracePath, *configPath)
+	if err != nil {
+		fmt.Fprintf(os.Stderr, "CriticalMoments: trace replay failed: %v\n", err)
+		os.Exit(1)
+	}
+	fmt.Println(report)
+}
@@ -32,6 +32,9 @@ NS_ASSUME_NONNULL_BEGIN
           builtIn:(bool)builtIn
           handler:(void (^_Nullable)(NSError *_Nullable error))handler;
 
+// Internal only -- process all events sent so far, before entering background or terminating
+- (void)flushEventsWithHandler:(void (^_Nullable)(void))handler;
+
 /// Access named themes
 - (DatamodelTheme *)themeFromConfigByName:(NSString *)name;
 
@@ -56,8 +59,9 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)disableUserNotifications;
 - (BOOL)userNotificationsDisabled;
 
-/// Private API to perform appcore work in background
-- (void)runAppcoreBackgroundWork;
+/// Private API to perform appcore work in background. Returns the next time background work should run (epoch
+/// seconds), or 0 if none
+- (int64_t)runAppcoreBackgroundWork:(NSError *_Nullable *_Nullable)error;
 
 /// Access the background handler, internal only, private API
 @property(nonatomic, strong) CMBackgroundHandler *backgroundHandler;
@@ -97,18 +97,25 @@
 }
 
 - (void)runBackgroundWorker:(BGTask *)task API_AVAILABLE(ios(13.0)) {
-    // Schedule next refresh. Currently only notifications need it, but can introduce others here as well.
+    // Appcore processes the work which is due, and returns when it next needs to run. Currently only notifications
+    // need it, but can introduce others here as well.
     NSError *error;
-    AppcoreNotificationPlan *plan = [self.cm currentNotificationPlan:&error];
+    int64_t nextWakeEpochSeconds = [self.cm runAppcoreBackgroundWork:&error];
     if (error) {
-        NSLog(@"CriticalMoments: error getting notification plan in runBackgroundWorker: %@",
-              error.localizedDescription);
-    }
-    if (plan) {
-        [self scheduleBackgroundTaskAtEpochTime:plan.earliestBgCheckTimeEpochSeconds];
+        // Keep the schedule from the current plan
+        error = nil;
+        AppcoreNotificationPlan *plan = [self.cm currentNotificationPlan:&error];
+        if (error) {
+            NSLog(@"CriticalMoments: error getting notification plan in runBackgroundWorker: %@",
+                  error.localizedDescription);
+        }
+        if (plan) {
+            [self scheduleBackgroundTaskAtEpochTime:plan.earliestBgCheckTimeEpochSeconds];
+        }
+    } else {
+        [self scheduleBackgroundTaskAtEpochTime:nextWakeEpochSeconds];
     }
 
-    [self.cm runAppcoreBackgroundWork];
     [self.cm sendEvent:DatamodelAppBgWorkBuiltInEvent builtIn:YES handler:nil];
 
     [task setTaskCompletedWithSuccess:YES];
@@ -352,10 +352,15 @@ static CriticalMoments *sharedInstance = nil;
     __block NSString *blockEventName = eventName;
     dispatch_async(_eventQueue, ^{
       NSError *error;
+      // Appcore processes events in order on its own queue. Only wait for the result if there's a handler for it.
+      AppcoreEventFuture *future;
       if (builtIn) {
-          [_appcore sendBuiltInEvent:blockEventName error:&error];
+          future = [_appcore enqueueBuiltInEvent:blockEventName error:&error];
       } else {
-          [_appcore sendClientEvent:blockEventName error:&error];
+          future = [_appcore enqueueClientEvent:blockEventName error:&error];
+      }
+      if (future && blockHandler) {
+          [future wait:&error];
       }
       if (error) {
           NSLog(@"CriticalMoments: Error sending event. %@", error.localizedDescription);
@@ -367,6 +372,21 @@ static CriticalMoments *sharedInstance = nil;
     });
 }
 
+- (void)flushEventsWithHandler:(void (^_Nullable)(void))handler {
+    __block void (^blockHandler)(void) = handler;
+    dispatch_async(_eventQueue, ^{
+      NSError *error;
+      [_appcore flushEvents:&error];
+      if (error) {
+          NSLog(@"CriticalMoments: Error flushing events. %@", error.localizedDescription);
+      }
+
+      if (blockHandler) {
+          blockHandler();
+      }
+    });
+}
+
 - (void)checkNamedCondition:(NSString *)name handler:(void (^)(bool, NSError *_Nullable))handler {
     [self checkNamedCondition:name completionHandler:handler];
 }
@@ -496,12 +516,14 @@ static CriticalMoments *sharedInstance = nil;
     [bgh registerBackgroundTasks];
 }
 
-- (void)runAppcoreBackgroundWork {
-    NSError *error;
-    [_appcore performBackgroundWork:&error];
-    if (error) {
+- (int64_t)runAppcoreBackgroundWork:(NSError *_Nullable *_Nullable)error {
+    int64_t nextWakeEpochSeconds = 0;
+    [_appcore performBackgroundWork:&nextWakeEpochSeconds error:error];
+    if (error && *error) {
         os_log_error(OS_LOG_DEFAULT, "CriticalMoments: issue performing background work");
+        return 0;
     }
+    return nextWakeEpochSeconds;
 }
 
 #pragma mark Notifications
@@ -13,6 +13,10 @@
 
 @property(nonatomic, weak) CriticalMoments *cm;
 
+// Version of the last plan applied. Appcore sends diffs against the prior plan, which we can only apply if we applied
+// that plan.
+@property(nonatomic) int64_t lastAppliedPlanVersion;
+
 @end
 
 @implementation CMNotificationHandler
@@ -26,6 +30,46 @@
 }
 
 - (void)updateNotificationPlan:(AppcoreNotificationPlan *_Nullable)plan {
+    if (!plan) {
+        return;
+    }
+    @synchronized(self) {
+        if (plan.isDiff && plan.baseVersion == self.lastAppliedPlanVersion) {
+            [self applyNotificationPlanDiff:plan];
+        } else {
+            [self syncFullNotificationPlan:plan];
+        }
+        self.lastAppliedPlanVersion = plan.version;
+    }
+}
+
+// Only the changes since the base plan, avoiding a bridge call for each unchanged notification
+- (void)applyNotificationPlanDiff:(AppcoreNotificationPlan *)plan {
+    long addedCount = plan.addedNotificationCount;
+    for (long i = 0; i < addedCount; i++) {
+        [self scheduleNotification:[plan addedNotificationAtIndex:i]];
+    }
+    // Scheduling with the same identifier replaces the pending request
+    long rescheduledCount = plan.rescheduledNotificationCount;
+    for (long i = 0; i < rescheduledCount; i++) {
+        [self scheduleNotification:[plan rescheduledNotificationAtIndex:i]];
+    }
+
+    long removedCount = plan.removedNotificationCount;
+    if (removedCount > 0) {
+        NSMutableArray<NSString *> *notifIdsToUnschedule = [[NSMutableArray alloc] init];
+        for (long i = 0; i < removedCount; i++) {
+            DatamodelNotification *notification = [plan removedNotificationAtIndex:i];
+            if (notification) {
+                [notifIdsToUnschedule addObject:[notification uniqueID]];
+            }
+        }
+        UNUserNotificationCenter *center = [UNUserNotificationCenter currentNotificationCenter];
+        [center removePendingNotificationRequestsWithIdentifiers:notifIdsToUnschedule];
+    }
+}
+
+- (void)syncFullNotificationPlan:(AppcoreNotificationPlan *)plan {
     // Schedule needed notifications
     NSMutableSet<NSString *> *scheduleNotifIds = [[NSMutableSet alloc] init];
     for (int i = 0; i < plan.scheduledNotificationCount; i++) {
@@ -72,11 +72,29 @@
 
     if (UIApplicationDidEnterBackgroundNotification == notification.name) {
         [self.cm sendEvent:DatamodelAppEnteredBackgroundBuiltInEvent builtIn:true handler:nil];
+        [self flushEvents];
     } else if (UIApplicationWillEnterForegroundNotification == notification.name) {
         [self.cm sendEvent:DatamodelAppEnteredForegroundBuiltInEvent builtIn:true handler:nil];
     } else if (UIApplicationWillTerminateNotification == notification.name) {
         [self.cm sendEvent:DatamodelAppTerminatedBuiltInEvent builtIn:true handler:nil];
+        [self flushEvents];
     }
 }
 
+// Events are processed async. Request background time so queued events are saved before we're suspended.
+- (void)flushEvents {
+    UIApplication *app = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier taskId = UIBackgroundTaskInvalid;
+    void (^endTask)(void) = ^{
+      if (taskId != UIBackgroundTaskInvalid) {
+          [app endBackgroundTask:taskId];
+          taskId = UIBackgroundTaskInvalid;
+      }
+    };
+    taskId = [app beginBackgroundTaskWithName:@"io.criticalmoments.flush_events" expirationHandler:endTask];
+    [self.cm flushEventsWithHandler:^{
+      dispatch_async(dispatch_get_main_queue(), endTask);
+    }];
+}
+
 @end